@@ -30,6 +30,8 @@
     ((void)OSAtomicAdd32Barrier(-amount, value))
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     OSAtomicCompareAndSwap32Barrier(oldValue, newValue, value)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    OSAtomicCompareAndSwap64Barrier(oldValue, newValue, value)
 
 typedef OSQueueHead xe_atomic_stack_t;
 #define xe_atomic_stack_init(stack) \
@@ -51,6 +53,8 @@ typedef OSQueueHead xe_atomic_stack_t;
     ((void)InterlockedExchangeSubtract((volatile unsigned*)value, amount))
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     (InterlockedCompareExchange((volatile LONG*)value, newValue, oldValue) == oldValue)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    (InterlockedCompareExchange64((volatile LONGLONG*)value, newValue, oldValue) == oldValue)
 
 typedef SLIST_HEADER xe_atomic_stack_t;
 #define xe_atomic_stack_init(stack) \
@@ -79,6 +83,8 @@ XEFORCEINLINE void* xe_atomic_stack_dequeue(xe_atomic_stack_t* stack,
     __sync_fetch_and_sub(value, amount)
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     __sync_bool_compare_and_swap(value, oldValue, newValue)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    __sync_bool_compare_and_swap(value, oldValue, newValue)
 
 #else
 
@@ -0,0 +1,29 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CORE_EVENT_H_
+#define XENIA_CORE_EVENT_H_
+
+#include <xenia/common.h>
+
+
+typedef struct xe_event xe_event_t;
+
+
+// Manual reset events stay set until reset. Auto reset events release a
+// single waiter and reset themselves.
+xe_event_t* xe_event_alloc(bool manual_reset);
+void xe_event_free(xe_event_t* event);
+
+int xe_event_set(xe_event_t* event);
+int xe_event_reset(xe_event_t* event);
+int xe_event_wait(xe_event_t* event);
+
+
+#endif  // XENIA_CORE_EVENT_H_
@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/core/event.h>
+
+
+struct xe_event {
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  bool            manual_reset;
+  bool            signaled;
+};
+
+xe_event_t* xe_event_alloc(bool manual_reset) {
+  xe_event_t* event = (xe_event_t*)xe_calloc(sizeof(xe_event_t));
+
+  if (pthread_mutex_init(&event->mutex, NULL)) {
+    xe_free(event);
+    return NULL;
+  }
+  if (pthread_cond_init(&event->cond, NULL)) {
+    pthread_mutex_destroy(&event->mutex);
+    xe_free(event);
+    return NULL;
+  }
+  event->manual_reset = manual_reset;
+  event->signaled = false;
+
+  return event;
+}
+
+void xe_event_free(xe_event_t* event) {
+  pthread_cond_destroy(&event->cond);
+  pthread_mutex_destroy(&event->mutex);
+  xe_free(event);
+}
+
+int xe_event_set(xe_event_t* event) {
+  pthread_mutex_lock(&event->mutex);
+  event->signaled = true;
+  if (event->manual_reset) {
+    pthread_cond_broadcast(&event->cond);
+  } else {
+    pthread_cond_signal(&event->cond);
+  }
+  pthread_mutex_unlock(&event->mutex);
+  return 0;
+}
+
+int xe_event_reset(xe_event_t* event) {
+  pthread_mutex_lock(&event->mutex);
+  event->signaled = false;
+  pthread_mutex_unlock(&event->mutex);
+  return 0;
+}
+
+int xe_event_wait(xe_event_t* event) {
+  pthread_mutex_lock(&event->mutex);
+  while (!event->signaled) {
+    pthread_cond_wait(&event->cond, &event->mutex);
+  }
+  if (!event->manual_reset) {
+    event->signaled = false;
+  }
+  pthread_mutex_unlock(&event->mutex);
+  return 0;
+}
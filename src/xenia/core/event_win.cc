@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/core/event.h>
+
+
+struct xe_event {
+  HANDLE value;
+};
+
+xe_event_t* xe_event_alloc(bool manual_reset) {
+  xe_event_t* event = (xe_event_t*)xe_calloc(sizeof(xe_event_t));
+
+  event->value = CreateEvent(NULL, manual_reset ? TRUE : FALSE, FALSE, NULL);
+  if (!event->value) {
+    xe_free(event);
+    return NULL;
+  }
+
+  return event;
+}
+
+void xe_event_free(xe_event_t* event) {
+  CloseHandle(event->value);
+  xe_free(event);
+}
+
+int xe_event_set(xe_event_t* event) {
+  return SetEvent(event->value) ? 0 : 1;
+}
+
+int xe_event_reset(xe_event_t* event) {
+  return ResetEvent(event->value) ? 0 : 1;
+}
+
+int xe_event_wait(xe_event_t* event) {
+  return WaitForSingleObject(event->value, INFINITE) == WAIT_OBJECT_0 ? 0 : 1;
+}
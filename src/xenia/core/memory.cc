@@ -39,13 +39,29 @@
  * We use the host OS to create an entire addressable range for this. That way
  * we don't have to emulate a TLB. It'd be really cool to pass through page
  * sizes or use madvice to let the OS know what to expect.
+ *
+ * The whole 4GB guest window is reserved, plus a guard region past the end
+ * for accesses that straddle the top of it. Only the ranges above are
+ * accessible - everything else, including the first page, is left
+ * inaccessible so that generated code can touch memory without any checks
+ * and have the host fault on bad addresses instead.
  */
 
+namespace {
+
+const size_t kGuestWindowLength   = 0x100000000ull;
+const size_t kGuardLength         = 64 * 1024;
+const size_t kReservedLength      = kGuestWindowLength + kGuardLength;
+const size_t kLowGuardLength      = 0x1000;
+
+}
+
 
 struct xe_memory {
   xe_ref_t ref;
 
   size_t      length;
+  size_t      reserved_length;
   void*       ptr;
 
   xe_mutex_t* heap_mutex;
@@ -61,17 +77,28 @@ xe_memory_ref xe_memory_create(xe_pal_ref pal, xe_memory_options_t options) {
   xe_ref_init((xe_ref)memory);
 
   memory->length = 0xC0000000;
+  memory->reserved_length = kReservedLength;
 
 #if XE_PLATFORM(WIN32)
-  memory->ptr = VirtualAlloc(0, memory->length,
-                             MEM_COMMIT | MEM_RESERVE,
-                             PAGE_READWRITE);
+  memory->ptr = VirtualAlloc(0, memory->reserved_length,
+                             MEM_RESERVE,
+                             PAGE_NOACCESS);
+  XEEXPECTNOTNULL(memory->ptr);
+  XEEXPECTNOTNULL(VirtualAlloc((uint8_t*)memory->ptr + kLowGuardLength,
+                               memory->length - kLowGuardLength,
+                               MEM_COMMIT,
+                               PAGE_READWRITE));
 #else
-  memory->ptr = mmap(0, memory->length, PROT_READ | PROT_WRITE,
-                     MAP_PRIVATE | MAP_ANON, -1, 0);
-  XEEXPECT(memory->ptr != MAP_FAILED);
-#endif  // WIN32
+  memory->ptr = mmap(0, memory->reserved_length, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+  if (memory->ptr == MAP_FAILED) {
+    memory->ptr = NULL;
+  }
   XEEXPECTNOTNULL(memory->ptr);
+  XEEXPECTZERO(mprotect((uint8_t*)memory->ptr + kLowGuardLength,
+                        memory->length - kLowGuardLength,
+                        PROT_READ | PROT_WRITE));
+#endif  // WIN32
 
   memory->heap_mutex = xe_mutex_alloc(0);
   XEEXPECTNOTNULL(memory->heap_mutex);
@@ -102,11 +129,13 @@ void xe_memory_dealloc(xe_memory_ref memory) {
     memory->heap_mutex = NULL;
   }
 
+  if (memory->ptr) {
 #if XE_PLATFORM(WIN32)
-  XEIGNORE(VirtualFree(memory->ptr, memory->length, MEM_RELEASE));
+    XEIGNORE(VirtualFree(memory->ptr, 0, MEM_RELEASE));
 #else
-  munmap(memory->ptr, memory->length);
+    munmap(memory->ptr, memory->reserved_length);
 #endif  // WIN32
+  }
 }
 
 xe_memory_ref xe_memory_retain(xe_memory_ref memory) {
@@ -126,6 +155,48 @@ uint8_t *xe_memory_addr(xe_memory_ref memory, size_t guest_addr) {
   return (uint8_t*)memory->ptr + guest_addr;
 }
 
+int xe_memory_get_guest_address(xe_memory_ref memory, const void* host_addr,
+                                uint32_t* out_guest_addr) {
+  uintptr_t base = (uintptr_t)memory->ptr;
+  uintptr_t p = (uintptr_t)host_addr;
+  if (p < base || p - base >= memory->reserved_length) {
+    return 1;
+  }
+  *out_guest_addr = (uint32_t)(p - base);
+  return 0;
+}
+
+int xe_memory_protect(xe_memory_ref memory, uint32_t address, uint32_t size,
+                      const xe_memory_access access) {
+  uint32_t start = address & ~0xFFF;
+  uint32_t end = (uint32_t)MIN((uint64_t)address + size + 0xFFF,
+                               (uint64_t)memory->length) & ~0xFFF;
+  if (start < kLowGuardLength || end <= start) {
+    return 1;
+  }
+  uint8_t* p = (uint8_t*)memory->ptr + start;
+
+#if XE_PLATFORM(WIN32)
+  DWORD protect = PAGE_NOACCESS;
+  if (access & kXEMemoryAccessWrite) {
+    protect = PAGE_READWRITE;
+  } else if (access & kXEMemoryAccessRead) {
+    protect = PAGE_READONLY;
+  }
+  DWORD old_protect;
+  return VirtualProtect(p, end - start, protect, &old_protect) ? 0 : 1;
+#else
+  int prot = PROT_NONE;
+  if (access & kXEMemoryAccessRead) {
+    prot |= PROT_READ;
+  }
+  if (access & kXEMemoryAccessWrite) {
+    prot |= PROT_READ | PROT_WRITE;
+  }
+  return mprotect(p, end - start, prot);
+#endif  // WIN32
+}
+
 uint32_t xe_memory_search_aligned(xe_memory_ref memory, size_t start,
                                   size_t end, const uint32_t *values,
                                   const size_t value_count) {
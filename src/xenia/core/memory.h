@@ -30,6 +30,20 @@ void xe_memory_release(xe_memory_ref memory);
 
 size_t xe_memory_get_length(xe_memory_ref memory);
 uint8_t *xe_memory_addr(xe_memory_ref memory, size_t guest_addr);
+// Maps a host pointer within the reserved guest window (including its guard
+// regions) back to the guest address. Returns non-zero if it is outside.
+int xe_memory_get_guest_address(xe_memory_ref memory, const void* host_addr,
+                                uint32_t* out_guest_addr);
+
+typedef enum {
+  kXEMemoryAccessRead   = (1 << 0),
+  kXEMemoryAccessWrite  = (1 << 1),
+} xe_memory_access;
+
+// Changes the host protection of a guest range. The range is expanded to
+// whole host pages (4k).
+int xe_memory_protect(xe_memory_ref memory, uint32_t address, uint32_t size,
+                      const xe_memory_access access);
 
 uint32_t xe_memory_search_aligned(xe_memory_ref memory, size_t start,
                                   size_t end, const uint32_t *values,
@@ -9,18 +9,76 @@
 
 #include <xenia/core/pal.h>
 
+#if XE_COMPILER(MSVC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif  // MSVC
+
 
 typedef struct xe_pal {
   xe_ref_t ref;
 
+  uint32_t processor_features;
 } xe_pal_t;
 
 
+namespace {
+
+void xe_pal_cpuid(uint32_t leaf, uint32_t regs[4]) {
+#if XE_COMPILER(MSVC)
+  __cpuid((int*)regs, (int)leaf);
+#else
+  __cpuid(leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif  // MSVC
+}
+
+uint64_t xe_pal_xgetbv() {
+#if XE_COMPILER(MSVC)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#endif  // MSVC
+}
+
+uint32_t xe_pal_detect_processor_features() {
+  uint32_t regs[4];
+  xe_pal_cpuid(0, regs);
+  if (regs[0] < 1) {
+    return 0;
+  }
+
+  xe_pal_cpuid(1, regs);
+  const uint32_t ecx = regs[2];
+  uint32_t features = 0;
+  if (ecx & (1 << 9)) {
+    features |= kXEPALProcessorFeatureSSSE3;
+  }
+  if (ecx & (1 << 19)) {
+    features |= kXEPALProcessorFeatureSSE41;
+  }
+  // AVX (and F16C, which uses the VEX encoding) also need the OS to save the
+  // YMM state on context switches.
+  if ((ecx & (1 << 27)) && (ecx & (1 << 28)) &&
+      (xe_pal_xgetbv() & 0x6) == 0x6) {
+    features |= kXEPALProcessorFeatureAVX;
+    if (ecx & (1 << 29)) {
+      features |= kXEPALProcessorFeatureF16C;
+    }
+  }
+  return features;
+}
+
+}
+
+
 xe_pal_ref xe_pal_create(xe_pal_options_t options) {
   xe_pal_ref pal = (xe_pal_ref)xe_calloc(sizeof(xe_pal_t));
   xe_ref_init((xe_ref)pal);
 
-  //
+  pal->processor_features = xe_pal_detect_processor_features();
 
   return pal;
 }
@@ -37,3 +95,24 @@ xe_pal_ref xe_pal_retain(xe_pal_ref pal) {
 void xe_pal_release(xe_pal_ref pal) {
   xe_ref_release((xe_ref)pal, (xe_ref_dealloc_t)xe_pal_dealloc);
 }
+
+#if XE_PLATFORM(WIN32)
+
+uint32_t xe_pal_get_processor_count(xe_pal_ref pal) {
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  return (uint32_t)system_info.dwNumberOfProcessors;
+}
+
+#else
+
+uint32_t xe_pal_get_processor_count(xe_pal_ref pal) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+}
+
+#endif  // WIN32
+
+uint32_t xe_pal_get_processor_features(xe_pal_ref pal) {
+  return pal->processor_features;
+}
@@ -27,5 +27,18 @@ xe_pal_ref xe_pal_create(xe_pal_options_t options);
 xe_pal_ref xe_pal_retain(xe_pal_ref pal);
 void xe_pal_release(xe_pal_ref pal);
 
+typedef enum {
+  kXEPALProcessorFeatureSSSE3   = (1 << 0),
+  kXEPALProcessorFeatureSSE41   = (1 << 1),
+  kXEPALProcessorFeatureAVX     = (1 << 2),
+  kXEPALProcessorFeatureF16C    = (1 << 3),
+} xe_pal_processor_feature_e;
+
+
+uint32_t xe_pal_get_processor_count(xe_pal_ref pal);
+// Instruction set extensions beyond SSE2 that the host processor and OS
+// support, as a mask of xe_pal_processor_feature_e.
+uint32_t xe_pal_get_processor_features(xe_pal_ref pal);
+
 
 #endif  // XENIA_CORE_PAL_H_
@@ -105,6 +105,10 @@ int xe_thread_start(xe_thread_ref thread) {
   return 0;
 }
 
+void xe_thread_sleep(uint32_t milliseconds) {
+  Sleep(milliseconds);
+}
+
 #else
 
 static void* xe_thread_callback_pthreads(void* param) {
@@ -138,4 +142,8 @@ int xe_thread_start(xe_thread_ref thread) {
   return 0;
 }
 
+void xe_thread_sleep(uint32_t milliseconds) {
+  usleep(milliseconds * 1000);
+}
+
 #endif  // WIN32
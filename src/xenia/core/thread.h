@@ -29,5 +29,7 @@ void xe_thread_release(xe_thread_ref thread);
 
 int xe_thread_start(xe_thread_ref thread);
 
+void xe_thread_sleep(uint32_t milliseconds);
+
 
 #endif  // XENIA_CORE_THREAD_H_
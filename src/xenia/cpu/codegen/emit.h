@@ -19,6 +19,7 @@ namespace codegen {
 
 
 void RegisterEmitCategoryALU();
+void RegisterEmitCategoryAltivec();
 void RegisterEmitCategoryControl();
 void RegisterEmitCategoryFPU();
 void RegisterEmitCategoryMemory();
@@ -0,0 +1,2149 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/codegen/emit.h>
+
+#include <llvm/IR/Intrinsics.h>
+
+#include <xenia/cpu/codegen/function_generator.h>
+
+
+using namespace llvm;
+using namespace xe::cpu::codegen;
+using namespace xe::cpu::ppc;
+
+
+namespace xe {
+namespace cpu {
+namespace codegen {
+
+
+// The VMX128 forms split their 7-bit register numbers across the word.
+#define VX128_VD128   (i.VX128.VD128l | (i.VX128.VD128h << 5))
+#define VX128_VA128   (i.VX128.VA128l | (i.VX128.VA128h << 5) | \
+                       (i.VX128.VA128H << 6))
+#define VX128_VB128   (i.VX128.VB128l | (i.VX128.VB128h << 5))
+#define VX128_1_VD128 (i.VX128_1.VD128l | (i.VX128_1.VD128h << 5))
+#define VX128_R_VD128 (i.VX128_R.VD128l | (i.VX128_R.VD128h << 5))
+#define VX128_R_VA128 (i.VX128_R.VA128l | (i.VX128_R.VA128h << 5) | \
+                       (i.VX128_R.VA128H << 6))
+#define VX128_R_VB128 (i.VX128_R.VB128l | (i.VX128_R.VB128h << 5))
+
+
+// Vector registers are held as <4 x float> with word 0 in element 0 and
+// each word in host byte order. Memory is big-endian, so 16 byte accesses
+// go through a byte swapped i128 (guest byte 0 in the high bits) and the
+// words are put back in element order. LLVM folds the swap and the shuffle
+// into a single byte shuffle.
+
+Value* XeVectorFromMemory(IRBuilder<>& b, Value* v) {
+  Type* wordsTy = VectorType::get(b.getInt32Ty(), 4);
+  uint32_t indices[] = { 3, 2, 1, 0 };
+  v = b.CreateBitCast(v, wordsTy);
+  v = b.CreateShuffleVector(v, UndefValue::get(wordsTy),
+                            ConstantDataVector::get(b.getContext(), indices));
+  return b.CreateBitCast(v, VectorType::get(b.getFloatTy(), 4));
+}
+
+Value* XeVectorToMemory(IRBuilder<>& b, Value* v) {
+  Type* wordsTy = VectorType::get(b.getInt32Ty(), 4);
+  uint32_t indices[] = { 3, 2, 1, 0 };
+  v = b.CreateBitCast(v, wordsTy);
+  v = b.CreateShuffleVector(v, UndefValue::get(wordsTy),
+                            ConstantDataVector::get(b.getContext(), indices));
+  return b.CreateBitCast(v, b.getIntNTy(128));
+}
+
+Value* XeVectorAsInt(IRBuilder<>& b, Value* v, uint32_t bits) {
+  return b.CreateBitCast(v, VectorType::get(b.getIntNTy(bits), 128 / bits));
+}
+
+Value* XeVectorSplat(IRBuilder<>& b, Value* v, uint32_t count) {
+  Type* vecTy = VectorType::get(v->getType(), count);
+  v = b.CreateInsertElement(UndefValue::get(vecTy), v, b.getInt32(0));
+  return b.CreateShuffleVector(
+      v, UndefValue::get(vecTy),
+      ConstantAggregateZero::get(VectorType::get(b.getInt32Ty(), count)));
+}
+
+Value* XeVectorEA(FunctionGenerator& g, IRBuilder<>& b,
+                  uint32_t ra, uint32_t rb) {
+  // EA <- (RA|0) + (RB)
+  Value* ea = g.gpr_value(rb);
+  if (ra) {
+    ea = b.CreateAdd(g.gpr_value(ra), ea);
+  }
+  return ea;
+}
+
+
+// Disassembly shared by the VMX and VMX128 forms.
+
+int XeDisasmVectorMemory(InstrDisasm& d, const char* name, const char* info,
+                         uint32_t vd, uint32_t ra, uint32_t rb,
+                         bool is_store) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd,
+                  is_store ? InstrRegister::kRead : InstrRegister::kWrite);
+  if (ra) {
+    d.AddRegOperand(InstrRegister::kGPR, ra, InstrRegister::kRead);
+  } else {
+    d.AddUImmOperand(0, 1);
+  }
+  d.AddRegOperand(InstrRegister::kGPR, rb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVectorOp(InstrDisasm& d, const char* name, const char* info,
+                     uint32_t vd, uint32_t va, uint32_t vb,
+                     bool reads_vd = false) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd,
+                  reads_vd ? InstrRegister::kReadWrite : InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVectorOp3(InstrDisasm& d, const char* name, const char* info,
+                      uint32_t vd, uint32_t va, uint32_t vb, uint32_t vc) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vc, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVectorCompare(InstrDisasm& d, const char* name, const char* info,
+                          uint32_t vd, uint32_t va, uint32_t vb, bool rc) {
+  // Rc updates CR6, not CR0, so it can't use the kRc flag.
+  d.Init(rc ? std::string(name) + "." : name, info, 0);
+  if (rc) {
+    d.AddCR(6, InstrRegister::kWrite);
+  }
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+
+// Vector load/store (VMX and VMX128)
+
+int XeEmitLoadVector(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                     uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- ((RA|0) + (RB)) & ~0xF
+  // VD <- MEM(EA, 16)
+
+  Value* ea = b.CreateAnd(XeVectorEA(g, b, ra, rb), ~0xFull);
+  Value* v = g.ReadMemory(i.address, ea, 16, false);
+  g.update_vmx_value(vd, XeVectorFromMemory(b, v));
+
+  return 0;
+}
+
+int XeEmitStoreVector(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                      uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- ((RA|0) + (RB)) & ~0xF
+  // MEM(EA, 16) <- (VS)
+
+  Value* ea = b.CreateAnd(XeVectorEA(g, b, ra, rb), ~0xFull);
+  g.WriteMemory(i.address, ea, 16, XeVectorToMemory(b, g.vmx_value(vd)));
+
+  return 0;
+}
+
+int XeEmitLoadVectorLeft(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                         uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- (RA|0) + (RB)
+  // eb <- EA & 0xF
+  // VD <- MEM(EA, 16 - eb) || 0s
+  // The load never crosses the 16 byte block EA is in.
+
+  Value* ea = XeVectorEA(g, b, ra, rb);
+  Value* eb = b.CreateAnd(ea, 0xF);
+  Value* v = g.ReadMemory(i.address, b.CreateAnd(ea, ~0xFull), 16, false);
+  v = b.CreateShl(v, b.CreateZExt(b.CreateShl(eb, 3), v->getType()));
+  g.update_vmx_value(vd, XeVectorFromMemory(b, v));
+
+  return 0;
+}
+
+int XeEmitLoadVectorRight(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                          uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- (RA|0) + (RB)
+  // eb <- EA & 0xF
+  // VD <- 0s || MEM(EA - eb, eb)
+  // Nothing is loaded if EA is aligned.
+
+  Value* ea = XeVectorEA(g, b, ra, rb);
+  Value* eb = b.CreateAnd(ea, 0xF);
+  Value* v = g.ReadMemory(i.address, b.CreateAnd(ea, ~0xFull), 16, false);
+  Value* shift = b.CreateAnd(b.CreateShl(b.CreateSub(b.getInt64(16), eb), 3),
+                             127);
+  v = b.CreateLShr(v, b.CreateZExt(shift, v->getType()));
+  v = b.CreateSelect(b.CreateICmpEQ(eb, b.getInt64(0)),
+                     ConstantInt::get(v->getType(), 0), v);
+  g.update_vmx_value(vd, XeVectorFromMemory(b, v));
+
+  return 0;
+}
+
+int XeEmitStoreVectorLeft(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                          uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- (RA|0) + (RB)
+  // eb <- EA & 0xF
+  // MEM(EA, 16 - eb) <- (VS)[0:16 - eb]
+  // The bytes before EA in the block are left as they were.
+
+  Value* ea = XeVectorEA(g, b, ra, rb);
+  Value* eb = b.CreateAnd(ea, 0xF);
+  ea = b.CreateAnd(ea, ~0xFull);
+  Value* v = XeVectorToMemory(b, g.vmx_value(vd));
+  Value* shift = b.CreateZExt(b.CreateShl(eb, 3), v->getType());
+  Value* mask = b.CreateLShr(Constant::getAllOnesValue(v->getType()), shift);
+  v = b.CreateLShr(v, shift);
+  Value* old_v = g.ReadMemory(i.address, ea, 16, false);
+  v = b.CreateOr(b.CreateAnd(old_v, b.CreateNot(mask)),
+                 b.CreateAnd(v, mask));
+  g.WriteMemory(i.address, ea, 16, v);
+
+  return 0;
+}
+
+int XeEmitStoreVectorRight(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                           uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- (RA|0) + (RB)
+  // eb <- EA & 0xF
+  // MEM(EA - eb, eb) <- (VS)[16 - eb:16]
+  // Nothing is stored if EA is aligned.
+
+  Value* ea = XeVectorEA(g, b, ra, rb);
+  Value* eb = b.CreateAnd(ea, 0xF);
+  ea = b.CreateAnd(ea, ~0xFull);
+  Value* v = XeVectorToMemory(b, g.vmx_value(vd));
+  Value* shift = b.CreateAnd(b.CreateShl(b.CreateSub(b.getInt64(16), eb), 3),
+                             127);
+  shift = b.CreateZExt(shift, v->getType());
+  Value* mask = b.CreateSelect(
+      b.CreateICmpEQ(eb, b.getInt64(0)),
+      ConstantInt::get(v->getType(), 0),
+      b.CreateShl(Constant::getAllOnesValue(v->getType()), shift));
+  v = b.CreateShl(v, shift);
+  Value* old_v = g.ReadMemory(i.address, ea, 16, false);
+  v = b.CreateOr(b.CreateAnd(old_v, b.CreateNot(mask)),
+                 b.CreateAnd(v, mask));
+  g.WriteMemory(i.address, ea, 16, v);
+
+  return 0;
+}
+
+XEDISASMR(lvx,          0x7C0000CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvx", "Load Vector Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvx,          0x7C0000CE, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVector(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvx128,       0x100000C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvx128", "Load Vector128 Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvx128,       0x100000C3, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVector(g, b, i,
+                          VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(lvxl,         0x7C0002CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvxl", "Load Vector Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvxl,         0x7C0002CE, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVector(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvxl128,      0x100002C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvxl128", "Load Vector128 Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvxl128,      0x100002C3, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVector(g, b, i,
+                          VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvx,         0x7C0001CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvx", "Store Vector Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvx,         0x7C0001CE, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVector(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvx128,      0x100001C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvx128", "Store Vector128 Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvx128,      0x100001C3, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVector(g, b, i,
+                           VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvxl,        0x7C0003CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvxl", "Store Vector Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvxl,        0x7C0003CE, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVector(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvxl128,     0x100003C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvxl128", "Store Vector128 Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvxl128,     0x100003C3, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVector(g, b, i,
+                           VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(lvlx,         0x7C00040E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlx", "Load Vector Left Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvlx,         0x7C00040E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorLeft(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvlx128,      0x10000403, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlx128", "Load Vector128 Left Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvlx128,      0x10000403, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorLeft(g, b, i,
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(lvlxl,        0x7C00060E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlxl", "Load Vector Left Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvlxl,        0x7C00060E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorLeft(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvlxl128,     0x10000603, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlxl128",
+                              "Load Vector128 Left Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvlxl128,     0x10000603, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorLeft(g, b, i,
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(lvrx,         0x7C00044E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrx", "Load Vector Right Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvrx,         0x7C00044E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorRight(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvrx128,      0x10000443, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrx128", "Load Vector128 Right Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvrx128,      0x10000443, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorRight(g, b, i,
+                               VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(lvrxl,        0x7C00064E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrxl", "Load Vector Right Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvrxl,        0x7C00064E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorRight(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(lvrxl128,     0x10000643, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrxl128",
+                              "Load Vector128 Right Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvrxl128,     0x10000643, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorRight(g, b, i,
+                               VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvlx,        0x7C00050E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlx", "Store Vector Left Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvlx,        0x7C00050E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorLeft(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvlx128,     0x10000503, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlx128", "Store Vector128 Left Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvlx128,     0x10000503, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorLeft(g, b, i,
+                               VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvlxl,       0x7C00070E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlxl", "Store Vector Left Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvlxl,       0x7C00070E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorLeft(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvlxl128,    0x10000703, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlxl128",
+                              "Store Vector128 Left Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvlxl128,    0x10000703, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorLeft(g, b, i,
+                               VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvrx,        0x7C00054E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrx", "Store Vector Right Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvrx,        0x7C00054E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorRight(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvrx128,     0x10000543, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrx128", "Store Vector128 Right Indexed",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvrx128,     0x10000543, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorRight(g, b, i,
+                                VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEDISASMR(stvrxl,       0x7C00074E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrxl", "Store Vector Right Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, true);
+}
+XEEMITTER(stvrxl,       0x7C00074E, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorRight(g, b, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEDISASMR(stvrxl128,    0x10000743, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrxl128",
+                              "Store Vector128 Right Indexed LRU",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              true);
+}
+XEEMITTER(stvrxl128,    0x10000743, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitStoreVectorRight(g, b, i,
+                                VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB);
+}
+
+
+// Vector floating-point arithmetic
+
+XEDISASMR(vaddfp,       0x1000000A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vaddfp", "Vector Add Floating Point",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vaddfp,       0x1000000A, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) + (VB)
+  g.update_vmx_value(i.VX.VD, b.CreateFAdd(g.vmx_value(i.VX.VA),
+                                           g.vmx_value(i.VX.VB)));
+  return 0;
+}
+
+XEDISASMR(vaddfp128,    0x14000010, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vaddfp128", "Vector128 Add Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vaddfp128,    0x14000010, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) + (VB)
+  g.update_vmx_value(VX128_VD128, b.CreateFAdd(g.vmx_value(VX128_VA128),
+                                               g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+XEDISASMR(vsubfp,       0x1000004A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsubfp", "Vector Subtract Floating Point",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsubfp,       0x1000004A, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) - (VB)
+  g.update_vmx_value(i.VX.VD, b.CreateFSub(g.vmx_value(i.VX.VA),
+                                           g.vmx_value(i.VX.VB)));
+  return 0;
+}
+
+XEDISASMR(vsubfp128,    0x14000050, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsubfp128",
+                          "Vector128 Subtract Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vsubfp128,    0x14000050, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) - (VB)
+  g.update_vmx_value(VX128_VD128, b.CreateFSub(g.vmx_value(VX128_VA128),
+                                               g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+XEDISASMR(vmulfp128,    0x14000090, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmulfp128", "Vector128 Multiply Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmulfp128,    0x14000090, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) * (VB)
+  g.update_vmx_value(VX128_VD128, b.CreateFMul(g.vmx_value(VX128_VA128),
+                                               g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+Value* XeEmitVectorMulAdd(FunctionGenerator& g, IRBuilder<>& b,
+                          Value* va, Value* vb, Value* vc) {
+  // (VA) * (VB) + (VC)
+  // llvm.fmuladd lets the backend fuse this where the host can.
+  Function* fmuladd = Intrinsic::getDeclaration(
+      g.gen_module(), Intrinsic::fmuladd, va->getType());
+  return b.CreateCall3(fmuladd, va, vb, vc);
+}
+
+XEDISASMR(vmaddfp,      0x1000002E, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp3(d, "vmaddfp",
+                           "Vector Multiply-Add Floating Point",
+                           i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB);
+}
+XEEMITTER(vmaddfp,      0x1000002E, VA )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ((VA) * (VC)) + (VB)
+  g.update_vmx_value(i.VA.VD, XeEmitVectorMulAdd(
+      g, b, g.vmx_value(i.VA.VA), g.vmx_value(i.VA.VC),
+      g.vmx_value(i.VA.VB)));
+  return 0;
+}
+
+XEDISASMR(vmaddfp128,   0x140000D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaddfp128",
+                          "Vector128 Multiply Add Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128, true);
+}
+XEEMITTER(vmaddfp128,   0x140000D0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ((VA) * (VB)) + (VD)
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMulAdd(
+      g, b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128),
+      g.vmx_value(VX128_VD128)));
+  return 0;
+}
+
+XEDISASMR(vmaddcfp128,  0x14000110, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaddcfp128",
+                          "Vector128 Multiply Add Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128, true);
+}
+XEEMITTER(vmaddcfp128,  0x14000110, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ((VA) * (VD)) + (VB)
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMulAdd(
+      g, b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VD128),
+      g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+XEDISASMR(vnmsubfp,     0x1000002F, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp3(d, "vnmsubfp",
+                           "Vector Negative Multiply-Subtract Floating Point",
+                           i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB);
+}
+XEEMITTER(vnmsubfp,     0x1000002F, VA )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- -(((VA) * (VC)) - (VB))
+  Value* v = XeEmitVectorMulAdd(
+      g, b, g.vmx_value(i.VA.VA), g.vmx_value(i.VA.VC),
+      b.CreateFNeg(g.vmx_value(i.VA.VB)));
+  g.update_vmx_value(i.VA.VD, b.CreateFNeg(v));
+  return 0;
+}
+
+XEDISASMR(vnmsubfp128,  0x14000150, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vnmsubfp128",
+                          "Vector128 Negative Multiply-Subtract "
+                          "Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128, true);
+}
+XEEMITTER(vnmsubfp128,  0x14000150, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- -(((VA) * (VB)) - (VD))
+  Value* v = XeEmitVectorMulAdd(
+      g, b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128),
+      b.CreateFNeg(g.vmx_value(VX128_VD128)));
+  g.update_vmx_value(VX128_VD128, b.CreateFNeg(v));
+  return 0;
+}
+
+XEDISASMR(vmsum3fp128,  0x14000190, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmsum3fp128",
+                          "Vector128 Multiply Sum 3-way Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmsum3fp128,  0x14000190, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // Dot product XYZ.
+  // (VD.xyzw) = (VA.x * VB.x) + (VA.y * VB.y) + (VA.z * VB.z)
+  Value* v = b.CreateFMul(g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128));
+  Value* sum = b.CreateFAdd(b.CreateExtractElement(v, b.getInt32(0)),
+                            b.CreateExtractElement(v, b.getInt32(1)));
+  sum = b.CreateFAdd(sum, b.CreateExtractElement(v, b.getInt32(2)));
+  g.update_vmx_value(VX128_VD128, XeVectorSplat(b, sum, 4));
+  return 0;
+}
+
+XEDISASMR(vmsum4fp128,  0x140001D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmsum4fp128",
+                          "Vector128 Multiply Sum 4-way Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmsum4fp128,  0x140001D0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // Dot product XYZW.
+  // (VD.xyzw) = (VA.x * VB.x) + (VA.y * VB.y) + (VA.z * VB.z) + (VA.w * VB.w)
+  Value* v = b.CreateFMul(g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128));
+  Value* sum = b.CreateFAdd(
+      b.CreateFAdd(b.CreateExtractElement(v, b.getInt32(0)),
+                   b.CreateExtractElement(v, b.getInt32(1))),
+      b.CreateFAdd(b.CreateExtractElement(v, b.getInt32(2)),
+                   b.CreateExtractElement(v, b.getInt32(3))));
+  g.update_vmx_value(VX128_VD128, XeVectorSplat(b, sum, 4));
+  return 0;
+}
+
+Value* XeEmitVectorMax(IRBuilder<>& b, Value* va, Value* vb) {
+  return b.CreateSelect(b.CreateFCmpOGT(va, vb), va, vb);
+}
+
+Value* XeEmitVectorMin(IRBuilder<>& b, Value* va, Value* vb) {
+  return b.CreateSelect(b.CreateFCmpOLT(va, vb), va, vb);
+}
+
+XEDISASMR(vmaxfp,       0x1000040A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaxfp", "Vector Maximum Floating Point",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmaxfp,       0x1000040A, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- max((VA), (VB))
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMax(b, g.vmx_value(i.VX.VA),
+                                              g.vmx_value(i.VX.VB)));
+  return 0;
+}
+
+XEDISASMR(vmaxfp128,    0x18000280, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaxfp128", "Vector128 Maximum Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmaxfp128,    0x18000280, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- max((VA), (VB))
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMax(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+XEDISASMR(vminfp,       0x1000044A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vminfp", "Vector Minimum Floating Point",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vminfp,       0x1000044A, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- min((VA), (VB))
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMin(b, g.vmx_value(i.VX.VA),
+                                              g.vmx_value(i.VX.VB)));
+  return 0;
+}
+
+XEDISASMR(vminfp128,    0x180002C0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vminfp128", "Vector128 Minimum Floating Point",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vminfp128,    0x180002C0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- min((VA), (VB))
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMin(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+
+// Vector logical
+
+XEDISASMR(vand,         0x10000404, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vand", "Vector Logical AND",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vand,         0x10000404, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) & (VB)
+  g.update_vmx_value(i.VX.VD, b.CreateAnd(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32)));
+  return 0;
+}
+
+XEDISASMR(vand128,      0x14000210, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vand128", "Vector128 Logical AND",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vand128,      0x14000210, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) & (VB)
+  g.update_vmx_value(VX128_VD128, b.CreateAnd(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeVectorAsInt(b, g.vmx_value(VX128_VB128), 32)));
+  return 0;
+}
+
+XEDISASMR(vandc,        0x10000444, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vandc", "Vector Logical AND with Complement",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vandc,        0x10000444, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) & ¬(VB)
+  g.update_vmx_value(i.VX.VD, b.CreateAnd(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      b.CreateNot(XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32))));
+  return 0;
+}
+
+XEDISASMR(vandc128,     0x14000250, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vandc128",
+                          "Vector128 Logical AND with Complement",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vandc128,     0x14000250, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) & ¬(VB)
+  g.update_vmx_value(VX128_VD128, b.CreateAnd(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      b.CreateNot(XeVectorAsInt(b, g.vmx_value(VX128_VB128), 32))));
+  return 0;
+}
+
+XEDISASMR(vnor,         0x10000504, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vnor", "Vector Logical NOR",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vnor,         0x10000504, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ¬((VA) | (VB))
+  g.update_vmx_value(i.VX.VD, b.CreateNot(b.CreateOr(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32))));
+  return 0;
+}
+
+XEDISASMR(vnor128,      0x14000290, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vnor128", "Vector128 Logical NOR",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vnor128,      0x14000290, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ¬((VA) | (VB))
+  g.update_vmx_value(VX128_VD128, b.CreateNot(b.CreateOr(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeVectorAsInt(b, g.vmx_value(VX128_VB128), 32))));
+  return 0;
+}
+
+XEDISASMR(vor,          0x10000484, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vor", "Vector Logical OR",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vor,          0x10000484, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) | (VB)
+  // vor vd, va, va is the vector move.
+  if (i.VX.VA == i.VX.VB) {
+    g.update_vmx_value(i.VX.VD, g.vmx_value(i.VX.VA));
+    return 0;
+  }
+  g.update_vmx_value(i.VX.VD, b.CreateOr(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32)));
+  return 0;
+}
+
+XEDISASMR(vor128,       0x140002D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vor128", "Vector128 Logical OR",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vor128,       0x140002D0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) | (VB)
+  if (VX128_VA128 == VX128_VB128) {
+    g.update_vmx_value(VX128_VD128, g.vmx_value(VX128_VA128));
+    return 0;
+  }
+  g.update_vmx_value(VX128_VD128, b.CreateOr(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeVectorAsInt(b, g.vmx_value(VX128_VB128), 32)));
+  return 0;
+}
+
+XEDISASMR(vxor,         0x100004C4, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vxor", "Vector Logical XOR",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vxor,         0x100004C4, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) ^ (VB)
+  g.update_vmx_value(i.VX.VD, b.CreateXor(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32)));
+  return 0;
+}
+
+XEDISASMR(vxor128,      0x14000310, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vxor128", "Vector128 Logical XOR",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vxor128,      0x14000310, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- (VA) ^ (VB)
+  g.update_vmx_value(VX128_VD128, b.CreateXor(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeVectorAsInt(b, g.vmx_value(VX128_VB128), 32)));
+  return 0;
+}
+
+Value* XeEmitVectorSelect(IRBuilder<>& b, Value* va, Value* vb, Value* vc) {
+  // (VA) & ¬(VC) | (VB) & (VC)
+  va = XeVectorAsInt(b, va, 32);
+  vb = XeVectorAsInt(b, vb, 32);
+  vc = XeVectorAsInt(b, vc, 32);
+  return b.CreateOr(b.CreateAnd(va, b.CreateNot(vc)), b.CreateAnd(vb, vc));
+}
+
+XEDISASMR(vsel,         0x1000002A, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp3(d, "vsel", "Vector Conditional Select",
+                           i.VA.VD, i.VA.VA, i.VA.VB, i.VA.VC);
+}
+XEEMITTER(vsel,         0x1000002A, VA )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ((VA) & ¬(VC)) | ((VB) & (VC))
+  g.update_vmx_value(i.VA.VD, XeEmitVectorSelect(
+      b, g.vmx_value(i.VA.VA), g.vmx_value(i.VA.VB), g.vmx_value(i.VA.VC)));
+  return 0;
+}
+
+XEDISASMR(vsel128,      0x14000350, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsel128", "Vector128 Conditional Select",
+                          VX128_VD128, VX128_VA128, VX128_VB128, true);
+}
+XEEMITTER(vsel128,      0x14000350, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // (VD) <- ((VA) & ¬(VD)) | ((VB) & (VD))
+  g.update_vmx_value(VX128_VD128, XeEmitVectorSelect(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128),
+      g.vmx_value(VX128_VD128)));
+  return 0;
+}
+
+
+// Vector integer arithmetic
+
+XEDISASMR(vaddubm,      0x10000000, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vaddubm", "Vector Add Unsigned Byte Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vaddubm,      0x10000000, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateAdd(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 8),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 8)));
+  return 0;
+}
+
+XEDISASMR(vadduhm,      0x10000040, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vadduhm", "Vector Add Unsigned Half Word Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vadduhm,      0x10000040, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateAdd(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 16),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 16)));
+  return 0;
+}
+
+XEDISASMR(vadduwm,      0x10000080, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vadduwm", "Vector Add Unsigned Word Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vadduwm,      0x10000080, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateAdd(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32)));
+  return 0;
+}
+
+XEDISASMR(vsububm,      0x10000400, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsububm",
+                          "Vector Subtract Unsigned Byte Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsububm,      0x10000400, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateSub(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 8),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 8)));
+  return 0;
+}
+
+XEDISASMR(vsubuhm,      0x10000440, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsubuhm",
+                          "Vector Subtract Unsigned Half Word Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsubuhm,      0x10000440, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateSub(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 16),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 16)));
+  return 0;
+}
+
+XEDISASMR(vsubuwm,      0x10000480, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsubuwm",
+                          "Vector Subtract Unsigned Word Modulo",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsubuwm,      0x10000480, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateSub(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32)));
+  return 0;
+}
+
+XEDISASMR(vmaxsw,       0x10000182, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaxsw", "Vector Maximum Signed Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmaxsw,       0x10000182, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  Value* va = XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32);
+  Value* vb = XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32);
+  g.update_vmx_value(i.VX.VD,
+                     b.CreateSelect(b.CreateICmpSGT(va, vb), va, vb));
+  return 0;
+}
+
+XEDISASMR(vmaxuw,       0x10000082, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmaxuw", "Vector Maximum Unsigned Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmaxuw,       0x10000082, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  Value* va = XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32);
+  Value* vb = XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32);
+  g.update_vmx_value(i.VX.VD,
+                     b.CreateSelect(b.CreateICmpUGT(va, vb), va, vb));
+  return 0;
+}
+
+XEDISASMR(vminsw,       0x10000382, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vminsw", "Vector Minimum Signed Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vminsw,       0x10000382, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  Value* va = XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32);
+  Value* vb = XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32);
+  g.update_vmx_value(i.VX.VD,
+                     b.CreateSelect(b.CreateICmpSLT(va, vb), va, vb));
+  return 0;
+}
+
+XEDISASMR(vminuw,       0x10000282, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vminuw", "Vector Minimum Unsigned Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vminuw,       0x10000282, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  Value* va = XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32);
+  Value* vb = XeVectorAsInt(b, g.vmx_value(i.VX.VB), 32);
+  g.update_vmx_value(i.VX.VD,
+                     b.CreateSelect(b.CreateICmpULT(va, vb), va, vb));
+  return 0;
+}
+
+
+// Vector shift/rotate
+// Only the low 5 bits of each word of (VB) are used as the shift count.
+
+Value* XeEmitVectorShiftCount(IRBuilder<>& b, Value* vb) {
+  vb = XeVectorAsInt(b, vb, 32);
+  return b.CreateAnd(vb, XeVectorSplat(b, b.getInt32(31), 4));
+}
+
+Value* XeEmitVectorRotate(IRBuilder<>& b, Value* va, Value* vb) {
+  // (VA) <<< ((VB) & 31), per word.
+  va = XeVectorAsInt(b, va, 32);
+  Value* sh = XeEmitVectorShiftCount(b, vb);
+  Value* rsh = b.CreateAnd(b.CreateSub(XeVectorSplat(b, b.getInt32(32), 4), sh),
+                           XeVectorSplat(b, b.getInt32(31), 4));
+  return b.CreateOr(b.CreateShl(va, sh), b.CreateLShr(va, rsh));
+}
+
+XEDISASMR(vrlw,         0x10000084, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vrlw", "Vector Rotate Left Integer Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vrlw,         0x10000084, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorRotate(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB)));
+  return 0;
+}
+
+XEDISASMR(vrlw128,      0x18000050, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vrlw128", "Vector128 Rotate Left Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vrlw128,      0x18000050, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, XeEmitVectorRotate(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128)));
+  return 0;
+}
+
+XEDISASMR(vslw,         0x10000184, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vslw", "Vector Shift Left Integer Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vslw,         0x10000184, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateShl(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(i.VX.VB))));
+  return 0;
+}
+
+XEDISASMR(vslw128,      0x180000D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vslw128", "Vector128 Shift Left Integer Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vslw128,      0x180000D0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, b.CreateShl(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(VX128_VB128))));
+  return 0;
+}
+
+XEDISASMR(vsrw,         0x10000284, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsrw", "Vector Shift Right Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsrw,         0x10000284, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateLShr(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(i.VX.VB))));
+  return 0;
+}
+
+XEDISASMR(vsrw128,      0x180001D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsrw128", "Vector128 Shift Right Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vsrw128,      0x180001D0, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, b.CreateLShr(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(VX128_VB128))));
+  return 0;
+}
+
+XEDISASMR(vsraw,        0x10000384, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsraw", "Vector Shift Right Algebraic Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vsraw,        0x10000384, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, b.CreateAShr(
+      XeVectorAsInt(b, g.vmx_value(i.VX.VA), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(i.VX.VB))));
+  return 0;
+}
+
+XEDISASMR(vsraw128,     0x18000150, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vsraw128",
+                          "Vector128 Shift Right Arithmetic Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vsraw128,     0x18000150, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, b.CreateAShr(
+      XeVectorAsInt(b, g.vmx_value(VX128_VA128), 32),
+      XeEmitVectorShiftCount(b, g.vmx_value(VX128_VB128))));
+  return 0;
+}
+
+
+// Vector compare
+
+int XeEmitVectorCompare(FunctionGenerator& g, IRBuilder<>& b,
+                        uint32_t vd, Value* cmp, bool rc) {
+  // Each element is set to all 1s where the compare is true.
+  VectorType* cmpTy = cast<VectorType>(cmp->getType());
+  uint32_t count = cmpTy->getNumElements();
+  Value* v = b.CreateSExt(
+      cmp, VectorType::get(b.getIntNTy(128 / count), count));
+  g.update_vmx_value(vd, v);
+
+  if (rc) {
+    // CR6 <- all true || 0b0 || all false || 0b0
+    Value* bits = b.CreateBitCast(v, b.getIntNTy(128));
+    Value* all_true = b.CreateICmpEQ(
+        bits, Constant::getAllOnesValue(bits->getType()));
+    Value* all_false = b.CreateICmpEQ(
+        bits, ConstantInt::get(bits->getType(), 0));
+    Value* cr = b.CreateOr(
+        b.CreateZExt(all_true, b.getInt8Ty()),
+        b.CreateShl(b.CreateZExt(all_false, b.getInt8Ty()), 2));
+    g.update_cr_value(6, cr);
+  }
+
+  return 0;
+}
+
+XEDISASMR(vcmpequb,     0x10000006, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpequb",
+                               "Vector Compare Equal-to Unsigned Byte",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpequb,     0x10000006, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpEQ(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 8),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 8)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpequh,     0x10000046, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpequh",
+                               "Vector Compare Equal-to Unsigned Half Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpequh,     0x10000046, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpEQ(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 16),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 16)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpequw,     0x10000086, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpequw",
+                               "Vector Compare Equal-to Unsigned Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpequw,     0x10000086, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpEQ(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 32)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpequw128,  0x18000200, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpequw128",
+                               "Vector128 Compare Equal-to Unsigned Word",
+                               VX128_R_VD128, VX128_R_VA128, VX128_R_VB128,
+                               i.VX128_R.Rc);
+}
+XEEMITTER(vcmpequw128,  0x18000200, VX128_R)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, VX128_R_VD128, b.CreateICmpEQ(
+      XeVectorAsInt(b, g.vmx_value(VX128_R_VA128), 32),
+      XeVectorAsInt(b, g.vmx_value(VX128_R_VB128), 32)), i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpgtub,     0x10000206, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtub",
+                               "Vector Compare Greater-Than Unsigned Byte",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtub,     0x10000206, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpUGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 8),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 8)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtuh,     0x10000246, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtuh",
+                               "Vector Compare Greater-Than Unsigned "
+                               "Half Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtuh,     0x10000246, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpUGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 16),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 16)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtuw,     0x10000286, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtuw",
+                               "Vector Compare Greater-Than Unsigned Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtuw,     0x10000286, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpUGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 32)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtsb,     0x10000306, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtsb",
+                               "Vector Compare Greater-Than Signed Byte",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtsb,     0x10000306, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpSGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 8),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 8)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtsh,     0x10000346, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtsh",
+                               "Vector Compare Greater-Than Signed Half Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtsh,     0x10000346, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpSGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 16),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 16)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtsw,     0x10000386, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtsw",
+                               "Vector Compare Greater-Than Signed Word",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtsw,     0x10000386, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateICmpSGT(
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VA), 32),
+      XeVectorAsInt(b, g.vmx_value(i.VXR.VB), 32)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpeqfp,     0x100000C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpeqfp",
+                               "Vector Compare Equal-to Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpeqfp,     0x100000C6, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateFCmpOEQ(
+      g.vmx_value(i.VXR.VA), g.vmx_value(i.VXR.VB)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpeqfp128,  0x18000000, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpeqfp128",
+                               "Vector128 Compare Equal-to Floating Point",
+                               VX128_R_VD128, VX128_R_VA128, VX128_R_VB128,
+                               i.VX128_R.Rc);
+}
+XEEMITTER(vcmpeqfp128,  0x18000000, VX128_R)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, VX128_R_VD128, b.CreateFCmpOEQ(
+      g.vmx_value(VX128_R_VA128), g.vmx_value(VX128_R_VB128)),
+      i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpgefp,     0x100001C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgefp",
+                               "Vector Compare Greater-Than-or-Equal-to "
+                               "Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgefp,     0x100001C6, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateFCmpOGE(
+      g.vmx_value(i.VXR.VA), g.vmx_value(i.VXR.VB)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgefp128,  0x18000080, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgefp128",
+                               "Vector128 Compare Greater-Than-or-Equal-to "
+                               "Floating Point",
+                               VX128_R_VD128, VX128_R_VA128, VX128_R_VB128,
+                               i.VX128_R.Rc);
+}
+XEEMITTER(vcmpgefp128,  0x18000080, VX128_R)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, VX128_R_VD128, b.CreateFCmpOGE(
+      g.vmx_value(VX128_R_VA128), g.vmx_value(VX128_R_VB128)),
+      i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpgtfp,     0x100002C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtfp",
+                               "Vector Compare Greater-Than Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+XEEMITTER(vcmpgtfp,     0x100002C6, VXR)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, i.VXR.VD, b.CreateFCmpOGT(
+      g.vmx_value(i.VXR.VA), g.vmx_value(i.VXR.VB)), i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtfp128,  0x18000100, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtfp128",
+                               "Vector128 Compare Greater-Than "
+                               "Floating Point",
+                               VX128_R_VD128, VX128_R_VA128, VX128_R_VB128,
+                               i.VX128_R.Rc);
+}
+XEEMITTER(vcmpgtfp128,  0x18000100, VX128_R)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitVectorCompare(g, b, VX128_R_VD128, b.CreateFCmpOGT(
+      g.vmx_value(VX128_R_VA128), g.vmx_value(VX128_R_VB128)),
+      i.VX128_R.Rc);
+}
+
+
+// Vector permute
+// Guest byte n of a vector is host byte n ^ 3 of its <16 x i8> view, as each
+// word is held in host order. Shuffles are built from guest byte indices into
+// (VA) || (VB) and converted here, so they can be written as in the manual.
+// The backend picks the best sequence for constant shuffles on its own (pshufb,
+// unpck*, palignr, pshufd...) for the host features it was set up with.
+
+#define VX128_2_VD128 (i.VX128_2.VD128l | (i.VX128_2.VD128h << 5))
+#define VX128_2_VA128 (i.VX128_2.VA128l | (i.VX128_2.VA128h << 5) | \
+                       (i.VX128_2.VA128H << 6))
+#define VX128_2_VB128 (i.VX128_2.VB128l | (i.VX128_2.VB128h << 5))
+#define VX128_3_VD128 (i.VX128_3.VD128l | (i.VX128_3.VD128h << 5))
+#define VX128_3_VB128 (i.VX128_3.VB128l | (i.VX128_3.VB128h << 5))
+#define VX128_4_VD128 (i.VX128_4.VD128l | (i.VX128_4.VD128h << 5))
+#define VX128_4_VB128 (i.VX128_4.VB128l | (i.VX128_4.VB128h << 5))
+#define VX128_5_VD128 (i.VX128_5.VD128l | (i.VX128_5.VD128h << 5))
+#define VX128_5_VA128 (i.VX128_5.VA128l | (i.VX128_5.VA128h << 5) | \
+                       (i.VX128_5.VA128H << 6))
+#define VX128_5_VB128 (i.VX128_5.VB128l | (i.VX128_5.VB128h << 5))
+
+Value* XeEmitVectorShuffle(IRBuilder<>& b, Value* va, Value* vb,
+                           const uint32_t guest_indices[16]) {
+  uint32_t indices[16];
+  for (uint32_t n = 0; n < 16; n++) {
+    indices[n] = guest_indices[n ^ 3] ^ 3;
+  }
+  return b.CreateShuffleVector(
+      XeVectorAsInt(b, va, 8), XeVectorAsInt(b, vb, 8),
+      ConstantDataVector::get(b.getContext(), indices));
+}
+
+Value* XeEmitVectorShuffleWords(IRBuilder<>& b, Value* va, Value* vb,
+                                const uint32_t indices[4]) {
+  // Words are in guest order already.
+  return b.CreateShuffleVector(
+      XeVectorAsInt(b, va, 32), XeVectorAsInt(b, vb, 32),
+      ConstantDataVector::get(b.getContext(), ArrayRef<uint32_t>(indices, 4)));
+}
+
+bool XeGetConstantVectorBytes(Value* v, uint8_t bytes[16]) {
+  // Gets the host bytes of a constant vector, looking through the bitcasts
+  // between vector types that the builder can't fold.
+  while (ConstantExpr* ce = dyn_cast<ConstantExpr>(v)) {
+    if (ce->getOpcode() != Instruction::BitCast) {
+      return false;
+    }
+    v = ce->getOperand(0);
+  }
+  Constant* c = dyn_cast<Constant>(v);
+  VectorType* vecTy = c ? dyn_cast<VectorType>(c->getType()) : NULL;
+  if (!vecTy || vecTy->getBitWidth() != 128) {
+    return false;
+  }
+  const uint32_t count = vecTy->getNumElements();
+  const uint32_t size = 16 / count;
+  for (uint32_t n = 0; n < count; n++) {
+    Constant* e = c->getAggregateElement(n);
+    uint64_t value;
+    if (ConstantInt* ci = dyn_cast_or_null<ConstantInt>(e)) {
+      value = ci->getZExtValue();
+    } else if (ConstantFP* cf = dyn_cast_or_null<ConstantFP>(e)) {
+      value = cf->getValueAPF().bitcastToAPInt().getZExtValue();
+    } else {
+      return false;
+    }
+    for (uint32_t m = 0; m < size; m++) {
+      bytes[n * size + m] = (uint8_t)(value >> (m * 8));
+    }
+  }
+  return true;
+}
+
+Value* XeEmitVectorPermute(FunctionGenerator& g, IRBuilder<>& b,
+                           Value* va, Value* vb, Value* vc) {
+  // (VD)[n] <- ((VA) || (VB))[(VC)[n] & 0x1F]
+  LLVMContext& context = b.getContext();
+  Type* bytesTy = VectorType::get(b.getInt8Ty(), 16);
+  Value* a8 = XeVectorAsInt(b, va, 8);
+  Value* b8 = XeVectorAsInt(b, vb, 8);
+  Value* c8 = XeVectorAsInt(b, vc, 8);
+
+  // Control vectors built from splats or other constants are the common case
+  // in vertex code and become a fixed shuffle.
+  uint8_t control[16];
+  if (XeGetConstantVectorBytes(vc, control)) {
+    uint32_t indices[16];
+    for (uint32_t n = 0; n < 16; n++) {
+      indices[n] = (control[n] & 0x1F) ^ 3;
+    }
+    return b.CreateShuffleVector(
+        a8, b8, ConstantDataVector::get(context, indices));
+  }
+
+  if (g.host_features() & kXEPALProcessorFeatureSSSE3) {
+    // pshufb only indexes 16 bytes, so both sources are shuffled and bit 4 of
+    // the control picks between them.
+    Function* pshufb = Intrinsic::getDeclaration(
+        g.gen_module(), Intrinsic::x86_ssse3_pshuf_b_128);
+    Value* index = b.CreateXor(
+        b.CreateAnd(c8, ConstantVector::getSplat(16, b.getInt8(0x0F))),
+        ConstantVector::getSplat(16, b.getInt8(0x03)));
+    Value* from_a = b.CreateCall2(pshufb, a8, index);
+    Value* from_b = b.CreateCall2(pshufb, b8, index);
+    Value* use_b = b.CreateICmpNE(
+        b.CreateAnd(c8, ConstantVector::getSplat(16, b.getInt8(0x10))),
+        ConstantAggregateZero::get(bytesTy));
+    return b.CreateSelect(use_b, from_b, from_a);
+  }
+
+  // SSE2 has no variable byte shuffle, so index the joined sources per byte.
+  uint32_t join_indices[32];
+  for (uint32_t n = 0; n < 32; n++) {
+    join_indices[n] = n;
+  }
+  Value* ab = b.CreateShuffleVector(
+      a8, b8, ConstantDataVector::get(context, join_indices));
+  Value* v = UndefValue::get(bytesTy);
+  for (uint32_t n = 0; n < 16; n++) {
+    Value* index = b.CreateExtractElement(c8, b.getInt32(n));
+    index = b.CreateXor(b.CreateAnd(index, 0x1F), 0x03);
+    v = b.CreateInsertElement(
+        v, b.CreateExtractElement(ab, b.CreateZExt(index, b.getInt32Ty())),
+        b.getInt32(n));
+  }
+  return v;
+}
+
+XEDISASMR(vperm,        0x1000002B, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp3(d, "vperm", "Vector Permute",
+                           i.VA.VD, i.VA.VA, i.VA.VB, i.VA.VC);
+}
+XEEMITTER(vperm,        0x1000002B, VA )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VA.VD, XeEmitVectorPermute(
+      g, b, g.vmx_value(i.VA.VA), g.vmx_value(i.VA.VB),
+      g.vmx_value(i.VA.VC)));
+  return 0;
+}
+
+XEDISASMR(vperm128,     0x14000000, VX128_2)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp3(d, "vperm128", "Vector128 Permute",
+                           VX128_2_VD128, VX128_2_VA128, VX128_2_VB128,
+                           i.VX128_2.VC);
+}
+XEEMITTER(vperm128,     0x14000000, VX128_2)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_2_VD128, XeEmitVectorPermute(
+      g, b, g.vmx_value(VX128_2_VA128), g.vmx_value(VX128_2_VB128),
+      g.vmx_value(i.VX128_2.VC)));
+  return 0;
+}
+
+Value* XeEmitVectorShiftLeftDouble(IRBuilder<>& b, Value* va, Value* vb,
+                                   uint32_t sh) {
+  // (VD) <- ((VA) || (VB)) << (SH * 8), high 16 bytes
+  uint32_t indices[16];
+  for (uint32_t n = 0; n < 16; n++) {
+    indices[n] = n + sh;
+  }
+  return XeEmitVectorShuffle(b, va, vb, indices);
+}
+
+XEDISASMR(vsldoi,       0x1000002C, VA )(InstrData& i, InstrDisasm& d) {
+  d.Init("vsldoi", "Vector Shift Left Double by Octet Immediate", 0);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VD, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VA, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VB, InstrRegister::kRead);
+  d.AddUImmOperand(i.VA.VC & 0xF, 1);
+  return d.Finish();
+}
+XEEMITTER(vsldoi,       0x1000002C, VA )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VA.VD, XeEmitVectorShiftLeftDouble(
+      b, g.vmx_value(i.VA.VA), g.vmx_value(i.VA.VB), i.VA.VC & 0xF));
+  return 0;
+}
+
+XEDISASMR(vsldoi128,    0x10000010, VX128_5)(InstrData& i, InstrDisasm& d) {
+  d.Init("vsldoi128", "Vector128 Shift Left Double by Octet Immediate", 0);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_5_VD128, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_5_VA128, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_5_VB128, InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_5.SH, 1);
+  return d.Finish();
+}
+XEEMITTER(vsldoi128,    0x10000010, VX128_5)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_5_VD128, XeEmitVectorShiftLeftDouble(
+      b, g.vmx_value(VX128_5_VA128), g.vmx_value(VX128_5_VB128),
+      i.VX128_5.SH));
+  return 0;
+}
+
+int XeEmitLoadVectorShift(FunctionGenerator& g, IRBuilder<>& b,
+                          uint32_t vd, uint32_t ra, uint32_t rb, bool left) {
+  // sh <- ((RA|0) + (RB)) & 0xF
+  // lvsl: (VD) <- sh, sh + 1, ..., sh + 15
+  // lvsr: (VD) <- 16 - sh, 17 - sh, ..., 31 - sh
+  // These only build vperm controls and never touch memory.
+  uint8_t base[16];
+  for (uint32_t n = 0; n < 16; n++) {
+    base[n] = (uint8_t)((left ? 0 : 16) + (n ^ 3));
+  }
+  Value* sh = b.CreateTrunc(
+      b.CreateAnd(XeVectorEA(g, b, ra, rb), 0xF), b.getInt8Ty());
+  Value* v = ConstantDataVector::get(b.getContext(), base);
+  Value* shv = XeVectorSplat(b, sh, 16);
+  v = left ? b.CreateAdd(v, shv) : b.CreateSub(v, shv);
+  g.update_vmx_value(vd, v);
+  return 0;
+}
+
+XEDISASMR(lvsl,         0x7C00000C, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsl", "Load Vector for Shift Left",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvsl,         0x7C00000C, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorShift(g, b, i.X.RT, i.X.RA, i.X.RB, true);
+}
+
+XEDISASMR(lvsl128,      0x10000003, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsl128", "Load Vector128 for Shift Left",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvsl128,      0x10000003, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorShift(g, b, VX128_1_VD128,
+                               i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEDISASMR(lvsr,         0x7C00004C, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsr", "Load Vector for Shift Right",
+                              i.X.RT, i.X.RA, i.X.RB, false);
+}
+XEEMITTER(lvsr,         0x7C00004C, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorShift(g, b, i.X.RT, i.X.RA, i.X.RB, false);
+}
+
+XEDISASMR(lvsr128,      0x10000043, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsr128", "Load Vector128 for Shift Right",
+                              VX128_1_VD128, i.VX128_1.RA, i.VX128_1.RB,
+                              false);
+}
+XEEMITTER(lvsr128,      0x10000043, VX128_1)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  return XeEmitLoadVectorShift(g, b, VX128_1_VD128,
+                               i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+Value* XeEmitVectorMerge(IRBuilder<>& b, Value* va, Value* vb,
+                         uint32_t size, bool low) {
+  // Interleaves the elements of one half of (VA) and (VB):
+  // (VD) <- (VA)[k], (VB)[k], (VA)[k + 1], (VB)[k + 1], ...
+  // where k is 0 for the high merges and half the element count for the low.
+  const uint32_t count = 16 / size;
+  uint32_t indices[16];
+  for (uint32_t n = 0; n < count; n++) {
+    uint32_t src = (low ? count / 2 : 0) + n / 2;
+    for (uint32_t m = 0; m < size; m++) {
+      indices[n * size + m] = ((n & 1) ? 16 : 0) + src * size + m;
+    }
+  }
+  return XeEmitVectorShuffle(b, va, vb, indices);
+}
+
+XEDISASMR(vmrghb,       0x1000000C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrghb", "Vector Merge High Byte",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrghb,       0x1000000C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 1, false));
+  return 0;
+}
+
+XEDISASMR(vmrghh,       0x1000004C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrghh", "Vector Merge High Half Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrghh,       0x1000004C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 2, false));
+  return 0;
+}
+
+XEDISASMR(vmrghw,       0x1000008C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrghw", "Vector Merge High Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrghw,       0x1000008C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 4, false));
+  return 0;
+}
+
+XEDISASMR(vmrghw128,    0x18000300, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrghw128", "Vector128 Merge High Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmrghw128,    0x18000300, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMerge(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128), 4, false));
+  return 0;
+}
+
+XEDISASMR(vmrglb,       0x1000010C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrglb", "Vector Merge Low Byte",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrglb,       0x1000010C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 1, true));
+  return 0;
+}
+
+XEDISASMR(vmrglh,       0x1000014C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrglh", "Vector Merge Low Half Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrglh,       0x1000014C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 2, true));
+  return 0;
+}
+
+XEDISASMR(vmrglw,       0x1000018C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrglw", "Vector Merge Low Word",
+                          i.VX.VD, i.VX.VA, i.VX.VB);
+}
+XEEMITTER(vmrglw,       0x1000018C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorMerge(
+      b, g.vmx_value(i.VX.VA), g.vmx_value(i.VX.VB), 4, true));
+  return 0;
+}
+
+XEDISASMR(vmrglw128,    0x18000340, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorOp(d, "vmrglw128", "Vector128 Merge Low Word",
+                          VX128_VD128, VX128_VA128, VX128_VB128);
+}
+XEEMITTER(vmrglw128,    0x18000340, VX128)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_VD128, XeEmitVectorMerge(
+      b, g.vmx_value(VX128_VA128), g.vmx_value(VX128_VB128), 4, true));
+  return 0;
+}
+
+int XeDisasmVectorSplat(InstrDisasm& d, const char* name, const char* info,
+                        uint32_t vd, uint32_t vb, uint32_t uimm) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  d.AddUImmOperand(uimm, 1);
+  return d.Finish();
+}
+
+Value* XeEmitVectorSplatElement(IRBuilder<>& b, Value* vb,
+                                uint32_t size, uint32_t uimm) {
+  // (VD) <- (VB)[UIMM] in every element
+  const uint32_t element = uimm & (16 / size - 1);
+  uint32_t indices[16];
+  for (uint32_t n = 0; n < 16; n++) {
+    indices[n] = element * size + n % size;
+  }
+  return XeEmitVectorShuffle(b, vb, vb, indices);
+}
+
+XEDISASMR(vspltb,       0x1000020C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltb", "Vector Splat Byte",
+                             i.VX.VD, i.VX.VB, i.VX.VA);
+}
+XEEMITTER(vspltb,       0x1000020C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatElement(
+      b, g.vmx_value(i.VX.VB), 1, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vsplth,       0x1000024C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vsplth", "Vector Splat Half Word",
+                             i.VX.VD, i.VX.VB, i.VX.VA);
+}
+XEEMITTER(vsplth,       0x1000024C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatElement(
+      b, g.vmx_value(i.VX.VB), 2, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vspltw,       0x1000028C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltw", "Vector Splat Word",
+                             i.VX.VD, i.VX.VB, i.VX.VA);
+}
+XEEMITTER(vspltw,       0x1000028C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatElement(
+      b, g.vmx_value(i.VX.VB), 4, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vspltw128,    0x18000730, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltw128", "Vector128 Splat Word",
+                             VX128_3_VD128, VX128_3_VB128, i.VX128_3.IMM);
+}
+XEEMITTER(vspltw128,    0x18000730, VX128_3)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_3_VD128, XeEmitVectorSplatElement(
+      b, g.vmx_value(VX128_3_VB128), 4, i.VX128_3.IMM));
+  return 0;
+}
+
+int XeDisasmVectorSplatImmediate(InstrDisasm& d, const char* name,
+                                 const char* info, uint32_t vd,
+                                 uint32_t simm) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddSImmOperand((int32_t)(simm << 27) >> 27, 1);
+  return d.Finish();
+}
+
+Value* XeEmitVectorSplatImmediate(IRBuilder<>& b, uint32_t size,
+                                  uint32_t simm) {
+  // (VD) <- EXTS(SIMM) in every element
+  // Always a constant, so later permutes by it are fixed shuffles.
+  const int32_t value = (int32_t)(simm << 27) >> 27;
+  return ConstantVector::getSplat(
+      16 / size, ConstantInt::get(b.getIntNTy(size * 8), value, true));
+}
+
+XEDISASMR(vspltisb,     0x1000030C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImmediate(
+      d, "vspltisb", "Vector Splat Immediate Signed Byte",
+      i.VX.VD, i.VX.VA);
+}
+XEEMITTER(vspltisb,     0x1000030C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatImmediate(b, 1, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vspltish,     0x1000034C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImmediate(
+      d, "vspltish", "Vector Splat Immediate Signed Half Word",
+      i.VX.VD, i.VX.VA);
+}
+XEEMITTER(vspltish,     0x1000034C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatImmediate(b, 2, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vspltisw,     0x1000038C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImmediate(
+      d, "vspltisw", "Vector Splat Immediate Signed Word",
+      i.VX.VD, i.VX.VA);
+}
+XEEMITTER(vspltisw,     0x1000038C, VX )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(i.VX.VD, XeEmitVectorSplatImmediate(b, 4, i.VX.VA));
+  return 0;
+}
+
+XEDISASMR(vspltisw128,  0x18000770, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImmediate(
+      d, "vspltisw128", "Vector128 Splat Immediate Signed Word",
+      VX128_3_VD128, i.VX128_3.IMM);
+}
+XEEMITTER(vspltisw128,  0x18000770, VX128_3)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  g.update_vmx_value(VX128_3_VD128,
+                     XeEmitVectorSplatImmediate(b, 4, i.VX128_3.IMM));
+  return 0;
+}
+
+
+// D3D pack/unpack (VMX128)
+// The unpacked forms are biased floats whose low mantissa bits hold the
+// integer: 1.0 + n * 2^-23 for D3DCOLOR bytes and 3.0 + n * 2^-22 for
+// NORMSHORT values, so titles scale them with a single multiply-add.
+
+Value* XeEmitVectorHalfToFloat(FunctionGenerator& g, IRBuilder<>& b,
+                               Value* v) {
+  // <4 x i16> halves to <4 x float>.
+  LLVMContext& context = b.getContext();
+  if (g.host_features() & kXEPALProcessorFeatureF16C) {
+    uint32_t indices[] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+    v = b.CreateShuffleVector(v, UndefValue::get(v->getType()),
+                              ConstantDataVector::get(context, indices));
+    Function* cvtph2ps = Intrinsic::getDeclaration(
+        g.gen_module(), Intrinsic::x86_vcvtph2ps_128);
+    return b.CreateCall(cvtph2ps, v);
+  }
+
+  // Rebias the exponent; denormals are renormalized with a float subtract
+  // and inf/NaN get the maximum exponent.
+  Type* wordsTy = VectorType::get(b.getInt32Ty(), 4);
+  Type* floatsTy = VectorType::get(b.getFloatTy(), 4);
+  Value* h = b.CreateZExt(v, wordsTy);
+  Value* o = b.CreateShl(
+      b.CreateAnd(h, XeVectorSplat(b, b.getInt32(0x7FFF), 4)),
+      XeVectorSplat(b, b.getInt32(13), 4));
+  Value* exp = b.CreateAnd(o, XeVectorSplat(b, b.getInt32(0x7C00 << 13), 4));
+  o = b.CreateAdd(o, XeVectorSplat(b, b.getInt32((127 - 15) << 23), 4));
+  Value* inf_nan = b.CreateAdd(
+      o, XeVectorSplat(b, b.getInt32((128 - 16) << 23), 4));
+  Value* denormal = b.CreateBitCast(b.CreateFSub(
+      b.CreateBitCast(
+          b.CreateAdd(o, XeVectorSplat(b, b.getInt32(1 << 23), 4)), floatsTy),
+      b.CreateBitCast(XeVectorSplat(b, b.getInt32(113 << 23), 4), floatsTy)),
+      wordsTy);
+  o = b.CreateSelect(
+      b.CreateICmpEQ(exp, XeVectorSplat(b, b.getInt32(0x7C00 << 13), 4)),
+      inf_nan, o);
+  o = b.CreateSelect(
+      b.CreateICmpEQ(exp, ConstantAggregateZero::get(wordsTy)),
+      denormal, o);
+  o = b.CreateOr(o, b.CreateShl(
+      b.CreateAnd(h, XeVectorSplat(b, b.getInt32(0x8000), 4)),
+      XeVectorSplat(b, b.getInt32(16), 4)));
+  return b.CreateBitCast(o, floatsTy);
+}
+
+Value* XeEmitVectorFloatToHalf(FunctionGenerator& g, IRBuilder<>& b,
+                               Value* v) {
+  // <4 x float> to <4 x i16> halves, rounding to nearest even.
+  LLVMContext& context = b.getContext();
+  uint32_t low_indices[] = { 0, 1, 2, 3 };
+  if (g.host_features() & kXEPALProcessorFeatureF16C) {
+    Function* cvtps2ph = Intrinsic::getDeclaration(
+        g.gen_module(), Intrinsic::x86_vcvtps2ph_128);
+    v = b.CreateCall2(cvtps2ph, v, b.getInt32(0));
+    return b.CreateShuffleVector(v, UndefValue::get(v->getType()),
+                                 ConstantDataVector::get(context,
+                                                         low_indices));
+  }
+
+  // Values too large become inf (or stay NaN), values too small go through
+  // a float add that does the denormal rounding, and the rest round the
+  // mantissa by adding half an ulp (plus one when odd, for ties to even).
+  Type* wordsTy = VectorType::get(b.getInt32Ty(), 4);
+  Type* floatsTy = VectorType::get(b.getFloatTy(), 4);
+  const uint32_t denormal_magic = ((127 - 15) + (23 - 10) + 1) << 23;
+  Value* f = b.CreateBitCast(v, wordsTy);
+  Value* sign = b.CreateAnd(f, XeVectorSplat(b, b.getInt32(0x80000000), 4));
+  f = b.CreateXor(f, sign);
+  Value* overflow = b.CreateSelect(
+      b.CreateICmpUGT(f, XeVectorSplat(b, b.getInt32(255 << 23), 4)),
+      XeVectorSplat(b, b.getInt32(0x7E00), 4),
+      XeVectorSplat(b, b.getInt32(0x7C00), 4));
+  Value* denormal = b.CreateSub(
+      b.CreateBitCast(b.CreateFAdd(
+          b.CreateBitCast(f, floatsTy),
+          b.CreateBitCast(XeVectorSplat(b, b.getInt32(denormal_magic), 4),
+                          floatsTy)), wordsTy),
+      XeVectorSplat(b, b.getInt32(denormal_magic), 4));
+  Value* odd = b.CreateAnd(
+      b.CreateLShr(f, XeVectorSplat(b, b.getInt32(13), 4)),
+      XeVectorSplat(b, b.getInt32(1), 4));
+  Value* normal = b.CreateAdd(
+      f, XeVectorSplat(b, b.getInt32(((uint32_t)(15 - 127) << 23) + 0xFFF),
+                       4));
+  normal = b.CreateLShr(b.CreateAdd(normal, odd),
+                        XeVectorSplat(b, b.getInt32(13), 4));
+  Value* o = b.CreateSelect(
+      b.CreateICmpULT(f, XeVectorSplat(b, b.getInt32(113 << 23), 4)),
+      denormal, normal);
+  o = b.CreateSelect(
+      b.CreateICmpUGE(f, XeVectorSplat(b, b.getInt32((127 + 16) << 23), 4)),
+      overflow, o);
+  o = b.CreateOr(o, b.CreateLShr(sign, XeVectorSplat(b, b.getInt32(16), 4)));
+  return b.CreateTrunc(o, VectorType::get(b.getInt16Ty(), 4));
+}
+
+XEDISASMR(vupkd3d128,   0x180007F0, VX128_3)(InstrData& i, InstrDisasm& d) {
+  d.Init("vupkd3d128", "Vector128 Unpack D3Dtype", 0);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_3_VD128, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_3_VB128, InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_3.IMM, 1);
+  return d.Finish();
+}
+XEEMITTER(vupkd3d128,   0x180007F0, VX128_3)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // The packed value is in the low word(s) of (VB). Each form is a byte or
+  // half word shuffle against zero plus a bias.
+  LLVMContext& context = b.getContext();
+  Type* wordsTy = VectorType::get(b.getInt32Ty(), 4);
+  Value* vb = g.vmx_value(VX128_3_VB128);
+  Value* v = NULL;
+  switch (i.VX128_3.IMM >> 2) {
+  case 0: {
+    // D3DCOLOR: word 3 is ARGB.
+    // (VD) <- 1.0 + R * 2^-23, G, B, A
+    // Host bytes 12-15 of (VB) are B, G, R, A.
+    uint32_t indices[] = {
+      14, 16, 16, 16,  13, 16, 16, 16,  12, 16, 16, 16,  15, 16, 16, 16,
+    };
+    v = b.CreateShuffleVector(
+        XeVectorAsInt(b, vb, 8),
+        ConstantAggregateZero::get(VectorType::get(b.getInt8Ty(), 16)),
+        ConstantDataVector::get(context, indices));
+    v = b.CreateOr(b.CreateBitCast(v, wordsTy),
+                   XeVectorSplat(b, b.getInt32(0x3F800000), 4));
+    break;
+  }
+  case 1:
+  case 4: {
+    // NORMSHORT2: word 3 is XY.
+    // (VD) <- 3.0 + X * 2^-22, Y, 0.0, 1.0
+    // NORMSHORT4: words 2 and 3 are XY and ZW.
+    // (VD) <- 3.0 + X * 2^-22, Y, Z, W
+    // Host half words 2n and 2n + 1 are the low and high halves of word n.
+    const bool is_short4 = (i.VX128_3.IMM >> 2) == 4;
+    uint32_t indices2[] = { 7, 6, 8, 8 };
+    uint32_t indices4[] = { 5, 4, 7, 6 };
+    v = b.CreateShuffleVector(
+        XeVectorAsInt(b, vb, 16),
+        ConstantAggregateZero::get(VectorType::get(b.getInt16Ty(), 8)),
+        ConstantDataVector::get(context, is_short4 ? indices4 : indices2));
+    uint32_t bias2[] = { 0x40400000, 0x40400000, 0, 0x3F800000 };
+    uint32_t bias4[] = { 0x40400000, 0x40400000, 0x40400000, 0x40400000 };
+    v = b.CreateAdd(b.CreateSExt(v, wordsTy), ConstantDataVector::get(
+        context, is_short4 ? bias4 : bias2));
+    break;
+  }
+  case 3:
+  case 5: {
+    // FLOAT16_2: word 3 is XY.
+    // (VD) <- X, Y, 0.0, 1.0
+    // FLOAT16_4: words 2 and 3 are XY and ZW.
+    // (VD) <- X, Y, Z, W
+    const bool is_float4 = (i.VX128_3.IMM >> 2) == 5;
+    uint32_t indices2[] = { 7, 6, 7, 6 };
+    uint32_t indices4[] = { 5, 4, 7, 6 };
+    v = b.CreateShuffleVector(
+        XeVectorAsInt(b, vb, 16),
+        UndefValue::get(VectorType::get(b.getInt16Ty(), 8)),
+        ConstantDataVector::get(context, is_float4 ? indices4 : indices2));
+    v = XeEmitVectorHalfToFloat(g, b, v);
+    if (!is_float4) {
+      uint32_t zw[] = { 0, 0, 0, 0x3F800000 };
+      uint32_t zw_indices[] = { 0, 1, 6, 7 };
+      v = b.CreateShuffleVector(
+          XeVectorAsInt(b, v, 32), ConstantDataVector::get(context, zw),
+          ConstantDataVector::get(context, zw_indices));
+    }
+    break;
+  }
+  default:
+    XEINSTRNOTIMPLEMENTED();
+    return 1;
+  }
+  g.update_vmx_value(VX128_3_VD128, v);
+  return 0;
+}
+
+XEDISASMR(vpkd3d128,    0x18000610, VX128_4)(InstrData& i, InstrDisasm& d) {
+  d.Init("vpkd3d128", "Vector128 Pack D3Dtype, Rotate Left Immediate and "
+         "Mask Insert", 0);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_4_VD128,
+                  InstrRegister::kReadWrite);
+  d.AddRegOperand(InstrRegister::kVMX, VX128_4_VB128, InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_4.IMM >> 2, 1);
+  d.AddUImmOperand(i.VX128_4.IMM & 0x3, 1);
+  d.AddUImmOperand(i.VX128_4.z, 1);
+  return d.Finish();
+}
+XEEMITTER(vpkd3d128,    0x18000610, VX128_4)(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
+  // Packs (VB) into the low word(s) of a temporary, the reverse of
+  // vupkd3d128, then inserts those words into (VD) at a word offset.
+  LLVMContext& context = b.getContext();
+  Type* floatsTy = VectorType::get(b.getFloatTy(), 4);
+  Value* vb = g.vmx_value(VX128_4_VB128);
+  Value* v = NULL;
+  switch (i.VX128_4.IMM >> 2) {
+  case 0: {
+    // D3DCOLOR: saturate to 1.0 + [0, 255] * 2^-23 and take the low byte of
+    // each as ARGB in word 3.
+    uint32_t lo[] = { 0x3F800000, 0x3F800000, 0x3F800000, 0x3F800000 };
+    uint32_t hi[] = { 0x3F8000FF, 0x3F8000FF, 0x3F8000FF, 0x3F8000FF };
+    v = XeEmitVectorMin(b, XeEmitVectorMax(
+        b, vb, b.CreateBitCast(ConstantDataVector::get(context, lo),
+                               floatsTy)),
+        b.CreateBitCast(ConstantDataVector::get(context, hi), floatsTy));
+    uint32_t indices[] = {
+      16, 16, 16, 16,  16, 16, 16, 16,  16, 16, 16, 16,  8, 4, 0, 12,
+    };
+    v = b.CreateShuffleVector(
+        XeVectorAsInt(b, v, 8),
+        ConstantAggregateZero::get(VectorType::get(b.getInt8Ty(), 16)),
+        ConstantDataVector::get(context, indices));
+    break;
+  }
+  case 1:
+  case 4: {
+    // NORMSHORT2/NORMSHORT4: saturate to 3.0 + [-32767, 32767] * 2^-22 and
+    // take the low half word of each as XY in word 3, or XY ZW in words 2
+    // and 3.
+    const bool is_short4 = (i.VX128_4.IMM >> 2) == 4;
+    uint32_t lo[] = { 0x403F8001, 0x403F8001, 0x403F8001, 0x403F8001 };
+    uint32_t hi[] = { 0x40407FFF, 0x40407FFF, 0x40407FFF, 0x40407FFF };
+    v = XeEmitVectorMin(b, XeEmitVectorMax(
+        b, vb, b.CreateBitCast(ConstantDataVector::get(context, lo),
+                               floatsTy)),
+        b.CreateBitCast(ConstantDataVector::get(context, hi), floatsTy));
+    uint32_t indices2[] = { 8, 8, 8, 8, 8, 8, 2, 0 };
+    uint32_t indices4[] = { 8, 8, 8, 8, 2, 0, 6, 4 };
+    v = b.CreateShuffleVector(
+        XeVectorAsInt(b, v, 16),
+        ConstantAggregateZero::get(VectorType::get(b.getInt16Ty(), 8)),
+        ConstantDataVector::get(context, is_short4 ? indices4 : indices2));
+    break;
+  }
+  case 3:
+  case 5: {
+    // FLOAT16_2/FLOAT16_4: XY in word 3, or XY ZW in words 2 and 3.
+    const bool is_float4 = (i.VX128_4.IMM >> 2) == 5;
+    v = XeEmitVectorFloatToHalf(g, b, vb);
+    uint32_t indices2[] = { 4, 4, 4, 4, 4, 4, 1, 0 };
+    uint32_t indices4[] = { 4, 4, 4, 4, 1, 0, 3, 2 };
+    v = b.CreateShuffleVector(
+        v, ConstantAggregateZero::get(VectorType::get(b.getInt16Ty(), 4)),
+        ConstantDataVector::get(context, is_float4 ? indices4 : indices2));
+    break;
+  }
+  default:
+    XEINSTRNOTIMPLEMENTED();
+    return 1;
+  }
+
+  // Insert into (VD). The shift counts words up from the right.
+  // z = 1: word 3 - shift <- word 3
+  // z = 2: words 2 - shift, 3 - shift <- words 2, 3 (word 3 <- 3 at shift 3)
+  // z = 3: as z = 2, but word 3 <- word 2 at shift 3
+  const uint32_t shift = i.VX128_4.IMM & 0x3;
+  uint32_t indices[] = { 0, 1, 2, 3 };
+  switch (i.VX128_4.z) {
+  case 1:
+    indices[3 - shift] = 4 + 3;
+    break;
+  case 2:
+  case 3:
+    if (shift < 3) {
+      indices[2 - shift] = 4 + 2;
+      indices[3 - shift] = 4 + 3;
+    } else {
+      indices[3] = 4 + (i.VX128_4.z == 2 ? 3 : 2);
+    }
+    break;
+  default:
+    XEINSTRNOTIMPLEMENTED();
+    return 1;
+  }
+  g.update_vmx_value(VX128_4_VD128, XeEmitVectorShuffleWords(
+      b, g.vmx_value(VX128_4_VD128), v, indices));
+  return 0;
+}
+
+
+void RegisterEmitCategoryAltivec() {
+  XEREGISTERINSTR(lvx,          0x7C0000CE);
+  XEREGISTERINSTR(lvx128,       0x100000C3);
+  XEREGISTERINSTR(lvxl,         0x7C0002CE);
+  XEREGISTERINSTR(lvxl128,      0x100002C3);
+  XEREGISTERINSTR(stvx,         0x7C0001CE);
+  XEREGISTERINSTR(stvx128,      0x100001C3);
+  XEREGISTERINSTR(stvxl,        0x7C0003CE);
+  XEREGISTERINSTR(stvxl128,     0x100003C3);
+  XEREGISTERINSTR(lvlx,         0x7C00040E);
+  XEREGISTERINSTR(lvlx128,      0x10000403);
+  XEREGISTERINSTR(lvlxl,        0x7C00060E);
+  XEREGISTERINSTR(lvlxl128,     0x10000603);
+  XEREGISTERINSTR(lvrx,         0x7C00044E);
+  XEREGISTERINSTR(lvrx128,      0x10000443);
+  XEREGISTERINSTR(lvrxl,        0x7C00064E);
+  XEREGISTERINSTR(lvrxl128,     0x10000643);
+  XEREGISTERINSTR(stvlx,        0x7C00050E);
+  XEREGISTERINSTR(stvlx128,     0x10000503);
+  XEREGISTERINSTR(stvlxl,       0x7C00070E);
+  XEREGISTERINSTR(stvlxl128,    0x10000703);
+  XEREGISTERINSTR(stvrx,        0x7C00054E);
+  XEREGISTERINSTR(stvrx128,     0x10000543);
+  XEREGISTERINSTR(stvrxl,       0x7C00074E);
+  XEREGISTERINSTR(stvrxl128,    0x10000743);
+  XEREGISTERINSTR(vaddfp,       0x1000000A);
+  XEREGISTERINSTR(vaddfp128,    0x14000010);
+  XEREGISTERINSTR(vsubfp,       0x1000004A);
+  XEREGISTERINSTR(vsubfp128,    0x14000050);
+  XEREGISTERINSTR(vmulfp128,    0x14000090);
+  XEREGISTERINSTR(vmaddfp,      0x1000002E);
+  XEREGISTERINSTR(vmaddfp128,   0x140000D0);
+  XEREGISTERINSTR(vmaddcfp128,  0x14000110);
+  XEREGISTERINSTR(vnmsubfp,     0x1000002F);
+  XEREGISTERINSTR(vnmsubfp128,  0x14000150);
+  XEREGISTERINSTR(vmsum3fp128,  0x14000190);
+  XEREGISTERINSTR(vmsum4fp128,  0x140001D0);
+  XEREGISTERINSTR(vmaxfp,       0x1000040A);
+  XEREGISTERINSTR(vmaxfp128,    0x18000280);
+  XEREGISTERINSTR(vminfp,       0x1000044A);
+  XEREGISTERINSTR(vminfp128,    0x180002C0);
+  XEREGISTERINSTR(vand,         0x10000404);
+  XEREGISTERINSTR(vand128,      0x14000210);
+  XEREGISTERINSTR(vandc,        0x10000444);
+  XEREGISTERINSTR(vandc128,     0x14000250);
+  XEREGISTERINSTR(vnor,         0x10000504);
+  XEREGISTERINSTR(vnor128,      0x14000290);
+  XEREGISTERINSTR(vor,          0x10000484);
+  XEREGISTERINSTR(vor128,       0x140002D0);
+  XEREGISTERINSTR(vxor,         0x100004C4);
+  XEREGISTERINSTR(vxor128,      0x14000310);
+  XEREGISTERINSTR(vsel,         0x1000002A);
+  XEREGISTERINSTR(vsel128,      0x14000350);
+  XEREGISTERINSTR(vaddubm,      0x10000000);
+  XEREGISTERINSTR(vadduhm,      0x10000040);
+  XEREGISTERINSTR(vadduwm,      0x10000080);
+  XEREGISTERINSTR(vsububm,      0x10000400);
+  XEREGISTERINSTR(vsubuhm,      0x10000440);
+  XEREGISTERINSTR(vsubuwm,      0x10000480);
+  XEREGISTERINSTR(vmaxsw,       0x10000182);
+  XEREGISTERINSTR(vmaxuw,       0x10000082);
+  XEREGISTERINSTR(vminsw,       0x10000382);
+  XEREGISTERINSTR(vminuw,       0x10000282);
+  XEREGISTERINSTR(vrlw,         0x10000084);
+  XEREGISTERINSTR(vrlw128,      0x18000050);
+  XEREGISTERINSTR(vslw,         0x10000184);
+  XEREGISTERINSTR(vslw128,      0x180000D0);
+  XEREGISTERINSTR(vsrw,         0x10000284);
+  XEREGISTERINSTR(vsrw128,      0x180001D0);
+  XEREGISTERINSTR(vsraw,        0x10000384);
+  XEREGISTERINSTR(vsraw128,     0x18000150);
+  XEREGISTERINSTR(vcmpequb,     0x10000006);
+  XEREGISTERINSTR(vcmpequh,     0x10000046);
+  XEREGISTERINSTR(vcmpequw,     0x10000086);
+  XEREGISTERINSTR(vcmpequw128,  0x18000200);
+  XEREGISTERINSTR(vcmpgtub,     0x10000206);
+  XEREGISTERINSTR(vcmpgtuh,     0x10000246);
+  XEREGISTERINSTR(vcmpgtuw,     0x10000286);
+  XEREGISTERINSTR(vcmpgtsb,     0x10000306);
+  XEREGISTERINSTR(vcmpgtsh,     0x10000346);
+  XEREGISTERINSTR(vcmpgtsw,     0x10000386);
+  XEREGISTERINSTR(vcmpeqfp,     0x100000C6);
+  XEREGISTERINSTR(vcmpeqfp128,  0x18000000);
+  XEREGISTERINSTR(vcmpgefp,     0x100001C6);
+  XEREGISTERINSTR(vcmpgefp128,  0x18000080);
+  XEREGISTERINSTR(vcmpgtfp,     0x100002C6);
+  XEREGISTERINSTR(vcmpgtfp128,  0x18000100);
+  XEREGISTERINSTR(vperm,        0x1000002B);
+  XEREGISTERINSTR(vperm128,     0x14000000);
+  XEREGISTERINSTR(vsldoi,       0x1000002C);
+  XEREGISTERINSTR(vsldoi128,    0x10000010);
+  XEREGISTERINSTR(lvsl,         0x7C00000C);
+  XEREGISTERINSTR(lvsl128,      0x10000003);
+  XEREGISTERINSTR(lvsr,         0x7C00004C);
+  XEREGISTERINSTR(lvsr128,      0x10000043);
+  XEREGISTERINSTR(vmrghb,       0x1000000C);
+  XEREGISTERINSTR(vmrghh,       0x1000004C);
+  XEREGISTERINSTR(vmrghw,       0x1000008C);
+  XEREGISTERINSTR(vmrghw128,    0x18000300);
+  XEREGISTERINSTR(vmrglb,       0x1000010C);
+  XEREGISTERINSTR(vmrglh,       0x1000014C);
+  XEREGISTERINSTR(vmrglw,       0x1000018C);
+  XEREGISTERINSTR(vmrglw128,    0x18000340);
+  XEREGISTERINSTR(vspltb,       0x1000020C);
+  XEREGISTERINSTR(vsplth,       0x1000024C);
+  XEREGISTERINSTR(vspltw,       0x1000028C);
+  XEREGISTERINSTR(vspltw128,    0x18000730);
+  XEREGISTERINSTR(vspltisb,     0x1000030C);
+  XEREGISTERINSTR(vspltish,     0x1000034C);
+  XEREGISTERINSTR(vspltisw,     0x1000038C);
+  XEREGISTERINSTR(vspltisw128,  0x18000770);
+  XEREGISTERINSTR(vupkd3d128,   0x180007F0);
+  XEREGISTERINSTR(vpkd3d128,    0x18000610);
+}
+
+
+}  // namespace codegen
+}  // namespace cpu
+}  // namespace xe
@@ -207,7 +207,7 @@ XEEMITTER(addzex,       0x7C000194, XO )(FunctionGenerator& g, IRBuilder<>& b, I
 
   Function* sadd_with_overflow = Intrinsic::getDeclaration(
       g.gen_module(), Intrinsic::sadd_with_overflow, b.getInt64Ty());
-  Value* ca = b.CreateAnd(b.CreateLShr(g.xer_value(), 29), 0x1);
+  Value* ca = g.xer_ca_value();
   Value* v = b.CreateCall2(sadd_with_overflow,
                            g.gpr_value(i.XO.RA), ca);
   Value* add_value = b.CreateExtractValue(v, 0);
@@ -626,7 +626,7 @@ XEEMITTER(subfex,       0x7C000110, XO )(FunctionGenerator& g, IRBuilder<>& b, I
   // TODO(benvanik): possible that the add of rb+ca needs to also check for
   //     overflow!
 
-  Value* ca = b.CreateAnd(b.CreateLShr(g.xer_value(), 29), 0x1);
+  Value* ca = g.xer_ca_value();
   Function* uadd_with_overflow = Intrinsic::getDeclaration(
       g.gen_module(), Intrinsic::uadd_with_overflow, b.getInt64Ty());
   Value* v = b.CreateCall2(uadd_with_overflow,
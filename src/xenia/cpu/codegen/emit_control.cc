@@ -9,6 +9,8 @@
 
 #include <xenia/cpu/codegen/emit.h>
 
+#include <set>
+
 #include <xenia/cpu/codegen/function_generator.h>
 #include <xenia/cpu/ppc/state.h>
 
@@ -88,21 +90,19 @@ int XeEmitBranchTo(
       g.SpillRegisters();
 
       XEASSERTNOTNULL(fn_block->outgoing_function);
-      Function* target_fn = g.GetFunction(fn_block->outgoing_function);
-      Function::arg_iterator args = g.gen_fn()->arg_begin();
-      Value* state_ptr = args;
+      FunctionSymbol* target_fn = fn_block->outgoing_function;
       BasicBlock* next_bb = g.GetNextBasicBlock();
       if (!lk || !next_bb) {
         // Tail. No need to refill the local register values, just return.
         // We optimize this by passing in the LR from our parent instead of the
         // next instruction. This allows the return from our callee to pop
         // all the way up.
-        b.CreateCall2(target_fn, state_ptr, ++args);
-        b.CreateRetVoid();
+        g.CallFunction(target_fn, ++(g.gen_fn()->arg_begin()));
+        g.GenerateReturn();
       } else {
         // Will return here eventually.
         // Refill registers from state.
-        b.CreateCall2(target_fn, state_ptr, b.getInt64(cia + 4));
+        g.CallFunction(target_fn, b.getInt64(cia + 4));
         g.FillRegisters();
         b.CreateBr(next_bb);
       }
@@ -120,6 +120,29 @@ int XeEmitBranchTo(
       printf("INDIRECT JUMP VIA CTR: %.8X\n", cia);
       return XeEmitIndirectBranchTo(g, b, src, cia, lk, kXEPPCRegCTR);
     }
+    case FunctionBlock::kTargetJumpTable:
+    {
+      // A switch statement found during analysis. All of the cases are
+      // blocks in this function. The default can only be hit if the analysis
+      // was wrong, so it takes the slow external path.
+      char name[32];
+      xesnprintfa(name, XECOUNT(name), "loc_%.8X_%s_default", cia, src);
+      BasicBlock* default_bb = BasicBlock::Create(
+          *g.context(), name, g.gen_fn(), g.GetNextBasicBlock());
+      Value* target = g.ctr_value();
+      std::set<uint32_t> cases(fn_block->jump_table.begin(),
+                               fn_block->jump_table.end());
+      SwitchInst* switch_i = b.CreateSwitch(
+          target, default_bb, static_cast<unsigned>(cases.size()));
+      for (std::set<uint32_t>::iterator it = cases.begin();
+           it != cases.end(); ++it) {
+        BasicBlock* target_bb = g.GetBasicBlock(*it);
+        XEASSERTNOTNULL(target_bb);
+        switch_i->addCase(b.getInt64(*it), target_bb);
+      }
+      b.SetInsertPoint(default_bb);
+      return g.GenerateIndirectionBranch(cia, target, lk, false);
+    }
     default:
     case FunctionBlock::kTargetNone:
       XEASSERTALWAYS();
@@ -218,12 +241,11 @@ XEEMITTER(bcx,          0x40000000, B  )(FunctionGenerator& g, IRBuilder<>& b, I
   if (XESELECTBITS(i.B.BO, 4, 4)) {
     // Ignore cond.
   } else {
-    Value* cr = g.cr_value(i.B.BI >> 2);
-    cr = b.CreateAnd(cr, 1 << (i.B.BI & 3));
+    Value* cr_bit = g.cr_bit_value(i.B.BI);
     if (XESELECTBITS(i.B.BO, 3, 3)) {
-      cond_ok = b.CreateICmpNE(cr, b.getInt64(0));
+      cond_ok = cr_bit;
     } else {
-      cond_ok = b.CreateICmpEQ(cr, b.getInt64(0));
+      cond_ok = b.CreateNot(cr_bit);
     }
   }
 
@@ -246,7 +268,8 @@ XEEMITTER(bcx,          0x40000000, B  )(FunctionGenerator& g, IRBuilder<>& b, I
     BasicBlock* branch_bb = BasicBlock::Create(*g.context(), name, g.gen_fn(),
                                                next_block);
 
-    b.CreateCondBr(ok, branch_bb, next_block);
+    g.GenerateConditionalBranch(i.address, i.B.BO, ok, branch_bb,
+                                next_block);
     b.SetInsertPoint(branch_bb);
   }
 
@@ -300,12 +323,11 @@ XEEMITTER(bcctrx,       0x4C000420, XL )(FunctionGenerator& g, IRBuilder<>& b, I
   if (XESELECTBITS(i.XL.BO, 4, 4)) {
     // Ignore cond.
   } else {
-    Value* cr = g.cr_value(i.XL.BI >> 2);
-    cr = b.CreateAnd(cr, 1 << (i.XL.BI & 3));
+    Value* cr_bit = g.cr_bit_value(i.XL.BI);
     if (XESELECTBITS(i.XL.BO, 3, 3)) {
-      cond_ok = b.CreateICmpNE(cr, b.getInt64(0));
+      cond_ok = cr_bit;
     } else {
-      cond_ok = b.CreateICmpEQ(cr, b.getInt64(0));
+      cond_ok = b.CreateNot(cr_bit);
     }
   }
 
@@ -325,7 +347,8 @@ XEEMITTER(bcctrx,       0x4C000420, XL )(FunctionGenerator& g, IRBuilder<>& b, I
     BasicBlock* branch_bb = BasicBlock::Create(*g.context(), name, g.gen_fn(),
                                                next_block);
 
-    b.CreateCondBr(ok, branch_bb, next_block);
+    g.GenerateConditionalBranch(i.address, i.XL.BO, ok, branch_bb,
+                                next_block);
     b.SetInsertPoint(branch_bb);
   }
 
@@ -397,12 +420,11 @@ XEEMITTER(bclrx,        0x4C000020, XL )(FunctionGenerator& g, IRBuilder<>& b, I
   if (XESELECTBITS(i.XL.BO, 4, 4)) {
     // Ignore cond.
   } else {
-    Value* cr = g.cr_value(i.XL.BI >> 2);
-    cr = b.CreateAnd(cr, 1 << (i.XL.BI & 3));
+    Value* cr_bit = g.cr_bit_value(i.XL.BI);
     if (XESELECTBITS(i.XL.BO, 3, 3)) {
-      cond_ok = b.CreateICmpNE(cr, b.getInt64(0));
+      cond_ok = cr_bit;
     } else {
-      cond_ok = b.CreateICmpEQ(cr, b.getInt64(0));
+      cond_ok = b.CreateNot(cr_bit);
     }
   }
 
@@ -426,7 +448,8 @@ XEEMITTER(bclrx,        0x4C000020, XL )(FunctionGenerator& g, IRBuilder<>& b, I
     BasicBlock* branch_bb = BasicBlock::Create(*g.context(), name, g.gen_fn(),
                                                next_block);
 
-    b.CreateCondBr(ok, branch_bb, next_block);
+    g.GenerateConditionalBranch(i.address, i.XL.BO, ok, branch_bb,
+                                next_block);
     b.SetInsertPoint(branch_bb);
   }
 
@@ -679,9 +702,32 @@ XEEMITTER(twi,          0x0C000000, D  )(FunctionGenerator& g, IRBuilder<>& b, I
 
 // Processor control (A-26)
 
+XEDISASMR(mfcr,         0x7C000026, X  )(InstrData& i, InstrDisasm& d) {
+  d.Init("mfcr", "Move From Condition Register", 0);
+  d.AddRegOperand(InstrRegister::kGPR, i.X.RT, InstrRegister::kWrite);
+  for (uint32_t n = 0; n < 8; n++) {
+    d.AddCR(n, InstrRegister::kRead);
+  }
+  return d.Finish();
+}
 XEEMITTER(mfcr,         0x7C000026, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RT <- 32(0) || CR
+
+  // This forces any pending compares to be materialized.
+  // Fields are kept with LT in bit 0 through SO in bit 3, which is reversed
+  // from the guest layout (LT = 8, GT = 4, EQ = 2, SO = 1).
+  Value* v = b.getInt64(0);
+  for (uint32_t n = 0; n < 8; n++) {
+    Value* c = g.cr_value(n);
+    Value* f = b.CreateShl(b.CreateAnd(c, 1), 3);
+    f = b.CreateOr(f, b.CreateShl(b.CreateAnd(c, 2), 1));
+    f = b.CreateOr(f, b.CreateLShr(b.CreateAnd(c, 4), 1));
+    f = b.CreateOr(f, b.CreateLShr(b.CreateAnd(c, 8), 3));
+    v = b.CreateOr(v, b.CreateShl(f, 28 - n * 4));
+  }
+  g.update_gpr_value(i.X.RT, v);
+
+  return 0;
 }
 
 XEDISASMR(mfspr,        0x7C0002A6, XFX)(InstrData& i, InstrDisasm& d) {
@@ -811,7 +857,7 @@ void RegisterEmitCategoryControl() {
   XEREGISTERINSTR(tdi,          0x08000000);
   XEREGISTERINSTR(tw,           0x7C000008);
   XEREGISTERINSTR(twi,          0x0C000000);
-  XEREGISTEREMITTER(mfcr,         0x7C000026);
+  XEREGISTERINSTR(mfcr,         0x7C000026);
   XEREGISTERINSTR(mfspr,        0x7C0002A6);
   XEREGISTEREMITTER(mftb,         0x7C0002E6);
   XEREGISTEREMITTER(mtcrf,        0x7C000120);
@@ -9,7 +9,11 @@
 
 #include <xenia/cpu/codegen/emit.h>
 
+#include <llvm/IR/Intrinsics.h>
+
+#include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/codegen/function_generator.h>
+#include <xenia/cpu/ppc/state.h>
 
 
 using namespace llvm;
@@ -999,6 +1003,109 @@ XEEMITTER(stswx,        0x7C00052A, X  )(FunctionGenerator& g, IRBuilder<>& b, I
 
 // Memory synchronization (A-18)
 
+// Reservations are modeled with a host compare-and-swap: the reserved load
+// remembers the address and the value it read and the store conditional only
+// succeeds if memory still holds that value. This is atomic across host
+// threads but can't see a store that put back the same value (ABA). With
+// --reservation_table stores conditional also bump a version per cache line
+// that the reservation is checked against, which catches that for code that
+// only modifies the line with stwcx/stdcx.
+
+int XeEmitLoadReserved(FunctionGenerator& g, IRBuilder<>& b, InstrData& i,
+                       uint32_t size) {
+  Value* ea = g.gpr_value(i.X.RB);
+  if (i.X.RA) {
+    ea = b.CreateAdd(g.gpr_value(i.X.RA), ea);
+  }
+  ea = b.CreateAnd(ea, UINT_MAX);
+
+  if (FLAGS_reservation_table) {
+    b.CreateCall2(g.gen_module()->getFunction("XeReserve"),
+                  g.gen_fn()->arg_begin(), ea);
+  }
+
+  Type* dataTy = b.getIntNTy(size * 8);
+  Value* ptr = b.CreatePointerCast(g.GetMemoryAddress(i.address, ea),
+                                   PointerType::getUnqual(dataTy));
+  LoadInst* raw = b.CreateLoad(ptr);
+  raw->setAlignment(size);
+  raw->setVolatile(true);
+  raw->setAtomic(Acquire);
+
+  g.StoreStateValue(offsetof(xe_ppc_state_t, reserve_address),
+                    b.getInt64Ty(), ea);
+  g.StoreStateValue(offsetof(xe_ppc_state_t, reserve_value),
+                    b.getInt64Ty(), b.CreateZExt(raw, b.getInt64Ty()));
+
+  Function* bswap = Intrinsic::getDeclaration(
+      g.gen_module(), Intrinsic::bswap, dataTy);
+  Value* v = b.CreateCall(bswap, raw);
+  g.update_gpr_value(i.X.RT, b.CreateZExt(v, b.getInt64Ty()));
+
+  return 0;
+}
+
+int XeEmitStoreConditional(FunctionGenerator& g, IRBuilder<>& b,
+                           InstrData& i, uint32_t size) {
+  Value* ea = g.gpr_value(i.X.RB);
+  if (i.X.RA) {
+    ea = b.CreateAdd(g.gpr_value(i.X.RA), ea);
+  }
+  ea = b.CreateAnd(ea, UINT_MAX);
+
+  Type* dataTy = b.getIntNTy(size * 8);
+  Function* bswap = Intrinsic::getDeclaration(
+      g.gen_module(), Intrinsic::bswap, dataTy);
+  Value* v = b.CreateCall(bswap, b.CreateTrunc(g.gpr_value(i.X.RT), dataTy));
+
+  // The reservation is always cleared, whether the store happens or not.
+  Value* reserve_address = g.LoadStateValue(
+      offsetof(xe_ppc_state_t, reserve_address), b.getInt64Ty());
+  Value* reserve_value = g.LoadStateValue(
+      offsetof(xe_ppc_state_t, reserve_value), b.getInt64Ty());
+  g.StoreStateValue(offsetof(xe_ppc_state_t, reserve_address),
+                    b.getInt64Ty(), b.getInt64(~0ull));
+
+  BasicBlock* entry_bb = b.GetInsertBlock();
+  BasicBlock* store_bb = BasicBlock::Create(*g.context(), "", g.gen_fn());
+  BasicBlock* done_bb = BasicBlock::Create(*g.context(), "", g.gen_fn());
+  b.CreateCondBr(b.CreateICmpEQ(reserve_address, ea), store_bb, done_bb);
+
+  b.SetInsertPoint(store_bb);
+  Value* stored;
+  if (FLAGS_reservation_table) {
+    std::vector<Value*> args;
+    args.push_back(g.gen_fn()->arg_begin());
+    args.push_back(ea);
+    args.push_back(reserve_value);
+    args.push_back(b.CreateZExt(v, b.getInt64Ty()));
+    args.push_back(b.getInt32(size));
+    stored = b.CreateICmpNE(
+        b.CreateCall(g.gen_module()->getFunction("XeStoreConditional"), args),
+        b.getInt32(0));
+  } else {
+    Value* ptr = b.CreatePointerCast(g.GetMemoryAddress(i.address, ea),
+                                     PointerType::getUnqual(dataTy));
+    Value* expected = b.CreateTrunc(reserve_value, dataTy);
+    Value* old = b.CreateAtomicCmpXchg(ptr, expected, v,
+                                       SequentiallyConsistent);
+    stored = b.CreateICmpEQ(old, expected);
+  }
+  // The call may have split the block.
+  store_bb = b.GetInsertBlock();
+  b.CreateBr(done_bb);
+
+  b.SetInsertPoint(done_bb);
+  PHINode* n = b.CreatePHI(b.getInt1Ty(), 2);
+  n->addIncoming(b.getFalse(), entry_bb);
+  n->addIncoming(stored, store_bb);
+
+  // TODO(benvanik): XER[SO]
+  g.update_cr_value(0, b.CreateSelect(n, b.getInt8(1 << 2), b.getInt8(0)));
+
+  return 0;
+}
+
 XEEMITTER(eieio,        0x7C0006AC, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
   XEINSTRNOTIMPLEMENTED();
   return 1;
@@ -1009,9 +1116,29 @@ XEEMITTER(isync,        0x4C00012C, XL )(FunctionGenerator& g, IRBuilder<>& b, I
   return 1;
 }
 
+XEDISASMR(ldarx,        0x7C0000A8, X  )(InstrData& i, InstrDisasm& d) {
+  d.Init("ldarx", "Load Doubleword And Reserve Indexed", 0);
+  d.AddRegOperand(InstrRegister::kGPR, i.X.RT, InstrRegister::kWrite);
+  if (i.X.RA) {
+    d.AddRegOperand(InstrRegister::kGPR, i.X.RA, InstrRegister::kRead);
+  } else {
+    d.AddUImmOperand(0, 1);
+  }
+  d.AddRegOperand(InstrRegister::kGPR, i.X.RB, InstrRegister::kRead);
+  return d.Finish();
+}
 XEEMITTER(ldarx,        0x7C0000A8, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // if RA = 0 then
+  //   b <- 0
+  // else
+  //   b <- (RA)
+  // EA <- b + (RB)
+  // RESERVE <- 1
+  // RESERVE_LENGTH <- 8
+  // RESERVE_ADDR <- real_addr(EA)
+  // RT <- MEM(EA, 8)
+
+  return XeEmitLoadReserved(g, b, i, 8);
 }
 
 XEDISASMR(lwarx,        0x7C000028, X  )(InstrData& i, InstrDisasm& d) {
@@ -1036,28 +1163,40 @@ XEEMITTER(lwarx,        0x7C000028, X  )(FunctionGenerator& g, IRBuilder<>& b, I
   // RESERVE_ADDR <- real_addr(EA)
   // RT <- i32.0 || MEM(EA, 4)
 
-  // TODO(benvanik): make this right
+  return XeEmitLoadReserved(g, b, i, 4);
+}
 
-  Value* ea = g.gpr_value(i.X.RB);
+XEDISASMR(stdcx,        0x7C0001AD, X  )(InstrData& i, InstrDisasm& d) {
+  d.Init("stdcx", "Store Doubleword Conditional Indexed",
+      InstrDisasm::kRc);
+  d.AddRegOperand(InstrRegister::kGPR, i.X.RT, InstrRegister::kRead);
   if (i.X.RA) {
-    ea = b.CreateAdd(g.gpr_value(i.X.RA), ea);
+    d.AddRegOperand(InstrRegister::kGPR, i.X.RA, InstrRegister::kRead);
+  } else {
+    d.AddUImmOperand(0, 1);
   }
-  Value* v = g.ReadMemory(i.address, ea, 4, /* acquire */ true);
-  g.update_gpr_value(i.X.RT, v);
-
-  return 0;
+  d.AddRegOperand(InstrRegister::kGPR, i.X.RB, InstrRegister::kRead);
+  return d.Finish();
 }
-
 XEEMITTER(stdcx,        0x7C0001AD, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // if RA = 0 then
+  //   b <- 0
+  // else
+  //   b <- (RA)
+  // EA <- b + (RB)
+  // RESERVE stuff...
+  // MEM(EA, 8) <- (RS)
+  // n <- 1 if store performed
+  // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
+
+  return XeEmitStoreConditional(g, b, i, 8);
 }
 
 XEDISASMR(stwcx,        0x7C00012D, X  )(InstrData& i, InstrDisasm& d) {
   d.Init("stwcx", "Store Word Conditional Indexed",
       InstrDisasm::kRc);
   d.AddRegOperand(InstrRegister::kGPR, i.X.RT, InstrRegister::kRead);
-  if (i.D.RA) {
+  if (i.X.RA) {
     d.AddRegOperand(InstrRegister::kGPR, i.X.RA, InstrRegister::kRead);
   } else {
     d.AddUImmOperand(0, 1);
@@ -1076,24 +1215,13 @@ XEEMITTER(stwcx,        0x7C00012D, X  )(FunctionGenerator& g, IRBuilder<>& b, I
   // n <- 1 if store performed
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
 
-  // TODO(benvanik): make this right
-
-  Value* ea = b.getInt64(XEEXTS16(i.D.DS));
-  if (i.D.RA) {
-    ea = b.CreateAdd(g.gpr_value(i.D.RA), ea);
-  }
-  Value* v = g.gpr_value(i.D.RT);
-  g.WriteMemory(i.address, ea, 4, v, /* release */ true);
-
-  // We always succeed.
-  g.update_cr_value(0, b.getInt64(1 << 2));
-
-  return 0;
+  return XeEmitStoreConditional(g, b, i, 4);
 }
 
 XEEMITTER(sync,         0x7C0004AC, X  )(FunctionGenerator& g, IRBuilder<>& b, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // Also covers lwsync (L=1), which only needs to be weaker than this.
+  b.CreateFence(SequentiallyConsistent);
+  return 0;
 }
 
 
@@ -1643,9 +1771,9 @@ void RegisterEmitCategoryMemory() {
   XEREGISTEREMITTER(stswx,        0x7C00052A);
   XEREGISTEREMITTER(eieio,        0x7C0006AC);
   XEREGISTEREMITTER(isync,        0x4C00012C);
-  XEREGISTEREMITTER(ldarx,        0x7C0000A8);
+  XEREGISTERINSTR(ldarx,        0x7C0000A8);
   XEREGISTERINSTR(lwarx,        0x7C000028);
-  XEREGISTEREMITTER(stdcx,        0x7C0001AD);
+  XEREGISTERINSTR(stdcx,        0x7C0001AD);
   XEREGISTERINSTR(stwcx,        0x7C00012D);
   XEREGISTEREMITTER(sync,         0x7C0004AC);
   XEREGISTERINSTR(lfd,          0xC8000000);
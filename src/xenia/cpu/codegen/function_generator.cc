@@ -10,23 +10,162 @@
 #include <xenia/cpu/codegen/function_generator.h>
 
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/Support/MDBuilder.h>
 
 #include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/ppc/state.h>
 
 
 using namespace llvm;
+using namespace xe::cpu;
 using namespace xe::cpu::codegen;
 using namespace xe::cpu::ppc;
 using namespace xe::cpu::sdb;
 
 
-DEFINE_bool(memory_address_verification, false,
-    "Whether to add additional checks to generated memory load/stores.");
 DEFINE_bool(log_codegen, false,
     "Log codegen to stdout.");
 
 
+namespace {
+
+const uint64_t kRegisterReadBits = 0x5555555555555555ull;
+
+bool IsUnconditionalBranch(InstrData& i) {
+  uint32_t opcode = i.code >> 26;
+  switch (opcode) {
+    case 18:  // b
+      return true;
+    case 16:  // bc
+      return (i.B.BO & 0x14) == 0x14;
+    case 19:  // bclr/bcctr
+      switch ((i.code >> 1) & 0x3FF) {
+        case 16:
+        case 528:
+          return (i.XL.BO & 0x14) == 0x14;
+      }
+      break;
+  }
+  return false;
+}
+
+bool IsBranchAndLink(InstrData& i) {
+  uint32_t opcode = i.code >> 26;
+  return (opcode == 16 || opcode == 18 || opcode == 19) && (i.code & 1);
+}
+
+}
+
+
+RegisterSet RegisterSet::FromReads(const InstrAccessBits& bits) {
+  RegisterSet set;
+  set.spr = bits.spr & kRegisterReadBits;
+  set.cr  = bits.cr  & kRegisterReadBits;
+  set.gpr = bits.gpr & kRegisterReadBits;
+  set.fpr = bits.fpr & kRegisterReadBits;
+  for (size_t n = 0; n < XECOUNT(set.vmx); n++) {
+    set.vmx[n] = bits.vmx[n] & kRegisterReadBits;
+  }
+  return set;
+}
+
+RegisterSet RegisterSet::FromWrites(const InstrAccessBits& bits) {
+  RegisterSet set;
+  set.spr = (bits.spr >> 1) & kRegisterReadBits;
+  set.cr  = (bits.cr  >> 1) & kRegisterReadBits;
+  set.gpr = (bits.gpr >> 1) & kRegisterReadBits;
+  set.fpr = (bits.fpr >> 1) & kRegisterReadBits;
+  for (size_t n = 0; n < XECOUNT(set.vmx); n++) {
+    set.vmx[n] = (bits.vmx[n] >> 1) & kRegisterReadBits;
+  }
+  return set;
+}
+
+RegisterSet RegisterSet::XER() {
+  RegisterSet set;
+  set.spr = 1ull << (2 * 0);
+  return set;
+}
+
+RegisterSet RegisterSet::LR() {
+  RegisterSet set;
+  set.spr = 1ull << (2 * 1);
+  return set;
+}
+
+RegisterSet RegisterSet::CTR() {
+  RegisterSet set;
+  set.spr = 1ull << (2 * 2);
+  return set;
+}
+
+RegisterSet RegisterSet::CR(uint32_t n) {
+  RegisterSet set;
+  set.cr = 1ull << (2 * n);
+  return set;
+}
+
+RegisterSet RegisterSet::GPR(uint32_t n) {
+  RegisterSet set;
+  set.gpr = 1ull << (2 * n);
+  return set;
+}
+
+RegisterSet RegisterSet::FPR(uint32_t n) {
+  RegisterSet set;
+  set.fpr = 1ull << (2 * n);
+  return set;
+}
+
+RegisterSet RegisterSet::VMX(uint32_t n) {
+  RegisterSet set;
+  set.vmx[n / 32] = 1ull << (2 * (n % 32));
+  return set;
+}
+
+void RegisterSet::Union(const RegisterSet& other) {
+  spr |= other.spr;
+  cr  |= other.cr;
+  gpr |= other.gpr;
+  fpr |= other.fpr;
+  for (size_t n = 0; n < XECOUNT(vmx); n++) {
+    vmx[n] |= other.vmx[n];
+  }
+}
+
+void RegisterSet::Subtract(const RegisterSet& other) {
+  spr &= ~other.spr;
+  cr  &= ~other.cr;
+  gpr &= ~other.gpr;
+  fpr &= ~other.fpr;
+  for (size_t n = 0; n < XECOUNT(vmx); n++) {
+    vmx[n] &= ~other.vmx[n];
+  }
+}
+
+bool RegisterSet::Contains(const RegisterSet& other) const {
+  for (size_t n = 0; n < XECOUNT(vmx); n++) {
+    if ((vmx[n] & other.vmx[n]) != other.vmx[n]) {
+      return false;
+    }
+  }
+  return (spr & other.spr) == other.spr &&
+         (cr  & other.cr)  == other.cr &&
+         (gpr & other.gpr) == other.gpr &&
+         (fpr & other.fpr) == other.fpr;
+}
+
+bool RegisterSet::Equals(const RegisterSet& other) const {
+  for (size_t n = 0; n < XECOUNT(vmx); n++) {
+    if (vmx[n] != other.vmx[n]) {
+      return false;
+    }
+  }
+  return spr == other.spr && cr == other.cr &&
+         gpr == other.gpr && fpr == other.fpr;
+}
+
+
 /**
  * This generates function code.
  * One context is created for each function to generate. Each basic block in
@@ -37,33 +176,106 @@ DEFINE_bool(log_codegen, false,
  * possible to exploit the SSA nature of LLVM to reuse register values within
  * a function without needing to flush to memory.
  *
- * Function calls (any branch outside of the function) will result in an
- * expensive flush of registers.
+ * Function calls (any branch outside of the function) will result in a flush
+ * of the registers written since the last call. Registers are only reloaded
+ * if they are read before being written again.
+ *
+ * When generating register functions the argument registers are passed in as
+ * LLVM arguments and the result is returned. The state is still kept up to
+ * date so that the function can be entered or left through it at any point.
  *
- * TODO(benvanik): track arguments by looking for register reads without writes
  * TODO(benvanik): avoid flushing registers for leaf nodes
- * TODO(benvnaik): pass return value in LLVM return, not by memory
  */
 
 
 FunctionGenerator::FunctionGenerator(
     xe_memory_ref memory, SymbolDatabase* sdb, FunctionSymbol* fn,
-    LLVMContext* context, Module* gen_module, Function* gen_fn) {
+    LLVMContext* context, Module* gen_module, Function* gen_fn,
+    uint32_t host_features, ModuleProfile* profile) {
   memory_ = memory;
   sdb_ = sdb;
   fn_ = fn;
   context_ = context;
   gen_module_ = gen_module;
   gen_fn_ = gen_fn;
+  host_features_ = host_features;
+  profile_ = profile;
   builder_ = new IRBuilder<>(*context_);
+  track_registers_ = true;
+
+  // Debug locations need a scope, so use the compile unit of the module.
+  NamedMDNode* cu_list = gen_module_->getNamedMetadata("llvm.dbg.cu");
+  cu_ = cu_list ? cu_list->getOperand(0) : NULL;
+  XEASSERTNOTNULL(cu_);
+
+  Reset();
+
+  if (FLAGS_log_codegen) {
+    printf("%s:\n", fn->name());
+  }
+}
+
+FunctionGenerator::~FunctionGenerator() {
+  delete builder_;
+}
+
+void FunctionGenerator::GetRegisterFunctionName(FunctionSymbol* fn,
+                                                char* buffer,
+                                                size_t buffer_count) {
+  xesnprintfa(buffer, buffer_count, "%s.regs", fn->name());
+}
+
+FunctionType* FunctionGenerator::GetRegisterFunctionType(
+    LLVMContext& context, FunctionSymbol* fn) {
+  // (state, lr, gpr args..., fpr args...), returning r3 or f1 if the
+  // function sets them.
+  std::vector<Type*> args;
+  args.push_back(PointerType::getUnqual(Type::getInt8Ty(context)));
+  args.push_back(Type::getInt64Ty(context));
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_gprs & (1 << n)) {
+      args.push_back(Type::getInt64Ty(context));
+    }
+  }
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_fprs & (1 << n)) {
+      args.push_back(Type::getDoubleTy(context));
+    }
+  }
+  Type* return_type = Type::getVoidTy(context);
+  if (fn->return_gprs & (1 << 3)) {
+    return_type = Type::getInt64Ty(context);
+  } else if (fn->return_fprs & (1 << 1)) {
+    return_type = Type::getDoubleTy(context);
+  }
+  return FunctionType::get(return_type, ArrayRef<Type*>(args), false);
+}
+
+void FunctionGenerator::Reset() {
   fn_block_ = NULL;
-  return_block_ = NULL;
   internal_indirection_block_ = NULL;
   external_indirection_block_ = NULL;
   bb_ = NULL;
+  insert_points_.clear();
+  bbs_.clear();
 
   access_bits_.Clear();
+  register_mismatch_ = false;
+  all_registers_ = RegisterSet();
+  block_registers_.clear();
+  valid_registers_ = RegisterSet();
+  dirty_registers_ = RegisterSet();
+  written_registers_ = RegisterSet();
+  indirection_dirty_registers_ = RegisterSet();
+  call_result_ = NULL;
+  flags_block_ = NULL;
+  ClearPendingFlags();
+  inherited_flags_.clear();
+  for (size_t n = 0; n < XECOUNT(vmx_constants_); n++) {
+    vmx_constants_[n] = NULL;
+  }
 
+  locals_.membase = NULL;
   locals_.indirection_target = NULL;
   locals_.indirection_cia = NULL;
 
@@ -79,16 +291,11 @@ FunctionGenerator::FunctionGenerator(
   for (size_t n = 0; n < XECOUNT(locals_.fpr); n++) {
     locals_.fpr[n] = NULL;
   }
-
-  if (FLAGS_log_codegen) {
-    printf("%s:\n", fn->name());
+  for (size_t n = 0; n < XECOUNT(locals_.vmx); n++) {
+    locals_.vmx[n] = NULL;
   }
 }
 
-FunctionGenerator::~FunctionGenerator() {
-  delete builder_;
-}
-
 SymbolDatabase* FunctionGenerator::sdb() {
   return sdb_;
 }
@@ -109,6 +316,10 @@ llvm::Function* FunctionGenerator::gen_fn() {
   return gen_fn_;
 }
 
+uint32_t FunctionGenerator::host_features() {
+  return host_features_;
+}
+
 FunctionBlock* FunctionGenerator::fn_block() {
   return fn_block_;
 }
@@ -127,6 +338,22 @@ void FunctionGenerator::PopInsertPoint() {
 }
 
 void FunctionGenerator::GenerateBasicBlocks() {
+  GenerateFunctionBody();
+
+  if (register_mismatch_) {
+    // The emitters touched registers in ways the disassemblers did not report,
+    // so the liveness info cannot be trusted. Start over and fill/spill every
+    // register the function uses.
+    XELOGCPU("Register usage mismatch in %.8X %s, regenerating",
+             fn_->start_address, fn_->name());
+    gen_fn_->deleteBody();
+    Reset();
+    track_registers_ = false;
+    GenerateFunctionBody();
+  }
+}
+
+void FunctionGenerator::GenerateFunctionBody() {
   IRBuilder<>& b = *builder_;
 
   // Always add an entry block.
@@ -146,15 +373,10 @@ void FunctionGenerator::GenerateBasicBlocks() {
 
   // If this function is empty, abort!
   if (!fn_->blocks.size()) {
-    b.CreateRetVoid();
+    GenerateReturn();
     return;
   }
 
-  // Create a return block.
-  // This spills registers and returns. All non-tail returns should branch
-  // here to do the return and ensure registers are spilled.
-  return_block_ = BasicBlock::Create(*context_, "return", gen_fn_);
-
   // Pass 1 creates all of the blocks - this way we can branch to them.
   // We also track registers used so that when know which ones to fill/spill.
   for (std::map<uint32_t, FunctionBlock*>::iterator it = fn_->blocks.begin();
@@ -162,6 +384,7 @@ void FunctionGenerator::GenerateBasicBlocks() {
     FunctionBlock* block = it->second;
     XEIGNORE(PrepareBasicBlock(block));
   }
+  AnalyzeRegisters();
 
   // Setup all local variables now that we know what we need.
   SetupLocals();
@@ -181,42 +404,72 @@ void FunctionGenerator::GenerateBasicBlocks() {
 void FunctionGenerator::GenerateSharedBlocks() {
   IRBuilder<>& b = *builder_;
 
-  Value* indirect_branch = gen_module_->getFunction("XeIndirectBranch");
-
   // Setup initial register fill in the entry block.
   // We can only do this once all the locals have been created.
   b.SetInsertPoint(&gen_fn_->getEntryBlock());
-  FillRegisters();
+  RegisterSet entry_registers = track_registers_ ?
+      block_registers_[bbs_.begin()->first].live_in : all_registers_;
+  if (gen_fn_->arg_size() > 2) {
+    // Register functions get the argument registers passed in, so there's
+    // no need to load them.
+    Function::arg_iterator args = gen_fn_->arg_begin();
+    ++args;
+    ++args;
+    for (uint32_t n = 0; n < 32; n++) {
+      if (fn_->arg_gprs & (1 << n)) {
+        Value* arg = args++;
+        if (locals_.gpr[n]) {
+          b.CreateStore(arg, locals_.gpr[n]);
+        }
+        entry_registers.Subtract(RegisterSet::GPR(n));
+      }
+    }
+    for (uint32_t n = 0; n < 32; n++) {
+      if (fn_->arg_fprs & (1 << n)) {
+        Value* arg = args++;
+        if (locals_.fpr[n]) {
+          b.CreateStore(arg, locals_.fpr[n]);
+        }
+        entry_registers.Subtract(RegisterSet::FPR(n));
+      }
+    }
+    XEASSERT(args == gen_fn_->arg_end());
+  }
+  FillRegisters(entry_registers);
   // Entry always falls through to the second block.
   b.CreateBr(bbs_.begin()->second);
 
-  // Setup the spill block in return.
-  b.SetInsertPoint(return_block_);
-  SpillRegisters();
-  b.CreateRetVoid();
-
   // Build indirection block on demand.
   // We have already prepped all basic blocks, so we can build these tables now.
   if (external_indirection_block_) {
-    // This will spill registers and call the external function.
+    // This will call the external function. Registers have already been
+    // spilled by whoever branched here.
     // It is only meant for LK=0.
     b.SetInsertPoint(external_indirection_block_);
-    SpillRegisters();
-    b.CreateCall3(indirect_branch,
-                  gen_fn_->arg_begin(),
-                  b.CreateLoad(locals_.indirection_target),
-                  b.CreateLoad(locals_.indirection_cia));
-    b.CreateRetVoid();
+    CallIndirectionTarget(b.CreateLoad(locals_.indirection_target),
+                          b.CreateLoad(locals_.indirection_cia),
+                          ++gen_fn_->arg_begin());
+    GenerateReturn();
   }
 
   if (internal_indirection_block_) {
     // This will not spill registers and instead try to switch on local blocks.
     // If it fails then the external indirection path is taken.
     // NOTE: we only generate this if a likely local branch is taken.
+    // Targets that miss spill everything that was dirty at any of the local
+    // indirection sites. All of those registers are live at each site, as
+    // the switch may branch to any block.
+    BasicBlock* miss_bb = BasicBlock::Create(
+        *context_, "internal_indirection_miss", gen_fn_);
+    b.SetInsertPoint(miss_bb);
+    SpillRegisters(track_registers_ ?
+        indirection_dirty_registers_ : all_registers_);
+    b.CreateBr(external_indirection_block_);
+
     b.SetInsertPoint(internal_indirection_block_);
     SwitchInst* switch_i = b.CreateSwitch(
         b.CreateLoad(locals_.indirection_target),
-        external_indirection_block_,
+        miss_bb,
         static_cast<int>(bbs_.size()));
     for (std::map<uint32_t, BasicBlock*>::iterator it = bbs_.begin();
          it != bbs_.end(); ++it) {
@@ -233,44 +486,155 @@ int FunctionGenerator::PrepareBasicBlock(FunctionBlock* block) {
   BasicBlock* bb = BasicBlock::Create(*context_, name, gen_fn_);
   bbs_.insert(std::pair<uint32_t, BasicBlock*>(block->start_address, bb));
 
-  // Scan and disassemble each instruction in the block to get accurate
-  // register access bits. In the future we could do other optimization checks
-  // in this pass.
-  // TODO(benvanik): perhaps we want to stash this for each basic block?
-  // We could use this for faster checking of cr/ca checks/etc.
+  // Gather the register access bits of each instruction in the block. These
+  // were computed when the instructions were decoded during analysis.
+  // The accesses are tracked in order so that we know which registers are
+  // read before being written in the block.
   InstrAccessBits access_bits;
-  uint8_t* p = xe_memory_addr(memory_, 0);
-  for (uint32_t ia = block->start_address; ia <= block->end_address; ia += 4) {
-    InstrData i;
-    i.address = ia;
-    i.code = XEGETUINT32BE(p + ia);
-    i.type = ppc::GetInstrType(i.code);
-
-    // Ignore unknown or ones with no disassembler fn.
-    if (!i.type || !i.type->disassemble) {
-      continue;
-    }
-
-    // We really need to know the registers modified, so die if we've been lazy
-    // and haven't implemented the disassemble method yet.
-    ppc::InstrDisasm d;
-    XEASSERTNOTNULL(i.type->disassemble);
-    int result_code = i.type->disassemble(i, d);
-    XEASSERTZERO(result_code);
-    if (result_code) {
-      return result_code;
+  BlockRegisters& regs = block_registers_[block->start_address];
+  for (std::vector<FunctionInstr>::iterator it = block->instrs.begin();
+       it != block->instrs.end(); ++it) {
+    InstrData& i = it->i;
+
+    // Figure out how the block ends.
+    if (i.address == block->end_address) {
+      bool lk = IsBranchAndLink(i);
+      regs.falls_through = lk || !IsUnconditionalBranch(i);
+      regs.refills =
+          lk && IsUnconditionalBranch(i) &&
+          block->outgoing_type == FunctionBlock::kTargetFunction;
     }
 
     // Accumulate access bits.
-    access_bits.Extend(d.access_bits);
+    InstrAccessBits instr_access_bits;
+    it->access_mask.Unpack(instr_access_bits);
+    access_bits.Extend(instr_access_bits);
+
+    // XER updates only change a few bits, so they also read it.
+    RegisterSet reads = RegisterSet::FromReads(instr_access_bits);
+    RegisterSet writes = RegisterSet::FromWrites(instr_access_bits);
+    if (writes.Contains(RegisterSet::XER())) {
+      reads.Union(RegisterSet::XER());
+    }
+    reads.Subtract(regs.defs);
+    regs.uses.Union(reads);
+    regs.defs.Union(writes);
   }
 
   // Add in access bits to function access bits.
   access_bits_.Extend(access_bits);
+  all_registers_.Union(RegisterSet::FromReads(access_bits));
+  all_registers_.Union(RegisterSet::FromWrites(access_bits));
 
   return 0;
 }
 
+void FunctionGenerator::AnalyzeRegisters() {
+  // Link up the blocks. This is conservative - extra edges only cost us some
+  // extra fills/spills.
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn_->blocks.begin();
+       it != fn_->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    BlockRegisters& regs = block_registers_[block->start_address];
+    std::map<uint32_t, FunctionBlock*>::iterator next_it = it;
+    ++next_it;
+    if (regs.falls_through && next_it != fn_->blocks.end()) {
+      regs.successors.push_back(next_it->first);
+    }
+    switch (block->outgoing_type) {
+    case FunctionBlock::kTargetBlock:
+      if (fn_->blocks.count(block->outgoing_address)) {
+        regs.successors.push_back(block->outgoing_address);
+      }
+      break;
+    case FunctionBlock::kTargetJumpTable:
+      for (std::vector<uint32_t>::iterator target_it =
+           block->jump_table.begin(); target_it != block->jump_table.end();
+           ++target_it) {
+        if (fn_->blocks.count(*target_it)) {
+          regs.successors.push_back(*target_it);
+        }
+      }
+      break;
+    case FunctionBlock::kTargetCTR:
+      // May go through the internal indirection table to any block.
+      for (std::map<uint32_t, FunctionBlock*>::iterator target_it =
+           fn_->blocks.begin(); target_it != fn_->blocks.end(); ++target_it) {
+        regs.successors.push_back(target_it->first);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // The first block is also entered from the entry block.
+  block_registers_[fn_->blocks.begin()->first].predecessors++;
+  for (std::map<uint32_t, BlockRegisters>::iterator it =
+       block_registers_.begin(); it != block_registers_.end(); ++it) {
+    BlockRegisters& regs = it->second;
+    for (std::vector<uint32_t>::iterator succ_it = regs.successors.begin();
+         succ_it != regs.successors.end(); ++succ_it) {
+      block_registers_[*succ_it].predecessors++;
+    }
+  }
+
+  if (!track_registers_) {
+    return;
+  }
+
+  // Forward pass: registers that may have been written since the last fill.
+  // Calls that refill clear this out, as everything was spilled before them.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::map<uint32_t, BlockRegisters>::iterator it =
+         block_registers_.begin(); it != block_registers_.end(); ++it) {
+      BlockRegisters& regs = it->second;
+      if (regs.refills) {
+        continue;
+      }
+      RegisterSet dirty_out = regs.dirty_in;
+      dirty_out.Union(regs.defs);
+      for (std::vector<uint32_t>::iterator succ_it = regs.successors.begin();
+           succ_it != regs.successors.end(); ++succ_it) {
+        BlockRegisters& succ = block_registers_[*succ_it];
+        if (!succ.dirty_in.Contains(dirty_out)) {
+          succ.dirty_in.Union(dirty_out);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Backward pass: registers that must hold valid values on entry to each
+  // block. Anything dirty must be valid as it may be spilled, and the fill
+  // after a refilling call covers everything after it.
+  changed = true;
+  while (changed) {
+    changed = false;
+    for (std::map<uint32_t, BlockRegisters>::reverse_iterator it =
+         block_registers_.rbegin(); it != block_registers_.rend(); ++it) {
+      BlockRegisters& regs = it->second;
+      RegisterSet live_in;
+      if (!regs.refills) {
+        for (std::vector<uint32_t>::iterator succ_it =
+             regs.successors.begin(); succ_it != regs.successors.end();
+             ++succ_it) {
+          live_in.Union(block_registers_[*succ_it].live_in);
+        }
+        live_in.Subtract(regs.defs);
+      }
+      live_in.Union(regs.uses);
+      live_in.Union(regs.dirty_in);
+      if (!live_in.Equals(regs.live_in)) {
+        regs.live_in = live_in;
+        changed = true;
+      }
+    }
+  }
+}
+
 void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
   IRBuilder<>& b = *builder_;
 
@@ -284,6 +648,23 @@ void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
   fn_block_ = block;
   bb_ = bb;
 
+  // Start tracking register state from what the analysis guarantees.
+  BlockRegisters& regs = block_registers_[block->start_address];
+  valid_registers_ = regs.live_in;
+  dirty_registers_ = regs.dirty_in;
+  written_registers_ = RegisterSet();
+  flags_block_ = bb;
+  ClearPendingFlags();
+  std::map<uint32_t, PendingFlags>::iterator inherited_it =
+      inherited_flags_.find(block->start_address);
+  if (inherited_it != inherited_flags_.end()) {
+    pending_flags_ = inherited_it->second;
+    inherited_flags_.erase(inherited_it);
+  }
+  for (size_t n = 0; n < XECOUNT(vmx_constants_); n++) {
+    vmx_constants_[n] = NULL;
+  }
+
   // Move the builder to this block and setup.
   b.SetInsertPoint(bb);
   //i->setMetadata("some.name", MDNode::get(context, MDString::get(context, pname)));
@@ -293,13 +674,19 @@ void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
   Value* traceInstruction =
       gen_module_->getFunction("XeTraceInstruction");
 
-  // Walk instructions in block.
-  uint8_t* p = xe_memory_addr(memory_, 0);
-  for (uint32_t ia = block->start_address; ia <= block->end_address; ia += 4) {
-    InstrData i;
-    i.address = ia;
-    i.code = XEGETUINT32BE(p + ia);
-    i.type = ppc::GetInstrType(i.code);
+  // Walk the instructions in the block, as decoded during analysis.
+  for (std::vector<FunctionInstr>::iterator it = block->instrs.begin();
+       it != block->instrs.end(); ++it) {
+    InstrData i = it->i;
+    uint32_t ia = i.address;
+
+    // If the last instruction branched around then flags it left pending
+    // are materialized where it started, and we continue from the join.
+    if (b.GetInsertBlock() != flags_block_) {
+      FlushPendingFlags();
+      ClearPendingFlags();
+      flags_block_ = b.GetInsertBlock();
+    }
 
     if (FLAGS_trace_instructions) {
       SpillRegisters();
@@ -333,9 +720,10 @@ void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
       }
     }
 
-    // TODO(benvanik): debugging information? source/etc?
-    // builder_>SetCurrentDebugLocation(DebugLoc::get(
-    //     ia >> 8, ia & 0xFF, ctx->cu));
+    // Tag everything generated for the instruction with its address so that
+    // faults in the native code can be mapped back to it. The address is
+    // split across the line (24 bits) and column (8 bits).
+    b.SetCurrentDebugLocation(DebugLoc::get(ia >> 8, ia & 0xFF, cu_));
 
     typedef int (*InstrEmitter)(FunctionGenerator& g, IRBuilder<>& b,
                                 InstrData& i);
@@ -355,6 +743,13 @@ void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
     }
   }
 
+  // The next blocks read the flags from the locals, unless they can take
+  // over the pending compares.
+  if (!HandOffPendingFlags(block)) {
+    FlushPendingFlags();
+  }
+  ClearPendingFlags();
+
   // If we fall through, create the branch.
   if (block->outgoing_type == FunctionBlock::kTargetNone) {
     BasicBlock* next_bb = GetNextBasicBlock();
@@ -365,10 +760,14 @@ void FunctionGenerator::GenerateBasicBlock(FunctionBlock* block) {
     // TODO(benvanik): assert this doesn't occur - means a bad sdb run!
     XELOGCPU("SDB function scan error in %.8X: bb %.8X has unknown exit",
              fn_->start_address, block->start_address);
-    b.CreateRetVoid();
+    GenerateReturn();
   }
 
-  // TODO(benvanik): finish up BB
+  // Everything the analysis thinks was written has to have been, otherwise
+  // later blocks will use values that were never loaded.
+  if (!written_registers_.Contains(regs.defs)) {
+    register_mismatch_ = true;
+  }
 }
 
 BasicBlock* FunctionGenerator::GetBasicBlock(uint32_t address) {
@@ -390,7 +789,16 @@ BasicBlock* FunctionGenerator::GetNextBasicBlock() {
 }
 
 BasicBlock* FunctionGenerator::GetReturnBasicBlock() {
-  return return_block_;
+  // Each return gets its own block so that it only spills the registers that
+  // are dirty at that point.
+  IRBuilder<>& b = *builder_;
+  BasicBlock* return_bb = BasicBlock::Create(*context_, "return", gen_fn_);
+  PushInsertPoint();
+  b.SetInsertPoint(return_bb);
+  SpillRegisters();
+  GenerateReturn();
+  PopInsertPoint();
+  return return_bb;
 }
 
 Function* FunctionGenerator::GetFunction(FunctionSymbol* fn) {
@@ -403,6 +811,214 @@ Function* FunctionGenerator::GetFunction(FunctionSymbol* fn) {
   return result;
 }
 
+Function* FunctionGenerator::GetRegisterFunction(FunctionSymbol* fn) {
+  // Only functions that were generated with the module have these.
+  char name[256];
+  GetRegisterFunctionName(fn, name, XECOUNT(name));
+  return gen_module_->getFunction(StringRef(name));
+}
+
+void FunctionGenerator::CallFunction(FunctionSymbol* fn, Value* lr) {
+  // Calls the given function directly. Registers must have been spilled
+  // before calling this, so the locals and the state agree and either can be
+  // used for the arguments.
+  IRBuilder<>& b = *builder_;
+  call_result_ = NULL;
+
+  if (FLAGS_native_replacements && GenerateNativeCall(fn)) {
+    return;
+  }
+
+  Function* reg_fn = GetRegisterFunction(fn);
+  if (!reg_fn) {
+    CallInst* call = b.CreateCall2(GetFunction(fn), gen_fn_->arg_begin(), lr);
+    call->setCallingConv(CallingConv::Fast);
+    return;
+  }
+
+  std::vector<Value*> args;
+  args.push_back(gen_fn_->arg_begin());
+  args.push_back(lr);
+  for (uint32_t n = 0; n < 32; n++) {
+    if (!(fn->arg_gprs & (1 << n))) {
+      continue;
+    }
+    if (locals_.gpr[n] && (!track_registers_ ||
+                           valid_registers_.Contains(RegisterSet::GPR(n)))) {
+      args.push_back(b.CreateLoad(locals_.gpr[n]));
+    } else {
+      args.push_back(LoadStateValue(
+          (uint32_t)offsetof(xe_ppc_state_t, r) + 8 * n, b.getInt64Ty()));
+    }
+  }
+  for (uint32_t n = 0; n < 32; n++) {
+    if (!(fn->arg_fprs & (1 << n))) {
+      continue;
+    }
+    if (locals_.fpr[n] && (!track_registers_ ||
+                           valid_registers_.Contains(RegisterSet::FPR(n)))) {
+      args.push_back(b.CreateLoad(locals_.fpr[n]));
+    } else {
+      args.push_back(LoadStateValue(
+          (uint32_t)offsetof(xe_ppc_state_t, f) + 8 * n, b.getDoubleTy()));
+    }
+  }
+
+  CallInst* call = b.CreateCall(reg_fn, args);
+  call->setCallingConv(CallingConv::Fast);
+  if (!reg_fn->getReturnType()->isVoidTy()) {
+    call_result_ = call;
+  }
+}
+
+bool FunctionGenerator::GenerateNativeCall(FunctionSymbol* fn) {
+  // Replaces a call to a known helper with code doing the same thing. The
+  // registers have been spilled, so everything works on the state just like
+  // the real function would.
+  IRBuilder<>& b = *builder_;
+  const uint32_t cia = fn->start_address;
+  const uint32_t r = (uint32_t)offsetof(xe_ppc_state_t, r);
+  Type* i64Ty = b.getInt64Ty();
+
+  if (fn->flags & FunctionSymbol::kFlagSaveGprLr) {
+    // __savegprlr_n: std rn..r31 below the stack pointer, then stw r12
+    // (holding the LR) at -8.
+    uint32_t first = 33 - (fn->end_address - fn->start_address) / 4;
+    Value* sp = LoadStateValue(r + 8 * 1, i64Ty);
+    for (uint32_t n = first; n <= 31; n++) {
+      WriteMemory(cia, b.CreateSub(sp, b.getInt64(8 * (33 - n))), 8,
+                  LoadStateValue(r + 8 * n, i64Ty));
+    }
+    WriteMemory(cia, b.CreateSub(sp, b.getInt64(8)), 4,
+                b.CreateTrunc(LoadStateValue(r + 8 * 12, i64Ty),
+                              b.getInt32Ty()));
+    return true;
+  } else if (fn->flags & FunctionSymbol::kFlagRestGprLr) {
+    // __restgprlr_n: ld rn..r31 from below the stack pointer, then lwz r12
+    // from -8 and mtlr r12.
+    uint32_t first = 34 - (fn->end_address - fn->start_address) / 4;
+    Value* sp = LoadStateValue(r + 8 * 1, i64Ty);
+    for (uint32_t n = first; n <= 31; n++) {
+      StoreStateValue(r + 8 * n, i64Ty, ReadMemory(
+          cia, b.CreateSub(sp, b.getInt64(8 * (33 - n))), 8));
+    }
+    Value* lr = b.CreateZExt(
+        ReadMemory(cia, b.CreateSub(sp, b.getInt64(8)), 4), i64Ty);
+    StoreStateValue(r + 8 * 12, i64Ty, lr);
+    StoreStateValue(offsetof(xe_ppc_state_t, lr), i64Ty, lr);
+    return true;
+  } else if (fn->flags & FunctionSymbol::kFlagMemcpy) {
+    // memcpy(r3 dest, r4 src, r5 size) returns dest, which is still in r3.
+    // memmove keeps overlapping copies behaving like the forward copy loops
+    // guest code may rely on.
+    Value* size = b.CreateAnd(LoadStateValue(r + 8 * 5, i64Ty), UINT_MAX);
+    b.CreateMemMove(
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 3, i64Ty)),
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 4, i64Ty)),
+        size, 1);
+    return true;
+  } else if (fn->flags & FunctionSymbol::kFlagMemset) {
+    // memset(r3 dest, r4 value, r5 size) returns dest, which is still in r3.
+    Value* size = b.CreateAnd(LoadStateValue(r + 8 * 5, i64Ty), UINT_MAX);
+    b.CreateMemSet(
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 3, i64Ty)),
+        b.CreateTrunc(LoadStateValue(r + 8 * 4, i64Ty), b.getInt8Ty()),
+        size, 1);
+    return true;
+  } else if (fn->flags & FunctionSymbol::kFlagStrlen) {
+    // strlen(r3 str)
+    Value* length = b.CreateCall(
+        gen_module_->getFunction("XeStrlen"),
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 3, i64Ty)));
+    StoreStateValue(r + 8 * 3, i64Ty, length);
+    return true;
+  } else if (fn->flags & FunctionSymbol::kFlagStrcmp) {
+    // strcmp(r3 str1, r4 str2)
+    Value* result = b.CreateCall2(
+        gen_module_->getFunction("XeStrcmp"),
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 3, i64Ty)),
+        GetMemoryAddress(cia, LoadStateValue(r + 8 * 4, i64Ty)));
+    StoreStateValue(r + 8 * 3, i64Ty, b.CreateSExt(result, i64Ty));
+    return true;
+  }
+  return false;
+}
+
+void FunctionGenerator::GenerateReturn() {
+  // Registers must have been spilled before calling this. Register functions
+  // return their result as well, which is either what a tail call just
+  // returned or whatever was spilled to the state.
+  IRBuilder<>& b = *builder_;
+  Type* return_type = gen_fn_->getReturnType();
+  if (return_type->isVoidTy()) {
+    b.CreateRetVoid();
+  } else if (call_result_ && call_result_->getType() == return_type) {
+    b.CreateRet(call_result_);
+  } else if (return_type->isDoubleTy()) {
+    b.CreateRet(LoadStateValue(
+        (uint32_t)offsetof(xe_ppc_state_t, f) + 8 * 1, b.getDoubleTy()));
+  } else {
+    b.CreateRet(LoadStateValue(
+        (uint32_t)offsetof(xe_ppc_state_t, r) + 8 * 3, b.getInt64Ty()));
+  }
+  call_result_ = NULL;
+}
+
+void FunctionGenerator::GenerateConditionalBranch(
+    uint32_t cia, uint32_t bo, Value* ok,
+    BasicBlock* taken_bb, BasicBlock* not_taken_bb) {
+  IRBuilder<>& b = *builder_;
+
+  // Count the outcome. The counters are plain host memory owned by the
+  // profile, and losing the odd racing increment doesn't matter.
+  if (profile_ && FLAGS_profile_instrumentation) {
+    uint64_t* counters = profile_->GetBranchCounters(cia);
+    Type* counterPtrTy = PointerType::getUnqual(b.getInt64Ty());
+    Value* counter = b.CreateSelect(
+        ok,
+        b.CreateIntToPtr(b.getInt64((uint64_t)&counters[0]), counterPtrTy),
+        b.CreateIntToPtr(b.getInt64((uint64_t)&counters[1]), counterPtrTy));
+    b.CreateStore(b.CreateAdd(b.CreateLoad(counter), b.getInt64(1)),
+                  counter);
+  }
+
+  BranchInst* br = b.CreateCondBr(ok, taken_bb, not_taken_bb);
+
+  // Weight the branch with what was seen when profiling, if anything, or
+  // else the static prediction in the at bits of BO. BO is numbered as in
+  // the encoding, so with no CTR test they are BO[1:0] and with no condition
+  // they are BO[3] and BO[0]. 0b11 is likely taken, 0b10 likely not taken.
+  uint64_t taken = 0;
+  uint64_t not_taken = 0;
+  if (profile_ && FLAGS_profile_guided &&
+      profile_->GetBranchCounts(cia, &taken, &not_taken)) {
+    // Weights are only 32 bits.
+    while ((taken | not_taken) > UINT_MAX) {
+      taken >>= 1;
+      not_taken >>= 1;
+    }
+  } else {
+    uint32_t at = 0;
+    if (XESELECTBITS(bo, 2, 2)) {
+      at = XESELECTBITS(bo, 0, 1);
+    } else if (XESELECTBITS(bo, 4, 4)) {
+      at = (XESELECTBITS(bo, 3, 3) << 1) | XESELECTBITS(bo, 0, 0);
+    }
+    if (at == 3) {
+      taken = 64;
+      not_taken = 4;
+    } else if (at == 2) {
+      taken = 4;
+      not_taken = 64;
+    }
+  }
+  if (taken || not_taken) {
+    MDBuilder md_builder(*context_);
+    br->setMetadata(LLVMContext::MD_prof, md_builder.createBranchWeights(
+        (uint32_t)taken, (uint32_t)not_taken));
+  }
+}
+
 int FunctionGenerator::GenerateIndirectionBranch(uint32_t cia, Value* target,
                                                  bool lk, bool likely_local) {
   // This function is called by the control emitters when they know that an
@@ -430,11 +1046,11 @@ int FunctionGenerator::GenerateIndirectionBranch(uint32_t cia, Value* target,
         b.getInt64Ty(), 0, "indirection_cia");
 
     external_indirection_block_ = BasicBlock::Create(
-        *context_, "external_indirection_block", gen_fn_, return_block_);
+        *context_, "external_indirection_block", gen_fn_);
   }
   if (likely_local && !internal_indirection_block_) {
     internal_indirection_block_ = BasicBlock::Create(
-        *context_, "internal_indirection_block", gen_fn_, return_block_);
+        *context_, "internal_indirection_block", gen_fn_);
   }
 
   PopInsertPoint();
@@ -446,13 +1062,18 @@ int FunctionGenerator::GenerateIndirectionBranch(uint32_t cia, Value* target,
   if (likely_local) {
     // Note that we only support LK=0, as we are using shared tables.
     XEASSERT(!lk);
+    indirection_dirty_registers_.Union(dirty_registers_);
     b.CreateStore(target, locals_.indirection_target);
     b.CreateStore(b.getInt64(cia), locals_.indirection_cia);
     Value* fn_ge_cmp = b.CreateICmpUGE(target, b.getInt64(fn_->start_address));
     Value* fn_l_cmp = b.CreateICmpULT(target, b.getInt64(fn_->end_address));
     Value* fn_target_cmp = b.CreateAnd(fn_ge_cmp, fn_l_cmp);
-    b.CreateCondBr(fn_target_cmp,
-                   internal_indirection_block_, external_indirection_block_);
+    BasicBlock* external_bb = BasicBlock::Create(
+        *context_, "indirection_external", gen_fn_);
+    b.CreateCondBr(fn_target_cmp, internal_indirection_block_, external_bb);
+    b.SetInsertPoint(external_bb);
+    SpillRegisters();
+    b.CreateBr(external_indirection_block_);
     return 0;
   }
 
@@ -460,35 +1081,116 @@ int FunctionGenerator::GenerateIndirectionBranch(uint32_t cia, Value* target,
   // from needing to fill the registers again after the call and shares more
   // code.
   if (!lk) {
+    SpillRegisters();
     b.CreateStore(target, locals_.indirection_target);
     b.CreateStore(b.getInt64(cia), locals_.indirection_cia);
     b.CreateBr(external_indirection_block_);
   } else {
-    // Slowest path - spill, call the external function, and fill.
-    // We should avoid this at all costs.
+    // Slow path - spill, call through the cache, and fill.
 
     // Spill registers. We could probably share this.
     SpillRegisters();
 
-    // TODO(benvanik): keep function pointer lookup local.
-    Value* indirect_branch = gen_module_->getFunction("XeIndirectBranch");
-    b.CreateCall3(indirect_branch,
-                  gen_fn_->arg_begin(),
-                  target,
-                  b.getInt64(cia));
+    CallIndirectionTarget(target, b.getInt64(cia), b.getInt64(cia + 4));
 
     if (next_block) {
       // Only refill if not a tail call.
       FillRegisters();
       b.CreateBr(next_block);
     } else {
-      b.CreateRetVoid();
+      GenerateReturn();
     }
   }
 
   return 0;
 }
 
+void FunctionGenerator::CallIndirectionTarget(Value* target, Value* cia,
+                                              Value* lr) {
+  // Calls the function at the given guest address. Registers must have been
+  // spilled before calling this.
+  // Each call site gets its own cache of the last target it resolved. Most
+  // indirect calls (vtables/function pointers) only ever see one target, so
+  // this is usually a load and compare instead of a call into the runtime.
+  IRBuilder<>& b = *builder_;
+
+  Value* indirect_branch = gen_module_->getFunction("XeIndirectBranch");
+  Value* trap = gen_module_->getFunction("XeTrap");
+
+  // IndirectionEntry: { i64 address, i8* fn_ptr }
+  StructType* entryTy = StructType::get(
+      b.getInt64Ty(), b.getInt8PtrTy(), NULL);
+  PointerType* entryPtrTy = PointerType::getUnqual(entryTy);
+  std::vector<Type*> fn_args;
+  fn_args.push_back(b.getInt8PtrTy());
+  fn_args.push_back(b.getInt64Ty());
+  FunctionType* fnTy = FunctionType::get(b.getVoidTy(), fn_args, false);
+
+  GlobalVariable* cache = new GlobalVariable(
+      *gen_module_, entryPtrTy, false, GlobalValue::InternalLinkage,
+      ConstantPointerNull::get(entryPtrTy), "indirection_cache");
+
+  BasicBlock* check_bb = BasicBlock::Create(
+      *context_, "indirection_check", gen_fn_);
+  BasicBlock* miss_bb = BasicBlock::Create(
+      *context_, "indirection_miss", gen_fn_);
+  BasicBlock* store_bb = BasicBlock::Create(
+      *context_, "indirection_store", gen_fn_);
+  BasicBlock* unresolved_bb = BasicBlock::Create(
+      *context_, "indirection_unresolved", gen_fn_);
+  BasicBlock* call_bb = BasicBlock::Create(
+      *context_, "indirection_call", gen_fn_);
+  BasicBlock* done_bb = BasicBlock::Create(
+      *context_, "indirection_done", gen_fn_);
+
+  // The entry may have been cached by another thread, so the load pairs with
+  // the store below to see it fully initialized.
+  LoadInst* cached_entry = b.CreateLoad(cache);
+  cached_entry->setAlignment(8);
+  cached_entry->setAtomic(Acquire);
+  b.CreateCondBr(b.CreateIsNull(cached_entry), miss_bb, check_bb);
+
+  b.SetInsertPoint(check_bb);
+  Value* cached_address = b.CreateLoad(b.CreateStructGEP(cached_entry, 0));
+  b.CreateCondBr(b.CreateICmpEQ(cached_address, target), call_bb, miss_bb);
+
+  // Miss: ask the runtime (which may generate the target) and update the
+  // cache. Entries are never freed so it's safe to race here.
+  b.SetInsertPoint(miss_bb);
+  Value* resolved_entry = b.CreateBitCast(
+      b.CreateCall3(indirect_branch, gen_fn_->arg_begin(), target, cia),
+      entryPtrTy);
+  b.CreateCondBr(b.CreateIsNull(resolved_entry), unresolved_bb, store_bb);
+
+  b.SetInsertPoint(store_bb);
+  StoreInst* cache_store = b.CreateStore(resolved_entry, cache);
+  cache_store->setAlignment(8);
+  cache_store->setAtomic(Release);
+  b.CreateBr(call_bb);
+
+  // The target could not be resolved. Trap instead of calling through NULL
+  // and leave the cache alone so that the next call tries again.
+  b.SetInsertPoint(unresolved_bb);
+  b.CreateCall2(trap, gen_fn_->arg_begin(),
+                b.CreateTrunc(cia, b.getInt32Ty()));
+  b.CreateBr(done_bb);
+
+  b.SetInsertPoint(call_bb);
+  PHINode* entry = b.CreatePHI(entryPtrTy, 2);
+  entry->addIncoming(cached_entry, check_bb);
+  entry->addIncoming(resolved_entry, store_bb);
+  LoadInst* fn_ptr = b.CreateLoad(b.CreateStructGEP(entry, 1));
+  fn_ptr->setAlignment(8);
+  fn_ptr->setAtomic(Monotonic);
+  CallInst* call = b.CreateCall2(
+      b.CreateBitCast(fn_ptr, PointerType::getUnqual(fnTy)),
+      gen_fn_->arg_begin(), lr);
+  call->setCallingConv(CallingConv::Fast);
+  b.CreateBr(done_bb);
+
+  b.SetInsertPoint(done_bb);
+}
+
 Value* FunctionGenerator::LoadStateValue(uint32_t offset, Type* type,
                                          const char* name) {
   IRBuilder<>& b = *builder_;
@@ -529,6 +1231,15 @@ void FunctionGenerator::SetupLocals() {
   spr_t >>= 2;
   // TODO: FPCSR
 
+  // The memory base is loaded once on entry and shared by every access so
+  // that it can stay in a register for the whole function, leaving address
+  // computation as a single add. It's dropped by the optimizer if unused.
+  PushInsertPoint();
+  b.SetInsertPoint(&gen_fn_->getEntryBlock());
+  locals_.membase = b.CreateLoad(
+      gen_module_->getGlobalVariable("xe_memory_base"), "membase");
+  PopInsertPoint();
+
   char name[32];
 
   uint64_t cr_t = access_bits_.cr;
@@ -557,6 +1268,14 @@ void FunctionGenerator::SetupLocals() {
     }
     fpr_t >>= 2;
   }
+
+  Type* vmxTy = VectorType::get(b.getFloatTy(), 4);
+  for (int n = 0; n < 128; n++) {
+    if ((access_bits_.vmx[n / 32] >> (2 * (n % 32))) & 3) {
+      xesnprintfa(name, XECOUNT(name), "v%d", n);
+      locals_.vmx[n] = SetupLocal(vmxTy, name);
+    }
+  }
 }
 
 Value* FunctionGenerator::SetupLocal(llvm::Type* type, const char* name) {
@@ -574,28 +1293,60 @@ Value* FunctionGenerator::cia_value() {
 }
 
 void FunctionGenerator::FillRegisters() {
-  // This updates all of the local register values from the state memory.
-  // It should be called on function entry for initial setup and after any
-  // calls that may modify the registers.
+  // This reloads the local register values from the state memory after a
+  // call that may have modified them. It is always followed by a branch to
+  // the next block, so only the registers that block needs are loaded.
+  IRBuilder<>& b = *builder_;
+  std::map<uint32_t, BasicBlock*>::iterator it = bbs_.upper_bound(
+      fn_block_->start_address);
+  RegisterSet registers = (track_registers_ && it != bbs_.end()) ?
+      block_registers_[it->first].live_in : all_registers_;
+
+  // A register function call returned the value it left in the state.
+  if (call_result_) {
+    bool is_fpr = call_result_->getType()->isDoubleTy();
+    RegisterSet result_register = is_fpr ?
+        RegisterSet::FPR(1) : RegisterSet::GPR(3);
+    Value* local = is_fpr ? locals_.fpr[1] : locals_.gpr[3];
+    if (local && registers.Contains(result_register)) {
+      b.CreateStore(call_result_, local);
+      registers.Subtract(result_register);
+    }
+    call_result_ = NULL;
+  }
 
-  // TODO(benvanik): use access flags to see if we need to do reads/writes.
-  // Though LLVM may do a better job than we can, except across calls.
+  FillRegisters(registers);
+}
 
+void FunctionGenerator::FillRegisters(const RegisterSet& registers) {
+  // This updates the given local register values from the state memory.
   IRBuilder<>& b = *builder_;
 
-  if (locals_.xer) {
+  // Anything we load replaces whatever was pending.
+  for (uint32_t n = 0; n < XECOUNT(pending_flags_.cr); n++) {
+    if (registers.Contains(RegisterSet::CR(n))) {
+      pending_flags_.cr[n].lhs = NULL;
+    }
+  }
+  if (registers.Contains(RegisterSet::XER())) {
+    pending_flags_.ca = NULL;
+    pending_flags_.ov = NULL;
+    pending_flags_.so = NULL;
+  }
+
+  if (locals_.xer && registers.Contains(RegisterSet::XER())) {
     b.CreateStore(LoadStateValue(
         offsetof(xe_ppc_state_t, xer),
         b.getInt64Ty()), locals_.xer);
   }
 
-  if (locals_.lr) {
+  if (locals_.lr && registers.Contains(RegisterSet::LR())) {
     b.CreateStore(LoadStateValue(
         offsetof(xe_ppc_state_t, lr),
         b.getInt64Ty()), locals_.lr);
   }
 
-  if (locals_.ctr) {
+  if (locals_.ctr && registers.Contains(RegisterSet::CTR())) {
     b.CreateStore(LoadStateValue(
         offsetof(xe_ppc_state_t, ctr),
         b.getInt64Ty()), locals_.ctr);
@@ -605,9 +1356,9 @@ void FunctionGenerator::FillRegisters() {
   // This could probably be done faster via an extractvalues or something.
   // Perhaps we could also change it to be a vector<8*i8>.
   Value* cr = NULL;
-  for (size_t n = 0; n < XECOUNT(locals_.cr); n++) {
+  for (uint32_t n = 0; n < XECOUNT(locals_.cr); n++) {
     Value* cr_n = locals_.cr[n];
-    if (!cr_n) {
+    if (!cr_n || !registers.Contains(RegisterSet::CR(n))) {
       continue;
     }
     if (!cr) {
@@ -620,66 +1371,86 @@ void FunctionGenerator::FillRegisters() {
                       b.getInt8Ty()), cr_n);
   }
 
-  for (size_t n = 0; n < XECOUNT(locals_.gpr); n++) {
-    if (locals_.gpr[n]) {
+  for (uint32_t n = 0; n < XECOUNT(locals_.gpr); n++) {
+    if (locals_.gpr[n] && registers.Contains(RegisterSet::GPR(n))) {
       b.CreateStore(LoadStateValue(
           (uint32_t)offsetof(xe_ppc_state_t, r) + 8 * n,
           b.getInt64Ty()), locals_.gpr[n]);
     }
   }
 
-  for (size_t n = 0; n < XECOUNT(locals_.fpr); n++) {
-    if (locals_.fpr[n]) {
+  for (uint32_t n = 0; n < XECOUNT(locals_.fpr); n++) {
+    if (locals_.fpr[n] && registers.Contains(RegisterSet::FPR(n))) {
       b.CreateStore(LoadStateValue(
           (uint32_t)offsetof(xe_ppc_state_t, f) + 8 * n,
           b.getDoubleTy()), locals_.fpr[n]);
     }
   }
+
+  for (uint32_t n = 0; n < XECOUNT(locals_.vmx); n++) {
+    if (locals_.vmx[n] && registers.Contains(RegisterSet::VMX(n))) {
+      vmx_constants_[n] = NULL;
+      b.CreateStore(LoadStateValue(
+          (uint32_t)offsetof(xe_ppc_state_t, v) + 16 * n,
+          VectorType::get(b.getFloatTy(), 4)), locals_.vmx[n]);
+    }
+  }
 }
 
 void FunctionGenerator::SpillRegisters() {
-  // This flushes all local registers (if written) to the register bank and
-  // resets their values.
-  //
-  // TODO(benvanik): only flush if actually required, or selective flushes.
+  // This flushes all local registers written since the last fill to the
+  // register bank. Everything else already matches what is in memory.
+  if (track_registers_) {
+    SpillRegisters(dirty_registers_);
+  } else {
+    SpillRegisters(all_registers_);
+  }
+}
 
+void FunctionGenerator::SpillRegisters(const RegisterSet& registers) {
+  // This flushes the given local registers to the register bank.
   IRBuilder<>& b = *builder_;
 
-  if (locals_.xer) {
+  FlushPendingFlags();
+
+  if (locals_.xer && registers.Contains(RegisterSet::XER())) {
     StoreStateValue(
         offsetof(xe_ppc_state_t, xer),
         b.getInt64Ty(),
         b.CreateLoad(locals_.xer));
   }
 
-  if (locals_.lr) {
+  if (locals_.lr && registers.Contains(RegisterSet::LR())) {
     StoreStateValue(
         offsetof(xe_ppc_state_t, lr),
         b.getInt64Ty(),
         b.CreateLoad(locals_.lr));
   }
 
-  if (locals_.ctr) {
+  if (locals_.ctr && registers.Contains(RegisterSet::CTR())) {
     StoreStateValue(
         offsetof(xe_ppc_state_t, ctr),
         b.getInt64Ty(),
         b.CreateLoad(locals_.ctr));
   }
 
-  // Stitch together all split CR values.
-  // TODO(benvanik): don't flush across calls?
+  // Stitch the split CR values back into the CR. Fields we are not spilling
+  // are left untouched.
   Value* cr = NULL;
-  for (size_t n = 0; n < XECOUNT(locals_.cr); n++) {
+  for (uint32_t n = 0; n < XECOUNT(locals_.cr); n++) {
     Value* cr_n = locals_.cr[n];
-    if (!cr_n) {
+    if (!cr_n || !registers.Contains(RegisterSet::CR(n))) {
       continue;
     }
-    cr_n = b.CreateZExt(b.CreateLoad(cr_n), b.getInt64Ty());
     if (!cr) {
-      cr = b.CreateShl(cr_n, n * 4);
-    } else {
-      cr = b.CreateOr(cr, b.CreateShl(cr_n, n * 4));
+      cr = LoadStateValue(
+          offsetof(xe_ppc_state_t, cr),
+          b.getInt64Ty());
     }
+    uint32_t shift = 28 - n * 4;
+    cr_n = b.CreateZExt(b.CreateLoad(cr_n), b.getInt64Ty());
+    cr = b.CreateAnd(cr, ~(0xFull << shift));
+    cr = b.CreateOr(cr, b.CreateShl(b.CreateAnd(cr_n, 0xF), shift));
   }
   if (cr) {
     StoreStateValue(
@@ -690,7 +1461,7 @@ void FunctionGenerator::SpillRegisters() {
 
   for (uint32_t n = 0; n < XECOUNT(locals_.gpr); n++) {
     Value* v = locals_.gpr[n];
-    if (v) {
+    if (v && registers.Contains(RegisterSet::GPR(n))) {
       StoreStateValue(
           offsetof(xe_ppc_state_t, r) + 8 * n,
           b.getInt64Ty(),
@@ -700,94 +1471,274 @@ void FunctionGenerator::SpillRegisters() {
 
   for (uint32_t n = 0; n < XECOUNT(locals_.fpr); n++) {
     Value* v = locals_.fpr[n];
-    if (v) {
+    if (v && registers.Contains(RegisterSet::FPR(n))) {
       StoreStateValue(
           offsetof(xe_ppc_state_t, f) + 8 * n,
           b.getDoubleTy(),
           b.CreateLoad(locals_.fpr[n]));
     }
   }
+
+  for (uint32_t n = 0; n < XECOUNT(locals_.vmx); n++) {
+    Value* v = locals_.vmx[n];
+    if (v && registers.Contains(RegisterSet::VMX(n))) {
+      StoreStateValue(
+          offsetof(xe_ppc_state_t, v) + 16 * n,
+          VectorType::get(b.getFloatTy(), 4),
+          b.CreateLoad(locals_.vmx[n]));
+    }
+  }
 }
 
-Value* FunctionGenerator::xer_value() {
-  XEASSERTNOTNULL(locals_.xer);
+void FunctionGenerator::ReadRegister(const RegisterSet& reg) {
+  if (track_registers_ && !valid_registers_.Contains(reg)) {
+    register_mismatch_ = true;
+  }
+}
+
+void FunctionGenerator::WriteRegister(const RegisterSet& reg) {
+  if (!track_registers_) {
+    return;
+  }
+  // Writes the analysis did not see would never get spilled by later blocks.
+  if (!block_registers_[fn_block_->start_address].defs.Contains(reg)) {
+    register_mismatch_ = true;
+  }
+  valid_registers_.Union(reg);
+  dirty_registers_.Union(reg);
+  written_registers_.Union(reg);
+}
+
+void FunctionGenerator::ClearPendingFlags() {
+  for (uint32_t n = 0; n < XECOUNT(pending_flags_.cr); n++) {
+    pending_flags_.cr[n].lhs = NULL;
+    pending_flags_.cr[n].rhs = NULL;
+    pending_flags_.cr[n].is_signed = false;
+    pending_flags_.cr[n].is_materialized = false;
+  }
+  pending_flags_.ca = NULL;
+  pending_flags_.ov = NULL;
+  pending_flags_.so = NULL;
+}
+
+bool FunctionGenerator::HandOffPendingFlags(FunctionBlock* block) {
+  // The inputs of the pending flags are only valid in blocks dominated by
+  // this one. Successors that are generated after us and have no other way
+  // in qualify; if any successor does not then everything is materialized
+  // here as before.
+  BlockRegisters& regs = block_registers_[block->start_address];
+  if (regs.successors.empty() ||
+      block->outgoing_type == FunctionBlock::kTargetUnknown) {
+    return false;
+  }
+  // Calls (bl, or bclrl/bcctrl) return to the fall-through successor with
+  // whatever CR/XER the callee left, so the compares don't hold there.
+  if (block->instrs.size()) {
+    InstrData& i = block->instrs.back().i;
+    if (i.type &&
+        ((i.type->opcode == 0x48000000 && i.I.LK) ||
+         (i.type->opcode == 0x40000000 && i.B.LK) ||
+         (i.type->opcode == 0x4C000020 && i.XL.LK) ||
+         (i.type->opcode == 0x4C000420 && i.XL.LK))) {
+      return false;
+    }
+  }
+  for (std::vector<uint32_t>::iterator it = regs.successors.begin();
+       it != regs.successors.end(); ++it) {
+    if (*it <= block->start_address ||
+        block_registers_[*it].predecessors != 1) {
+      return false;
+    }
+  }
+  for (std::vector<uint32_t>::iterator it = regs.successors.begin();
+       it != regs.successors.end(); ++it) {
+    inherited_flags_[*it] = pending_flags_;
+  }
+  return true;
+}
+
+void FunctionGenerator::FlushPendingFlags() {
+  // Writes anything pending out to the locals. The inputs are kept around so
+  // that branches can still test the compares directly.
+  for (uint32_t n = 0; n < XECOUNT(pending_flags_.cr); n++) {
+    MaterializeCR(n);
+  }
+  MaterializeXER();
+}
+
+void FunctionGenerator::PushFlagsInsertPoint() {
+  // Emitters may have branched away from the block the flags were set in.
+  // Materializing at the end of that block (before its terminator, if it has
+  // one yet) keeps the values valid on every path out of it.
   IRBuilder<>& b = *builder_;
-  return b.CreateLoad(locals_.xer);
+  PushInsertPoint();
+  TerminatorInst* terminator = flags_block_->getTerminator();
+  if (terminator) {
+    b.SetInsertPoint(terminator);
+  } else {
+    b.SetInsertPoint(flags_block_);
+  }
 }
 
-void FunctionGenerator::update_xer_value(Value* value) {
-  XEASSERTNOTNULL(locals_.xer);
+void FunctionGenerator::MaterializeCR(uint32_t n) {
+  if (!pending_flags_.cr[n].lhs || pending_flags_.cr[n].is_materialized) {
+    return;
+  }
   IRBuilder<>& b = *builder_;
+  PushFlagsInsertPoint();
 
-  // Extend to 64bits if needed.
-  if (!value->getType()->isIntegerTy(64)) {
-    value = b.CreateZExt(value, b.getInt64Ty());
+  // bit0 = RA < RB
+  // bit1 = RA > RB
+  // bit2 = RA = RB
+  // bit3 = XER[SO]
+  Value* lhs = pending_flags_.cr[n].lhs;
+  Value* rhs = pending_flags_.cr[n].rhs;
+  bool is_signed = pending_flags_.cr[n].is_signed;
+  Value* is_lt = is_signed ?
+      b.CreateICmpSLT(lhs, rhs) : b.CreateICmpULT(lhs, rhs);
+  Value* is_gt = is_signed ?
+      b.CreateICmpSGT(lhs, rhs) : b.CreateICmpUGT(lhs, rhs);
+  Value* cp = b.CreateSelect(is_gt, b.getInt8(1 << 1), b.getInt8(1 << 2));
+  Value* c = b.CreateSelect(is_lt, b.getInt8(1 << 0), cp);
+
+  // TODO(benvanik): set bit 4 to XER[SO]
+
+  b.CreateStore(c, locals_.cr[n]);
+  pending_flags_.cr[n].is_materialized = true;
+
+  PopInsertPoint();
+}
+
+void FunctionGenerator::MaterializeXER() {
+  if (!pending_flags_.ca && !pending_flags_.ov && !pending_flags_.so) {
+    return;
   }
-  b.CreateStore(value, locals_.xer);
+  IRBuilder<>& b = *builder_;
+  PushFlagsInsertPoint();
+
+  Value* xer = b.CreateLoad(locals_.xer);
+  if (pending_flags_.ca) {
+    xer = b.CreateAnd(xer, 0xFFFFFFFFDFFFFFFF); // clear bit 29
+    xer = b.CreateOr(xer, b.CreateShl(pending_flags_.ca, 29));
+  }
+  if (pending_flags_.ov) {
+    xer = b.CreateAnd(xer, 0xFFFFFFFFBFFFFFFF); // clear bit 30
+    xer = b.CreateOr(xer, b.CreateShl(pending_flags_.ov, 30));
+  }
+  if (pending_flags_.so) {
+    xer = b.CreateOr(xer, b.CreateShl(pending_flags_.so, 31));
+  }
+  b.CreateStore(xer, locals_.xer);
+  pending_flags_.ca = NULL;
+  pending_flags_.ov = NULL;
+  pending_flags_.so = NULL;
+
+  PopInsertPoint();
 }
 
-void FunctionGenerator::update_xer_with_overflow(Value* value) {
+Value* FunctionGenerator::xer_value() {
   XEASSERTNOTNULL(locals_.xer);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::XER());
+  MaterializeXER();
+  return b.CreateLoad(locals_.xer);
+}
 
-  // Expects a i1 indicating overflow.
-  // Trust the caller that if it's larger than that it's already truncated.
-  if (!value->getType()->isIntegerTy(64)) {
-    value = b.CreateZExt(value, b.getInt64Ty());
+Value* FunctionGenerator::xer_ca_value() {
+  // Carrying chains (adde/addze/subfe) can use the pending carry directly.
+  XEASSERTNOTNULL(locals_.xer);
+  IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::XER());
+  if (pending_flags_.ca) {
+    return pending_flags_.ca;
   }
-
-  Value* xer = xer_value();
-  xer = b.CreateAnd(xer, 0xFFFFFFFFBFFFFFFF); // clear bit 30
-  xer = b.CreateOr(xer, b.CreateShl(value, 31));
-  xer = b.CreateOr(xer, b.CreateShl(value, 30));
-  b.CreateStore(xer, locals_.xer);
+  return b.CreateAnd(b.CreateLShr(xer_value(), 29), 0x1);
 }
 
-void FunctionGenerator::update_xer_with_carry(Value* value) {
+void FunctionGenerator::update_xer_value(Value* value) {
   XEASSERTNOTNULL(locals_.xer);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::XER());
 
-  // Expects a i1 indicating carry.
-  // Trust the caller that if it's larger than that it's already truncated.
+  // Extend to 64bits if needed.
   if (!value->getType()->isIntegerTy(64)) {
     value = b.CreateZExt(value, b.getInt64Ty());
   }
+  pending_flags_.ca = NULL;
+  pending_flags_.ov = NULL;
+  pending_flags_.so = NULL;
+  b.CreateStore(value, locals_.xer);
+}
 
-  Value* xer = xer_value();
-  xer = b.CreateAnd(xer, 0xFFFFFFFFDFFFFFFF); // clear bit 29
-  xer = b.CreateOr(xer, b.CreateShl(value, 29));
-  b.CreateStore(xer, locals_.xer);
+void FunctionGenerator::update_xer_with_overflow(Value* value) {
+  update_xer_flags(NULL, value);
+}
+
+void FunctionGenerator::update_xer_with_carry(Value* value) {
+  update_xer_flags(value, NULL);
 }
 
 void FunctionGenerator::update_xer_with_overflow_and_carry(Value* value) {
+  update_xer_flags(value, value);
+}
+
+void FunctionGenerator::update_xer_flags(Value* ca, Value* ov) {
   XEASSERTNOTNULL(locals_.xer);
   IRBuilder<>& b = *builder_;
 
-  // Expects a i1 indicating overflow.
+  // Expects i1s indicating carry/overflow.
   // Trust the caller that if it's larger than that it's already truncated.
-  if (!value->getType()->isIntegerTy(64)) {
-    value = b.CreateZExt(value, b.getInt64Ty());
+  if (ca && !ca->getType()->isIntegerTy(64)) {
+    ca = b.CreateZExt(ca, b.getInt64Ty());
+  }
+  if (ov && !ov->getType()->isIntegerTy(64)) {
+    ov = b.CreateZExt(ov, b.getInt64Ty());
   }
 
-  // This is effectively an update_xer_with_overflow followed by an
-  // update_xer_with_carry, but since the logic is largely the same share it.
-  Value* xer = xer_value();
-  xer = b.CreateAnd(xer, 0xFFFFFFFF9FFFFFFF); // clear bit 30 & 29
-  xer = b.CreateOr(xer, b.CreateShl(value, 31));
-  xer = b.CreateOr(xer, b.CreateShl(value, 30));
-  xer = b.CreateOr(xer, b.CreateShl(value, 29));
-  b.CreateStore(xer, locals_.xer);
+  // These only change a few bits, so the rest of XER must be valid.
+  ReadRegister(RegisterSet::XER());
+  WriteRegister(RegisterSet::XER());
+
+  if (b.GetInsertBlock() != flags_block_) {
+    // Inside of some control flow an emitter created. Anything pending has
+    // to be written out for the other paths and this update done in place.
+    MaterializeXER();
+    Value* xer = b.CreateLoad(locals_.xer);
+    if (ca) {
+      xer = b.CreateAnd(xer, 0xFFFFFFFFDFFFFFFF); // clear bit 29
+      xer = b.CreateOr(xer, b.CreateShl(ca, 29));
+    }
+    if (ov) {
+      xer = b.CreateAnd(xer, 0xFFFFFFFFBFFFFFFF); // clear bit 30
+      xer = b.CreateOr(xer, b.CreateShl(ov, 31));
+      xer = b.CreateOr(xer, b.CreateShl(ov, 30));
+    }
+    b.CreateStore(xer, locals_.xer);
+    return;
+  }
+
+  if (ca) {
+    pending_flags_.ca = ca;
+  }
+  if (ov) {
+    // SO is sticky.
+    pending_flags_.ov = ov;
+    pending_flags_.so = pending_flags_.so ?
+        b.CreateOr(pending_flags_.so, ov) : ov;
+  }
 }
 
 Value* FunctionGenerator::lr_value() {
   XEASSERTNOTNULL(locals_.lr);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::LR());
   return b.CreateLoad(locals_.lr);
 }
 
 void FunctionGenerator::update_lr_value(Value* value) {
   XEASSERTNOTNULL(locals_.lr);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::LR());
 
   // Extend to 64bits if needed.
   if (!value->getType()->isIntegerTy(64)) {
@@ -799,6 +1750,7 @@ void FunctionGenerator::update_lr_value(Value* value) {
 Value* FunctionGenerator::ctr_value() {
   XEASSERTNOTNULL(locals_.ctr);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::CTR());
 
   return b.CreateLoad(locals_.ctr);
 }
@@ -806,6 +1758,7 @@ Value* FunctionGenerator::ctr_value() {
 void FunctionGenerator::update_ctr_value(Value* value) {
   XEASSERTNOTNULL(locals_.ctr);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::CTR());
 
   // Extend to 64bits if needed.
   if (!value->getType()->isIntegerTy(64)) {
@@ -818,16 +1771,54 @@ Value* FunctionGenerator::cr_value(uint32_t n) {
   XEASSERT(n >= 0 && n < 8);
   XEASSERTNOTNULL(locals_.cr[n]);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::CR(n));
+  MaterializeCR(n);
 
   Value* v = b.CreateLoad(locals_.cr[n]);
   v = b.CreateZExt(v, b.getInt64Ty());
   return v;
 }
 
+Value* FunctionGenerator::cr_bit_value(uint32_t bi) {
+  // Returns an i1 for the given CR bit. When the field came from a compare
+  // that has not been materialized the compare is used directly.
+  IRBuilder<>& b = *builder_;
+  uint32_t n = bi >> 2;
+  uint32_t bit = bi & 3;
+  if (pending_flags_.cr[n].lhs) {
+    ReadRegister(RegisterSet::CR(n));
+    Value* lhs = pending_flags_.cr[n].lhs;
+    Value* rhs = pending_flags_.cr[n].rhs;
+    bool is_signed = pending_flags_.cr[n].is_signed;
+    switch (bit) {
+    case 0:
+      return is_signed ?
+          b.CreateICmpSLT(lhs, rhs) : b.CreateICmpULT(lhs, rhs);
+    case 1:
+      return is_signed ?
+          b.CreateICmpSGT(lhs, rhs) : b.CreateICmpUGT(lhs, rhs);
+    case 2:
+      return b.CreateICmpEQ(lhs, rhs);
+    default:
+      // TODO(benvanik): XER[SO], once compares set it.
+      return b.getInt1(0);
+    }
+  }
+  Value* cr = b.CreateAnd(cr_value(n), 1 << bit);
+  return b.CreateICmpNE(cr, b.getInt64(0));
+}
+
 void FunctionGenerator::update_cr_value(uint32_t n, Value* value) {
   XEASSERT(n >= 0 && n < 8);
   XEASSERTNOTNULL(locals_.cr[n]);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::CR(n));
+
+  // Other paths out of the flags block may still need the pending value.
+  if (b.GetInsertBlock() != flags_block_) {
+    MaterializeCR(n);
+  }
+  pending_flags_.cr[n].lhs = NULL;
 
   // Truncate to 8 bits if needed.
   // TODO(benvanik): also widen?
@@ -840,40 +1831,37 @@ void FunctionGenerator::update_cr_value(uint32_t n, Value* value) {
 
 void FunctionGenerator::update_cr_with_cond(
     uint32_t n, Value* lhs, Value* rhs, bool is_signed) {
+  XEASSERT(n >= 0 && n < 8);
+  XEASSERTNOTNULL(locals_.cr[n]);
   IRBuilder<>& b = *builder_;
 
-  // bit0 = RA < RB
-  // bit1 = RA > RB
-  // bit2 = RA = RB
-  // bit3 = XER[SO]
-
-  // TODO(benvanik): inline this using the x86 cmp instruction - this prevents
-  // the need for a lot of the compares and ensures we lower to the best
-  // possible x86.
-  // Value* cmp = InlineAsm::get(
-  //     FunctionType::get(),
-  //     "cmp $0, $1                 \n"
-  //     "mov from compare registers \n",
-  //     "r,r", ??
-  //     true);
-
-  Value* is_lt = is_signed ?
-      b.CreateICmpSLT(lhs, rhs) : b.CreateICmpULT(lhs, rhs);
-  Value* is_gt = is_signed ?
-      b.CreateICmpSGT(lhs, rhs) : b.CreateICmpUGT(lhs, rhs);
-  Value* cp = b.CreateSelect(is_gt, b.getInt8(1 << 1), b.getInt8(1 << 2));
-  Value* c = b.CreateSelect(is_lt, b.getInt8(1 << 0), cp);
-
-  // TODO(benvanik): set bit 4 to XER[SO]
+  // Most compares are overwritten by the next one or only tested by a
+  // branch, so just remember the inputs. Inside of control flow the field is
+  // computed right away as the inputs may not be valid everywhere after it.
+  if (b.GetInsertBlock() != flags_block_) {
+    MaterializeCR(n);
+    Value* is_lt = is_signed ?
+        b.CreateICmpSLT(lhs, rhs) : b.CreateICmpULT(lhs, rhs);
+    Value* is_gt = is_signed ?
+        b.CreateICmpSGT(lhs, rhs) : b.CreateICmpUGT(lhs, rhs);
+    Value* cp = b.CreateSelect(is_gt, b.getInt8(1 << 1), b.getInt8(1 << 2));
+    Value* c = b.CreateSelect(is_lt, b.getInt8(1 << 0), cp);
+    update_cr_value(n, c);
+    return;
+  }
 
-  // Insert the 4 bits into their location in the CR.
-  update_cr_value(n, c);
+  WriteRegister(RegisterSet::CR(n));
+  pending_flags_.cr[n].lhs = lhs;
+  pending_flags_.cr[n].rhs = rhs;
+  pending_flags_.cr[n].is_signed = is_signed;
+  pending_flags_.cr[n].is_materialized = false;
 }
 
 Value* FunctionGenerator::gpr_value(uint32_t n) {
   XEASSERT(n >= 0 && n < 32);
   XEASSERTNOTNULL(locals_.gpr[n]);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::GPR(n));
 
   // Actually r0 is writable, even though nobody should ever do that.
   // Perhaps we can check usage and enable this if safe?
@@ -889,6 +1877,7 @@ void FunctionGenerator::update_gpr_value(uint32_t n, Value* value) {
   XEASSERT(n >= 0 && n < 32);
   XEASSERTNOTNULL(locals_.gpr[n]);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::GPR(n));
 
   // See above - r0 can be written.
   // if (n == 0) {
@@ -908,6 +1897,7 @@ Value* FunctionGenerator::fpr_value(uint32_t n) {
   XEASSERT(n >= 0 && n < 32);
   XEASSERTNOTNULL(locals_.fpr[n]);
   IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::FPR(n));
   return b.CreateLoad(locals_.fpr[n]);
 }
 
@@ -915,11 +1905,46 @@ void FunctionGenerator::update_fpr_value(uint32_t n, Value* value) {
   XEASSERT(n >= 0 && n < 32);
   XEASSERTNOTNULL(locals_.fpr[n]);
   IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::FPR(n));
   value = b.CreateFPExtOrFPTrunc(value, b.getDoubleTy());
   b.CreateStore(value, locals_.fpr[n]);
 }
 
+Value* FunctionGenerator::vmx_value(uint32_t n) {
+  XEASSERT(n >= 0 && n < 128);
+  XEASSERTNOTNULL(locals_.vmx[n]);
+  IRBuilder<>& b = *builder_;
+  ReadRegister(RegisterSet::VMX(n));
+  if (vmx_constants_[n]) {
+    return vmx_constants_[n];
+  }
+  return b.CreateLoad(locals_.vmx[n]);
+}
+
+void FunctionGenerator::update_vmx_value(uint32_t n, Value* value) {
+  XEASSERT(n >= 0 && n < 128);
+  XEASSERTNOTNULL(locals_.vmx[n]);
+  IRBuilder<>& b = *builder_;
+  WriteRegister(RegisterSet::VMX(n));
+
+  // Vector registers are kept as <4 x float>. Integer vectors of the same
+  // width are just reinterpreted.
+  Type* vmxTy = VectorType::get(b.getFloatTy(), 4);
+  if (value->getType() != vmxTy) {
+    value = b.CreateBitCast(value, vmxTy);
+  }
+
+  // The builder folds operations on constants, so splats and anything
+  // computed only from them stay visible to later permutes.
+  vmx_constants_[n] = dyn_cast<Constant>(value);
+
+  b.CreateStore(value, locals_.vmx[n]);
+}
+
 Value* FunctionGenerator::GetMembase() {
+  if (locals_.membase) {
+    return locals_.membase;
+  }
   Value* v = gen_module_->getGlobalVariable("xe_memory_base");
   return builder_->CreateLoad(v);
 }
@@ -930,28 +1955,8 @@ Value* FunctionGenerator::GetMemoryAddress(uint32_t cia, Value* addr) {
   // Input address is always in 32-bit space.
   addr = b.CreateAnd(addr, UINT_MAX);
 
-  // Add runtime memory address checks, if needed.
-  if (FLAGS_memory_address_verification) {
-    BasicBlock* invalid_bb = BasicBlock::Create(*context_, "", gen_fn_);
-    BasicBlock* valid_bb = BasicBlock::Create(*context_, "", gen_fn_);
-
-    // The heap starts at 0x1000 - if we write below that we're boned.
-    Value* gt = b.CreateICmpUGE(addr, b.getInt64(0x00001000));
-    b.CreateCondBr(gt, valid_bb, invalid_bb);
-
-    b.SetInsertPoint(invalid_bb);
-    Value* access_violation = gen_module_->getFunction("XeAccessViolation");
-    SpillRegisters();
-    b.CreateCall3(access_violation,
-                  gen_fn_->arg_begin(),
-                  b.getInt32(cia),
-                  addr);
-    b.CreateBr(valid_bb);
-
-    b.SetInsertPoint(valid_bb);
-  }
-
-  // Rebase off of memory base pointer.
+  // Rebase off of memory base pointer. There are no checks - the whole 32-bit
+  // space is reserved and bad accesses fault into the FaultHandler instead.
   return b.CreateInBoundsGEP(GetMembase(), addr);
 }
 
@@ -977,6 +1982,10 @@ Value* FunctionGenerator::ReadMemory(
       dataTy = b.getInt64Ty();
       needs_swap = true;
       break;
+    case 16:
+      dataTy = b.getIntNTy(128);
+      needs_swap = true;
+      break;
     default:
       XEASSERTALWAYS();
       return NULL;
@@ -1026,6 +2035,10 @@ void FunctionGenerator::WriteMemory(
       dataTy = b.getInt64Ty();
       needs_swap = true;
       break;
+    case 16:
+      dataTy = b.getIntNTy(128);
+      needs_swap = true;
+      break;
     default:
       XEASSERTALWAYS();
       return;
@@ -17,6 +17,7 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 
+#include <xenia/cpu/module_profile.h>
 #include <xenia/cpu/sdb.h>
 #include <xenia/cpu/ppc/instr.h>
 
@@ -26,20 +27,61 @@ namespace cpu {
 namespace codegen {
 
 
+// A set of registers. This uses the same layout as ppc::InstrAccessBits but
+// only the read bit of each register is ever set.
+class RegisterSet {
+public:
+  RegisterSet() : spr(0), cr(0), gpr(0), fpr(0) {
+    vmx[0] = vmx[1] = vmx[2] = vmx[3] = 0;
+  }
+
+  uint64_t spr;   // fpcsr/ctr/lr/xer
+  uint64_t cr;    // cr7/6/5/4/3/2/1/0
+  uint64_t gpr;   // r31-0
+  uint64_t fpr;   // f31-0
+  uint64_t vmx[4];  // v127-0
+
+  static RegisterSet FromReads(const ppc::InstrAccessBits& bits);
+  static RegisterSet FromWrites(const ppc::InstrAccessBits& bits);
+  static RegisterSet XER();
+  static RegisterSet LR();
+  static RegisterSet CTR();
+  static RegisterSet CR(uint32_t n);
+  static RegisterSet GPR(uint32_t n);
+  static RegisterSet FPR(uint32_t n);
+  static RegisterSet VMX(uint32_t n);
+
+  void Union(const RegisterSet& other);
+  void Subtract(const RegisterSet& other);
+  bool Contains(const RegisterSet& other) const;
+  bool Equals(const RegisterSet& other) const;
+};
+
+
 class FunctionGenerator {
 public:
   FunctionGenerator(
       xe_memory_ref memory, sdb::SymbolDatabase* sdb, sdb::FunctionSymbol* fn,
       llvm::LLVMContext* context, llvm::Module* gen_module,
-      llvm::Function* gen_fn);
+      llvm::Function* gen_fn, uint32_t host_features,
+      ModuleProfile* profile);
   ~FunctionGenerator();
 
+  // Functions can have a variant that takes the registers they use as
+  // arguments and returns their result instead of going through the state.
+  static void GetRegisterFunctionName(sdb::FunctionSymbol* fn,
+                                      char* buffer, size_t buffer_count);
+  static llvm::FunctionType* GetRegisterFunctionType(
+      llvm::LLVMContext& context, sdb::FunctionSymbol* fn);
+
   sdb::SymbolDatabase* sdb();
   sdb::FunctionSymbol* fn();
   llvm::LLVMContext* context();
   llvm::Module* gen_module();
   llvm::Function* gen_fn();
   sdb::FunctionBlock* fn_block();
+  // xe_pal_processor_feature_e mask the generated code may use.
+  uint32_t host_features();
 
   void PushInsertPoint();
   void PopInsertPoint();
@@ -50,9 +92,17 @@ public:
   llvm::BasicBlock* GetReturnBasicBlock();
 
   llvm::Function* GetFunction(sdb::FunctionSymbol* fn);
+  llvm::Function* GetRegisterFunction(sdb::FunctionSymbol* fn);
+  void CallFunction(sdb::FunctionSymbol* fn, llvm::Value* lr);
+  void GenerateReturn();
 
   int GenerateIndirectionBranch(uint32_t cia, llvm::Value* target,
                                 bool lk, bool likely_local);
+  // Branches on the condition of a bc* instruction, counting the outcome
+  // when profiling and weighting it by the profile or the BO hint.
+  void GenerateConditionalBranch(uint32_t cia, uint32_t bo, llvm::Value* ok,
+                                 llvm::BasicBlock* taken_bb,
+                                 llvm::BasicBlock* not_taken_bb);
 
   llvm::Value* LoadStateValue(uint32_t offset, llvm::Type* type,
                               const char* name = "");
@@ -64,7 +114,10 @@ public:
   void FillRegisters();
   void SpillRegisters();
 
+  void FlushPendingFlags();
+
   llvm::Value* xer_value();
+  llvm::Value* xer_ca_value();
   void update_xer_value(llvm::Value* value);
   void update_xer_with_overflow(llvm::Value* value);
   void update_xer_with_carry(llvm::Value* value);
@@ -77,6 +130,7 @@ public:
   void update_ctr_value(llvm::Value* value);
 
   llvm::Value* cr_value(uint32_t n);
+  llvm::Value* cr_bit_value(uint32_t bi);
   void update_cr_value(uint32_t n, llvm::Value* value);
   void update_cr_with_cond(uint32_t n, llvm::Value* lhs, llvm::Value* rhs,
                            bool is_signed);
@@ -85,6 +139,8 @@ public:
   void update_gpr_value(uint32_t n, llvm::Value* value);
   llvm::Value* fpr_value(uint32_t n);
   void update_fpr_value(uint32_t n, llvm::Value* value);
+  llvm::Value* vmx_value(uint32_t n);
+  void update_vmx_value(uint32_t n, llvm::Value* value);
 
   llvm::Value* GetMembase();
   llvm::Value* GetMemoryAddress(uint32_t cia, llvm::Value* addr);
@@ -95,10 +151,43 @@ public:
       bool release = false);
 
 private:
+  // Register usage of a block, used to only fill and spill the registers
+  // that are needed.
+  class BlockRegisters {
+  public:
+    BlockRegisters() :
+        falls_through(true), refills(false), predecessors(0) {}
+
+    RegisterSet uses;       // Read before being written in the block.
+    RegisterSet defs;       // Written in the block.
+    RegisterSet dirty_in;   // May have been written since the last fill.
+    RegisterSet live_in;    // Must hold valid values on entry.
+    bool        falls_through;
+    bool        refills;    // Ends in a call that refills the registers.
+    std::vector<uint32_t> successors;
+    uint32_t    predecessors; // Incoming edges, including from the entry.
+  };
+
+  void Reset();
+  void GenerateFunctionBody();
   void GenerateSharedBlocks();
+  void CallIndirectionTarget(llvm::Value* target, llvm::Value* cia,
+                             llvm::Value* lr);
+  bool GenerateNativeCall(sdb::FunctionSymbol* fn);
   int PrepareBasicBlock(sdb::FunctionBlock* block);
+  void AnalyzeRegisters();
   void GenerateBasicBlock(sdb::FunctionBlock* block);
   void SetupLocals();
+  void FillRegisters(const RegisterSet& registers);
+  void SpillRegisters(const RegisterSet& registers);
+  void ReadRegister(const RegisterSet& reg);
+  void WriteRegister(const RegisterSet& reg);
+  void ClearPendingFlags();
+  bool HandOffPendingFlags(sdb::FunctionBlock* block);
+  void PushFlagsInsertPoint();
+  void update_xer_flags(llvm::Value* ca, llvm::Value* ov);
+  void MaterializeCR(uint32_t n);
+  void MaterializeXER();
 
   xe_memory_ref         memory_;
   sdb::SymbolDatabase*  sdb_;
@@ -106,12 +195,14 @@ private:
   llvm::LLVMContext*    context_;
   llvm::Module*         gen_module_;
   llvm::Function*       gen_fn_;
+  uint32_t              host_features_;
+  ModuleProfile*        profile_;
   sdb::FunctionBlock*   fn_block_;
-  llvm::BasicBlock*     return_block_;
   llvm::BasicBlock*     internal_indirection_block_;
   llvm::BasicBlock*     external_indirection_block_;
   llvm::BasicBlock*     bb_;
   llvm::IRBuilder<>*    builder_;
+  llvm::MDNode*         cu_;
 
   std::vector<std::pair<llvm::BasicBlock*, llvm::BasicBlock::iterator> >
       insert_points_;
@@ -122,7 +213,52 @@ private:
   uint32_t        cia_;
 
   ppc::InstrAccessBits access_bits_;
+
+  // When tracking registers only live registers are filled and only dirty
+  // registers are spilled. If the emitters touch registers the disassembler
+  // did not report the function is regenerated without tracking.
+  bool            track_registers_;
+  bool            register_mismatch_;
+  RegisterSet     all_registers_;
+  std::map<uint32_t, BlockRegisters> block_registers_;
+  RegisterSet     valid_registers_;
+  RegisterSet     dirty_registers_;
+  RegisterSet     written_registers_;
+  RegisterSet     indirection_dirty_registers_;
+
+  // Result of the last register function call, if it returned one. It is
+  // used in place of reloading the register from the state.
+  llvm::Value*    call_result_;
+
+  // Vector registers known to hold a constant since the last fill, so that
+  // permutes and splats of them can use fixed shuffles.
+  llvm::Constant* vmx_constants_[128];
+
+  // CR fields set by compares and the XER bits set by carrying/overflowing
+  // instructions are only computed once something reads them. Until then
+  // the inputs are kept here. Pending flags are materialized at the end of
+  // flags_block_ so that they cover every path out of it, unless all of the
+  // successors of the block can only be reached from it. Those inherit the
+  // pending flags instead so that a compare in one block can be tested by a
+  // branch in the next without ever building the CR field.
+  llvm::BasicBlock* flags_block_;
+  struct PendingFlags {
+    struct {
+      llvm::Value*  lhs;
+      llvm::Value*  rhs;
+      bool          is_signed;
+      bool          is_materialized;
+    } cr[8];
+    llvm::Value*  ca;
+    llvm::Value*  ov;
+    llvm::Value*  so;
+  };
+  PendingFlags    pending_flags_;
+  std::map<uint32_t, PendingFlags> inherited_flags_;
+
   struct {
+    llvm::Value*  membase;
+
     llvm::Value*  indirection_target;
     llvm::Value*  indirection_cia;
 
@@ -132,6 +268,7 @@ private:
     llvm::Value*  cr[8];
     llvm::Value*  gpr[32];
     llvm::Value*  fpr[32];
+    llvm::Value*  vmx[128];
   } locals_;
 };
 
@@ -13,7 +13,9 @@
 #include <llvm/Linker.h>
 #include <llvm/PassManager.h>
 #include <llvm/DebugInfo.h>
+#include <llvm/ADT/OwningPtr.h>
 #include <llvm/Analysis/Verifier.h>
+#include <llvm/Bitcode/ReaderWriter.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/DataLayout.h>
@@ -21,26 +23,36 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/MDBuilder.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/MutexGuard.h>
+#include <llvm/Support/raw_ostream.h>
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 
 #include <xenia/cpu/cpu-private.h>
+#include <xenia/cpu/fault_handler.h>
 #include <xenia/cpu/ppc.h>
 #include <xenia/cpu/codegen/function_generator.h>
+#include <xenia/cpu/interpreter/function_interpreter.h>
 
 
 using namespace llvm;
 using namespace xe;
 using namespace xe::cpu;
 using namespace xe::cpu::codegen;
+using namespace xe::cpu::interpreter;
 using namespace xe::cpu::sdb;
 using namespace xe::kernel;
 
 
 ModuleGenerator::ModuleGenerator(
-    xe_memory_ref memory, ExportResolver* export_resolver,
+    xe_pal_ref pal, xe_memory_ref memory, ExportResolver* export_resolver,
     const char* module_name, const char* module_path, SymbolDatabase* sdb,
-    LLVMContext* context, Module* gen_module, ExecutionEngine* engine) {
+    LLVMContext* context, Module* gen_module, ExecutionEngine* engine,
+    ModuleProfile* profile, FaultHandler* fault_handler) {
+  pal_ = xe_pal_retain(pal);
   memory_ = xe_memory_retain(memory);
   export_resolver_ = export_resolver;
   module_name_ = xestrdupa(module_name);
@@ -49,43 +61,51 @@ ModuleGenerator::ModuleGenerator(
   context_ = context;
   gen_module_ = gen_module;
   engine_ = engine;
+  profile_ = profile;
+  fault_handler_ = fault_handler;
+  host_features_ = FLAGS_use_host_cpu_features ?
+      xe_pal_get_processor_features(pal_) : 0;
   di_builder_ = NULL;
+  generate_mutex_ = xe_mutex_alloc(0);
+  shard_done_event_ = xe_event_alloc(true);
+
+  tier_up_thread_ = NULL;
+  tier_up_mutex_ = xe_mutex_alloc(0);
+  tier_up_event_ = xe_event_alloc(false);
+  tier_up_exited_event_ = xe_event_alloc(true);
+  tier_up_running_ = false;
 }
 
 ModuleGenerator::~ModuleGenerator() {
+  // Wait for the tier up thread to finish whatever it is working on.
+  if (tier_up_thread_) {
+    tier_up_running_ = false;
+    xe_event_set(tier_up_event_);
+    xe_event_wait(tier_up_exited_event_);
+    xe_thread_release(tier_up_thread_);
+  }
+  xe_event_free(tier_up_exited_event_);
+  xe_event_free(tier_up_event_);
+  xe_mutex_free(tier_up_mutex_);
+
   for (std::map<uint32_t, CodegenFunction*>::iterator it =
        functions_.begin(); it != functions_.end(); ++it) {
     delete it->second;
   }
 
+  xe_event_free(shard_done_event_);
+  xe_mutex_free(generate_mutex_);
   delete di_builder_;
   xe_free(module_path_);
   xe_free(module_name_);
   xe_memory_release(memory_);
+  xe_pal_release(pal_);
 }
 
 int ModuleGenerator::Generate() {
   std::string error_message;
 
-  // Setup a debug info builder.
-  // This is used when creating any debug info. We may want to go more
-  // fine grained than this, but for now it's something.
-  char dir[XE_MAX_PATH];
-  XEIGNORE(xestrcpya(dir, XECOUNT(dir), module_path_));
-  char* slash = xestrrchra(dir, '/');
-  if (slash) {
-    *(slash + 1) = 0;
-  }
-  di_builder_ = new DIBuilder(*gen_module_);
-  di_builder_->createCompileUnit(
-      dwarf::DW_LANG_C99, //0x8010,
-      StringRef(module_name_),
-      StringRef(dir),
-      StringRef("xenia"),
-      true,
-      StringRef(""),
-      0);
-  cu_ = (MDNode*)di_builder_->getCU();
+  CreateCompileUnit();
 
   // Add export wrappers.
   //
@@ -93,6 +113,11 @@ int ModuleGenerator::Generate() {
   // Add all functions.
   // We do two passes - the first creates the function signature and global
   // value (so that we can call it), the second actually builds the function.
+  // Register functions are only used when everything is generated up front,
+  // as stubs (and stale checks) only know how to take the state.
+  bool use_registers =
+      FLAGS_register_arguments && !FLAGS_lazy_function_generation &&
+      !FLAGS_protect_code;
   std::vector<FunctionSymbol*> functions;
   if (!sdb_->GetAllFunctions(functions)) {
     XELOGI("Beginning prep of %ld functions...", functions.size());
@@ -101,7 +126,7 @@ int ModuleGenerator::Generate() {
       FunctionSymbol* fn = *it;
       switch (fn->type) {
       case FunctionSymbol::User:
-        PrepareFunction(fn);
+        PrepareFunction(fn, use_registers);
         break;
       case FunctionSymbol::Kernel:
         if (fn->kernel_export && fn->kernel_export->is_implemented) {
@@ -119,28 +144,537 @@ int ModuleGenerator::Generate() {
   }
 
   // Build out all the user functions.
-  size_t n = 0;
-  XELOGI("Beginning generation of %ld functions...", functions.size());
-  for (std::map<uint32_t, CodegenFunction*>::iterator it =
-       functions_.begin(); it != functions_.end(); ++it, ++n) {
-    FunctionSymbol* symbol = it->second->symbol;
-    XELOGI("Generating %ld/%ld %.8X %s",
-           n, functions_.size(), symbol->start_address, symbol->name());
-    BuildFunction(it->second);
+  // When generating lazily only stubs are built here and the real bodies are
+  // generated the first time each function is called.
+  uint32_t thread_count = FLAGS_codegen_threads > 0 ?
+      (uint32_t)FLAGS_codegen_threads : xe_pal_get_processor_count(pal_);
+  if (FLAGS_lazy_function_generation) {
+    XELOGI("Building stubs for %ld functions...", functions_.size());
+    for (std::map<uint32_t, CodegenFunction*>::iterator it =
+         functions_.begin(); it != functions_.end(); ++it) {
+      BuildStub(it->second);
+    }
+  } else if (thread_count > 1) {
+    if (GenerateParallel(thread_count)) {
+      XELOGE("Parallel function generation failed");
+      return 1;
+    }
+  } else {
+    size_t n = 0;
+    XELOGI("Beginning generation of %ld functions...", functions.size());
+    for (std::map<uint32_t, CodegenFunction*>::iterator it =
+         functions_.begin(); it != functions_.end(); ++it, ++n) {
+      FunctionSymbol* symbol = it->second->symbol;
+      XELOGI("Generating %ld/%ld %.8X %s",
+             n, functions_.size(), symbol->start_address, symbol->name());
+      BuildFunction(it->second);
+    }
+    XELOGI("Function generation complete");
+  }
+
+  // Now that all of the bodies exist pull the small ones into their callers.
+  // Inlined copies would miss the stale check of their callee, so nothing is
+  // inlined when code is watched.
+  if (FLAGS_inline_calls && !FLAGS_lazy_function_generation &&
+      !FLAGS_tiered_compilation && !FLAGS_protect_code) {
+    InlineCalls();
   }
-  XELOGI("Function generation complete");
 
   di_builder_->finalize();
 
+  // Hot functions are recompiled with optimizations on a background thread
+  // so that execution is not blocked on the optimizer.
+  if (FLAGS_tiered_compilation) {
+    tier_up_running_ = true;
+    tier_up_thread_ = xe_thread_create(pal_, "Tier Up",
+                                       TierUpThreadStart, this);
+    if (xe_thread_start(tier_up_thread_)) {
+      XELOGE("Unable to start tier up thread");
+      tier_up_running_ = false;
+      xe_thread_release(tier_up_thread_);
+      tier_up_thread_ = NULL;
+    }
+  }
+
+  return 0;
+}
+
+int ModuleGenerator::AdoptModule() {
+  // Used for modules loaded from the cache once their code is written to.
+  // Nothing is generated here: the cached functions are taken as they are
+  // and only regenerated when they go stale. The JIT may be compiling them
+  // on other threads, so the engine lock is held while touching the IR.
+  MutexGuard jit_lock(engine_->lock);
+  CreateCompileUnit();
+
+  std::vector<FunctionSymbol*> functions;
+  if (sdb_->GetAllFunctions(functions)) {
+    return 1;
+  }
+  for (std::vector<FunctionSymbol*>::iterator it = functions.begin();
+       it != functions.end(); ++it) {
+    FunctionSymbol* fn = *it;
+    if (fn->type != FunctionSymbol::User) {
+      continue;
+    }
+    PrepareFunction(fn, false);
+    CodegenFunction* cgf = GetCodegenFunction(fn->start_address);
+    if (cgf->function->isDeclaration()) {
+      BuildStub(cgf);
+    } else {
+      cgf->is_generated = true;
+    }
+  }
+
+  di_builder_->finalize();
   return 0;
 }
 
+int ModuleGenerator::GenerateFunction(uint32_t address) {
+  int result_code = 1;
+
+  // Mark whatever was written to since as stale before looking at it.
+  if (fault_handler_) {
+    fault_handler_->ProcessCodeWrites();
+  }
+
+  xe_mutex_lock(generate_mutex_);
+
+  CodegenFunction* cgf = GetCodegenFunction(address);
+  XEEXPECTNOTNULL(cgf);
+
+  // Another thread may have beaten us here.
+  if (!cgf->is_generated || *cgf->is_stale) {
+    // The JIT takes the engine lock whenever it compiles or looks up code,
+    // so holding it keeps every other thread out of the IR while it changes.
+    MutexGuard jit_lock(engine_->lock);
+    FunctionSymbol* symbol = cgf->symbol;
+    XELOGCPU("Generating %.8X %s", symbol->start_address, symbol->name());
+
+    // The code changed since it was analyzed. Watch it again before reading
+    // it so that any later write marks the function stale again. The flag
+    // stays set until the new body is in place, so a failure here traps
+    // instead of running the old code.
+    if (*cgf->is_stale) {
+      if (fault_handler_) {
+        fault_handler_->WatchCode(
+            symbol->start_address,
+            symbol->end_address - symbol->start_address + 4);
+      }
+      if (sdb_->ReanalyzeFunction(symbol)) {
+        XELOGE("Unable to reanalyze %.8X %s",
+               symbol->start_address, symbol->name());
+        XEFAIL();
+      }
+      PrepareNewFunctions();
+
+      // Any optimized tier was built from the old code, so start over.
+      cgf->optimized_fn_ptr = NULL;
+      cgf->is_optimized = false;
+      cgf->call_count = 0;
+    }
+
+    // The body is built as a new function and published to the entry point
+    // once it has been compiled. Other threads may be running the entry
+    // point or an older body, so none of that code is ever patched.
+    bool was_generated = cgf->is_generated;
+    Function* body_f = CreateFunctionVersion(cgf, "body");
+    BuildFunction(cgf, gen_module_, body_f, NULL);
+    void* fn_ptr = engine_->getPointerToFunction(body_f);
+    if (!fn_ptr) {
+      XELOGE("Unable to compile %.8X %s",
+             symbol->start_address, symbol->name());
+      cgf->is_generated = was_generated;
+      XEFAIL();
+    }
+    // Aligned pointer stores are atomic. The code is fully written by now.
+    *cgf->fn_ptr = fn_ptr;
+    *cgf->is_stale = 0;
+  }
+
+  result_code = 0;
+XECLEANUP:
+  xe_mutex_unlock(generate_mutex_);
+  return result_code;
+}
+
+void ModuleGenerator::InvalidateCode(uint32_t address, uint32_t length) {
+  // Called from FaultHandler::ProcessCodeWrites when guest code was written
+  // to. Everything overlapping the range regenerates itself the next time it
+  // is called.
+  xe_mutex_lock(generate_mutex_);
+  for (std::map<uint32_t, CodegenFunction*>::iterator it =
+       functions_.begin(); it != functions_.end(); ++it) {
+    CodegenFunction* cgf = it->second;
+    FunctionSymbol* symbol = cgf->symbol;
+    if (symbol->start_address < address + length &&
+        symbol->end_address + 4 > address) {
+      *cgf->is_stale = 1;
+    }
+  }
+  xe_mutex_unlock(generate_mutex_);
+}
+
+int ModuleGenerator::InterpretFunction(
+    xe_ppc_state_t* state, uint32_t address, uint64_t lr) {
+  if (fault_handler_) {
+    fault_handler_->ProcessCodeWrites();
+  }
+
+  xe_mutex_lock(generate_mutex_);
+  CodegenFunction* cgf = GetCodegenFunction(address);
+  XEASSERTNOTNULL(cgf);
+
+  // Cold functions are interpreted until they have been called enough to be
+  // worth generating. Anything the interpreter can't handle is generated on
+  // the first call.
+  if (cgf->is_generated || *cgf->is_stale || !cgf->can_interpret ||
+      xe_atomic_inc_32(&cgf->interpret_count) >
+          FLAGS_interpreter_threshold) {
+    xe_mutex_unlock(generate_mutex_);
+    return 0;
+  }
+
+  // The interpreter copies the blocks, so it is created under the lock that
+  // reanalysis runs under and keeps running the code it started with.
+  FunctionInterpreter interpreter(cgf->symbol, state, lr);
+  xe_mutex_unlock(generate_mutex_);
+  if (interpreter.Execute()) {
+    // The state is undefined now, so there is no falling back to the JIT.
+    XELOGE("Interpreter failed in %.8X %s",
+           cgf->symbol->start_address, cgf->symbol->name());
+    XEASSERTALWAYS();
+  }
+  return 1;
+}
+
+int ModuleGenerator::GenerateParallel(uint32_t thread_count) {
+  int result_code = 1;
+  std::string error_message;
+  std::vector<xe_thread_ref> threads;
+  size_t shard_count = thread_count * 4;
+  if (shard_count > functions_.size()) {
+    shard_count = functions_.size();
+  }
+  if (!shard_count) {
+    return 0;
+  }
+
+  // Snapshot the module with every function declared. Each shard starts from
+  // a copy of this in its own context so that it can reference anything.
+  {
+    raw_string_ostream os(shard_bitcode_);
+    WriteBitcodeToFile(gen_module_, os);
+  }
+
+  // Deal the functions out to the shards. There are more shards than threads
+  // so that the threads stay busy when some shards take longer than others.
+  for (size_t n = 0; n < shard_count; n++) {
+    CodegenShard* shard = new CodegenShard();
+    shard->result_code = 1;
+    shards_.push_back(shard);
+  }
+  {
+    size_t n = 0;
+    for (std::map<uint32_t, CodegenFunction*>::iterator it =
+         functions_.begin(); it != functions_.end(); ++it, ++n) {
+      shards_[n % shard_count]->functions.push_back(it->second);
+    }
+  }
+
+  XELOGI("Beginning generation of %ld functions in %ld shards on %d threads...",
+         functions_.size(), shard_count, thread_count);
+  // The running count includes this thread so that it can't drop to zero
+  // while threads are still being started.
+  next_shard_ = 0;
+  shard_threads_running_ = 1;
+  xe_event_reset(shard_done_event_);
+  for (uint32_t n = 1; n < thread_count; n++) {
+    xe_atomic_inc_32(&shard_threads_running_);
+    xe_thread_ref thread = xe_thread_create(pal_, "Codegen",
+                                            ShardThreadStart, this);
+    if (xe_thread_start(thread)) {
+      xe_atomic_dec_32(&shard_threads_running_);
+      xe_thread_release(thread);
+      break;
+    }
+    threads.push_back(thread);
+  }
+
+  // Help out on this thread and then wait for the others to finish. The
+  // last one out sets the event.
+  ShardThread();
+  if (xe_atomic_dec_32(&shard_threads_running_)) {
+    xe_event_wait(shard_done_event_);
+  }
+  for (std::vector<xe_thread_ref>::iterator it = threads.begin();
+       it != threads.end(); ++it) {
+    xe_thread_release(*it);
+  }
+  XELOGI("Function generation complete, linking shards...");
+
+  // Link the shards back into the main module in order so that the result
+  // does not depend on thread timing.
+  for (std::vector<CodegenShard*>::iterator it = shards_.begin();
+       it != shards_.end(); ++it) {
+    CodegenShard* shard = *it;
+    XEEXPECTZERO(shard->result_code);
+    MemoryBuffer* buffer = MemoryBuffer::getMemBuffer(
+        StringRef(shard->bitcode), "", false);
+    Module* shard_module = ParseBitcodeFile(buffer, *context_, &error_message);
+    delete buffer;
+    if (!shard_module) {
+      XELOGE("Unable to load shard: %s", error_message.c_str());
+      XEFAIL();
+    }
+    bool link_failed = Linker::LinkModules(
+        gen_module_, shard_module, Linker::DestroySource, &error_message);
+    delete shard_module;
+    if (link_failed) {
+      XELOGE("Unable to link shard: %s", error_message.c_str());
+      XEFAIL();
+    }
+  }
+
+  // Linking replaces the declarations with new functions, so look them up
+  // again.
+  for (std::map<uint32_t, CodegenFunction*>::iterator it =
+       functions_.begin(); it != functions_.end(); ++it) {
+    CodegenFunction* cgf = it->second;
+    cgf->function = gen_module_->getFunction(StringRef(cgf->symbol->name()));
+    XEEXPECTNOTNULL(cgf->function);
+    if (cgf->reg_function) {
+      char name[256];
+      FunctionGenerator::GetRegisterFunctionName(
+          cgf->symbol, name, XECOUNT(name));
+      cgf->reg_function = gen_module_->getFunction(StringRef(name));
+      XEEXPECTNOTNULL(cgf->reg_function);
+    }
+  }
+
+  result_code = 0;
+XECLEANUP:
+  for (std::vector<CodegenShard*>::iterator it = shards_.begin();
+       it != shards_.end(); ++it) {
+    delete *it;
+  }
+  shards_.clear();
+  shard_bitcode_.clear();
+  return result_code;
+}
+
+void ModuleGenerator::ShardThreadStart(void* param) {
+  ModuleGenerator* generator = reinterpret_cast<ModuleGenerator*>(param);
+  generator->ShardThread();
+  if (!xe_atomic_dec_32(&generator->shard_threads_running_)) {
+    xe_event_set(generator->shard_done_event_);
+  }
+}
+
+void ModuleGenerator::ShardThread() {
+  while (true) {
+    int32_t index = xe_atomic_inc_32(&next_shard_) - 1;
+    if (index >= (int32_t)shards_.size()) {
+      break;
+    }
+    CodegenShard* shard = shards_[index];
+    shard->result_code = GenerateShard(shard);
+  }
+}
+
+int ModuleGenerator::GenerateShard(CodegenShard* shard) {
+  int result_code = 1;
+  std::string error_message;
+  LLVMContext context;
+  MemoryBuffer* buffer = MemoryBuffer::getMemBuffer(
+      StringRef(shard_bitcode_), "", false);
+  OwningPtr<Module> m(ParseBitcodeFile(buffer, context, &error_message));
+  delete buffer;
+  if (!m.get()) {
+    XELOGE("Unable to load shard module: %s", error_message.c_str());
+    XEFAIL();
+  }
+
+  // Reduce everything already in the module to declarations. The real
+  // definitions stay in the main module and are resolved by name when the
+  // shard is linked back in.
+  for (Module::iterator it = m->begin(); it != m->end(); ++it) {
+    if (!it->isDeclaration()) {
+      it->deleteBody();
+    }
+  }
+  for (Module::global_iterator it = m->global_begin();
+       it != m->global_end(); ++it) {
+    if (it->hasInitializer()) {
+      it->setInitializer(NULL);
+      it->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+  // The compile unit is kept, as debug locations are scoped to it and faults
+  // are mapped back to guest code through them.
+  for (Module::named_metadata_iterator it = m->named_metadata_begin();
+       it != m->named_metadata_end();) {
+    NamedMDNode* md = it++;
+    if (md->getName() != "llvm.dbg.cu") {
+      m->eraseNamedMetadata(md);
+    }
+  }
+
+  for (std::vector<CodegenFunction*>::iterator it = shard->functions.begin();
+       it != shard->functions.end(); ++it) {
+    CodegenFunction* cgf = *it;
+    Function* f = m->getFunction(StringRef(cgf->symbol->name()));
+    XEEXPECTNOTNULL(f);
+    Function* reg_f = NULL;
+    if (cgf->reg_function) {
+      char name[256];
+      FunctionGenerator::GetRegisterFunctionName(
+          cgf->symbol, name, XECOUNT(name));
+      reg_f = m->getFunction(StringRef(name));
+      XEEXPECTNOTNULL(reg_f);
+    }
+    BuildFunction(cgf, m.get(), f, reg_f);
+  }
+
+  // Drop all the declarations we did not end up using to keep linking fast.
+  {
+    PassManager pm;
+    pm.add(createGlobalDCEPass());
+    pm.run(*m);
+  }
+
+  // The locations still reference the compile unit, but listing it would
+  // add another one to the main module for every shard linked in.
+  {
+    NamedMDNode* cu_list = m->getNamedMetadata("llvm.dbg.cu");
+    if (cu_list) {
+      m->eraseNamedMetadata(cu_list);
+    }
+  }
+
+  {
+    raw_string_ostream os(shard->bitcode);
+    WriteBitcodeToFile(m.get(), os);
+  }
+
+  result_code = 0;
+XECLEANUP:
+  return result_code;
+}
+
+void ModuleGenerator::QueueTierUp(uint32_t address) {
+  // This is called from generated code, so avoid the generate lock (which
+  // may be held for a long time while optimizing) and look the function up
+  // on the tier up thread instead.
+  xe_mutex_lock(tier_up_mutex_);
+  tier_up_queue_.push_back(address);
+  xe_mutex_unlock(tier_up_mutex_);
+  xe_event_set(tier_up_event_);
+}
+
+void ModuleGenerator::TierUpThreadStart(void* param) {
+  ModuleGenerator* generator = reinterpret_cast<ModuleGenerator*>(param);
+  generator->TierUpThread();
+}
+
+void ModuleGenerator::TierUpThread() {
+  while (tier_up_running_) {
+    uint32_t address = 0;
+    xe_mutex_lock(tier_up_mutex_);
+    if (tier_up_queue_.size()) {
+      address = tier_up_queue_.front();
+      tier_up_queue_.erase(tier_up_queue_.begin());
+    }
+    xe_mutex_unlock(tier_up_mutex_);
+    if (!address) {
+      // Queueing sets the event, so nothing is missed between the check
+      // above and the wait.
+      xe_event_wait(tier_up_event_);
+      continue;
+    }
+
+    xe_mutex_lock(generate_mutex_);
+    CodegenFunction* cgf = GetCodegenFunction(address);
+    if (cgf && cgf->is_generated && !cgf->is_optimized &&
+        !*cgf->is_stale) {
+      TierUpFunction(cgf);
+    }
+    xe_mutex_unlock(generate_mutex_);
+  }
+  xe_event_set(tier_up_exited_event_);
+}
+
+void ModuleGenerator::TierUpFunction(CodegenFunction* cgf) {
+  // NOTE: generate_mutex_ must be held.
+  // The engine lock keeps the JIT (on any thread) out of the IR while the
+  // new function is built.
+  MutexGuard jit_lock(engine_->lock);
+  FunctionSymbol* symbol = cgf->symbol;
+  XELOGCPU("Optimizing %.8X %s", symbol->start_address, symbol->name());
+
+  // The optimized version is built as a new function instead of replacing
+  // the old one, as other threads may be running the old code and patching
+  // it in place is not safe. Once compiled its address is published to the
+  // first tier, which forwards all calls to it from then on. Register
+  // functions keep their wrapper as-is.
+  Function* opt_f = CreateFunctionVersion(cgf, "opt");
+
+  cgf->is_optimized = true;
+  BuildFunction(cgf, gen_module_, opt_f, NULL);
+  void* fn_ptr = engine_->getPointerToFunction(opt_f);
+  if (!fn_ptr) {
+    XELOGE("Unable to compile optimized %.8X %s",
+           symbol->start_address, symbol->name());
+    return;
+  }
+  // Aligned pointer stores are atomic. The code is fully written by now.
+  cgf->optimized_fn_ptr = fn_ptr;
+}
+
+Function* ModuleGenerator::AddRuntimeFunction(uint32_t address) {
+  Function* result = NULL;
+  xe_mutex_lock(generate_mutex_);
+
+  CodegenFunction* cgf = GetCodegenFunction(address);
+  if (!cgf) {
+    MutexGuard jit_lock(engine_->lock);
+    FunctionSymbol* fn = sdb_->AnalyzeNewFunction(address);
+    if (fn && fn->type == FunctionSymbol::User) {
+      PrepareNewFunctions();
+      cgf = GetCodegenFunction(address);
+    }
+  }
+  if (cgf) {
+    result = cgf->function;
+  }
+
+  xe_mutex_unlock(generate_mutex_);
+  return result;
+}
+
 void ModuleGenerator::AddFunctionsToMap(
     std::tr1::unordered_map<uint32_t, llvm::Function*>& map) {
   for (std::map<uint32_t, CodegenFunction*>::iterator it = functions_.begin();
        it != functions_.end(); ++it) {
     map.insert(std::pair<uint32_t, Function*>(it->first, it->second->function));
   }
+
+  // Imports are included so that the runtime (and the interpreter) can call
+  // them by their thunk address.
+  std::vector<FunctionSymbol*> functions;
+  if (!sdb_->GetAllFunctions(functions)) {
+    for (std::vector<FunctionSymbol*>::iterator it = functions.begin();
+         it != functions.end(); ++it) {
+      FunctionSymbol* fn = *it;
+      if (fn->type != FunctionSymbol::Kernel) {
+        continue;
+      }
+      Function* f = gen_module_->getFunction(fn->name());
+      if (f) {
+        map.insert(std::pair<uint32_t, Function*>(fn->start_address, f));
+      }
+    }
+  }
 }
 
 ModuleGenerator::CodegenFunction* ModuleGenerator::GetCodegenFunction(
@@ -152,6 +686,53 @@ ModuleGenerator::CodegenFunction* ModuleGenerator::GetCodegenFunction(
   return NULL;
 }
 
+GlobalVariable* ModuleGenerator::GetFunctionGlobal(Module* m,
+                                                   FunctionSymbol* fn,
+                                                   const char* suffix) {
+  char name[256];
+  xesnprintfa(name, XECOUNT(name), "%s_%s", fn->name(), suffix);
+  return m->getNamedGlobal(StringRef(name));
+}
+
+void* ModuleGenerator::CreateFunctionGlobal(FunctionSymbol* fn,
+                                            const char* suffix, Type* type) {
+  // Modules loaded from the cache already have the global.
+  GlobalVariable* gv = GetFunctionGlobal(gen_module_, fn, suffix);
+  if (!gv) {
+    char name[256];
+    xesnprintfa(name, XECOUNT(name), "%s_%s", fn->name(), suffix);
+    gv = new GlobalVariable(
+        *gen_module_, type, false, GlobalValue::ExternalLinkage,
+        Constant::getNullValue(type), StringRef(name));
+    gv->setAlignment(8);
+  }
+  // The JIT allocates the global the first time it is asked for it, and
+  // code compiled later uses the same memory.
+  return engine_->getPointerToGlobal(gv);
+}
+
+void ModuleGenerator::CreateCompileUnit() {
+  // Setup a debug info builder.
+  // This is used when creating any debug info. We may want to go more
+  // fine grained than this, but for now it's something.
+  char dir[XE_MAX_PATH];
+  XEIGNORE(xestrcpya(dir, XECOUNT(dir), module_path_));
+  char* slash = xestrrchra(dir, '/');
+  if (slash) {
+    *(slash + 1) = 0;
+  }
+  di_builder_ = new DIBuilder(*gen_module_);
+  di_builder_->createCompileUnit(
+      dwarf::DW_LANG_C99, //0x8010,
+      StringRef(module_name_),
+      StringRef(dir),
+      StringRef("xenia"),
+      true,
+      StringRef(""),
+      0);
+  cu_ = (MDNode*)di_builder_->getCU();
+}
+
 Function* ModuleGenerator::CreateFunctionDefinition(const char* name) {
   Module* m = gen_module_;
   LLVMContext& context = m->getContext();
@@ -171,9 +752,11 @@ Function* ModuleGenerator::CreateFunctionDefinition(const char* name) {
   // If we ever support native exception handling we may need to remove this.
   f->doesNotThrow();
 
-  // May be worth trying the X86_FastCall, as we only need state in a register.
-  //f->setCallingConv(CallingConv::Fast);
-  f->setCallingConv(CallingConv::C);
+  // Generated functions are only ever called from generated code (or the
+  // execute trampoline), so use the fast convention. This keeps state and lr
+  // in registers and lets the backend do tail calls between functions.
+  // Every call site must match this.
+  f->setCallingConv(CallingConv::Fast);
 
   Function::arg_iterator fn_args = f->arg_begin();
   // 'state'
@@ -193,6 +776,52 @@ Function* ModuleGenerator::CreateFunctionDefinition(const char* name) {
   return f;
 };
 
+Function* ModuleGenerator::CreateRegisterFunctionDefinition(
+    FunctionSymbol* fn) {
+  Module* m = gen_module_;
+  LLVMContext& context = m->getContext();
+
+  char name[256];
+  FunctionGenerator::GetRegisterFunctionName(fn, name, XECOUNT(name));
+  FunctionType* ft = FunctionGenerator::GetRegisterFunctionType(context, fn);
+  Function* f = cast<Function>(m->getOrInsertFunction(StringRef(name), ft));
+  f->setVisibility(GlobalValue::DefaultVisibility);
+  f->doesNotThrow();
+
+  // These are only ever called directly from generated code, so we are free
+  // to pick whatever convention is fastest.
+  f->setCallingConv(CallingConv::Fast);
+
+  Function::arg_iterator fn_args = f->arg_begin();
+  // 'state'
+  Value* fn_arg = fn_args++;
+  fn_arg->setName("state");
+  f->setDoesNotAlias(1);
+  f->setDoesNotCapture(1);
+  // 'lr'
+  fn_arg = fn_args++;
+  fn_arg->setName("lr");
+
+  // Argument registers.
+  char arg_name[32];
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_gprs & (1 << n)) {
+      xesnprintfa(arg_name, XECOUNT(arg_name), "arg_r%d", n);
+      fn_arg = fn_args++;
+      fn_arg->setName(arg_name);
+    }
+  }
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_fprs & (1 << n)) {
+      xesnprintfa(arg_name, XECOUNT(arg_name), "arg_f%d", n);
+      fn_arg = fn_args++;
+      fn_arg->setName(arg_name);
+    }
+  }
+
+  return f;
+}
+
 void ModuleGenerator::AddMissingImport(FunctionSymbol* fn) {
   Module *m = gen_module_;
   LLVMContext& context = m->getContext();
@@ -231,8 +860,6 @@ void ModuleGenerator::AddPresentImport(FunctionSymbol* fn) {
   Module *m = gen_module_;
   LLVMContext& context = m->getContext();
 
-  const DataLayout* dl = engine_->getDataLayout();
-  Type* intPtrTy = dl->getIntPtrType(context);
   Type* int8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
 
   // Add the externs.
@@ -251,15 +878,14 @@ void ModuleGenerator::AddPresentImport(FunctionSymbol* fn) {
   Function* shim = Function::Create(
       shimTy, Function::ExternalLinkage, shim_name, m);
 
+  // The shim data is left as a declaration that the JIT resolves to the slot
+  // in the export. This keeps host pointers out of the generated code so that
+  // the module can be cached.
   GlobalVariable* gv = new GlobalVariable(
       *m, int8PtrTy, true, GlobalValue::ExternalLinkage, 0,
       shim_data_name);
-
-  // TODO(benvanik): don't initialize on startup - move to exec_module
-  gv->setInitializer(ConstantExpr::getIntToPtr(
-      ConstantInt::get(intPtrTy,
-                       (uintptr_t)fn->kernel_export->function_data.shim_data),
-      int8PtrTy));
+  engine_->addGlobalMapping(gv,
+      (void*)&fn->kernel_export->function_data.shim_data);
   engine_->addGlobalMapping(shim,
       (void*)fn->kernel_export->function_data.shim);
 
@@ -289,33 +915,494 @@ void ModuleGenerator::AddPresentImport(FunctionSymbol* fn) {
   OptimizeFunction(m, f);
 }
 
-void ModuleGenerator::PrepareFunction(FunctionSymbol* fn) {
+void ModuleGenerator::PrepareFunction(FunctionSymbol* fn, bool use_registers) {
   // Create the function (and setup args/attributes/etc).
+  // With registers the body goes into the register function and the normal
+  // one just wraps it for indirect calls and calls from the runtime.
   Function* f = CreateFunctionDefinition(fn->name());
+  Function* reg_f = NULL;
+  if (use_registers) {
+    reg_f = CreateRegisterFunctionDefinition(fn);
+  }
 
   // Setup our codegen wrapper to keep all the pointers together.
+  // The stale flag and the published body are globals of the module rather
+  // than fields of the wrapper, so that generated code doesn't embed host
+  // pointers and modules with code protection can be cached.
+  LLVMContext& context = gen_module_->getContext();
   CodegenFunction* cgf = new CodegenFunction();
   cgf->symbol = fn;
   cgf->function_type = f->getFunctionType();
   cgf->function = f;
+  cgf->reg_function = reg_f;
+  cgf->fn_ptr = (void* volatile*)CreateFunctionGlobal(
+      fn, "fn_ptr", PointerType::getUnqual(Type::getInt8Ty(context)));
+  cgf->is_generated = false;
+  cgf->is_optimized = false;
+  cgf->call_count = 0;
+  cgf->optimized_fn_ptr = NULL;
+  cgf->can_interpret = FunctionInterpreter::CanInterpret(fn);
+  cgf->interpret_count = 0;
+  cgf->is_stale = (volatile int32_t*)CreateFunctionGlobal(
+      fn, "stale", Type::getInt32Ty(context));
   functions_.insert(std::pair<uint32_t, CodegenFunction*>(
       fn->start_address, cgf));
 }
 
+void ModuleGenerator::PrepareNewFunctions() {
+  // Functions found after the module was generated all get stubs, so they are
+  // generated when they are first called.
+  std::vector<FunctionSymbol*> functions;
+  if (sdb_->GetAllFunctions(functions)) {
+    return;
+  }
+  for (std::vector<FunctionSymbol*>::iterator it = functions.begin();
+       it != functions.end(); ++it) {
+    FunctionSymbol* fn = *it;
+    if (fn->type != FunctionSymbol::User ||
+        GetCodegenFunction(fn->start_address)) {
+      continue;
+    }
+    PrepareFunction(fn, false);
+    BuildStub(GetCodegenFunction(fn->start_address));
+  }
+}
+
 void ModuleGenerator::BuildFunction(CodegenFunction* cgf) {
+  BuildFunction(cgf, gen_module_, cgf->function, cgf->reg_function);
+}
+
+void ModuleGenerator::BuildFunction(CodegenFunction* cgf, Module* m,
+                                    Function* f, Function* reg_f) {
   FunctionSymbol* fn = cgf->symbol;
 
+  // The wrapper only needs to be built once, as it never changes.
+  if (reg_f) {
+    if (f->isDeclaration()) {
+      BuildRegisterWrapper(cgf, m, f, reg_f);
+    }
+    f = reg_f;
+  }
+
   // Setup the generation context.
   FunctionGenerator fgen(
-      memory_, sdb_, fn, context_, gen_module_, cgf->function);
+      memory_, sdb_, fn, &m->getContext(), m, f, host_features_, profile_);
 
   // Run through and generate each basic block.
   fgen.GenerateBasicBlocks();
 
+  // Count calls when gathering a profile.
+  if (profile_ && FLAGS_profile_instrumentation) {
+    AddCallCounter(cgf, m, f);
+  }
+
+  // When tiering the first version of the function counts its calls and is
+  // rebuilt with optimizations once it gets hot.
+  bool first_tier = FLAGS_tiered_compilation && !cgf->is_optimized;
+  if (first_tier) {
+    AddTierUpCounter(cgf, m, f);
+  }
+
+  // Bail out to the generator if the code was written to since, and forward
+  // to the new body once there is one. Checks are added in front of the ones
+  // before, so these run before a first tier can forward to stale optimized
+  // code.
+  if (FLAGS_protect_code) {
+    if (f->getName() == StringRef(fn->name())) {
+      AddEntryForward(cgf, m, f);
+    }
+    AddStaleCheck(cgf, m, f);
+  }
+
   // Run the optimizer on the function.
   // Doing this here keeps the size of the IR small and speeds up the later
-  // passes.
-  OptimizeFunction(gen_module_, cgf->function);
+  // passes. The first tier is left unoptimized.
+  if (first_tier) {
+    FunctionPassManager pm(m);
+    pm.add(createVerifierPass());
+    pm.run(*f);
+  } else {
+    OptimizeFunction(m, f);
+  }
+
+  // Leaf functions only fill and spill the registers they touch, and once
+  // inlined those fold into the values the caller already has. Small ones
+  // are always inlined into their direct callers by the module optimizer.
+  // Watched code is never inlined, as the copy would skip the stale check.
+  if (FLAGS_protect_code) {
+    f->addFnAttr(Attribute::NoInline);
+  } else if (fn->flags & FunctionSymbol::kFlagLeaf) {
+    uint32_t instr_count = (fn->end_address - fn->start_address) / 4 + 1;
+    if (instr_count <= (uint32_t)FLAGS_leaf_inline_threshold) {
+      f->addFnAttr(Attribute::AlwaysInline);
+    } else {
+      f->addFnAttr(Attribute::InlineHint);
+    }
+  }
+
+  cgf->is_generated = true;
+}
+
+void ModuleGenerator::BuildRegisterWrapper(CodegenFunction* cgf, Module* m,
+                                           Function* f, Function* reg_f) {
+  FunctionSymbol* fn = cgf->symbol;
+  LLVMContext& context = m->getContext();
+
+  BasicBlock* block = BasicBlock::Create(context, "entry", f);
+  IRBuilder<> b(block);
+
+  // Pull the arguments out of the state and call the real function. The
+  // result is already in the state, so it is dropped.
+  Value* state = f->arg_begin();
+  std::vector<Value*> args;
+  args.push_back(state);
+  args.push_back(++f->arg_begin());
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_gprs & (1 << n)) {
+      Value* address = b.CreateInBoundsGEP(
+          state, b.getInt32((uint32_t)offsetof(xe_ppc_state_t, r) + 8 * n));
+      args.push_back(b.CreateLoad(b.CreatePointerCast(
+          address, PointerType::getUnqual(b.getInt64Ty()))));
+    }
+  }
+  for (uint32_t n = 0; n < 32; n++) {
+    if (fn->arg_fprs & (1 << n)) {
+      Value* address = b.CreateInBoundsGEP(
+          state, b.getInt32((uint32_t)offsetof(xe_ppc_state_t, f) + 8 * n));
+      args.push_back(b.CreateLoad(b.CreatePointerCast(
+          address, PointerType::getUnqual(b.getDoubleTy()))));
+    }
+  }
+  CallInst* call = b.CreateCall(reg_f, args);
+  call->setCallingConv(CallingConv::Fast);
+  b.CreateRetVoid();
+
+  OptimizeFunction(m, f);
+}
+
+void ModuleGenerator::BuildStub(CodegenFunction* cgf) {
+  FunctionSymbol* fn = cgf->symbol;
+  Function* f = cgf->function;
+  LLVMContext& context = *context_;
+
+  // The stub is what direct calls and the function table point at, and it
+  // stays that way once the function has been generated. The body is a
+  // separate function that is published through fn_ptr.
+  f->addFnAttr(Attribute::NoInline);
+
+  BasicBlock* block = BasicBlock::Create(context, "entry", f);
+  BasicBlock* forward = BasicBlock::Create(context, "forward", f);
+  BasicBlock* generate_block = BasicBlock::Create(context, "generate", f);
+  IRBuilder<> b(block);
+
+  // Forward to the body once there is one. The arguments are passed along
+  // untouched.
+  LoadInst* fn_ptr = b.CreateLoad(
+      GetFunctionGlobal(gen_module_, fn, "fn_ptr"));
+  fn_ptr->setAlignment(8);
+  fn_ptr->setAtomic(Acquire);
+  b.CreateCondBr(b.CreateIsNull(fn_ptr), generate_block, forward);
+
+  b.SetInsertPoint(forward);
+  CallInst* call = b.CreateCall2(
+      b.CreateBitCast(fn_ptr, f->getType()),
+      f->arg_begin(), ++f->arg_begin());
+  call->setCallingConv(CallingConv::Fast);
+  call->setTailCall();
+  b.CreateRetVoid();
+
+  // While the function is cold it may be interpreted instead. The interpreter
+  // runs the whole call, so all that is left is to return.
+  b.SetInsertPoint(generate_block);
+  if (FLAGS_interpreter) {
+    Value* interpretFunction = gen_module_->getFunction("XeInterpretFunction");
+    Value* interpreted = b.CreateCall4(
+        interpretFunction,
+        f->arg_begin(),
+        b.getInt64((uint64_t)this),
+        b.getInt64(fn->start_address),
+        ++f->arg_begin());
+    BasicBlock* return_block = BasicBlock::Create(context, "interpreted", f);
+    generate_block = BasicBlock::Create(context, "generate_body", f);
+    b.CreateCondBr(b.CreateICmpNE(interpreted, b.getInt32(0)),
+                   return_block, generate_block);
+    b.SetInsertPoint(return_block);
+    b.CreateRetVoid();
+  }
+  BuildGenerateCall(cgf, gen_module_, f, generate_block);
+}
+
+Function* ModuleGenerator::CreateFunctionVersion(CodegenFunction* cgf,
+                                                 const char* suffix) {
+  // Bodies built after the module was generated are new functions with the
+  // same signature as the one they stand in for. The stub is the only one
+  // that must not be inlined.
+  Function* f = cgf->reg_function ? cgf->reg_function : cgf->function;
+  char name[256];
+  xesnprintfa(name, XECOUNT(name), "%s_%s",
+              f->getName().str().c_str(), suffix);
+  Function* new_f = Function::Create(
+      f->getFunctionType(), f->getLinkage(), StringRef(name), gen_module_);
+  new_f->copyAttributesFrom(f);
+  new_f->removeFnAttr(Attribute::NoInline);
+  Function::arg_iterator new_args = new_f->arg_begin();
+  for (Function::arg_iterator args = f->arg_begin(); args != f->arg_end();
+       ++args, ++new_args) {
+    new_args->setName(args->getName());
+  }
+  return new_f;
+}
+
+void ModuleGenerator::BuildGenerateCall(CodegenFunction* cgf, Module* m,
+                                        Function* f, BasicBlock* block) {
+  FunctionSymbol* fn = cgf->symbol;
+  LLVMContext& context = m->getContext();
+
+  // Generate the function and call it again through its entry point, which
+  // now forwards to the new body. If that failed there is nothing sane left
+  // to run, so trap instead of falling back into the old code. Generation
+  // goes through the module, as modules loaded from the cache only get a
+  // generator once their code has been written to. The module is the
+  // address of a global that is mapped to it when it is loaded.
+  IRBuilder<> b(block);
+  BasicBlock* retry = BasicBlock::Create(context, "generated", f);
+  BasicBlock* trap = BasicBlock::Create(context, "generate_failed", f);
+  Value* generateFunction = m->getFunction("XeGenerateFunction");
+  Value* generated = b.CreateCall3(
+      generateFunction,
+      f->arg_begin(),
+      b.CreatePtrToInt(m->getNamedGlobal("xe_exec_module"), b.getInt64Ty()),
+      b.getInt64(fn->start_address));
+  b.CreateCondBr(b.CreateICmpEQ(generated, b.getInt32(0)), retry, trap);
+
+  b.SetInsertPoint(retry);
+  Function* entry_f = m->getFunction(StringRef(fn->name()));
+  CallInst* call = b.CreateCall2(entry_f, f->arg_begin(), ++f->arg_begin());
+  call->setCallingConv(CallingConv::Fast);
+  call->setTailCall();
+  b.CreateRetVoid();
+
+  b.SetInsertPoint(trap);
+  b.CreateCall2(m->getFunction("XeTrap"), f->arg_begin(),
+                b.getInt32(fn->start_address));
+  b.CreateRetVoid();
+}
+
+bool ModuleGenerator::ShouldInline(CodegenFunction* cgf) {
+  FunctionSymbol* fn = cgf->symbol;
+  uint32_t instr_count = (fn->end_address - fn->start_address) / 4 + 1;
+  if (instr_count <= (uint32_t)FLAGS_inline_threshold) {
+    return true;
+  }
+  // Bigger functions are still worth it if they are called a lot.
+  return profile_ && FLAGS_profile_guided &&
+      instr_count <= (uint32_t)FLAGS_inline_hot_threshold &&
+      profile_->GetCallCount(fn->start_address) >=
+          (uint64_t)FLAGS_inline_hot_calls;
+}
+
+void ModuleGenerator::InlineCalls() {
+  // Map every function we generated back to its symbol. Calls may go to
+  // either the normal or the register function of the callee.
+  std::map<Function*, CodegenFunction*> callees;
+  for (std::map<uint32_t, CodegenFunction*>::iterator it =
+       functions_.begin(); it != functions_.end(); ++it) {
+    CodegenFunction* cgf = it->second;
+    callees.insert(std::pair<Function*, CodegenFunction*>(
+        cgf->function, cgf));
+    if (cgf->reg_function) {
+      callees.insert(std::pair<Function*, CodegenFunction*>(
+          cgf->reg_function, cgf));
+    }
+  }
+
+  // Only a single level is inlined per call, using the callee body as it is
+  // when we get to it. The callee locals fill from the state the caller just
+  // spilled to, and reoptimizing the caller folds them into its own.
+  size_t inline_count = 0;
+  XELOGI("Inlining calls...");
+  for (std::map<uint32_t, CodegenFunction*>::iterator it =
+       functions_.begin(); it != functions_.end(); ++it) {
+    CodegenFunction* cgf = it->second;
+    Function* f = cgf->reg_function ? cgf->reg_function : cgf->function;
+    if (f->isDeclaration()) {
+      continue;
+    }
+
+    std::vector<CallInst*> calls;
+    for (Function::iterator bb = f->begin(); bb != f->end(); ++bb) {
+      for (BasicBlock::iterator i = bb->begin(); i != bb->end(); ++i) {
+        CallInst* call = dyn_cast<CallInst>(i);
+        Function* callee = call ? call->getCalledFunction() : NULL;
+        if (!callee || callee->isDeclaration()) {
+          continue;
+        }
+        std::map<Function*, CodegenFunction*>::iterator callee_it =
+            callees.find(callee);
+        if (callee_it != callees.end() && callee_it->second != cgf &&
+            ShouldInline(callee_it->second)) {
+          calls.push_back(call);
+        }
+      }
+    }
+
+    bool inlined = false;
+    for (std::vector<CallInst*>::iterator call_it = calls.begin();
+         call_it != calls.end(); ++call_it) {
+      InlineFunctionInfo ifi;
+      if (InlineFunction(*call_it, ifi)) {
+        inlined = true;
+        inline_count++;
+      }
+    }
+    if (inlined) {
+      OptimizeFunction(gen_module_, f);
+    }
+  }
+  XELOGI("Inlined %ld calls", inline_count);
+}
+
+void ModuleGenerator::AddCallCounter(CodegenFunction* cgf, Module* m,
+                                     Function* f) {
+  FunctionSymbol* fn = cgf->symbol;
+
+  // The counter is owned by the profile and never moves. Like the branch
+  // counters it isn't atomic, as a few lost calls don't matter.
+  BasicBlock* entry = &f->getEntryBlock();
+  IRBuilder<> b(entry->getTerminator());
+  Value* counter = b.CreateIntToPtr(
+      b.getInt64((uint64_t)profile_->GetCallCounter(fn->start_address)),
+      PointerType::getUnqual(b.getInt64Ty()));
+  b.CreateStore(b.CreateAdd(b.CreateLoad(counter), b.getInt64(1)), counter);
+}
+
+void ModuleGenerator::AddEntryForward(CodegenFunction* cgf, Module* m,
+                                      Function* f) {
+  LLVMContext& context = m->getContext();
+
+  // Functions generated up front are their own entry point. When they are
+  // regenerated the new body is published to fn_ptr like for a stub, and
+  // from then on this only forwards to it.
+  BasicBlock* entry = &f->getEntryBlock();
+  BasicBlock* body = entry->splitBasicBlock(entry->getTerminator(),
+                                            "entry_body");
+  entry->getTerminator()->eraseFromParent();
+  BasicBlock* forward = BasicBlock::Create(context, "entry_forward", f, body);
+
+  IRBuilder<> b(entry);
+  LoadInst* fn_ptr = b.CreateLoad(
+      GetFunctionGlobal(m, cgf->symbol, "fn_ptr"));
+  fn_ptr->setAlignment(8);
+  fn_ptr->setAtomic(Acquire);
+  BranchInst* br = b.CreateCondBr(b.CreateIsNull(fn_ptr), body, forward);
+  MDBuilder md_builder(context);
+  br->setMetadata(LLVMContext::MD_prof,
+                  md_builder.createBranchWeights(2000, 1));
+
+  b.SetInsertPoint(forward);
+  CallInst* call = b.CreateCall2(
+      b.CreateBitCast(fn_ptr, f->getType()),
+      f->arg_begin(), ++f->arg_begin());
+  call->setCallingConv(CallingConv::Fast);
+  call->setTailCall();
+  b.CreateRetVoid();
+}
+
+void ModuleGenerator::AddStaleCheck(CodegenFunction* cgf, Module* m,
+                                    Function* f) {
+  LLVMContext& context = m->getContext();
+
+  BasicBlock* entry = &f->getEntryBlock();
+  BasicBlock* body = entry->splitBasicBlock(entry->getTerminator(),
+                                            "stale_body");
+  entry->getTerminator()->eraseFromParent();
+  BasicBlock* stale = BasicBlock::Create(context, "stale", f, body);
+
+  // The flag is set by ProcessCodeWrites, so it has to be reloaded on every
+  // call. The fault handler only counts writes, so any that have not been
+  // processed yet also go to the generator, which processes them first. The
+  // counters are globals mapped to the fault handler when the module is
+  // loaded.
+  IRBuilder<> b(entry);
+  Value* flag = GetFunctionGlobal(m, cgf->symbol, "stale");
+  Value* is_stale = b.CreateICmpNE(b.CreateLoad(flag, true), b.getInt32(0));
+  is_stale = b.CreateOr(is_stale, b.CreateICmpNE(
+      b.CreateLoad(m->getNamedGlobal("xe_code_write_count"), true),
+      b.CreateLoad(m->getNamedGlobal("xe_processed_code_write_count"),
+                   true)));
+  BranchInst* br = b.CreateCondBr(is_stale, stale, body);
+  MDBuilder md_builder(context);
+  br->setMetadata(LLVMContext::MD_prof,
+                  md_builder.createBranchWeights(1, 2000));
+
+  // Same as a stub: regenerate and call the function again through its entry
+  // point.
+  BuildGenerateCall(cgf, m, f, stale);
+}
+
+void ModuleGenerator::AddTierUpCounter(CodegenFunction* cgf, Module* m,
+                                       Function* f) {
+  FunctionSymbol* fn = cgf->symbol;
+  LLVMContext& context = m->getContext();
+
+  // Split the entry block so that the counter runs after the registers have
+  // been filled but before any of the function body.
+  BasicBlock* entry = &f->getEntryBlock();
+  BasicBlock* body = entry->splitBasicBlock(entry->getTerminator(),
+                                            "tier_body");
+  entry->getTerminator()->eraseFromParent();
+  BasicBlock* forward = BasicBlock::Create(context, "tier_forward", f, body);
+  BasicBlock* count_bb = BasicBlock::Create(context, "tier_count", f, body);
+  BasicBlock* tier_up = BasicBlock::Create(context, "tier_up", f, body);
+
+  // Once the optimized tier has been compiled every call is forwarded to it.
+  // The fill above only reads the state, so the arguments are passed along
+  // untouched.
+  IRBuilder<> b(entry);
+  Value* fn_ptr_slot = b.CreateIntToPtr(
+      b.getInt64((uint64_t)&cgf->optimized_fn_ptr),
+      PointerType::getUnqual(b.getInt8PtrTy()));
+  LoadInst* fn_ptr = b.CreateLoad(fn_ptr_slot);
+  fn_ptr->setAlignment(8);
+  fn_ptr->setAtomic(Acquire);
+  b.CreateCondBr(b.CreateIsNull(fn_ptr), count_bb, forward);
+
+  b.SetInsertPoint(forward);
+  std::vector<Value*> args;
+  for (Function::arg_iterator it = f->arg_begin(); it != f->arg_end(); ++it) {
+    args.push_back(it);
+  }
+  CallInst* call = b.CreateCall(
+      b.CreateBitCast(fn_ptr, f->getType()), args);
+  call->setCallingConv(CallingConv::Fast);
+  call->setTailCall();
+  if (f->getReturnType()->isVoidTy()) {
+    b.CreateRetVoid();
+  } else {
+    b.CreateRet(call);
+  }
+
+  // The counter lives in the CodegenFunction, which is never moved or freed
+  // while the code is alive. The increment is atomic so that exactly one call
+  // hits the threshold.
+  b.SetInsertPoint(count_bb);
+  Value* counter = b.CreateIntToPtr(
+      b.getInt64((uint64_t)&cgf->call_count),
+      PointerType::getUnqual(b.getInt32Ty()));
+  Value* count = b.CreateAtomicRMW(
+      AtomicRMWInst::Add, counter, b.getInt32(1), Monotonic);
+  b.CreateCondBr(
+      b.CreateICmpEQ(count, b.getInt32(FLAGS_tier_up_threshold - 1)),
+      tier_up, body);
+
+  b.SetInsertPoint(tier_up);
+  Value* tierUpFunction = m->getFunction("XeTierUpFunction");
+  b.CreateCall3(
+      tierUpFunction,
+      f->arg_begin(),
+      b.getInt64((uint64_t)this),
+      b.getInt64(fn->start_address));
+  b.CreateBr(body);
 }
 
 void ModuleGenerator::OptimizeFunction(Module* m, Function* fn) {
@@ -13,19 +13,31 @@
 #include <xenia/common.h>
 #include <xenia/core.h>
 
+#include <xenia/cpu/module_profile.h>
 #include <xenia/cpu/sdb.h>
+#include <xenia/cpu/ppc/state.h>
 #include <xenia/core/memory.h>
 #include <xenia/kernel/export.h>
 
 
 namespace llvm {
+  class BasicBlock;
   class DIBuilder;
   class ExecutionEngine;
   class Function;
   class FunctionType;
+  class GlobalVariable;
   class LLVMContext;
   class Module;
   class MDNode;
+  class Type;
+}
+
+
+namespace xe {
+namespace cpu {
+  class FaultHandler;
+}
 }
 
 
@@ -37,14 +49,21 @@ namespace codegen {
 class ModuleGenerator {
 public:
   ModuleGenerator(
-      xe_memory_ref memory, kernel::ExportResolver* export_resolver,
+      xe_pal_ref pal, xe_memory_ref memory, kernel::ExportResolver* export_resolver,
       const char* module_name, const char* module_path,
       sdb::SymbolDatabase* sdb,
       llvm::LLVMContext* context, llvm::Module* gen_module,
-      llvm::ExecutionEngine* engine);
+      llvm::ExecutionEngine* engine, ModuleProfile* profile,
+      FaultHandler* fault_handler);
   ~ModuleGenerator();
 
   int Generate();
+  int AdoptModule();
+  int GenerateFunction(uint32_t address);
+  int InterpretFunction(xe_ppc_state_t* state, uint32_t address, uint64_t lr);
+  void QueueTierUp(uint32_t address);
+  void InvalidateCode(uint32_t address, uint32_t length);
+  llvm::Function* AddRuntimeFunction(uint32_t address);
 
   void AddFunctionsToMap(
       std::tr1::unordered_map<uint32_t, llvm::Function*>& map);
@@ -55,18 +74,77 @@ private:
     sdb::FunctionSymbol*    symbol;
     llvm::FunctionType*     function_type;
     llvm::Function*         function;
+    llvm::Function*         reg_function;
+    // Native code of the body last generated after the module was. Stubs
+    // and functions that can be regenerated stay the entry point for good
+    // and forward all calls to it. This and the stale flag live in globals
+    // of the module, see PrepareFunction.
+    void* volatile*         fn_ptr;
+    bool                    is_generated;
+    bool                    is_optimized;
+    uint32_t                call_count;
+    // Native code of the optimized tier once it has been compiled. The first
+    // tier forwards all calls to it.
+    void* volatile          optimized_fn_ptr;
+    bool                    can_interpret;
+    volatile int32_t        interpret_count;
+    volatile int32_t*       is_stale;
+  };
+
+  // A set of functions generated together in their own context and module
+  // on one of the codegen threads.
+  class CodegenShard {
+  public:
+    std::vector<CodegenFunction*> functions;
+    std::string             bitcode;
+    int                     result_code;
   };
 
   CodegenFunction* GetCodegenFunction(uint32_t address);
+  llvm::GlobalVariable* GetFunctionGlobal(llvm::Module* m,
+                                          sdb::FunctionSymbol* fn,
+                                          const char* suffix);
+  void* CreateFunctionGlobal(sdb::FunctionSymbol* fn, const char* suffix,
+                             llvm::Type* type);
 
+  void CreateCompileUnit();
   void AddImports();
   llvm::Function* CreateFunctionDefinition(const char* name);
+  llvm::Function* CreateRegisterFunctionDefinition(sdb::FunctionSymbol* fn);
   void AddMissingImport(sdb::FunctionSymbol* fn);
   void AddPresentImport(sdb::FunctionSymbol* fn);
-  void PrepareFunction(sdb::FunctionSymbol* fn);
+  void PrepareFunction(sdb::FunctionSymbol* fn, bool use_registers);
+  void PrepareNewFunctions();
+  int GenerateParallel(uint32_t thread_count);
+  static void ShardThreadStart(void* param);
+  void ShardThread();
+  int GenerateShard(CodegenShard* shard);
   void BuildFunction(CodegenFunction* cgf);
+  void BuildFunction(CodegenFunction* cgf, llvm::Module* m,
+                     llvm::Function* f, llvm::Function* reg_f);
+  void BuildRegisterWrapper(CodegenFunction* cgf, llvm::Module* m,
+                            llvm::Function* f, llvm::Function* reg_f);
+  void BuildStub(CodegenFunction* cgf);
+  llvm::Function* CreateFunctionVersion(CodegenFunction* cgf,
+                                        const char* suffix);
+  void BuildGenerateCall(CodegenFunction* cgf, llvm::Module* m,
+                         llvm::Function* f, llvm::BasicBlock* block);
+  bool ShouldInline(CodegenFunction* cgf);
+  void InlineCalls();
+  void AddTierUpCounter(CodegenFunction* cgf, llvm::Module* m,
+                        llvm::Function* f);
+  void AddCallCounter(CodegenFunction* cgf, llvm::Module* m,
+                      llvm::Function* f);
+  void AddEntryForward(CodegenFunction* cgf, llvm::Module* m,
+                       llvm::Function* f);
+  void AddStaleCheck(CodegenFunction* cgf, llvm::Module* m,
+                     llvm::Function* f);
+  static void TierUpThreadStart(void* param);
+  void TierUpThread();
+  void TierUpFunction(CodegenFunction* cgf);
   void OptimizeFunction(llvm::Module* m, llvm::Function* fn);
 
+  xe_pal_ref pal_;
   xe_memory_ref memory_;
   kernel::ExportResolver* export_resolver_;
   char* module_name_;
@@ -76,10 +154,27 @@ private:
   llvm::LLVMContext*  context_;
   llvm::Module*       gen_module_;
   llvm::ExecutionEngine* engine_;
+  ModuleProfile*      profile_;
+  FaultHandler*       fault_handler_;
+  uint32_t            host_features_;
   llvm::DIBuilder*    di_builder_;
   llvm::MDNode*       cu_;
 
   std::map<uint32_t, CodegenFunction*> functions_;
+  xe_mutex_t*         generate_mutex_;
+
+  std::string         shard_bitcode_;
+  std::vector<CodegenShard*> shards_;
+  volatile int32_t    next_shard_;
+  volatile int32_t    shard_threads_running_;
+  xe_event_t*         shard_done_event_;
+
+  xe_thread_ref       tier_up_thread_;
+  xe_mutex_t*         tier_up_mutex_;
+  xe_event_t*         tier_up_event_;
+  xe_event_t*         tier_up_exited_event_;
+  std::vector<uint32_t> tier_up_queue_;
+  volatile bool       tier_up_running_;
 };
 
 
@@ -18,13 +18,38 @@ DECLARE_bool(trace_user_calls);
 DECLARE_bool(trace_kernel_calls);
 
 DECLARE_string(load_module_map);
+DECLARE_string(load_function_signatures);
+
+DECLARE_bool(cache_modules);
+DECLARE_string(cache_path);
 
 DECLARE_string(dump_path);
 DECLARE_bool(dump_module_bitcode);
 DECLARE_bool(dump_module_map);
+DECLARE_bool(dump_function_signatures);
+
+DECLARE_bool(profile_instrumentation);
+DECLARE_bool(profile_guided);
+DECLARE_string(profile_path);
 
 DECLARE_bool(optimize_ir_modules);
 DECLARE_bool(optimize_ir_functions);
+DECLARE_bool(lazy_function_generation);
+DECLARE_bool(tiered_compilation);
+DECLARE_int32(tier_up_threshold);
+DECLARE_bool(interpreter);
+DECLARE_int32(interpreter_threshold);
+DECLARE_int32(codegen_threads);
+DECLARE_bool(register_arguments);
+DECLARE_int32(leaf_inline_threshold);
+DECLARE_bool(inline_calls);
+DECLARE_int32(inline_threshold);
+DECLARE_int32(inline_hot_threshold);
+DECLARE_int32(inline_hot_calls);
+DECLARE_bool(native_replacements);
+DECLARE_bool(use_host_cpu_features);
+DECLARE_bool(reservation_table);
+DECLARE_bool(protect_code);
 
 
 #endif  // XENIA_CPU_PRIVATE_H_
@@ -23,6 +23,16 @@ DEFINE_bool(trace_kernel_calls, false,
 DEFINE_string(load_module_map, "",
     "Loads a .map for symbol names and to diff with the generated symbol "
     "database.");
+DEFINE_string(load_function_signatures, "",
+    "Loads function signatures to name matching functions. memcpy, memset, "
+    "strlen, and strcmp are replaced with native code when found.");
+
+
+// Caching:
+DEFINE_bool(cache_modules, false,
+    "Caches optimized module bitcode on disk and reuses it on later runs.");
+DEFINE_string(cache_path, "build/",
+    "Directory that cached module bitcode is placed into.");
 
 
 // Dumping:
@@ -32,6 +42,19 @@ DEFINE_bool(dump_module_bitcode, true,
     "Writes the module bitcode both before and after optimizations.");
 DEFINE_bool(dump_module_map, true,
     "Dumps the module symbol database.");
+DEFINE_bool(dump_function_signatures, false,
+    "Dumps the signatures of named functions for load_function_signatures.");
+
+
+// Profiling:
+DEFINE_bool(profile_instrumentation, false,
+    "Counts function calls and taken/not taken conditional branches and "
+    "adds them to the profile of the module on exit.");
+DEFINE_bool(profile_guided, false,
+    "Uses the profile of the module, if there is one, for branch weights and "
+    "to generate the most called functions first.");
+DEFINE_string(profile_path, "build/",
+    "Directory that module profiles are read from and written to.");
 
 
 // Optimizations:
@@ -39,3 +62,48 @@ DEFINE_bool(optimize_ir_modules, true,
     "Whether to run LLVM optimizations on modules.");
 DEFINE_bool(optimize_ir_functions, true,
     "Whether to run LLVM optimizations on functions.");
+DEFINE_bool(lazy_function_generation, false,
+    "Generates functions the first time they are called instead of when the "
+    "module is loaded.");
+DEFINE_bool(tiered_compilation, false,
+    "Generates functions without optimizations and recompiles them with full "
+    "optimizations in the background once they become hot.");
+DEFINE_int32(tier_up_threshold, 1000,
+    "Number of calls before a function is recompiled with optimizations.");
+DEFINE_bool(interpreter, false,
+    "Interprets functions until they have been called interpreter_threshold "
+    "times before generating them. Requires --lazy_function_generation.");
+DEFINE_int32(interpreter_threshold, 10,
+    "Number of interpreted calls before a function is generated.");
+DEFINE_int32(codegen_threads, 1,
+    "Number of threads used to generate modules. 1 generates on the loading "
+    "thread and 0 uses one thread per host processor.");
+DEFINE_bool(register_arguments, false,
+    "Passes guest function arguments and return values in host registers on "
+    "direct calls. Ignored when generating lazily.");
+DEFINE_int32(leaf_inline_threshold, 32,
+    "Leaf functions with at most this many instructions are always inlined "
+    "into their callers. Larger leaf functions are only hinted.");
+DEFINE_bool(inline_calls, false,
+    "Inlines small guest functions into their direct callers once the module "
+    "has been generated. Ignored when generating lazily or tiering.");
+DEFINE_int32(inline_threshold, 16,
+    "Functions with at most this many instructions are inlined.");
+DEFINE_int32(inline_hot_threshold, 64,
+    "Functions with at most this many instructions are inlined if the "
+    "profile shows at least inline_hot_calls calls to them.");
+DEFINE_int32(inline_hot_calls, 10000,
+    "Number of profiled calls before a function is considered hot.");
+DEFINE_bool(native_replacements, true,
+    "Replaces calls to __savegprlr/__restgprlr and recognized CRT routines "
+    "with inline or native code.");
+DEFINE_bool(use_host_cpu_features, true,
+    "Generates code for the instruction set extensions of the host processor "
+    "(SSSE3/SSE4.1/AVX/F16C). When false only SSE2 is assumed.");
+DEFINE_bool(reservation_table, false,
+    "Tracks lwarx/stwcx reservations per cache line so that a store "
+    "conditional fails if another one hit the line since the reservation, "
+    "even if the value was put back. Slower, but exact for lock-free code.");
+DEFINE_bool(protect_code, false,
+    "Write protects guest code and regenerates functions whose code is "
+    "written to (self-modifying code, overlays).");
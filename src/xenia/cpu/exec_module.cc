@@ -19,6 +19,7 @@
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/MemoryBuffer.h>
@@ -28,13 +29,16 @@
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 
+#include <xenia/cpu/codegen_stamp.h>
 #include <xenia/cpu/cpu-private.h>
+#include <xenia/cpu/fault_handler.h>
 #include <xenia/cpu/llvm_exports.h>
 #include <xenia/cpu/sdb.h>
 #include <xenia/cpu/codegen/module_generator.h>
 #include <xenia/cpu/ppc/instr.h>
 #include <xenia/cpu/ppc/state.h>
 #include <xenia/cpu/xethunk/xethunk.h>
+#include <xenia/dbg/simple_sha1.h>
 
 
 using namespace llvm;
@@ -45,35 +49,66 @@ using namespace xe::cpu::sdb;
 using namespace xe::kernel;
 
 
+namespace {
+
+// Bump this whenever the generated code changes in a way not covered by the
+// cache key to invalidate all cached modules.
+const uint32_t kCacheVersion = 5;
+
+}
+
+
 ExecModule::ExecModule(
-    xe_memory_ref memory, shared_ptr<ExportResolver> export_resolver,
+    xe_pal_ref pal, xe_memory_ref memory,
+    shared_ptr<ExportResolver> export_resolver,
     const char* module_name, const char* module_path,
-    shared_ptr<llvm::ExecutionEngine>& engine) {
+    shared_ptr<llvm::ExecutionEngine>& engine, FaultHandler* fault_handler) {
+  pal_ = xe_pal_retain(pal);
   memory_ = xe_memory_retain(memory);
   export_resolver_ = export_resolver;
   module_name_ = xestrdupa(module_name);
   module_path_ = xestrdupa(module_path);
   engine_ = engine;
+  fault_handler_ = fault_handler;
 
   context_ = shared_ptr<LLVMContext>(new LLVMContext());
+
+  memory_base_ = xe_memory_addr(memory_, 0);
+  code_addr_low_ = 0;
+  code_addr_high_ = 0;
+  fn_table_ = NULL;
+
+  codegen_mutex_ = xe_mutex_alloc(0);
+  codegen_failed_ = false;
 }
 
 ExecModule::~ExecModule() {
+  // Save what was counted this run. Generated code may still be running on
+  // other threads, so this is only a snapshot.
+  if (profile_.get() && FLAGS_profile_instrumentation) {
+    char profile_path[XE_MAX_PATH];
+    GetProfilePath(profile_path, XECOUNT(profile_path));
+    profile_->Write(profile_path);
+  }
+
   if (gen_module_) {
     Uninit();
     engine_->removeModule(gen_module_.get());
   }
 
+  xe_free(fn_table_);
+  xe_mutex_free(codegen_mutex_);
   xe_free(module_path_);
   xe_free(module_name_);
   xe_memory_release(memory_);
+  xe_pal_release(pal_);
 }
 
 int ExecModule::PrepareXex(xe_xex2_ref xex) {
   sdb_ = shared_ptr<sdb::SymbolDatabase>(
       new sdb::XexSymbolDatabase(memory_, export_resolver_.get(), xex));
 
-  code_addr_low_ = 0;
+  code_addr_low_ = UINT_MAX;
   code_addr_high_ = 0;
   const xe_xex2_header_t* header = xe_xex2_get_header(xex);
   for (size_t n = 0, i = 0; n < header->section_count; n++) {
@@ -116,6 +151,8 @@ int ExecModule::Prepare() {
   std::string error_message;
 
   char file_name[XE_MAX_PATH];
+  char cache_path[XE_MAX_PATH];
+  bool write_cache = false;
 
   OwningPtr<MemoryBuffer> shared_module_buffer;
   auto_ptr<Module> shared_module;
@@ -127,36 +164,67 @@ int ExecModule::Prepare() {
   // TODO(benvanik): embed the bc file into the emulator.
   const char *thunk_path = "src/xenia/cpu/xethunk/xethunk.bc";
 
-  // Calculate a cache path based on the module, the CPU version, and other
-  // bits.
-  // TODO(benvanik): cache path calculation.
-  //const char *cache_path = "build/generated.bc";
+  // Setup the function table for the code range. Entries are filled in as
+  // the processor resolves functions.
+  if (code_addr_high_ > code_addr_low_) {
+    fn_table_ = (void**)xe_calloc(
+        ((code_addr_high_ - code_addr_low_) / 4) * sizeof(void*));
+    XEEXPECTNOTNULL(fn_table_);
+  }
+
+  // Load shared bitcode files.
+  // These contain globals and common thunk code that are used by the
+  // generated code. They are also part of the cache key.
+  XEEXPECTZERO(MemoryBuffer::getFile(thunk_path, shared_module_buffer));
+
+  // Load the profile from previous runs. It's fine if there isn't one yet.
+  if ((FLAGS_profile_instrumentation || FLAGS_profile_guided) &&
+      code_addr_high_ > code_addr_low_) {
+    uint8_t code_hash[20];
+    HashCode(code_hash);
+    profile_ = auto_ptr<ModuleProfile>(new ModuleProfile(code_hash));
+    char profile_path[XE_MAX_PATH];
+    GetProfilePath(profile_path, XECOUNT(profile_path));
+    if (!profile_->Read(profile_path)) {
+      XELOGCPU("Loaded profile %s", profile_path);
+    }
+  }
 
   // Check the cache to see if the bitcode exists.
   // If it does, load that module directly. In the future we could also cache
   // on linked binaries but that requires more safety around versioning.
-  // TODO(benvanik): check cache for module bitcode and load.
-  // if (path_exists(cache_key)) {
-  //   exec_module = load_bitcode(cache_key);
-  //   sdb = load_symbol_table(cache_key);
-  // }
+  // Tracing, lazy generation, tiering, and profiling embed host pointers into
+  // the generated code so those modules are never cached.
+  if (FLAGS_cache_modules &&
+      !FLAGS_lazy_function_generation &&
+      !FLAGS_tiered_compilation &&
+      !FLAGS_profile_instrumentation &&
+      !FLAGS_trace_instructions &&
+      !FLAGS_trace_user_calls &&
+      !FLAGS_trace_kernel_calls) {
+    // Modules without a code range have no key and are just not cached.
+    if (GetCachePath(&*shared_module_buffer,
+                     cache_path, XECOUNT(cache_path))) {
+      XELOGCPU("Unable to build cache key for %s; not caching", module_name_);
+    } else if (!LoadCachedModule(cache_path)) {
+      XELOGCPU("Loaded cached module %s", cache_path);
+    } else {
+      write_cache = true;
+    }
+  }
 
   // If not found in cache, generate a new module.
   if (!gen_module_.get()) {
-    // Load shared bitcode files.
-    // These contain globals and common thunk code that are used by the
-    // generated code.
-    XEEXPECTZERO(MemoryBuffer::getFile(thunk_path, shared_module_buffer));
     shared_module = auto_ptr<Module>(ParseBitcodeFile(
         &*shared_module_buffer, *context_, &error_message));
     XEEXPECTNOTNULL(shared_module.get());
 
     // Analyze the module and add its symbols to the symbol database.
-    XEEXPECTZERO(sdb_->Analyze());
-
-    // Load a specified module map and diff.
-    if (FLAGS_load_module_map.size()) {
-      sdb_->ReadMap(FLAGS_load_module_map.c_str());
+    XEEXPECTZERO(AnalyzeCode());
+    if (FLAGS_dump_function_signatures) {
+      xesnprintfa(file_name, XECOUNT(file_name),
+                  "%s%s.sigs", FLAGS_dump_path.c_str(), module_name_);
+      sdb_->WriteSignatures(file_name);
     }
 
     // Dump the symbol database.
@@ -184,13 +252,11 @@ int ExecModule::Prepare() {
 
     // Build the module from the source code.
     codegen_ = auto_ptr<ModuleGenerator>(new ModuleGenerator(
-        memory_, export_resolver_.get(), module_name_, module_path_,
+        pal_, memory_, export_resolver_.get(), module_name_, module_path_,
         sdb_.get(), context_.get(), gen_module_.get(),
-        engine_.get()));
+        engine_.get(), profile_.get(), fault_handler_));
     XEEXPECTZERO(codegen_->Generate());
-
-    // Write to cache.
-    // TODO(benvanik): cache stuff
+    codegen_->AddFunctionsToMap(fns_);
 
     // Dump pre-optimized module to disk.
     if (FLAGS_dump_module_bitcode) {
@@ -201,44 +267,68 @@ int ExecModule::Prepare() {
       XEEXPECTTRUE(error_message.empty());
       WriteBitcodeToFile(gen_module_.get(), *outs);
     }
-  }
-
-  // Link optimizations.
-  XEEXPECTZERO(gen_module_->MaterializeAllPermanently(&error_message));
 
-  // Reset target triple (ignore what's in xethunk).
-  gen_module_->setTargetTriple(llvm::sys::getDefaultTargetTriple());
-
-  // Run full module optimizations.
-  pm.add(new DataLayout(gen_module_.get()));
-  if (FLAGS_optimize_ir_modules) {
+    // Link optimizations.
+    XEEXPECTZERO(gen_module_->MaterializeAllPermanently(&error_message));
+
+    // Reset target triple (ignore what's in xethunk).
+    gen_module_->setTargetTriple(llvm::sys::getDefaultTargetTriple());
+
+    // Run full module optimizations.
+    // Lazily generated and tiered functions are optimized as they are
+    // generated and the stubs/counters must be left alone.
+    pm.add(new DataLayout(gen_module_.get()));
+    if (FLAGS_optimize_ir_modules && !FLAGS_lazy_function_generation &&
+        !FLAGS_tiered_compilation) {
+      pm.add(createVerifierPass());
+      pmb.OptLevel      = 3;
+      pmb.SizeLevel     = 0;
+      pmb.Inliner       = createFunctionInliningPass();
+      pmb.Vectorize     = true;
+      pmb.LoopVectorize = true;
+      pmb.populateModulePassManager(pm);
+      pmb.populateLTOPassManager(pm, false, true);
+    }
     pm.add(createVerifierPass());
-    pmb.OptLevel      = 3;
-    pmb.SizeLevel     = 0;
-    pmb.Inliner       = createFunctionInliningPass();
-    pmb.Vectorize     = true;
-    pmb.LoopVectorize = true;
-    pmb.populateModulePassManager(pm);
-    pmb.populateLTOPassManager(pm, false, true);
-  }
-  pm.add(createVerifierPass());
-  pm.run(*gen_module_);
+    pm.run(*gen_module_);
 
-  // Dump post-optimized module to disk.
-  if (FLAGS_optimize_ir_modules && FLAGS_dump_module_bitcode) {
-    xesnprintfa(file_name, XECOUNT(file_name),
-                "%s%s.bc", FLAGS_dump_path.c_str(), module_name_);
-    outs = auto_ptr<raw_ostream>(new raw_fd_ostream(
-        file_name, error_message, raw_fd_ostream::F_Binary));
-    XEEXPECTTRUE(error_message.empty());
-    WriteBitcodeToFile(gen_module_.get(), *outs);
+    // Dump post-optimized module to disk.
+    if (FLAGS_optimize_ir_modules && !FLAGS_lazy_function_generation &&
+        !FLAGS_tiered_compilation && FLAGS_dump_module_bitcode) {
+      xesnprintfa(file_name, XECOUNT(file_name),
+                  "%s%s.bc", FLAGS_dump_path.c_str(), module_name_);
+      outs = auto_ptr<raw_ostream>(new raw_fd_ostream(
+          file_name, error_message, raw_fd_ostream::F_Binary));
+      XEEXPECTTRUE(error_message.empty());
+      WriteBitcodeToFile(gen_module_.get(), *outs);
+    }
+
+    // Write to cache.
+    // Failures here are not fatal - we'll just regenerate next run.
+    if (write_cache) {
+      WriteCachedModule(cache_path);
+    }
   }
 
-  // TODO(benvanik): experiment with LLD to see if we can write out a dll.
+  // Modules compiled ahead of time by xenia-aot come back through the cache.
+  // Native objects can't be used as the JIT has to own the code to relink it.
 
   // Initialize the module.
   XEEXPECTZERO(Init());
 
+  // Catch writes to the code so that changed functions get regenerated.
+  // Modules loaded from the cache get a generator on the first write.
+  if (FLAGS_protect_code && fault_handler_) {
+    XEEXPECTZERO(fault_handler_->WatchCode(
+        code_addr_low_, code_addr_high_ - code_addr_low_));
+  }
+
+  // JIT the functions the profile says are hot first so that they end up
+  // next to each other in memory.
+  if (profile_.get() && FLAGS_profile_guided) {
+    GenerateHotFunctions();
+  }
+
   // Force JIT of all functions.
   // for (Module::iterator it = gen_module_->begin(); it != gen_module_->end();
   //      ++it) {
@@ -253,8 +343,295 @@ XECLEANUP:
   return result_code;
 }
 
+void ExecModule::HashCode(uint8_t out_hash[20]) {
+  dbg::SHA1(xe_memory_addr(memory_, code_addr_low_),
+            code_addr_high_ - code_addr_low_, out_hash);
+}
+
+void ExecModule::GetProfilePath(char* out_path, size_t out_path_size) {
+  xesnprintfa(out_path, out_path_size, "%s%s.profile",
+              FLAGS_profile_path.c_str(), module_name_);
+}
+
+void ExecModule::GenerateHotFunctions() {
+  std::vector<uint32_t> addresses;
+  profile_->GetFunctionsByCallCount(addresses);
+  for (std::vector<uint32_t>::iterator it = addresses.begin();
+       it != addresses.end(); ++it) {
+    uint32_t address = *it;
+    FunctionMap::iterator fn_it = fns_.find(address);
+    if (fn_it == fns_.end() || !ContainsCode(address) ||
+        GetFunctionPointer(address)) {
+      continue;
+    }
+    // Lazily generated functions are still stubs, so build them for real.
+    if (FLAGS_lazy_function_generation && codegen_.get()) {
+      codegen_->GenerateFunction(address);
+    }
+    void* fn_ptr = engine_->getPointerToFunction(fn_it->second);
+    if (fn_ptr) {
+      SetFunctionPointer(address, fn_ptr);
+    }
+  }
+}
+
+int ExecModule::GetCachePath(const MemoryBuffer* thunk_buffer,
+                             char* out_path, size_t out_path_size) {
+  // The key covers everything that changes the generated code: the guest
+  // code, the thunk module, the profile, the function signatures, the
+  // code generator sources, the codegen flags and inlining thresholds, and
+  // the host CPU features the emitters were allowed to use.
+  struct {
+    uint32_t  version;
+    uint32_t  flags;
+    uint32_t  host_features;
+    int32_t   leaf_inline_threshold;
+    int32_t   inline_threshold;
+    int32_t   inline_hot_threshold;
+    int32_t   inline_hot_calls;
+    uint8_t   code_hash[20];
+    uint8_t   thunk_hash[20];
+    uint8_t   profile_hash[20];
+    uint8_t   signatures_hash[20];
+    char      codegen_stamp[48];
+  } key;
+  xe_zero_struct(&key, sizeof(key));
+
+  if (code_addr_high_ <= code_addr_low_) {
+    return 1;
+  }
+
+  key.version = kCacheVersion;
+  key.flags =
+      (FLAGS_optimize_ir_modules ? (1 << 0) : 0) |
+      (FLAGS_optimize_ir_functions ? (1 << 1) : 0) |
+      (FLAGS_register_arguments ? (1 << 3) : 0) |
+      (FLAGS_reservation_table ? (1 << 4) : 0) |
+      (FLAGS_profile_guided ? (1 << 5) : 0) |
+      (FLAGS_inline_calls ? (1 << 6) : 0) |
+      (FLAGS_native_replacements ? (1 << 7) : 0) |
+      (FLAGS_protect_code ? (1 << 8) : 0);
+  key.host_features = FLAGS_use_host_cpu_features ?
+      xe_pal_get_processor_features(pal_) : 0;
+  key.leaf_inline_threshold = FLAGS_leaf_inline_threshold;
+  key.inline_threshold = FLAGS_inline_threshold;
+  key.inline_hot_threshold = FLAGS_inline_hot_threshold;
+  key.inline_hot_calls = FLAGS_inline_hot_calls;
+  HashCode(key.code_hash);
+  dbg::SHA1((const uint8_t*)thunk_buffer->getBufferStart(),
+            thunk_buffer->getBufferSize(), key.thunk_hash);
+  if (profile_.get() && FLAGS_profile_guided) {
+    xe_copy_struct(key.profile_hash, profile_->hash(),
+                   sizeof(key.profile_hash));
+  }
+  if (FLAGS_load_function_signatures.size()) {
+    OwningPtr<MemoryBuffer> signatures_buffer;
+    if (!MemoryBuffer::getFile(FLAGS_load_function_signatures.c_str(),
+                               signatures_buffer)) {
+      dbg::SHA1((const uint8_t*)signatures_buffer->getBufferStart(),
+                signatures_buffer->getBufferSize(), key.signatures_hash);
+    }
+  }
+  XEIGNORE(xestrcpya(key.codegen_stamp, XECOUNT(key.codegen_stamp),
+                     XE_CODEGEN_STAMP));
+
+  uint8_t hash[20];
+  dbg::SHA1((const uint8_t*)&key, sizeof(key), hash);
+  char hash_string[XECOUNT(hash) * 2 + 1];
+  for (size_t n = 0; n < XECOUNT(hash); n++) {
+    xesnprintfa(hash_string + n * 2, 3, "%.2x", hash[n]);
+  }
+
+  xesnprintfa(out_path, out_path_size, "%s%s-%s.bc",
+              FLAGS_cache_path.c_str(), module_name_, hash_string);
+  return 0;
+}
+
+int ExecModule::AnalyzeCode() {
+  XEEXPECTZERO(sdb_->Analyze());
+
+  // Load a specified module map and diff.
+  if (FLAGS_load_module_map.size()) {
+    sdb_->ReadMap(FLAGS_load_module_map.c_str());
+  }
+
+  // Name known functions and mark the ones with native replacements.
+  if (FLAGS_load_function_signatures.size()) {
+    sdb_->ReadSignatures(FLAGS_load_function_signatures.c_str());
+  }
+
+  return 0;
+XECLEANUP:
+  return 1;
+}
+
+int ExecModule::LoadCachedModule(const char* cache_path) {
+  std::string error_message;
+
+  OwningPtr<MemoryBuffer> buffer;
+  if (MemoryBuffer::getFile(cache_path, buffer)) {
+    // Not yet cached.
+    return 1;
+  }
+
+  auto_ptr<Module> module(
+      ParseBitcodeFile(&*buffer, *context_, &error_message));
+  if (!module.get()) {
+    XELOGW("Unable to load cached module %s: %s",
+           cache_path, error_message.c_str());
+    return 1;
+  }
+
+  // Validate the module before touching any other state so that a bad file
+  // can fall back to generation cleanly.
+  NamedMDNode* function_table = module->getNamedMetadata("xe.functions");
+  if (!function_table ||
+      !module->getFunction("xe_module_init") ||
+      !module->getFunction("xe_module_uninit")) {
+    XELOGW("Cached module %s is invalid; regenerating", cache_path);
+    return 1;
+  }
+  FunctionMap fns;
+  for (unsigned n = 0; n < function_table->getNumOperands(); n++) {
+    MDNode* entry = function_table->getOperand(n);
+    ConstantInt* address = entry->getNumOperands() == 2 ?
+        dyn_cast_or_null<ConstantInt>(entry->getOperand(0)) : NULL;
+    Function* f = entry->getNumOperands() == 2 ?
+        dyn_cast_or_null<Function>(entry->getOperand(1)) : NULL;
+    if (!address || !f) {
+      XELOGW("Cached module %s is invalid; regenerating", cache_path);
+      return 1;
+    }
+    fns.insert(std::pair<uint32_t, Function*>(
+        (uint32_t)address->getZExtValue(), f));
+  }
+  gen_module_ = shared_ptr<Module>(module.release());
+  fns_.swap(fns);
+
+  // Only the imports are needed from the symbol database. They are used to
+  // relink the kernel calls and setup kernel variables. Import analysis only
+  // ever runs once, so a full analysis after a failure here won't redo it.
+  if (sdb_->AnalyzeImports() ||
+      InjectGlobals() ||
+      LinkImports()) {
+    XELOGW("Cached module %s could not be linked; regenerating", cache_path);
+    // Drop the mappings made for the module before it goes away.
+    engine_->clearGlobalMappingsFromModule(gen_module_.get());
+    fns_.clear();
+    gen_module_.reset();
+    return 1;
+  }
+
+  return 0;
+}
+
+int ExecModule::WriteCachedModule(const char* cache_path) {
+  LLVMContext& context = *context_.get();
+  std::string error_message;
+
+  // Stash the function map in the module so that it can be rebuilt without
+  // analyzing the code.
+  NamedMDNode* function_table =
+      gen_module_->getOrInsertNamedMetadata("xe.functions");
+  for (FunctionMap::iterator it = fns_.begin(); it != fns_.end(); ++it) {
+    Value* values[] = {
+      ConstantInt::get(Type::getInt32Ty(context), it->first),
+      it->second,
+    };
+    function_table->addOperand(MDNode::get(context, values));
+  }
+
+  raw_fd_ostream outs(cache_path, error_message, raw_fd_ostream::F_Binary);
+  if (!error_message.empty()) {
+    XELOGW("Unable to write cached module %s: %s",
+           cache_path, error_message.c_str());
+    return 1;
+  }
+  WriteBitcodeToFile(gen_module_.get(), outs);
+  XELOGI("Wrote cached module %s", cache_path);
+  return 0;
+}
+
 void ExecModule::AddFunctionsToMap(FunctionMap& map) {
-  codegen_->AddFunctionsToMap(map);
+  map.insert(fns_.begin(), fns_.end());
+}
+
+Function* ExecModule::AddRuntimeFunction(uint32_t address) {
+  // Modules loaded from the cache have no generator until their code is
+  // written to, and cannot add new code before then.
+  if (address < code_addr_low_ || address >= code_addr_high_) {
+    return NULL;
+  }
+  ModuleGenerator* codegen = GetGenerator(false);
+  if (!codegen) {
+    return NULL;
+  }
+  Function* f = codegen->AddRuntimeFunction(address);
+  if (f) {
+    fns_.insert(std::pair<uint32_t, Function*>(address, f));
+  }
+  return f;
+}
+
+void ExecModule::InvalidateCode(uint32_t address, uint32_t length) {
+  if (address >= code_addr_high_ || address + length <= code_addr_low_) {
+    return;
+  }
+  ModuleGenerator* codegen = GetGenerator(true);
+  if (codegen) {
+    codegen->InvalidateCode(address, length);
+  }
+}
+
+int ExecModule::GenerateFunction(uint32_t address) {
+  // Writes not processed yet may be what created the generator.
+  if (fault_handler_) {
+    fault_handler_->ProcessCodeWrites();
+  }
+  ModuleGenerator* codegen = GetGenerator(false);
+  if (!codegen) {
+    // Only stale functions call in here, and those have a generator.
+    return 1;
+  }
+  return codegen->GenerateFunction(address);
+}
+
+ModuleGenerator* ExecModule::GetGenerator(bool create) {
+  xe_mutex_lock(codegen_mutex_);
+  if (!codegen_.get() && create && !codegen_failed_) {
+    // Modules loaded from the cache skipped analysis, so it has to be done
+    // now to be able to regenerate any of their functions. The cached code is
+    // taken over as-is, see ModuleGenerator::AdoptModule.
+    XELOGCPU("Code of cached module %s written to; adopting it",
+             module_name_);
+    codegen_ = auto_ptr<ModuleGenerator>(new ModuleGenerator(
+        pal_, memory_, export_resolver_.get(), module_name_, module_path_,
+        sdb_.get(), context_.get(), gen_module_.get(),
+        engine_.get(), profile_.get(), fault_handler_));
+    if (AnalyzeCode() || codegen_->AdoptModule()) {
+      XELOGE("Unable to adopt cached module %s", module_name_);
+      codegen_.reset();
+      codegen_failed_ = true;
+    }
+  }
+  ModuleGenerator* codegen = codegen_.get();
+  xe_mutex_unlock(codegen_mutex_);
+  return codegen;
+}
+
+bool ExecModule::ContainsCode(uint32_t address) {
+  return fn_table_ && address >= code_addr_low_ && address < code_addr_high_;
+}
+
+void* ExecModule::GetFunctionPointer(uint32_t address) {
+  XEASSERT(ContainsCode(address));
+  // Pointer sized aligned loads and stores are atomic, so no lock is needed.
+  return ((void* volatile*)fn_table_)[(address - code_addr_low_) >> 2];
+}
+
+void ExecModule::SetFunctionPointer(uint32_t address, void* fn_ptr) {
+  XEASSERT(ContainsCode(address));
+  ((void* volatile*)fn_table_)[(address - code_addr_low_) >> 2] = fn_ptr;
 }
 
 int ExecModule::InjectGlobals() {
@@ -266,24 +643,106 @@ int ExecModule::InjectGlobals() {
 
   // xe_memory_base
   // This is the base void* pointer to the memory space.
-  gv = new GlobalVariable(
-      *gen_module_,
-      int8PtrTy,
-      true,
-      GlobalValue::ExternalLinkage,
-      0,
-      "xe_memory_base");
-  // Align to 64b - this makes SSE faster.
-  gv->setAlignment(64);
-  gv->setInitializer(ConstantExpr::getIntToPtr(
-      ConstantInt::get(intPtrTy, (uintptr_t)xe_memory_addr(memory_, 0)),
-      int8PtrTy));
+  gv = gen_module_->getNamedGlobal("xe_memory_base");
+  if (!gv) {
+    gv = new GlobalVariable(
+        *gen_module_,
+        int8PtrTy,
+        true,
+        GlobalValue::ExternalLinkage,
+        0,
+        "xe_memory_base");
+    // Align to 64b - this makes SSE faster.
+    gv->setAlignment(64);
+  }
+  if (FLAGS_cache_modules) {
+    // Cached modules cannot embed the host address of memory, so have the JIT
+    // resolve the global to our copy of it instead.
+    engine_->addGlobalMapping(gv, &memory_base_);
+  } else {
+    gv->setInitializer(ConstantExpr::getIntToPtr(
+        ConstantInt::get(intPtrTy, (uintptr_t)memory_base_),
+        int8PtrTy));
+  }
+
+  // xe_exec_module
+  // Generated code passes the address of this to the runtime to find the
+  // module again. It is only ever declared so that the address is ours.
+  gv = gen_module_->getNamedGlobal("xe_exec_module");
+  if (!gv) {
+    gv = new GlobalVariable(
+        *gen_module_,
+        Type::getInt8Ty(context),
+        true,
+        GlobalValue::ExternalLinkage,
+        0,
+        "xe_exec_module");
+  }
+  engine_->addGlobalMapping(gv, this);
+
+  // xe_code_write_count/xe_processed_code_write_count
+  // Write counters of the fault handler, checked by code that can go stale.
+  static const char* counter_names[] = {
+    "xe_code_write_count",
+    "xe_processed_code_write_count",
+  };
+  for (size_t n = 0; n < XECOUNT(counter_names); n++) {
+    gv = gen_module_->getNamedGlobal(counter_names[n]);
+    if (!gv) {
+      gv = new GlobalVariable(
+          *gen_module_,
+          Type::getInt32Ty(context),
+          false,
+          GlobalValue::ExternalLinkage,
+          0,
+          counter_names[n]);
+    }
+    if (fault_handler_) {
+      engine_->addGlobalMapping(gv, (void*)(n ?
+          fault_handler_->processed_code_write_count() :
+          fault_handler_->code_write_count()));
+    }
+  }
 
   SetupLlvmExports(gen_module_.get(), dl, engine_.get());
 
   return 0;
 }
 
+int ExecModule::LinkImports() {
+  // Map the kernel shims referenced by the module back to the host functions.
+  // Fresh modules have this done by the ModuleGenerator.
+  std::vector<FunctionSymbol*> functions;
+  if (sdb_->GetAllFunctions(functions)) {
+    return 1;
+  }
+  char name[256];
+  for (std::vector<FunctionSymbol*>::iterator it = functions.begin();
+       it != functions.end(); ++it) {
+    FunctionSymbol* fn = *it;
+    KernelExport* kernel_export = fn->kernel_export;
+    if (fn->type != FunctionSymbol::Kernel ||
+        !kernel_export || !kernel_export->is_implemented) {
+      continue;
+    }
+
+    xesnprintfa(name, XECOUNT(name), "__shim_%s", kernel_export->name);
+    Function* shim = gen_module_->getFunction(name);
+    if (shim) {
+      engine_->addGlobalMapping(shim,
+          (void*)kernel_export->function_data.shim);
+    }
+
+    xesnprintfa(name, XECOUNT(name), "__shim_data_%s", kernel_export->name);
+    GlobalVariable* gv = gen_module_->getNamedGlobal(name);
+    if (gv) {
+      engine_->addGlobalMapping(gv,
+          (void*)&kernel_export->function_data.shim_data);
+    }
+  }
+  return 0;
+}
+
 int ExecModule::Init() {
   // Setup all kernel variables.
   std::vector<VariableSymbol*> variables;
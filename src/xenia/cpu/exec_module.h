@@ -13,6 +13,7 @@
 #include <xenia/common.h>
 #include <xenia/core.h>
 
+#include <xenia/cpu/module_profile.h>
 #include <xenia/cpu/sdb.h>
 #include <xenia/kernel/export.h>
 #include <xenia/kernel/xex2.h>
@@ -22,11 +23,13 @@ namespace llvm {
   class ExecutionEngine;
   class Function;
   class LLVMContext;
+  class MemoryBuffer;
   class Module;
 }
 
 namespace xe {
 namespace cpu {
+  class FaultHandler;
 namespace codegen {
   class ModuleGenerator;
 }
@@ -44,37 +47,70 @@ typedef std::tr1::unordered_map<uint32_t, llvm::Function*> FunctionMap;
 class ExecModule {
 public:
   ExecModule(
-      xe_memory_ref memory, shared_ptr<kernel::ExportResolver> export_resolver,
+      xe_pal_ref pal, xe_memory_ref memory, shared_ptr<kernel::ExportResolver> export_resolver,
       const char* module_name, const char* module_path,
-      shared_ptr<llvm::ExecutionEngine>& engine);
+      shared_ptr<llvm::ExecutionEngine>& engine, FaultHandler* fault_handler);
   ~ExecModule();
 
   int PrepareXex(xe_xex2_ref xex);
   int PrepareRawBinary(uint32_t start_address, uint32_t end_address);
 
   void AddFunctionsToMap(FunctionMap& map);
+  llvm::Function* AddRuntimeFunction(uint32_t address);
+
+  // Generates (or regenerates) the function at the given address. Called from
+  // generated code, see ModuleGenerator::GenerateFunction.
+  int GenerateFunction(uint32_t address);
+
+  // Marks generated functions overlapping the range as stale so that they are
+  // regenerated on their next call. Used with --protect_code.
+  void InvalidateCode(uint32_t address, uint32_t length);
+
+  // Native entry points of functions in the code range are kept in a flat
+  // table indexed by (address - code_addr_low_) / 4. Reads are lock-free and
+  // entries are published as functions are compiled.
+  bool ContainsCode(uint32_t address);
+  void* GetFunctionPointer(uint32_t address);
+  void SetFunctionPointer(uint32_t address, void* fn_ptr);
 
   void Dump();
 
 private:
   int Prepare();
+  int AnalyzeCode();
+  codegen::ModuleGenerator* GetGenerator(bool create);
+  void HashCode(uint8_t out_hash[20]);
+  void GetProfilePath(char* out_path, size_t out_path_size);
+  void GenerateHotFunctions();
+  int GetCachePath(const llvm::MemoryBuffer* thunk_buffer,
+                   char* out_path, size_t out_path_size);
+  int LoadCachedModule(const char* cache_path);
+  int WriteCachedModule(const char* cache_path);
   int InjectGlobals();
+  int LinkImports();
   int Init();
   int Uninit();
 
+  xe_pal_ref                          pal_;
   xe_memory_ref                       memory_;
   shared_ptr<kernel::ExportResolver>  export_resolver_;
   char*                               module_name_;
   char*                               module_path_;
   shared_ptr<llvm::ExecutionEngine>   engine_;
+  FaultHandler*                       fault_handler_;
   shared_ptr<sdb::SymbolDatabase>     sdb_;
   shared_ptr<llvm::LLVMContext>       context_;
   shared_ptr<llvm::Module>            gen_module_;
+  auto_ptr<ModuleProfile>             profile_;
   auto_ptr<codegen::ModuleGenerator>  codegen_;
+  xe_mutex_t*                         codegen_mutex_;
+  bool                                codegen_failed_;
 
+  uint8_t*    memory_base_;
   uint32_t    code_addr_low_;
   uint32_t    code_addr_high_;
   FunctionMap fns_;
+  void**      fn_table_;
 };
 
 
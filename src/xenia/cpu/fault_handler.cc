@@ -0,0 +1,480 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/fault_handler.h>
+
+#include <algorithm>
+
+#if !XE_LIKE(WIN32)
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ucontext.h>
+#endif  // WIN32
+
+#include <llvm/Support/DebugLoc.h>
+
+
+using namespace llvm;
+using namespace xe;
+using namespace xe::cpu;
+
+
+namespace {
+
+// Host faults are process-wide, so only one handler can be active.
+FaultHandler* current_handler_ = NULL;
+
+// Code pages are tracked at the host page size.
+const uint32_t kCodePageShift = 12;
+const uint32_t kCodePageSize  = 1 << kCodePageShift;
+const size_t   kCodePageCount = 0x100000000ull >> kCodePageShift;
+
+enum CodePageState {
+  kCodePageUnwatched      = 0,
+  // Read only. The first write moves it to kCodePageUnprotecting.
+  kCodePageProtected      = 1,
+  // Writable and not yet reported by ProcessCodeWrites.
+  kCodePageWritten        = 2,
+  // Writable and reported, or on its way to being protected again. Faults
+  // on it just retry.
+  kCodePageUnprotected    = 3,
+  // Being made writable by the fault handler. Only the handler moves it on,
+  // to kCodePageWritten once the protection has changed. Faults on it just
+  // retry.
+  kCodePageUnprotecting   = 4,
+};
+
+// Pages in the other states belong to the fault handler or are waiting to be
+// reported.
+bool IsCodePageWatchable(int32_t state) {
+  return state == kCodePageUnwatched || state == kCodePageUnprotected;
+}
+
+#if XE_LIKE(WIN32)
+
+void ReportInvalidAccess(uint32_t cia, uint32_t ea) {
+  XELOGE("INVALID ACCESS %.8X: tried to touch %.8X", cia, ea);
+}
+
+#else
+
+void FormatHex32(char* p, uint32_t value) {
+  const char* digits = "0123456789ABCDEF";
+  for (int n = 7; n >= 0; n--) {
+    p[n] = digits[value & 0xF];
+    value >>= 4;
+  }
+}
+
+// This runs in the signal handler, where the logging functions can't be
+// used as they lock and allocate. The message is formatted in place and
+// written straight to stderr instead.
+void ReportInvalidAccess(uint32_t cia, uint32_t ea) {
+  char message[] = "INVALID ACCESS XXXXXXXX: tried to touch XXXXXXXX\n";
+  FormatHex32(message + 15, cia);
+  FormatHex32(message + 40, ea);
+  XEIGNORE(write(STDERR_FILENO, message, sizeof(message) - 1));
+}
+
+#endif  // WIN32
+
+#if XE_LIKE(WIN32)
+
+void* vectored_handler_ = NULL;
+
+LONG CALLBACK FaultExceptionHandler(PEXCEPTION_POINTERS ex_info) {
+  if (ex_info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION) {
+    return EXCEPTION_CONTINUE_SEARCH;
+  }
+  uintptr_t host_pc = (uintptr_t)ex_info->ContextRecord->Rip;
+  const void* fault_addr =
+      (const void*)ex_info->ExceptionRecord->ExceptionInformation[1];
+  if (current_handler_) {
+    if (current_handler_->HandleCodeWrite(fault_addr)) {
+      return EXCEPTION_CONTINUE_EXECUTION;
+    }
+    XEIGNORE(current_handler_->HandleFault(host_pc, fault_addr));
+  }
+
+  // The guest cannot be resumed after a bad access, so let the exception
+  // carry on to whatever would have handled it without us.
+  return EXCEPTION_CONTINUE_SEARCH;
+}
+
+#else
+
+struct sigaction old_segv_action_;
+struct sigaction old_bus_action_;
+
+void FaultSignalHandler(int signal, siginfo_t* info, void* context) {
+  ucontext_t* uc = (ucontext_t*)context;
+#if XE_LIKE(OSX)
+  uintptr_t host_pc = (uintptr_t)uc->uc_mcontext->__ss.__rip;
+#else
+  uintptr_t host_pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+#endif  // OSX
+  if (current_handler_) {
+    // Writes to watched code retry once the page is writable again.
+    if (current_handler_->HandleCodeWrite(info->si_addr)) {
+      return;
+    }
+    XEIGNORE(current_handler_->HandleFault(host_pc, info->si_addr));
+  }
+
+  // The guest cannot be resumed after a bad access. Put back the previous
+  // handler and return so that the instruction faults again and gets
+  // whatever handling it would have had without us.
+  sigaction(signal,
+            signal == SIGBUS ? &old_bus_action_ : &old_segv_action_,
+            NULL);
+}
+
+#endif  // WIN32
+
+}
+
+
+FaultHandler::FaultHandler(xe_memory_ref memory) {
+  memory_ = xe_memory_retain(memory);
+  installed_ = false;
+  ranges_mutex_ = xe_mutex_alloc(0);
+  ranges_table_ = NULL;
+  ranges_readers_ = 0;
+  code_pages_mutex_ = xe_mutex_alloc(0);
+  code_pages_ = NULL;
+  code_pages_low_ = UINT_MAX;
+  code_pages_high_ = 0;
+  code_write_count_ = 0;
+  processed_code_write_count_ = 0;
+  code_writes_mutex_ = xe_mutex_alloc(0);
+  code_write_callback_ = NULL;
+  code_write_callback_data_ = NULL;
+}
+
+FaultHandler::~FaultHandler() {
+  Uninstall();
+
+  for (CodeRangeMap::iterator it = ranges_.begin(); it != ranges_.end();
+       ++it) {
+    delete it->second;
+  }
+  delete ranges_table_;
+  for (std::vector<CodeRangeTable*>::iterator it = retired_tables_.begin();
+       it != retired_tables_.end(); ++it) {
+    delete *it;
+  }
+  for (std::vector<CodeRange*>::iterator it = retired_ranges_.begin();
+       it != retired_ranges_.end(); ++it) {
+    delete *it;
+  }
+
+  xe_free((void*)code_pages_);
+  xe_mutex_free(code_writes_mutex_);
+  xe_mutex_free(code_pages_mutex_);
+  xe_mutex_free(ranges_mutex_);
+  xe_memory_release(memory_);
+}
+
+int FaultHandler::Install() {
+  XEASSERTFALSE(installed_);
+  XEASSERTNULL(current_handler_);
+  current_handler_ = this;
+
+#if XE_LIKE(WIN32)
+  vectored_handler_ = AddVectoredExceptionHandler(1, FaultExceptionHandler);
+  XEEXPECTNOTNULL(vectored_handler_);
+#else
+  struct sigaction action;
+  xe_zero_struct(&action, sizeof(action));
+  action.sa_sigaction = FaultSignalHandler;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  XEEXPECTZERO(sigaction(SIGSEGV, &action, &old_segv_action_));
+  // Some hosts raise SIGBUS for protection faults.
+  XEEXPECTZERO(sigaction(SIGBUS, &action, &old_bus_action_));
+#endif  // WIN32
+
+  installed_ = true;
+  return 0;
+
+XECLEANUP:
+  current_handler_ = NULL;
+  return 1;
+}
+
+void FaultHandler::Uninstall() {
+  if (!installed_) {
+    return;
+  }
+
+#if XE_LIKE(WIN32)
+  RemoveVectoredExceptionHandler(vectored_handler_);
+  vectored_handler_ = NULL;
+#else
+  sigaction(SIGSEGV, &old_segv_action_, NULL);
+  sigaction(SIGBUS, &old_bus_action_, NULL);
+#endif  // WIN32
+
+  current_handler_ = NULL;
+  installed_ = false;
+}
+
+void FaultHandler::NotifyFunctionEmitted(
+    const Function& f, void* code, size_t size,
+    const EmittedFunctionDetails& details) {
+  // Generated functions set the debug location of each guest instruction to
+  // its address split across the line (high 24 bits) and column (low 8).
+  // Anything without locations (trampolines, stubs) never touches guest
+  // memory and isn't tracked.
+  if (details.LineStarts.empty()) {
+    return;
+  }
+
+  CodeRange* range = new CodeRange();
+  range->start = (uintptr_t)code;
+  range->end = range->start + size;
+  for (std::vector<EmittedFunctionDetails::LineStart>::const_iterator it =
+       details.LineStarts.begin(); it != details.LineStarts.end(); ++it) {
+    uint32_t cia = (it->Loc.getLine() << 8) | it->Loc.getCol();
+    range->lines.push_back(std::make_pair(it->Address, cia));
+  }
+
+  xe_mutex_lock(ranges_mutex_);
+  CodeRangeMap::iterator it = ranges_.find(range->start);
+  if (it != ranges_.end()) {
+    retired_ranges_.push_back(it->second);
+    ranges_.erase(it);
+  }
+  ranges_.insert(CodeRangeMap::value_type(range->start, range));
+  PublishRanges();
+  xe_mutex_unlock(ranges_mutex_);
+}
+
+void FaultHandler::NotifyFreeingMachineCode(void* old_ptr) {
+  xe_mutex_lock(ranges_mutex_);
+  CodeRangeMap::iterator it = ranges_.find((uintptr_t)old_ptr);
+  if (it != ranges_.end()) {
+    retired_ranges_.push_back(it->second);
+    ranges_.erase(it);
+    PublishRanges();
+  }
+  xe_mutex_unlock(ranges_mutex_);
+}
+
+void FaultHandler::PublishRanges() {
+  // Must be called with ranges_mutex_ held.
+  CodeRangeTable* table = new CodeRangeTable();
+  table->ranges.reserve(ranges_.size());
+  for (CodeRangeMap::iterator it = ranges_.begin(); it != ranges_.end();
+       ++it) {
+    table->ranges.push_back(it->second);
+  }
+
+  // The swap is a full barrier, so any fault that may still be reading the
+  // old table has already been counted in ranges_readers_.
+  CodeRangeTable* old_table = ranges_table_;
+  XEIGNORE(xe_atomic_cas_64((int64_t)(intptr_t)old_table,
+                            (int64_t)(intptr_t)table,
+                            (volatile int64_t*)&ranges_table_));
+  if (old_table) {
+    retired_tables_.push_back(old_table);
+  }
+  if (!ranges_readers_) {
+    for (std::vector<CodeRangeTable*>::iterator it = retired_tables_.begin();
+         it != retired_tables_.end(); ++it) {
+      delete *it;
+    }
+    retired_tables_.clear();
+    for (std::vector<CodeRange*>::iterator it = retired_ranges_.begin();
+         it != retired_ranges_.end(); ++it) {
+      delete *it;
+    }
+    retired_ranges_.clear();
+  }
+}
+
+bool FaultHandler::CodeRangeStartLess(uintptr_t host_pc,
+                                      const CodeRange* range) {
+  return host_pc < range->start;
+}
+
+int FaultHandler::GetGuestAddress(uintptr_t host_pc, uint32_t* out_cia) {
+  // This is called from the fault handler and must not lock or allocate.
+  int result_code = 1;
+  xe_atomic_inc_32(&ranges_readers_);
+  CodeRangeTable* table = ranges_table_;
+
+  // Find the function containing the pc and then the last line starting at
+  // or before it.
+  if (table) {
+    std::vector<CodeRange*>::iterator it = std::upper_bound(
+        table->ranges.begin(), table->ranges.end(), host_pc,
+        CodeRangeStartLess);
+    if (it != table->ranges.begin()) {
+      CodeRange* range = *(--it);
+      if (host_pc < range->end) {
+        std::vector<std::pair<uintptr_t, uint32_t> >::iterator line =
+            std::upper_bound(range->lines.begin(), range->lines.end(),
+                             std::make_pair(host_pc, (uint32_t)UINT_MAX));
+        if (line != range->lines.begin()) {
+          *out_cia = (--line)->second;
+          result_code = 0;
+        }
+      }
+    }
+  }
+
+  xe_atomic_dec_32(&ranges_readers_);
+  return result_code;
+}
+
+int FaultHandler::HandleFault(uintptr_t host_pc, const void* fault_addr) {
+  // Only faults in generated code on the guest window are ours. Everything
+  // else is a host bug and is left alone.
+  uint32_t ea;
+  if (xe_memory_get_guest_address(memory_, fault_addr, &ea)) {
+    return 1;
+  }
+  uint32_t cia;
+  if (GetGuestAddress(host_pc, &cia)) {
+    return 1;
+  }
+
+  // The fault is raised again once we return, which stops in the debugger
+  // or kills the process, so all that is left to do is report it.
+  ReportInvalidAccess(cia, ea);
+  return 0;
+}
+
+void FaultHandler::SetCodeWriteCallback(CodeWriteCallback callback,
+                                        void* data) {
+  code_write_callback_ = callback;
+  code_write_callback_data_ = data;
+}
+
+int FaultHandler::WatchCode(uint32_t address, uint32_t length) {
+  if (!length) {
+    return 0;
+  }
+  int result_code = 1;
+  xe_mutex_lock(code_pages_mutex_);
+
+  if (!code_pages_) {
+    code_pages_ = (volatile int32_t*)xe_calloc(
+        kCodePageCount * sizeof(int32_t));
+    XEEXPECTNOTNULL((void*)code_pages_);
+  }
+
+  {
+    uint32_t first_page = address >> kCodePageShift;
+    uint32_t last_page = (address + length - 1) >> kCodePageShift;
+    code_pages_low_ = MIN(code_pages_low_, first_page);
+    code_pages_high_ = MAX(code_pages_high_, last_page);
+
+    // Pages that are still protected are already watched, and written ones
+    // (or ones the fault handler is making writable) have to be reported
+    // before they can be watched again. The fault handler never touches the
+    // rest, which are protected in runs. Faults on them before they are
+    // marked as protected just retry.
+    uint32_t page = first_page;
+    while (page <= last_page) {
+      if (!IsCodePageWatchable(code_pages_[page])) {
+        page++;
+        continue;
+      }
+      uint32_t run_start = page;
+      while (page <= last_page && IsCodePageWatchable(code_pages_[page])) {
+        code_pages_[page++] = kCodePageUnprotected;
+      }
+      XEEXPECTZERO(xe_memory_protect(
+          memory_, run_start << kCodePageShift,
+          (page - run_start) << kCodePageShift, kXEMemoryAccessRead));
+      for (uint32_t n = run_start; n < page; n++) {
+        code_pages_[n] = kCodePageProtected;
+      }
+    }
+  }
+
+  result_code = 0;
+XECLEANUP:
+  xe_mutex_unlock(code_pages_mutex_);
+  return result_code;
+}
+
+bool FaultHandler::HandleCodeWrite(const void* fault_addr) {
+  // This runs in the fault handler, so it must not lock, allocate or log.
+  uint32_t ea;
+  if (!code_pages_ ||
+      xe_memory_get_guest_address(memory_, fault_addr, &ea) ||
+      ea >= xe_memory_get_length(memory_)) {
+    return false;
+  }
+  uint32_t page = ea >> kCodePageShift;
+  int32_t state = code_pages_[page];
+  if (state == kCodePageUnwatched) {
+    return false;
+  }
+
+  // Only the first writer makes the page writable. Anyone else (or anyone
+  // racing WatchCode) retries the write until it no longer faults. The page
+  // is only published as written once it really is, so that WatchCode can't
+  // protect it again in between and then have it made writable under it.
+  if (state == kCodePageProtected &&
+      xe_atomic_cas_32(kCodePageProtected, kCodePageUnprotecting,
+                       &code_pages_[page])) {
+    XEIGNORE(xe_memory_protect(memory_, page << kCodePageShift,
+                               kCodePageSize,
+                               (xe_memory_access)(kXEMemoryAccessRead |
+                                                  kXEMemoryAccessWrite)));
+    code_pages_[page] = kCodePageWritten;
+    xe_atomic_inc_32(&code_write_count_);
+  }
+  return true;
+}
+
+void FaultHandler::ProcessCodeWrites() {
+  if (code_write_count_ == processed_code_write_count_) {
+    return;
+  }
+
+  // Only one thread reports at a time, and the count is only caught up once
+  // everything has been reported. Anyone who sees it behind waits here until
+  // the functions have been marked stale.
+  xe_mutex_lock(code_writes_mutex_);
+  int32_t count = code_write_count_;
+  std::vector<uint32_t> pages;
+  xe_mutex_lock(code_pages_mutex_);
+  for (uint32_t page = code_pages_low_; page <= code_pages_high_; page++) {
+    if (code_pages_[page] == kCodePageWritten) {
+      code_pages_[page] = kCodePageUnprotected;
+      pages.push_back(page);
+    }
+  }
+  xe_mutex_unlock(code_pages_mutex_);
+
+  // The callback takes the generator locks, which are held around WatchCode,
+  // so it is called without code_pages_mutex_.
+  if (code_write_callback_) {
+    for (std::vector<uint32_t>::iterator it = pages.begin();
+         it != pages.end(); ++it) {
+      code_write_callback_(code_write_callback_data_,
+                           *it << kCodePageShift, kCodePageSize);
+    }
+  }
+  processed_code_write_count_ = count;
+  xe_mutex_unlock(code_writes_mutex_);
+}
+
+volatile int32_t* FaultHandler::code_write_count() {
+  return &code_write_count_;
+}
+
+volatile int32_t* FaultHandler::processed_code_write_count() {
+  return &processed_code_write_count_;
+}
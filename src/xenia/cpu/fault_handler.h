@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_FAULT_HANDLER_H_
+#define XENIA_CPU_FAULT_HANDLER_H_
+
+#include <xenia/common.h>
+#include <xenia/core.h>
+
+#include <map>
+#include <vector>
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+
+
+namespace xe {
+namespace cpu {
+
+
+// Catches host faults caused by generated code touching guest memory that is
+// not accessible and reports them against the guest instruction that did it.
+// Generated memory accesses are unchecked and rely on this to catch bad
+// addresses. As a JIT listener it records the guest address of each run of
+// native code, which the generator stores as the debug location.
+class FaultHandler : public llvm::JITEventListener {
+public:
+  FaultHandler(xe_memory_ref memory);
+  virtual ~FaultHandler();
+
+  int Install();
+  void Uninstall();
+
+  virtual void NotifyFunctionEmitted(
+      const llvm::Function& f, void* code, size_t size,
+      const EmittedFunctionDetails& details);
+  virtual void NotifyFreeingMachineCode(void* old_ptr);
+
+  int GetGuestAddress(uintptr_t host_pc, uint32_t* out_cia);
+  int HandleFault(uintptr_t host_pc, const void* fault_addr);
+
+  // Guest code can be write protected so that changes to it are caught. The
+  // first write to a watched page makes it writable again and marks it
+  // dirty; that is all that happens in the fault handler. Dirty pages are
+  // reported to the callback by ProcessCodeWrites, which generated code
+  // calls into (through the generator) whenever code_write_count has moved
+  // past processed_code_write_count. The callback must treat whatever was
+  // generated from the page as stale. Pages are watched again once their
+  // code has been regenerated.
+  typedef void (*CodeWriteCallback)(void* data, uint32_t address,
+                                    uint32_t length);
+  void SetCodeWriteCallback(CodeWriteCallback callback, void* data);
+  int WatchCode(uint32_t address, uint32_t length);
+  // Returns true if the fault was a write to watched code and the writer can
+  // be resumed.
+  bool HandleCodeWrite(const void* fault_addr);
+  void ProcessCodeWrites();
+  volatile int32_t* code_write_count();
+  volatile int32_t* processed_code_write_count();
+
+private:
+  class CodeRange {
+  public:
+    uintptr_t start;
+    uintptr_t end;
+    // Native code addresses and the guest instruction they start, in order.
+    std::vector<std::pair<uintptr_t, uint32_t> > lines;
+  };
+  typedef std::map<uintptr_t, CodeRange*> CodeRangeMap;
+  // Immutable copy of ranges_, sorted by start address.
+  class CodeRangeTable {
+  public:
+    std::vector<CodeRange*> ranges;
+  };
+
+  void PublishRanges();
+  static bool CodeRangeStartLess(uintptr_t host_pc, const CodeRange* range);
+
+  xe_memory_ref memory_;
+  bool          installed_;
+
+  xe_mutex_t*   ranges_mutex_;
+  CodeRangeMap  ranges_;
+
+  // Faults may happen while ranges_ is being changed, and may even interrupt
+  // the thread changing it, so the fault path never takes the lock. Instead
+  // it searches the current table, which is swapped whenever ranges_
+  // changes. Replaced tables and freed ranges are kept until no fault is
+  // reading them.
+  CodeRangeTable* volatile  ranges_table_;
+  volatile int32_t          ranges_readers_;
+  std::vector<CodeRangeTable*> retired_tables_;
+  std::vector<CodeRange*>   retired_ranges_;
+
+  // One entry per guest page, see CodePageState. The fault handler only
+  // ever moves a page from protected to written, with a compare and swap.
+  xe_mutex_t*         code_pages_mutex_;
+  volatile int32_t*   code_pages_;
+  uint32_t            code_pages_low_;
+  uint32_t            code_pages_high_;
+  volatile int32_t    code_write_count_;
+  volatile int32_t    processed_code_write_count_;
+  xe_mutex_t*         code_writes_mutex_;
+  CodeWriteCallback   code_write_callback_;
+  void*               code_write_callback_data_;
+};
+
+
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_FAULT_HANDLER_H_
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/interpreter/function_interpreter.h>
+
+#include <xenia/cpu/processor.h>
+
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::interpreter;
+using namespace xe::cpu::ppc;
+using namespace xe::cpu::sdb;
+
+
+FunctionInterpreter::FunctionInterpreter(
+    FunctionSymbol* fn, xe_ppc_state_t* state, uint64_t lr) :
+    start_address_(fn->start_address), end_address_(fn->end_address),
+    blocks_(fn->blocks), state_(state), lr_(lr),
+    has_branch_(false), branch_cia_(0), branch_nia_(0), branch_lk_(false) {
+}
+
+FunctionInterpreter::~FunctionInterpreter() {
+}
+
+bool FunctionInterpreter::CanInterpret(FunctionSymbol* fn) {
+  if (!fn->blocks.size()) {
+    return false;
+  }
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    if (block->instrs.size() !=
+        (block->end_address - block->start_address) / 4 + 1) {
+      return false;
+    }
+    for (std::vector<FunctionInstr>::iterator instr_it =
+         block->instrs.begin(); instr_it != block->instrs.end(); ++instr_it) {
+      if (!instr_it->i.type || !instr_it->i.type->interpret) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int FunctionInterpreter::Execute() {
+  typedef int (*InstrInterpreter)(FunctionInterpreter& f,
+                                  xe_ppc_state_t* state, InstrData& i);
+
+  uint32_t cia = start_address_;
+  while (true) {
+    FunctionBlock* block = GetBlockContaining(cia);
+    if (!block) {
+      XELOGCPU("Interpreter left function %.8X at %.8X",
+               start_address_, cia);
+      return 1;
+    }
+
+    // Run up to the end of the block or the first taken branch.
+    has_branch_ = false;
+    for (size_t n = (cia - block->start_address) / 4;
+         n < block->instrs.size(); n++) {
+      InstrData& i = block->instrs[n].i;
+      InstrInterpreter interpret = (InstrInterpreter)i.type->interpret;
+      if (interpret(*this, state_, i)) {
+        XELOGCPU("Unable to interpret instruction %.8X: %.8X %s",
+                 i.address, i.code, i.type->name);
+        return 1;
+      }
+      if (has_branch_) {
+        break;
+      }
+    }
+    if (!has_branch_) {
+      cia = block->end_address + 4;
+      continue;
+    }
+
+    // Resolve the branch the same way the generated code does: returns to
+    // the caller are plain returns, local targets continue here, and anything
+    // else is a call (or a tail call when not linking).
+    uint64_t nia = branch_nia_;
+    uint32_t next_ia = branch_cia_ + 4;
+    if (!branch_lk_) {
+      if (nia == lr_) {
+        return 0;
+      }
+      if (GetBlockContaining((uint32_t)nia)) {
+        cia = (uint32_t)nia;
+        continue;
+      }
+      return CallFunction(nia, lr_);
+    } else if (!GetBlockContaining(next_ia)) {
+      return CallFunction(nia, lr_);
+    }
+    if (CallFunction(nia, next_ia)) {
+      return 1;
+    }
+    cia = next_ia;
+  }
+}
+
+void FunctionInterpreter::BranchTo(uint32_t cia, uint64_t nia, bool lk) {
+  has_branch_ = true;
+  branch_cia_ = cia;
+  branch_nia_ = nia;
+  branch_lk_ = lk;
+}
+
+FunctionBlock* FunctionInterpreter::GetBlockContaining(uint32_t address) {
+  if (address < start_address_ || address > end_address_) {
+    return NULL;
+  }
+  std::map<uint32_t, FunctionBlock*>::iterator it =
+      blocks_.upper_bound(address);
+  if (it == blocks_.begin()) {
+    return NULL;
+  }
+  FunctionBlock* block = (--it)->second;
+  return address <= block->end_address ? block : NULL;
+}
+
+int FunctionInterpreter::CallFunction(uint64_t address, uint64_t lr) {
+  Processor* processor = (Processor*)state_->processor;
+  if (processor->CallFunction(state_, (uint32_t)address, lr)) {
+    XELOGCPU("Interpreter unable to call %.8X from %.8X",
+             (uint32_t)address, start_address_);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_INTERPRETER_FUNCTION_INTERPRETER_H_
+#define XENIA_CPU_INTERPRETER_FUNCTION_INTERPRETER_H_
+
+#include <xenia/common.h>
+#include <xenia/core.h>
+
+#include <map>
+
+#include <xenia/cpu/sdb.h>
+#include <xenia/cpu/ppc/instr.h>
+#include <xenia/cpu/ppc/state.h>
+
+
+namespace xe {
+namespace cpu {
+namespace interpreter {
+
+
+// Runs a single call of a guest function directly from the instructions
+// decoded during analysis. This has the same contract as a generated
+// function: all registers live in the state, lr is the address the caller
+// expects to be returned to, and calls out go through the processor so they
+// reach whatever tier the callee is in.
+class FunctionInterpreter {
+public:
+  FunctionInterpreter(sdb::FunctionSymbol* fn, xe_ppc_state_t* state,
+                      uint64_t lr);
+  ~FunctionInterpreter();
+
+  // Whether every instruction in the function has an interpreter. Functions
+  // that fail this must be generated instead.
+  static bool CanInterpret(sdb::FunctionSymbol* fn);
+
+  int Execute();
+
+  // Called by the branch interpreters when the branch is taken. The branch is
+  // resolved once the instruction has finished.
+  void BranchTo(uint32_t cia, uint64_t nia, bool lk);
+
+private:
+  sdb::FunctionBlock* GetBlockContaining(uint32_t address);
+  int CallFunction(uint64_t address, uint64_t lr);
+
+  // The blocks are copied when the interpreter is created, so that
+  // reanalysis of the function doesn't change them mid call. Create it with
+  // the generator locked.
+  uint32_t              start_address_;
+  uint32_t              end_address_;
+  std::map<uint32_t, sdb::FunctionBlock*> blocks_;
+  xe_ppc_state_t*       state_;
+  uint64_t              lr_;
+
+  bool      has_branch_;
+  uint32_t  branch_cia_;
+  uint64_t  branch_nia_;
+  bool      branch_lk_;
+};
+
+
+}  // namespace interpreter
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_INTERPRETER_FUNCTION_INTERPRETER_H_
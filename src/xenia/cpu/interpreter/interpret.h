@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_INTERPRETER_INTERPRET_H_
+#define XENIA_CPU_INTERPRETER_INTERPRET_H_
+
+#include <xenia/cpu/ppc/instr.h>
+#include <xenia/cpu/ppc/state.h>
+
+
+namespace xe {
+namespace cpu {
+namespace interpreter {
+
+
+void RegisterInterpretCategoryALU();
+void RegisterInterpretCategoryControl();
+void RegisterInterpretCategoryMemory();
+
+
+#define XEINTERPRETER(name, opcode, format) int InstrInterpret_##name
+
+#define XEREGISTERINTERPRETER(name, opcode) \
+  RegisterInstrInterpret(opcode, (InstrInterpretFn)InstrInterpret_##name);
+
+
+// Condition register fields are kept in the state with field n in bits
+// 28-4n..31-4n and lt/gt/eq/so at bits 0/1/2/3 of the field, the same as the
+// generated code spills them.
+inline uint32_t XeInterpretGetCR(xe_ppc_state_t* state, uint32_t n) {
+  return (state->cr.value >> (28 - n * 4)) & 0xF;
+}
+inline void XeInterpretSetCR(xe_ppc_state_t* state, uint32_t n,
+                             uint32_t value) {
+  uint32_t shift = 28 - n * 4;
+  state->cr.value = (state->cr.value & ~(0xFu << shift)) |
+                    ((value & 0xF) << shift);
+}
+inline uint32_t XeInterpretGetCRBit(xe_ppc_state_t* state, uint32_t bi) {
+  return (XeInterpretGetCR(state, bi >> 2) >> (bi & 3)) & 1;
+}
+
+// Fields are stored with LT in bit 0 through SO in bit 3, which is reversed
+// from the guest layout (LT = 8, GT = 4, EQ = 2, SO = 1). Converts between
+// the two in either direction.
+inline uint32_t XeInterpretSwapCRFields(uint32_t value) {
+  return ((value & 0x11111111) << 3) | ((value & 0x22222222) << 1) |
+         ((value & 0x44444444) >> 1) | ((value & 0x88888888) >> 3);
+}
+
+// Matches FunctionGenerator::update_cr_with_cond, which leaves SO clear.
+inline void XeInterpretCompare(xe_ppc_state_t* state, uint32_t n,
+                               uint64_t lhs, uint64_t rhs, bool is_signed) {
+  uint32_t c;
+  if (is_signed ? (int64_t)lhs < (int64_t)rhs : lhs < rhs) {
+    c = 1 << 0;
+  } else if (is_signed ? (int64_t)lhs > (int64_t)rhs : lhs > rhs) {
+    c = 1 << 1;
+  } else {
+    c = 1 << 2;
+  }
+  XeInterpretSetCR(state, n, c);
+}
+
+inline uint32_t XeInterpretGetCA(xe_ppc_state_t* state) {
+  return (uint32_t)((state->xer >> 29) & 1);
+}
+inline void XeInterpretSetCA(xe_ppc_state_t* state, uint32_t ca) {
+  state->xer = (state->xer & ~(1ull << 29)) | ((uint64_t)(ca & 1) << 29);
+}
+
+inline uint8_t* XeInterpretGetMemory(xe_ppc_state_t* state, uint64_t ea) {
+  return state->membase + (uint32_t)ea;
+}
+
+
+}  // namespace interpreter
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_INTERPRETER_INTERPRET_H_
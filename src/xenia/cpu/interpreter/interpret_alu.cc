@@ -0,0 +1,671 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/interpreter/interpret.h>
+
+#include <xenia/cpu/interpreter/function_interpreter.h>
+
+
+using namespace xe::cpu::interpreter;
+using namespace xe::cpu::ppc;
+
+
+namespace xe {
+namespace cpu {
+namespace interpreter {
+
+
+namespace {
+
+void XeInterpretUpdateCR0(xe_ppc_state_t* state, uint64_t v) {
+  XeInterpretCompare(state, 0, v, 0, true);
+}
+
+// a + b + c, returning the carry out of bit 0.
+uint64_t XeInterpretAddWithCarry(uint64_t a, uint64_t b, uint32_t c,
+                                 uint32_t* out_ca) {
+  uint64_t v = a + b + c;
+  *out_ca = (v < a || (c && v == a)) ? 1 : 0;
+  return v;
+}
+
+uint64_t XeInterpretRotateLeft32(uint64_t v, uint32_t n) {
+  // ROTL32(x, y) = rotl(i64.(x||x), y)
+  v &= UINT32_MAX;
+  v = (v << 32) | v;
+  return n ? (v << n) | (v >> (64 - n)) : v;
+}
+
+}
+
+
+// Integer arithmetic (A-3)
+
+XEINTERPRETER(addx,         0x7C000214, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RD <- (RA) + (RB)
+  uint64_t v = s->r[i.XO.RA] + s->r[i.XO.RB];
+  s->r[i.XO.RT] = v;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(addcx,        0x7C000014, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RD <- (RA) + (RB)
+  // XER[CA] <- carry bit
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(s->r[i.XO.RA], s->r[i.XO.RB], 0, &ca);
+  s->r[i.XO.RT] = v;
+  XeInterpretSetCA(s, ca);
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(addex,        0x7C000114, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RD <- (RA) + (RB) + XER[CA]
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(s->r[i.XO.RA], s->r[i.XO.RB],
+                                       XeInterpretGetCA(s), &ca);
+  s->r[i.XO.RT] = v;
+  XeInterpretSetCA(s, ca);
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(addi,         0x38000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // if RA = 0 then RT <- EXTS(SI)
+  // else RT <- (RA) + EXTS(SI)
+  uint64_t v = (int64_t)XEEXTS16(i.D.DS);
+  if (i.D.RA) {
+    v += s->r[i.D.RA];
+  }
+  s->r[i.D.RT] = v;
+  return 0;
+}
+
+XEINTERPRETER(addic,        0x30000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- (RA) + EXTS(SI)
+  // XER[CA] <- carry bit
+  uint32_t ca;
+  s->r[i.D.RT] = XeInterpretAddWithCarry(
+      s->r[i.D.RA], (int64_t)XEEXTS16(i.D.DS), 0, &ca);
+  XeInterpretSetCA(s, ca);
+  return 0;
+}
+
+XEINTERPRETER(addicx,       0x34000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- (RA) + EXTS(SI)
+  // XER[CA] <- carry bit
+  // CR0 updated
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(
+      s->r[i.D.RA], (int64_t)XEEXTS16(i.D.DS), 0, &ca);
+  s->r[i.D.RT] = v;
+  XeInterpretSetCA(s, ca);
+  XeInterpretUpdateCR0(s, v);
+  return 0;
+}
+
+XEINTERPRETER(addis,        0x3C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // if RA = 0 then RT <- EXTS(SI) || i16.0
+  // else RT <- (RA) + EXTS(SI) || i16.0
+  uint64_t v = (int64_t)XEEXTS16(i.D.DS) << 16;
+  if (i.D.RA) {
+    v += s->r[i.D.RA];
+  }
+  s->r[i.D.RT] = v;
+  return 0;
+}
+
+XEINTERPRETER(addzex,       0x7C000194, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- (RA) + XER[CA]
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(s->r[i.XO.RA], 0,
+                                       XeInterpretGetCA(s), &ca);
+  s->r[i.XO.RT] = v;
+  XeInterpretSetCA(s, ca);
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(divwx,        0x7C0003D6, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // dividend[0:31] <- (RA)[32:63]
+  // divisor[0:31] <- (RB)[32:63]
+  // RT[32:63] <- dividend ÷ divisor
+  // RT[0:31] <- undefined
+  // The undefined cases give 0 rather than trapping on the host.
+  int32_t dividend = (int32_t)s->r[i.XO.RA];
+  int32_t divisor = (int32_t)s->r[i.XO.RB];
+  int32_t v = 0;
+  if (divisor && !(dividend == INT32_MIN && divisor == -1)) {
+    v = dividend / divisor;
+  }
+  s->r[i.XO.RT] = (uint32_t)v;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, s->r[i.XO.RT]);
+  }
+  return 0;
+}
+
+XEINTERPRETER(divwux,       0x7C000396, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // dividend[0:31] <- (RA)[32:63]
+  // divisor[0:31] <- (RB)[32:63]
+  // RT[32:63] <- dividend ÷ divisor
+  // RT[0:31] <- undefined
+  uint32_t dividend = (uint32_t)s->r[i.XO.RA];
+  uint32_t divisor = (uint32_t)s->r[i.XO.RB];
+  s->r[i.XO.RT] = divisor ? dividend / divisor : 0;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, s->r[i.XO.RT]);
+  }
+  return 0;
+}
+
+XEINTERPRETER(mulhwux,      0x7C000016, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT[32:64] <- ((RA)[32:63] × (RB)[32:63])[0:31]
+  uint64_t v = (uint64_t)(uint32_t)s->r[i.XO.RA] *
+               (uint64_t)(uint32_t)s->r[i.XO.RB];
+  s->r[i.XO.RT] = v >> 32;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, s->r[i.XO.RT]);
+  }
+  return 0;
+}
+
+XEINTERPRETER(mulli,        0x1C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // prod[0:127] <- (RA) × EXTS(SI)
+  // RT <- prod[64:127]
+  s->r[i.D.RT] = (uint64_t)((int64_t)s->r[i.D.RA] * XEEXTS16(i.D.DS));
+  return 0;
+}
+
+XEINTERPRETER(mullwx,       0x7C0001D6, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- (RA)[32:63] × (RB)[32:63]
+  int64_t v = (int64_t)(int32_t)s->r[i.XO.RA] *
+              (int64_t)(int32_t)s->r[i.XO.RB];
+  s->r[i.XO.RT] = (uint64_t)v;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, (uint64_t)v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(negx,         0x7C0000D0, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- ¬(RA) + 1
+  uint64_t v = ~s->r[i.XO.RA] + 1;
+  s->r[i.XO.RT] = v;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(subfx,        0x7C000050, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- ¬(RA) + (RB) + 1
+  uint64_t v = s->r[i.XO.RB] - s->r[i.XO.RA];
+  s->r[i.XO.RT] = v;
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(subfcx,       0x7C000010, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- ¬(RA) + (RB) + 1
+  // XER[CA] <- carry bit
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(~s->r[i.XO.RA], s->r[i.XO.RB], 1, &ca);
+  s->r[i.XO.RT] = v;
+  XeInterpretSetCA(s, ca);
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(subfex,       0x7C000110, XO )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- ¬(RA) + (RB) + XER[CA]
+  uint32_t ca;
+  uint64_t v = XeInterpretAddWithCarry(~s->r[i.XO.RA], s->r[i.XO.RB],
+                                       XeInterpretGetCA(s), &ca);
+  s->r[i.XO.RT] = v;
+  XeInterpretSetCA(s, ca);
+  if (i.XO.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(subficx,      0x20000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- ¬(RA) + EXTS(SI) + 1
+  // XER[CA] <- carry bit
+  uint32_t ca;
+  s->r[i.D.RT] = XeInterpretAddWithCarry(
+      ~s->r[i.D.RA], (int64_t)XEEXTS16(i.D.DS), 1, &ca);
+  XeInterpretSetCA(s, ca);
+  return 0;
+}
+
+
+// Integer compare (A-4)
+
+XEINTERPRETER(cmp,          0x7C000000, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  uint32_t BF = i.X.RT >> 2;
+  uint32_t L = i.X.RT & 1;
+  uint64_t lhs = s->r[i.X.RA];
+  uint64_t rhs = s->r[i.X.RB];
+  if (!L) {
+    lhs = (int64_t)(int32_t)lhs;
+    rhs = (int64_t)(int32_t)rhs;
+  }
+  XeInterpretCompare(s, BF, lhs, rhs, true);
+  return 0;
+}
+
+XEINTERPRETER(cmpi,         0x2C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  uint32_t BF = i.D.RT >> 2;
+  uint32_t L = i.D.RT & 1;
+  uint64_t lhs = s->r[i.D.RA];
+  if (!L) {
+    lhs = (int64_t)(int32_t)lhs;
+  }
+  XeInterpretCompare(s, BF, lhs, (int64_t)XEEXTS16(i.D.DS), true);
+  return 0;
+}
+
+XEINTERPRETER(cmpl,         0x7C000040, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  uint32_t BF = i.X.RT >> 2;
+  uint32_t L = i.X.RT & 1;
+  uint64_t lhs = s->r[i.X.RA];
+  uint64_t rhs = s->r[i.X.RB];
+  if (!L) {
+    lhs = (uint32_t)lhs;
+    rhs = (uint32_t)rhs;
+  }
+  XeInterpretCompare(s, BF, lhs, rhs, false);
+  return 0;
+}
+
+XEINTERPRETER(cmpli,        0x28000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  uint32_t BF = i.D.RT >> 2;
+  uint32_t L = i.D.RT & 1;
+  uint64_t lhs = s->r[i.D.RA];
+  if (!L) {
+    lhs = (uint32_t)lhs;
+  }
+  XeInterpretCompare(s, BF, lhs, i.D.DS, false);
+  return 0;
+}
+
+
+// Integer logical (A-5)
+
+XEINTERPRETER(andx,         0x7C000038, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) & (RB)
+  uint64_t v = s->r[i.X.RT] & s->r[i.X.RB];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(andcx,        0x7C000078, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) & ¬(RB)
+  uint64_t v = s->r[i.X.RT] & ~s->r[i.X.RB];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(andix,        0x70000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) & (i48.0 || UI)
+  uint64_t v = s->r[i.D.RT] & (uint64_t)i.D.DS;
+  s->r[i.D.RA] = v;
+  XeInterpretUpdateCR0(s, v);
+  return 0;
+}
+
+XEINTERPRETER(andisx,       0x74000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) & (i32.0 || UI || i16.0)
+  uint64_t v = s->r[i.D.RT] & ((uint64_t)i.D.DS << 16);
+  s->r[i.D.RA] = v;
+  XeInterpretUpdateCR0(s, v);
+  return 0;
+}
+
+XEINTERPRETER(cntlzwx,      0x7C000034, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- 32
+  // do while n < 64
+  //   if (RS) = 1 then leave n
+  //   n <- n + 1
+  // RA <- n - 32
+  uint32_t v = (uint32_t)s->r[i.X.RT];
+  uint64_t n = 0;
+  while (n < 32 && !(v & 0x80000000)) {
+    v <<= 1;
+    n++;
+  }
+  s->r[i.X.RA] = n;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, n);
+  }
+  return 0;
+}
+
+XEINTERPRETER(eqvx,         0x7C000238, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) == (RB)
+  uint64_t v = ~(s->r[i.X.RT] ^ s->r[i.X.RB]);
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(extsbx,       0x7C000774, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // s <- (RS)[56]
+  // RA[56:63] <- (RS)[56:63]
+  // RA[0:55] <- i56.s
+  uint64_t v = (int64_t)(int8_t)s->r[i.X.RT];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(extshx,       0x7C000734, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // s <- (RS)[48]
+  // RA[48:63] <- (RS)[48:63]
+  // RA[0:47] <- 48.s
+  uint64_t v = (int64_t)(int16_t)s->r[i.X.RT];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(extswx,       0x7C0007B4, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // s <- (RS)[32]
+  // RA[32:63] <- (RS)[32:63]
+  // RA[0:31] <- i32.s
+  uint64_t v = (int64_t)(int32_t)s->r[i.X.RT];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(nandx,        0x7C0003B8, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- ¬((RS) & (RB))
+  uint64_t v = ~(s->r[i.X.RT] & s->r[i.X.RB]);
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(norx,         0x7C0000F8, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- ¬((RS) | (RB))
+  uint64_t v = ~(s->r[i.X.RT] | s->r[i.X.RB]);
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(orx,          0x7C000378, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) | (RB)
+  uint64_t v = s->r[i.X.RT] | s->r[i.X.RB];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(orcx,         0x7C000338, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) | ¬(RB)
+  uint64_t v = s->r[i.X.RT] | ~s->r[i.X.RB];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(ori,          0x60000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) | (i48.0 || UI)
+  s->r[i.D.RA] = s->r[i.D.RT] | (uint64_t)i.D.DS;
+  return 0;
+}
+
+XEINTERPRETER(oris,         0x64000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) | (i32.0 || UI || i16.0)
+  s->r[i.D.RA] = s->r[i.D.RT] | ((uint64_t)i.D.DS << 16);
+  return 0;
+}
+
+XEINTERPRETER(xorx,         0x7C000278, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) XOR (RB)
+  uint64_t v = s->r[i.X.RT] ^ s->r[i.X.RB];
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(xori,         0x68000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) XOR (i48.0 || UI)
+  s->r[i.D.RA] = s->r[i.D.RT] ^ (uint64_t)i.D.DS;
+  return 0;
+}
+
+XEINTERPRETER(xoris,        0x6C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RA <- (RS) XOR (i32.0 || UI || i16.0)
+  s->r[i.D.RA] = s->r[i.D.RT] ^ ((uint64_t)i.D.DS << 16);
+  return 0;
+}
+
+
+// Integer rotate (A-6)
+
+XEINTERPRETER(rlwimix,      0x50000000, M  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- SH
+  // r <- ROTL32((RS)[32:63], n)
+  // m <- MASK(MB+32, ME+32)
+  // RA <- r&m | (RA)&¬m
+  uint64_t m = XEMASK(i.M.MB + 32, i.M.ME + 32);
+  uint64_t v = (XeInterpretRotateLeft32(s->r[i.M.RT], i.M.SH) & m) |
+               (s->r[i.M.RA] & ~m);
+  s->r[i.M.RA] = v;
+  if (i.M.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(rlwinmx,      0x54000000, M  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- SH
+  // r <- ROTL32((RS)[32:63], n)
+  // m <- MASK(MB+32, ME+32)
+  // RA <- r & m
+  uint64_t v = XeInterpretRotateLeft32(s->r[i.M.RT], i.M.SH) &
+               XEMASK(i.M.MB + 32, i.M.ME + 32);
+  s->r[i.M.RA] = v;
+  if (i.M.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(rlwnmx,       0x5C000000, M  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- (RB)[59:63]
+  // r <- ROTL32((RS)[32:63], n)
+  // m <- MASK(MB+32, ME+32)
+  // RA <- r & m
+  uint64_t v = XeInterpretRotateLeft32(s->r[i.M.RT], s->r[i.M.SH] & 0x1F) &
+               XEMASK(i.M.MB + 32, i.M.ME + 32);
+  s->r[i.M.RA] = v;
+  if (i.M.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+
+// Integer shift (A-7)
+
+XEINTERPRETER(slwx,         0x7C000030, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- (RB)[59:63]
+  // r <- ROTL32((RS)[32:63], n)
+  // if (RB)[58] = 0 then
+  //   m <- MASK(32, 63-n)
+  // else
+  //   m <- i64.0
+  // RA <- r & m
+  uint64_t n = s->r[i.X.RB] & 0x3F;
+  uint64_t v = n < 32 ? (uint32_t)((uint32_t)s->r[i.X.RT] << n) : 0;
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(srwx,         0x7C000430, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- (RB)[59:63]
+  // r <- ROTL32((RS)[32:63], 64-n)
+  // if (RB)[58] = 0 then
+  //   m <- MASK(n+32, 63)
+  // else
+  //   m <- i64.0
+  // RA <- r & m
+  uint64_t n = s->r[i.X.RB] & 0x3F;
+  uint64_t v = n < 32 ? ((uint32_t)s->r[i.X.RT] >> n) : 0;
+  s->r[i.X.RA] = v;
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, v);
+  }
+  return 0;
+}
+
+XEINTERPRETER(srawx,        0x7C000630, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- rB[59:63]
+  // r <- ROTL32((RS)[32:63], 64-n)
+  // m <- MASK(n+32, 63)
+  // s <- (RS)[32]
+  // RA <- r&m | (i64.s)&¬m
+  // CA <- s & ((r&¬m)[32:63]≠0)
+  int32_t rs = (int32_t)s->r[i.X.RT];
+  uint64_t n = s->r[i.X.RB] & 0x3F;
+  int32_t v;
+  uint32_t ca;
+  if (n < 32) {
+    v = rs >> n;
+    ca = rs < 0 && n && ((uint32_t)rs << (32 - n)) ? 1 : 0;
+  } else {
+    v = rs < 0 ? -1 : 0;
+    ca = rs < 0 ? 1 : 0;
+  }
+  s->r[i.X.RA] = (int64_t)v;
+  XeInterpretSetCA(s, ca);
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, s->r[i.X.RA]);
+  }
+  return 0;
+}
+
+XEINTERPRETER(srawix,       0x7C000670, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- SH
+  // r <- ROTL32((RS)[32:63], 64-n)
+  // m <- MASK(n+32, 63)
+  // s <- (RS)[32]
+  // RA <- r&m | (i64.s)&¬m
+  // CA <- s & ((r&¬m)[32:63]≠0)
+  int32_t rs = (int32_t)s->r[i.X.RT];
+  uint32_t n = i.X.RB;
+  s->r[i.X.RA] = (int64_t)(rs >> n);
+  XeInterpretSetCA(s, rs < 0 && n && ((uint32_t)rs << (32 - n)) ? 1 : 0);
+  if (i.X.Rc) {
+    XeInterpretUpdateCR0(s, s->r[i.X.RA]);
+  }
+  return 0;
+}
+
+
+void RegisterInterpretCategoryALU() {
+  XEREGISTERINTERPRETER(addx,         0x7C000214);
+  XEREGISTERINTERPRETER(addcx,        0x7C000014);
+  XEREGISTERINTERPRETER(addex,        0x7C000114);
+  XEREGISTERINTERPRETER(addi,         0x38000000);
+  XEREGISTERINTERPRETER(addic,        0x30000000);
+  XEREGISTERINTERPRETER(addicx,       0x34000000);
+  XEREGISTERINTERPRETER(addis,        0x3C000000);
+  XEREGISTERINTERPRETER(addzex,       0x7C000194);
+  XEREGISTERINTERPRETER(divwx,        0x7C0003D6);
+  XEREGISTERINTERPRETER(divwux,       0x7C000396);
+  XEREGISTERINTERPRETER(mulhwux,      0x7C000016);
+  XEREGISTERINTERPRETER(mulli,        0x1C000000);
+  XEREGISTERINTERPRETER(mullwx,       0x7C0001D6);
+  XEREGISTERINTERPRETER(negx,         0x7C0000D0);
+  XEREGISTERINTERPRETER(subfx,        0x7C000050);
+  XEREGISTERINTERPRETER(subfcx,       0x7C000010);
+  XEREGISTERINTERPRETER(subfex,       0x7C000110);
+  XEREGISTERINTERPRETER(subficx,      0x20000000);
+  XEREGISTERINTERPRETER(cmp,          0x7C000000);
+  XEREGISTERINTERPRETER(cmpi,         0x2C000000);
+  XEREGISTERINTERPRETER(cmpl,         0x7C000040);
+  XEREGISTERINTERPRETER(cmpli,        0x28000000);
+  XEREGISTERINTERPRETER(andx,         0x7C000038);
+  XEREGISTERINTERPRETER(andcx,        0x7C000078);
+  XEREGISTERINTERPRETER(andix,        0x70000000);
+  XEREGISTERINTERPRETER(andisx,       0x74000000);
+  XEREGISTERINTERPRETER(cntlzwx,      0x7C000034);
+  XEREGISTERINTERPRETER(eqvx,         0x7C000238);
+  XEREGISTERINTERPRETER(extsbx,       0x7C000774);
+  XEREGISTERINTERPRETER(extshx,       0x7C000734);
+  XEREGISTERINTERPRETER(extswx,       0x7C0007B4);
+  XEREGISTERINTERPRETER(nandx,        0x7C0003B8);
+  XEREGISTERINTERPRETER(norx,         0x7C0000F8);
+  XEREGISTERINTERPRETER(orx,          0x7C000378);
+  XEREGISTERINTERPRETER(orcx,         0x7C000338);
+  XEREGISTERINTERPRETER(ori,          0x60000000);
+  XEREGISTERINTERPRETER(oris,         0x64000000);
+  XEREGISTERINTERPRETER(xorx,         0x7C000278);
+  XEREGISTERINTERPRETER(xori,         0x68000000);
+  XEREGISTERINTERPRETER(xoris,        0x6C000000);
+  XEREGISTERINTERPRETER(rlwimix,      0x50000000);
+  XEREGISTERINTERPRETER(rlwinmx,      0x54000000);
+  XEREGISTERINTERPRETER(rlwnmx,       0x5C000000);
+  XEREGISTERINTERPRETER(slwx,         0x7C000030);
+  XEREGISTERINTERPRETER(srwx,         0x7C000430);
+  XEREGISTERINTERPRETER(srawx,        0x7C000630);
+  XEREGISTERINTERPRETER(srawix,       0x7C000670);
+}
+
+
+}  // namespace interpreter
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,266 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/interpreter/interpret.h>
+
+#include <xenia/cpu/interpreter/function_interpreter.h>
+
+
+using namespace xe::cpu::interpreter;
+using namespace xe::cpu::ppc;
+
+
+namespace xe {
+namespace cpu {
+namespace interpreter {
+
+
+namespace {
+
+// Shared by the conditional branches. BO is numbered as in the encoding, so
+// the bits are reversed from the docs (BO[0] is bit 4 here).
+bool XeInterpretBranchCondition(xe_ppc_state_t* s, uint32_t BO, uint32_t BI,
+                                bool use_ctr) {
+  bool ctr_ok = true;
+  if (use_ctr && !XESELECTBITS(BO, 2, 2)) {
+    s->ctr--;
+    ctr_ok = XESELECTBITS(BO, 1, 1) ? s->ctr == 0 : s->ctr != 0;
+  }
+  bool cond_ok = true;
+  if (!XESELECTBITS(BO, 4, 4)) {
+    cond_ok = XeInterpretGetCRBit(s, BI) == XESELECTBITS(BO, 3, 3);
+  }
+  return ctr_ok && cond_ok;
+}
+
+}
+
+
+// Branch (A-1)
+
+XEINTERPRETER(bx,           0x48000000, I  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // if AA then
+  //   NIA <- EXTS(LI || 0b00)
+  // else
+  //   NIA <- CIA + EXTS(LI || 0b00)
+  // if LK then
+  //   LR <- CIA + 4
+  uint32_t nia;
+  if (i.I.AA) {
+    nia = XEEXTS26(i.I.LI << 2);
+  } else {
+    nia = i.address + XEEXTS26(i.I.LI << 2);
+  }
+  if (i.I.LK) {
+    s->lr = i.address + 4;
+  }
+  f.BranchTo(i.address, nia, i.I.LK);
+  return 0;
+}
+
+XEINTERPRETER(bcx,          0x40000000, B  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // if ¬BO[2] then
+  //   CTR <- CTR - 1
+  // ctr_ok <- BO[2] | ((CTR[0:63] != 0) XOR BO[3])
+  // cond_ok <- BO[0] | (CR[BI+32] ≡ BO[1])
+  // if ctr_ok & cond_ok then
+  //   if AA then
+  //     NIA <- EXTS(BD || 0b00)
+  //   else
+  //     NIA <- CIA + EXTS(BD || 0b00)
+  // if LK then
+  //   LR <- CIA + 4
+  if (i.B.LK) {
+    s->lr = i.address + 4;
+  }
+  if (XeInterpretBranchCondition(s, i.B.BO, i.B.BI, true)) {
+    uint32_t nia;
+    if (i.B.AA) {
+      nia = XEEXTS26(i.B.BD << 2);
+    } else {
+      nia = i.address + XEEXTS26(i.B.BD << 2);
+    }
+    f.BranchTo(i.address, nia, i.B.LK);
+  }
+  return 0;
+}
+
+XEINTERPRETER(bcctrx,       0x4C000420, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // cond_ok <- BO[0] | (CR[BI+32] ≡ BO[1])
+  // if cond_ok then
+  //   NIA <- CTR[0:61] || 0b00
+  // if LK then
+  //   LR <- CIA + 4
+  if (i.XL.LK) {
+    s->lr = i.address + 4;
+  }
+  if (XeInterpretBranchCondition(s, i.XL.BO, i.XL.BI, false)) {
+    f.BranchTo(i.address, s->ctr & ~3ull, i.XL.LK);
+  }
+  return 0;
+}
+
+XEINTERPRETER(bclrx,        0x4C000020, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // if ¬BO[2] then
+  //   CTR <- CTR - 1
+  // ctr_ok <- BO[2] | ((CTR[0:63] != 0) XOR BO[3]
+  // cond_ok <- BO[0] | (CR[BI+32] ≡ BO[1])
+  // if ctr_ok & cond_ok then
+  //   NIA <- LR[0:61] || 0b00
+  // if LK then
+  //   LR <- CIA + 4
+  // The target is read before LR is updated.
+  uint64_t nia = s->lr & ~3ull;
+  if (i.XL.LK) {
+    s->lr = i.address + 4;
+  }
+  if (XeInterpretBranchCondition(s, i.XL.BO, i.XL.BI, true)) {
+    f.BranchTo(i.address, nia, i.XL.LK);
+  }
+  return 0;
+}
+
+
+// Condition register logical (A-23)
+
+XEINTERPRETER(crand,        0x4C000202, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // CR[BT+32] <- CR[BA+32] & CR[BB+32]
+  uint32_t bt = i.XL.BO;
+  uint32_t v =
+      XeInterpretGetCRBit(s, i.XL.BI) & XeInterpretGetCRBit(s, i.XL.BB);
+  uint32_t field = XeInterpretGetCR(s, bt >> 2);
+  field = (field & ~(1 << (bt & 3))) | (v << (bt & 3));
+  XeInterpretSetCR(s, bt >> 2, field);
+  return 0;
+}
+
+XEINTERPRETER(cror,         0x4C000382, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // CR[BT+32] <- CR[BA+32] | CR[BB+32]
+  uint32_t bt = i.XL.BO;
+  uint32_t v =
+      XeInterpretGetCRBit(s, i.XL.BI) | XeInterpretGetCRBit(s, i.XL.BB);
+  uint32_t field = XeInterpretGetCR(s, bt >> 2);
+  field = (field & ~(1 << (bt & 3))) | (v << (bt & 3));
+  XeInterpretSetCR(s, bt >> 2, field);
+  return 0;
+}
+
+XEINTERPRETER(crxor,        0x4C000182, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // CR[BT+32] <- CR[BA+32] XOR CR[BB+32]
+  uint32_t bt = i.XL.BO;
+  uint32_t v =
+      XeInterpretGetCRBit(s, i.XL.BI) ^ XeInterpretGetCRBit(s, i.XL.BB);
+  uint32_t field = XeInterpretGetCR(s, bt >> 2);
+  field = (field & ~(1 << (bt & 3))) | (v << (bt & 3));
+  XeInterpretSetCR(s, bt >> 2, field);
+  return 0;
+}
+
+XEINTERPRETER(mcrf,         0x4C000000, XL )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // CR[4×BF+32:4×BF+35] <- CR[4×BFA+32:4×BFA+35]
+  XeInterpretSetCR(s, i.XL.BO >> 2, XeInterpretGetCR(s, i.XL.BI >> 2));
+  return 0;
+}
+
+
+// System linkage (A-24)
+
+XEINTERPRETER(mfcr,         0x7C000026, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- 32(0) || CR
+  s->r[i.X.RT] = XeInterpretSwapCRFields(s->cr.value);
+  return 0;
+}
+
+XEINTERPRETER(mfspr,        0x7C0002A6, XFX)(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- spr[5:9] || spr[0:4]
+  // if length(SPR(n)) = 64 then
+  //   RT <- SPR(n)
+  // else
+  //   RT <- i32.0 || SPR(n)
+  const uint32_t n = ((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F);
+  switch (n) {
+  case 1:
+    // XER
+    s->r[i.XFX.RT] = s->xer;
+    break;
+  case 8:
+    // LR
+    s->r[i.XFX.RT] = s->lr;
+    break;
+  case 9:
+    // CTR
+    s->r[i.XFX.RT] = s->ctr;
+    break;
+  default:
+    return 1;
+  }
+  return 0;
+}
+
+XEINTERPRETER(mtcrf,        0x7C000120, XFX)(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // mask <- i4(FXM[0]) || ... || i4(FXM[7])
+  // CR <- ((RS)[32:63] & mask) | (CR & ¬mask)
+  uint32_t fxm = (i.XFX.spr >> 1) & 0xFF;
+  uint32_t mask = 0;
+  for (uint32_t n = 0; n < 8; n++) {
+    if (fxm & (0x80 >> n)) {
+      mask |= 0xF << (28 - n * 4);
+    }
+  }
+  uint32_t v = XeInterpretSwapCRFields((uint32_t)s->r[i.XFX.RT]);
+  s->cr.value = (v & mask) | (s->cr.value & ~mask);
+  return 0;
+}
+
+XEINTERPRETER(mtspr,        0x7C0003A6, XFX)(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // n <- spr[5:9] || spr[0:4]
+  // if length(SPR(n)) = 64 then
+  //   SPR(n) <- (RS)
+  // else
+  //   SPR(n) <- (RS)[32:63]
+  const uint32_t n = ((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F);
+  switch (n) {
+  case 1:
+    // XER
+    s->xer = s->r[i.XFX.RT];
+    break;
+  case 8:
+    // LR
+    s->lr = s->r[i.XFX.RT];
+    break;
+  case 9:
+    // CTR
+    s->ctr = s->r[i.XFX.RT];
+    break;
+  default:
+    return 1;
+  }
+  return 0;
+}
+
+
+void RegisterInterpretCategoryControl() {
+  XEREGISTERINTERPRETER(bx,           0x48000000);
+  XEREGISTERINTERPRETER(bcx,          0x40000000);
+  XEREGISTERINTERPRETER(bcctrx,       0x4C000420);
+  XEREGISTERINTERPRETER(bclrx,        0x4C000020);
+  XEREGISTERINTERPRETER(crand,        0x4C000202);
+  XEREGISTERINTERPRETER(cror,         0x4C000382);
+  XEREGISTERINTERPRETER(crxor,        0x4C000182);
+  XEREGISTERINTERPRETER(mcrf,         0x4C000000);
+  XEREGISTERINTERPRETER(mfcr,         0x7C000026);
+  XEREGISTERINTERPRETER(mfspr,        0x7C0002A6);
+  XEREGISTERINTERPRETER(mtcrf,        0x7C000120);
+  XEREGISTERINTERPRETER(mtspr,        0x7C0003A6);
+}
+
+
+}  // namespace interpreter
+}  // namespace cpu
+}  // namespace xe
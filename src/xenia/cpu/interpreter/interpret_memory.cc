@@ -0,0 +1,355 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/interpreter/interpret.h>
+
+#include <xenia/cpu/interpreter/function_interpreter.h>
+
+
+using namespace xe::cpu::interpreter;
+using namespace xe::cpu::ppc;
+
+
+namespace xe {
+namespace cpu {
+namespace interpreter {
+
+
+namespace {
+
+// EA for the D forms: (RA|0) + EXTS(D)
+uint64_t XeInterpretDAddress(xe_ppc_state_t* s, InstrData& i) {
+  uint64_t ea = (int64_t)XEEXTS16(i.D.DS);
+  return i.D.RA ? s->r[i.D.RA] + ea : ea;
+}
+
+// EA for the DS forms: (RA|0) + EXTS(DS || 0b00)
+uint64_t XeInterpretDSAddress(xe_ppc_state_t* s, InstrData& i) {
+  uint64_t ea = (int64_t)XEEXTS16(i.DS.DS << 2);
+  return i.DS.RA ? s->r[i.DS.RA] + ea : ea;
+}
+
+// EA for the X forms: (RA|0) + (RB)
+uint64_t XeInterpretXAddress(xe_ppc_state_t* s, InstrData& i) {
+  return i.X.RA ? s->r[i.X.RA] + s->r[i.X.RB] : s->r[i.X.RB];
+}
+
+}
+
+
+// Integer load (A-13)
+
+XEINTERPRETER(lbz,          0x88000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i56.0 || MEM(EA, 1)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  s->r[i.D.RT] = XEGETUINT8BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lbzu,         0x8C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i56.0 || MEM(EA, 1)
+  // RA <- EA
+  uint64_t ea = s->r[i.D.RA] + (int64_t)XEEXTS16(i.D.DS);
+  s->r[i.D.RT] = XEGETUINT8BE(XeInterpretGetMemory(s, ea));
+  s->r[i.D.RA] = ea;
+  return 0;
+}
+
+XEINTERPRETER(lbzx,         0x7C0000AE, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i56.0 || MEM(EA, 1)
+  uint64_t ea = XeInterpretXAddress(s, i);
+  s->r[i.X.RT] = XEGETUINT8BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(ld,           0xE8000000, DS )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- MEM(EA, 8)
+  uint64_t ea = XeInterpretDSAddress(s, i);
+  s->r[i.DS.RT] = XEGETUINT64BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(ldx,          0x7C00002A, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- MEM(EA, 8)
+  uint64_t ea = XeInterpretXAddress(s, i);
+  s->r[i.X.RT] = XEGETUINT64BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lha,          0xA8000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- EXTS(MEM(EA, 2))
+  uint64_t ea = XeInterpretDAddress(s, i);
+  s->r[i.D.RT] =
+      (int64_t)(int16_t)XEGETUINT16BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lhax,         0x7C0002AE, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- EXTS(MEM(EA, 2))
+  uint64_t ea = XeInterpretXAddress(s, i);
+  s->r[i.X.RT] =
+      (int64_t)(int16_t)XEGETUINT16BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lhz,          0xA0000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i48.0 || MEM(EA, 2)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  s->r[i.D.RT] = XEGETUINT16BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lhzx,         0x7C00022E, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i48.0 || MEM(EA, 2)
+  uint64_t ea = XeInterpretXAddress(s, i);
+  s->r[i.X.RT] = XEGETUINT16BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lwa,          0xE8000002, DS )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- EXTS(MEM(EA, 4))
+  uint64_t ea = XeInterpretDSAddress(s, i);
+  s->r[i.DS.RT] =
+      (int64_t)(int32_t)XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lwz,          0x80000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i32.0 || MEM(EA, 4)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  s->r[i.D.RT] = XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+XEINTERPRETER(lwzu,         0x84000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i32.0 || MEM(EA, 4)
+  // RA <- EA
+  uint64_t ea = s->r[i.D.RA] + (int64_t)XEEXTS16(i.D.DS);
+  s->r[i.D.RT] = XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  s->r[i.D.RA] = ea;
+  return 0;
+}
+
+XEINTERPRETER(lwzx,         0x7C00002E, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // RT <- i32.0 || MEM(EA, 4)
+  uint64_t ea = XeInterpretXAddress(s, i);
+  s->r[i.X.RT] = XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  return 0;
+}
+
+
+// Integer store (A-14)
+
+XEINTERPRETER(stb,          0x98000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 1) <- (RS)[56:63]
+  uint64_t ea = XeInterpretDAddress(s, i);
+  XESETUINT8BE(XeInterpretGetMemory(s, ea), s->r[i.D.RT]);
+  return 0;
+}
+
+XEINTERPRETER(stbu,         0x9C000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 1) <- (RS)[56:63]
+  // RA <- EA
+  uint64_t ea = s->r[i.D.RA] + (int64_t)XEEXTS16(i.D.DS);
+  XESETUINT8BE(XeInterpretGetMemory(s, ea), s->r[i.D.RT]);
+  s->r[i.D.RA] = ea;
+  return 0;
+}
+
+XEINTERPRETER(stbx,         0x7C0001AE, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 1) <- (RS)[56:63]
+  uint64_t ea = XeInterpretXAddress(s, i);
+  XESETUINT8BE(XeInterpretGetMemory(s, ea), s->r[i.X.RT]);
+  return 0;
+}
+
+XEINTERPRETER(std,          0xF8000000, DS )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 8) <- (RS)
+  uint64_t ea = XeInterpretDSAddress(s, i);
+  XESETUINT64BE(XeInterpretGetMemory(s, ea), s->r[i.DS.RT]);
+  return 0;
+}
+
+XEINTERPRETER(stdu,         0xF8000001, DS )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 8) <- (RS)
+  // RA <- EA
+  uint64_t ea = s->r[i.DS.RA] + (int64_t)XEEXTS16(i.DS.DS << 2);
+  XESETUINT64BE(XeInterpretGetMemory(s, ea), s->r[i.DS.RT]);
+  s->r[i.DS.RA] = ea;
+  return 0;
+}
+
+XEINTERPRETER(stdx,         0x7C00012A, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 8) <- (RS)
+  uint64_t ea = XeInterpretXAddress(s, i);
+  XESETUINT64BE(XeInterpretGetMemory(s, ea), s->r[i.X.RT]);
+  return 0;
+}
+
+XEINTERPRETER(sth,          0xB0000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 2) <- (RS)[48:63]
+  uint64_t ea = XeInterpretDAddress(s, i);
+  XESETUINT16BE(XeInterpretGetMemory(s, ea), s->r[i.D.RT]);
+  return 0;
+}
+
+XEINTERPRETER(sthx,         0x7C00032E, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 2) <- (RS)[48:63]
+  uint64_t ea = XeInterpretXAddress(s, i);
+  XESETUINT16BE(XeInterpretGetMemory(s, ea), s->r[i.X.RT]);
+  return 0;
+}
+
+XEINTERPRETER(stw,          0x90000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 4) <- (RS)[32:63]
+  uint64_t ea = XeInterpretDAddress(s, i);
+  XESETUINT32BE(XeInterpretGetMemory(s, ea), s->r[i.D.RT]);
+  return 0;
+}
+
+XEINTERPRETER(stwu,         0x94000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 4) <- (RS)[32:63]
+  // RA <- EA
+  uint64_t ea = s->r[i.D.RA] + (int64_t)XEEXTS16(i.D.DS);
+  XESETUINT32BE(XeInterpretGetMemory(s, ea), s->r[i.D.RT]);
+  s->r[i.D.RA] = ea;
+  return 0;
+}
+
+XEINTERPRETER(stwx,         0x7C00012E, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 4) <- (RS)[32:63]
+  uint64_t ea = XeInterpretXAddress(s, i);
+  XESETUINT32BE(XeInterpretGetMemory(s, ea), s->r[i.X.RT]);
+  return 0;
+}
+
+
+// Integer load and store multiple (A-16)
+
+XEINTERPRETER(lmw,          0xB8000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // r <- RT
+  // do while r ≤ 31
+  //   GPR(r) <- i32.0 || MEM(EA, 4)
+  //   r <- r + 1
+  //   EA <- EA + 4
+  uint64_t ea = XeInterpretDAddress(s, i);
+  for (uint32_t r = i.D.RT; r <= 31; r++, ea += 4) {
+    s->r[r] = XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  }
+  return 0;
+}
+
+XEINTERPRETER(stmw,         0xBC000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // r <- RS
+  // do while r ≤ 31
+  //   MEM(EA, 4) <- GPR(r)[32:63]
+  //   r <- r + 1
+  //   EA <- EA + 4
+  uint64_t ea = XeInterpretDAddress(s, i);
+  for (uint32_t r = i.D.RT; r <= 31; r++, ea += 4) {
+    XESETUINT32BE(XeInterpretGetMemory(s, ea), s->r[r]);
+  }
+  return 0;
+}
+
+
+// Floating-point load and store (A-19, A-20)
+// Only the moves, so that functions that save and restore FPRs can still be
+// interpreted.
+
+XEINTERPRETER(lfd,          0xC8000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // FRT <- MEM(EA, 8)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  uint64_t v = XEGETUINT64BE(XeInterpretGetMemory(s, ea));
+  xe_copy_struct(&s->f[i.D.RT], &v, sizeof(v));
+  return 0;
+}
+
+XEINTERPRETER(lfs,          0xC0000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // FRT <- DOUBLE(MEM(EA, 4))
+  uint64_t ea = XeInterpretDAddress(s, i);
+  uint32_t v = XEGETUINT32BE(XeInterpretGetMemory(s, ea));
+  float fv;
+  xe_copy_struct(&fv, &v, sizeof(v));
+  s->f[i.D.RT] = fv;
+  return 0;
+}
+
+XEINTERPRETER(stfd,         0xD8000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 8) <- (FRS)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  uint64_t v;
+  xe_copy_struct(&v, &s->f[i.D.RT], sizeof(v));
+  XESETUINT64BE(XeInterpretGetMemory(s, ea), v);
+  return 0;
+}
+
+XEINTERPRETER(stfs,         0xD0000000, D  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // MEM(EA, 4) <- SINGLE(FRS)
+  uint64_t ea = XeInterpretDAddress(s, i);
+  float fv = (float)s->f[i.D.RT];
+  uint32_t v;
+  xe_copy_struct(&v, &fv, sizeof(v));
+  XESETUINT32BE(XeInterpretGetMemory(s, ea), v);
+  return 0;
+}
+
+
+// Cache management (A-27)
+
+XEINTERPRETER(dcbt,         0x7C00022C, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // No-op.
+  return 0;
+}
+
+XEINTERPRETER(dcbtst,       0x7C0001EC, X  )(FunctionInterpreter& f, xe_ppc_state_t* s, InstrData& i) {
+  // No-op.
+  return 0;
+}
+
+
+void RegisterInterpretCategoryMemory() {
+  XEREGISTERINTERPRETER(lbz,          0x88000000);
+  XEREGISTERINTERPRETER(lbzu,         0x8C000000);
+  XEREGISTERINTERPRETER(lbzx,         0x7C0000AE);
+  XEREGISTERINTERPRETER(ld,           0xE8000000);
+  XEREGISTERINTERPRETER(ldx,          0x7C00002A);
+  XEREGISTERINTERPRETER(lha,          0xA8000000);
+  XEREGISTERINTERPRETER(lhax,         0x7C0002AE);
+  XEREGISTERINTERPRETER(lhz,          0xA0000000);
+  XEREGISTERINTERPRETER(lhzx,         0x7C00022E);
+  XEREGISTERINTERPRETER(lwa,          0xE8000002);
+  XEREGISTERINTERPRETER(lwz,          0x80000000);
+  XEREGISTERINTERPRETER(lwzu,         0x84000000);
+  XEREGISTERINTERPRETER(lwzx,         0x7C00002E);
+  XEREGISTERINTERPRETER(stb,          0x98000000);
+  XEREGISTERINTERPRETER(stbu,         0x9C000000);
+  XEREGISTERINTERPRETER(stbx,         0x7C0001AE);
+  XEREGISTERINTERPRETER(std,          0xF8000000);
+  XEREGISTERINTERPRETER(stdu,         0xF8000001);
+  XEREGISTERINTERPRETER(stdx,         0x7C00012A);
+  XEREGISTERINTERPRETER(sth,          0xB0000000);
+  XEREGISTERINTERPRETER(sthx,         0x7C00032E);
+  XEREGISTERINTERPRETER(stw,          0x90000000);
+  XEREGISTERINTERPRETER(stwu,         0x94000000);
+  XEREGISTERINTERPRETER(stwx,         0x7C00012E);
+  XEREGISTERINTERPRETER(lmw,          0xB8000000);
+  XEREGISTERINTERPRETER(stmw,         0xBC000000);
+  XEREGISTERINTERPRETER(lfd,          0xC8000000);
+  XEREGISTERINTERPRETER(lfs,          0xC0000000);
+  XEREGISTERINTERPRETER(stfd,         0xD8000000);
+  XEREGISTERINTERPRETER(stfs,         0xD0000000);
+  XEREGISTERINTERPRETER(dcbt,         0x7C00022C);
+  XEREGISTERINTERPRETER(dcbtst,       0x7C0001EC);
+}
+
+
+}  // namespace interpreter
+}  // namespace cpu
+}  // namespace xe
@@ -16,7 +16,10 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 
+#include <xenia/cpu/exec_module.h>
+#include <xenia/cpu/processor.h>
 #include <xenia/cpu/sdb.h>
+#include <xenia/cpu/codegen/module_generator.h>
 #include <xenia/cpu/ppc/instr.h>
 #include <xenia/cpu/ppc/state.h>
 #include <xenia/kernel/export.h>
@@ -37,10 +40,107 @@ void XeTrap(xe_ppc_state_t* state, uint32_t cia) {
   XEASSERTALWAYS();
 }
 
-void XeIndirectBranch(xe_ppc_state_t* state, uint64_t target, uint64_t br_ia) {
-  XELOGCPU("INDIRECT BRANCH %.8X -> %.8X",
-           (uint32_t)br_ia, (uint32_t)target);
-  XEASSERTALWAYS();
+void* XeIndirectBranch(xe_ppc_state_t* state, uint64_t target,
+                       uint64_t br_ia) {
+  // Resolve the target to native code. The returned entry is cached by the
+  // call site so we should only get here on the first call or when the
+  // target changes.
+  Processor* processor = (Processor*)state->processor;
+  IndirectionEntry* entry = processor->GetIndirectionEntry((uint32_t)target);
+  if (!entry) {
+    XELOGCPU("INDIRECT BRANCH %.8X -> %.8X: unable to resolve target",
+             (uint32_t)br_ia, (uint32_t)target);
+    XEASSERTALWAYS();
+  }
+  return entry;
+}
+
+uint32_t XeGenerateFunction(xe_ppc_state_t* state, uint64_t module,
+                            uint64_t address) {
+  // The caller traps when this fails.
+  ExecModule* exec_module = (ExecModule*)module;
+  if (exec_module->GenerateFunction((uint32_t)address)) {
+    XELOGE("Unable to generate function %.8X", (uint32_t)address);
+    return 1;
+  }
+  return 0;
+}
+
+uint32_t XeInterpretFunction(xe_ppc_state_t* state, uint64_t generator,
+                             uint64_t address, uint64_t lr) {
+  codegen::ModuleGenerator* module_generator =
+      (codegen::ModuleGenerator*)generator;
+  return module_generator->InterpretFunction(state, (uint32_t)address, lr);
+}
+
+void XeTierUpFunction(xe_ppc_state_t* state, uint64_t generator,
+                      uint64_t address) {
+  codegen::ModuleGenerator* module_generator =
+      (codegen::ModuleGenerator*)generator;
+  module_generator->QueueTierUp((uint32_t)address);
+}
+
+// Reservation versions of guest cache lines (128b), hashed into a fixed
+// table. Collisions only cause spurious store conditional failures, which
+// the guest has to handle anyway. Odd versions mean the line is locked by a
+// store conditional in progress.
+const uint32_t kReservationLineCount = 64 * 1024;
+volatile int32_t reservation_lines_[kReservationLineCount];
+
+volatile int32_t* XeGetReservationLine(uint64_t ea) {
+  return &reservation_lines_[(ea >> 7) % kReservationLineCount];
+}
+
+void XeReserve(xe_ppc_state_t* state, uint64_t ea) {
+  // Called before the reserved load so that any store conditional to the
+  // line after this point is seen.
+  volatile int32_t* line = XeGetReservationLine(ea);
+  int32_t version;
+  do {
+    version = *line;
+  } while (version & 1);
+  state->reserve_version = (uint32_t)version;
+}
+
+uint32_t XeStoreConditional(xe_ppc_state_t* state, uint64_t ea,
+                            uint64_t expected, uint64_t value,
+                            uint32_t size) {
+  // Lock the line, failing if anything stored conditionally to it since the
+  // reservation was made.
+  volatile int32_t* line = XeGetReservationLine(ea);
+  int32_t version = (int32_t)state->reserve_version;
+  int32_t locked_version = (int32_t)(state->reserve_version + 1);
+  if (!xe_atomic_cas_32(version, locked_version, line)) {
+    return 0;
+  }
+
+  // Plain stores don't go through the table, so the value still has to be
+  // swapped in atomically.
+  uint8_t* p = state->membase + (uint32_t)ea;
+  bool stored;
+  if (size == 8) {
+    stored = xe_atomic_cas_64((int64_t)expected, (int64_t)value,
+                              (volatile int64_t*)p);
+  } else {
+    stored = xe_atomic_cas_32((int32_t)expected, (int32_t)value,
+                              (volatile int32_t*)p);
+  }
+
+  // Unlock, bumping the version if the line was changed.
+  int32_t new_version = stored ?
+      (int32_t)(state->reserve_version + 2) : version;
+  XEIGNORE(xe_atomic_cas_32(locked_version, new_version, line));
+  return stored ? 1 : 0;
+}
+
+// Native replacements for guest CRT routines. The arguments are already
+// host pointers into guest memory.
+uint64_t XeStrlen(const char* str) {
+  return xestrlena(str);
+}
+
+int32_t XeStrcmp(const char* str1, const char* str2) {
+  return xestrcmpa(str1, str2);
 }
 
 void XeInvalidInstruction(xe_ppc_state_t* state, uint32_t cia, uint32_t data) {
@@ -65,12 +165,6 @@ void XeInvalidInstruction(xe_ppc_state_t* state, uint32_t cia, uint32_t data) {
   }
 }
 
-void XeAccessViolation(xe_ppc_state_t* state, uint32_t cia, uint64_t ea) {
-  XELOGE("INVALID ACCESS %.8X: tried to touch %.8X",
-         cia, (uint32_t)ea);
-  XEASSERTALWAYS();
-}
-
 void XeTraceKernelCall(xe_ppc_state_t* state, uint64_t cia, uint64_t call_ia,
                        KernelExport* kernel_export) {
   XELOGCPU("TRACE: %.8X -> k.%.8X (%s)",
@@ -99,6 +193,18 @@ void XeTraceInstruction(xe_ppc_state_t* state, uint32_t cia, uint32_t data) {
 }
 
 
+void AddExport(Module* module, ExecutionEngine* engine, FunctionType* type,
+               const char* name, void* fn) {
+  // Modules loaded from the cache already have the declaration and only need
+  // the mapping to the host function.
+  Function* f = module->getFunction(name);
+  if (!f) {
+    f = Function::Create(type, Function::ExternalLinkage, name, module);
+  }
+  engine->addGlobalMapping(f, fn);
+}
+
+
 }
 
 
@@ -114,19 +220,71 @@ void xe::cpu::SetupLlvmExports(llvm::Module* module,
   trapArgs.push_back(Type::getInt32Ty(context));
   FunctionType* trapTy = FunctionType::get(
       Type::getVoidTy(context), trapArgs, false);
-  engine->addGlobalMapping(Function::Create(
-      trapTy, Function::ExternalLinkage, "XeTrap",
-      module), (void*)&XeTrap);
+  AddExport(module, engine, trapTy, "XeTrap", (void*)&XeTrap);
 
   std::vector<Type*> indirectBranchArgs;
   indirectBranchArgs.push_back(int8PtrTy);
   indirectBranchArgs.push_back(Type::getInt64Ty(context));
   indirectBranchArgs.push_back(Type::getInt64Ty(context));
   FunctionType* indirectBranchTy = FunctionType::get(
-      Type::getVoidTy(context), indirectBranchArgs, false);
-  engine->addGlobalMapping(Function::Create(
-      indirectBranchTy, Function::ExternalLinkage, "XeIndirectBranch",
-      module), (void*)&XeIndirectBranch);
+      int8PtrTy, indirectBranchArgs, false);
+  AddExport(module, engine, indirectBranchTy, "XeIndirectBranch",
+            (void*)&XeIndirectBranch);
+
+  // Memory methods:
+  std::vector<Type*> reserveArgs;
+  reserveArgs.push_back(int8PtrTy);
+  reserveArgs.push_back(Type::getInt64Ty(context));
+  FunctionType* reserveTy = FunctionType::get(
+      Type::getVoidTy(context), reserveArgs, false);
+  AddExport(module, engine, reserveTy, "XeReserve", (void*)&XeReserve);
+
+  std::vector<Type*> storeConditionalArgs;
+  storeConditionalArgs.push_back(int8PtrTy);
+  storeConditionalArgs.push_back(Type::getInt64Ty(context));
+  storeConditionalArgs.push_back(Type::getInt64Ty(context));
+  storeConditionalArgs.push_back(Type::getInt64Ty(context));
+  storeConditionalArgs.push_back(Type::getInt32Ty(context));
+  FunctionType* storeConditionalTy = FunctionType::get(
+      Type::getInt32Ty(context), storeConditionalArgs, false);
+  AddExport(module, engine, storeConditionalTy, "XeStoreConditional",
+            (void*)&XeStoreConditional);
+
+  std::vector<Type*> strlenArgs;
+  strlenArgs.push_back(int8PtrTy);
+  FunctionType* strlenTy = FunctionType::get(
+      Type::getInt64Ty(context), strlenArgs, false);
+  AddExport(module, engine, strlenTy, "XeStrlen", (void*)&XeStrlen);
+
+  std::vector<Type*> strcmpArgs;
+  strcmpArgs.push_back(int8PtrTy);
+  strcmpArgs.push_back(int8PtrTy);
+  FunctionType* strcmpTy = FunctionType::get(
+      Type::getInt32Ty(context), strcmpArgs, false);
+  AddExport(module, engine, strcmpTy, "XeStrcmp", (void*)&XeStrcmp);
+
+  // Code generation methods:
+  std::vector<Type*> generateFunctionArgs;
+  generateFunctionArgs.push_back(int8PtrTy);
+  generateFunctionArgs.push_back(Type::getInt64Ty(context));
+  generateFunctionArgs.push_back(Type::getInt64Ty(context));
+  FunctionType* generateFunctionTy = FunctionType::get(
+      Type::getInt32Ty(context), generateFunctionArgs, false);
+  AddExport(module, engine, generateFunctionTy, "XeGenerateFunction",
+            (void*)&XeGenerateFunction);
+  FunctionType* tierUpFunctionTy = FunctionType::get(
+      Type::getVoidTy(context), generateFunctionArgs, false);
+  AddExport(module, engine, tierUpFunctionTy, "XeTierUpFunction",
+            (void*)&XeTierUpFunction);
+  std::vector<Type*> interpretFunctionArgs;
+  interpretFunctionArgs.push_back(int8PtrTy);
+  interpretFunctionArgs.push_back(Type::getInt64Ty(context));
+  interpretFunctionArgs.push_back(Type::getInt64Ty(context));
+  interpretFunctionArgs.push_back(Type::getInt64Ty(context));
+  FunctionType* interpretFunctionTy = FunctionType::get(
+      Type::getInt32Ty(context), interpretFunctionArgs, false);
+  AddExport(module, engine, interpretFunctionTy, "XeInterpretFunction",
+            (void*)&XeInterpretFunction);
 
   // Debugging methods:
   std::vector<Type*> invalidInstructionArgs;
@@ -135,19 +293,8 @@ void xe::cpu::SetupLlvmExports(llvm::Module* module,
   invalidInstructionArgs.push_back(Type::getInt32Ty(context));
   FunctionType* invalidInstructionTy = FunctionType::get(
       Type::getVoidTy(context), invalidInstructionArgs, false);
-  engine->addGlobalMapping(Function::Create(
-      invalidInstructionTy, Function::ExternalLinkage, "XeInvalidInstruction",
-      module), (void*)&XeInvalidInstruction);
-
-  std::vector<Type*> accessViolationArgs;
-  accessViolationArgs.push_back(int8PtrTy);
-  accessViolationArgs.push_back(Type::getInt32Ty(context));
-  accessViolationArgs.push_back(Type::getInt64Ty(context));
-  FunctionType* accessViolationTy = FunctionType::get(
-      Type::getVoidTy(context), accessViolationArgs, false);
-  engine->addGlobalMapping(Function::Create(
-      accessViolationTy, Function::ExternalLinkage, "XeAccessViolation",
-      module), (void*)&XeAccessViolation);
+  AddExport(module, engine, invalidInstructionTy, "XeInvalidInstruction",
+            (void*)&XeInvalidInstruction);
 
   // Tracing methods:
   std::vector<Type*> traceCallArgs;
@@ -164,13 +311,10 @@ void xe::cpu::SetupLlvmExports(llvm::Module* module,
   FunctionType* traceInstructionTy = FunctionType::get(
       Type::getVoidTy(context), traceInstructionArgs, false);
 
-  engine->addGlobalMapping(Function::Create(
-      traceCallTy, Function::ExternalLinkage, "XeTraceKernelCall",
-      module), (void*)&XeTraceKernelCall);
-  engine->addGlobalMapping(Function::Create(
-      traceCallTy, Function::ExternalLinkage, "XeTraceUserCall",
-      module), (void*)&XeTraceUserCall);
-  engine->addGlobalMapping(Function::Create(
-      traceInstructionTy, Function::ExternalLinkage, "XeTraceInstruction",
-      module), (void*)&XeTraceInstruction);
+  AddExport(module, engine, traceCallTy, "XeTraceKernelCall",
+            (void*)&XeTraceKernelCall);
+  AddExport(module, engine, traceCallTy, "XeTraceUserCall",
+            (void*)&XeTraceUserCall);
+  AddExport(module, engine, traceInstructionTy, "XeTraceInstruction",
+            (void*)&XeTraceInstruction);
 }
@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/module_profile.h>
+
+#include <algorithm>
+
+#include <xenia/dbg/simple_sha1.h>
+
+
+using namespace xe;
+using namespace xe::cpu;
+
+
+namespace {
+
+const uint32_t kProfileMagic    = 0x58455046;  // 'XEPF'
+const uint32_t kProfileVersion  = 1;
+
+typedef struct {
+  uint32_t  magic;
+  uint32_t  version;
+  uint8_t   code_hash[20];
+  uint32_t  call_count;
+  uint32_t  branch_count;
+} ProfileHeader;
+
+typedef struct {
+  uint32_t  address;
+  uint64_t  count;
+} ProfileCallEntry;
+
+typedef struct {
+  uint32_t  address;
+  uint64_t  taken;
+  uint64_t  not_taken;
+} ProfileBranchEntry;
+
+bool CompareCallCounts(const std::pair<uint64_t, uint32_t>& a,
+                       const std::pair<uint64_t, uint32_t>& b) {
+  return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+}
+
+
+ModuleProfile::ModuleProfile(const uint8_t code_hash[20]) {
+  xe_copy_struct(code_hash_, code_hash, sizeof(code_hash_));
+  xe_zero_struct(hash_, sizeof(hash_));
+  lock_ = xe_mutex_alloc(0);
+}
+
+ModuleProfile::~ModuleProfile() {
+  xe_mutex_free(lock_);
+}
+
+int ModuleProfile::Read(const char* path) {
+  int result_code = 1;
+  std::vector<uint8_t> data;
+  const uint8_t* p = NULL;
+  const ProfileHeader* header = NULL;
+  size_t expected_length = 0;
+
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  XEEXPECTTRUE(length >= (long)sizeof(ProfileHeader));
+  data.resize(length);
+  XEEXPECTTRUE(fread(&data[0], 1, length, file) == (size_t)length);
+
+  p = &data[0];
+  header = (const ProfileHeader*)p;
+  XEEXPECTTRUE(header->magic == kProfileMagic);
+  XEEXPECTTRUE(header->version == kProfileVersion);
+  XEEXPECTZERO(memcmp(header->code_hash, code_hash_, sizeof(code_hash_)));
+  expected_length = sizeof(ProfileHeader) +
+      header->call_count * sizeof(ProfileCallEntry) +
+      header->branch_count * sizeof(ProfileBranchEntry);
+  XEEXPECTTRUE((size_t)length == expected_length);
+
+  xe_mutex_lock(lock_);
+  p += sizeof(ProfileHeader);
+  for (uint32_t n = 0; n < header->call_count; n++) {
+    const ProfileCallEntry* entry = (const ProfileCallEntry*)p;
+    calls_[entry->address] += entry->count;
+    p += sizeof(ProfileCallEntry);
+  }
+  for (uint32_t n = 0; n < header->branch_count; n++) {
+    const ProfileBranchEntry* entry = (const ProfileBranchEntry*)p;
+    BranchCounts& counts = branches_[entry->address];
+    counts.counts[0] += entry->taken;
+    counts.counts[1] += entry->not_taken;
+    p += sizeof(ProfileBranchEntry);
+  }
+  xe_mutex_unlock(lock_);
+
+  dbg::SHA1(&data[0], data.size(), hash_);
+
+  result_code = 0;
+XECLEANUP:
+  fclose(file);
+  return result_code;
+}
+
+int ModuleProfile::Write(const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    XELOGW("Unable to write profile %s", path);
+    return 1;
+  }
+
+  xe_mutex_lock(lock_);
+
+  ProfileHeader header;
+  xe_zero_struct(&header, sizeof(header));
+  header.magic = kProfileMagic;
+  header.version = kProfileVersion;
+  xe_copy_struct(header.code_hash, code_hash_, sizeof(code_hash_));
+  header.call_count = (uint32_t)calls_.size();
+  header.branch_count = (uint32_t)branches_.size();
+  fwrite(&header, sizeof(header), 1, file);
+
+  for (std::map<uint32_t, uint64_t>::iterator it = calls_.begin();
+       it != calls_.end(); ++it) {
+    ProfileCallEntry entry;
+    xe_zero_struct(&entry, sizeof(entry));
+    entry.address = it->first;
+    entry.count = it->second;
+    fwrite(&entry, sizeof(entry), 1, file);
+  }
+  for (std::map<uint32_t, BranchCounts>::iterator it = branches_.begin();
+       it != branches_.end(); ++it) {
+    ProfileBranchEntry entry;
+    xe_zero_struct(&entry, sizeof(entry));
+    entry.address = it->first;
+    entry.taken = it->second.counts[0];
+    entry.not_taken = it->second.counts[1];
+    fwrite(&entry, sizeof(entry), 1, file);
+  }
+
+  xe_mutex_unlock(lock_);
+
+  fclose(file);
+  XELOGI("Wrote profile %s", path);
+  return 0;
+}
+
+const uint8_t* ModuleProfile::hash() {
+  return hash_;
+}
+
+uint64_t* ModuleProfile::GetCallCounter(uint32_t address) {
+  xe_mutex_lock(lock_);
+  uint64_t* counter = &calls_[address];
+  xe_mutex_unlock(lock_);
+  return counter;
+}
+
+uint64_t* ModuleProfile::GetBranchCounters(uint32_t address) {
+  xe_mutex_lock(lock_);
+  uint64_t* counters = branches_[address].counts;
+  xe_mutex_unlock(lock_);
+  return counters;
+}
+
+uint64_t ModuleProfile::GetCallCount(uint32_t address) {
+  uint64_t count = 0;
+  xe_mutex_lock(lock_);
+  std::map<uint32_t, uint64_t>::iterator it = calls_.find(address);
+  if (it != calls_.end()) {
+    count = it->second;
+  }
+  xe_mutex_unlock(lock_);
+  return count;
+}
+
+bool ModuleProfile::GetBranchCounts(uint32_t address,
+                                    uint64_t* out_taken,
+                                    uint64_t* out_not_taken) {
+  bool found = false;
+  xe_mutex_lock(lock_);
+  std::map<uint32_t, BranchCounts>::iterator it = branches_.find(address);
+  if (it != branches_.end()) {
+    *out_taken = it->second.counts[0];
+    *out_not_taken = it->second.counts[1];
+    found = *out_taken || *out_not_taken;
+  }
+  xe_mutex_unlock(lock_);
+  return found;
+}
+
+void ModuleProfile::GetFunctionsByCallCount(
+    std::vector<uint32_t>& addresses) {
+  std::vector<std::pair<uint64_t, uint32_t> > counts;
+  xe_mutex_lock(lock_);
+  for (std::map<uint32_t, uint64_t>::iterator it = calls_.begin();
+       it != calls_.end(); ++it) {
+    if (it->second) {
+      counts.push_back(std::pair<uint64_t, uint32_t>(it->second, it->first));
+    }
+  }
+  xe_mutex_unlock(lock_);
+  std::sort(counts.begin(), counts.end(), CompareCallCounts);
+  for (std::vector<std::pair<uint64_t, uint32_t> >::iterator it =
+       counts.begin(); it != counts.end(); ++it) {
+    addresses.push_back(it->second);
+  }
+}
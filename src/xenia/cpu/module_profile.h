@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_MODULE_PROFILE_H_
+#define XENIA_CPU_MODULE_PROFILE_H_
+
+#include <xenia/common.h>
+#include <xenia/core.h>
+
+#include <map>
+#include <vector>
+
+
+namespace xe {
+namespace cpu {
+
+
+// Runtime counts for the code of a module: how often each function was
+// called and how often each conditional branch was taken or not. Generated
+// code updates the counters in place when instrumented, and the counts are
+// persisted so that later runs can generate code with them.
+class ModuleProfile {
+public:
+  ModuleProfile(const uint8_t code_hash[20]);
+  ~ModuleProfile();
+
+  // Fails if the file is missing or was recorded for different code.
+  int Read(const char* path);
+  int Write(const char* path);
+
+  // SHA1 of the counts as read, so caches can be keyed on them.
+  const uint8_t* hash();
+
+  // The counters live as long as the profile and never move.
+  uint64_t* GetCallCounter(uint32_t address);
+  uint64_t* GetBranchCounters(uint32_t address);
+
+  uint64_t GetCallCount(uint32_t address);
+  bool GetBranchCounts(uint32_t address,
+                       uint64_t* out_taken, uint64_t* out_not_taken);
+
+  // All called functions, most called first.
+  void GetFunctionsByCallCount(std::vector<uint32_t>& addresses);
+
+private:
+  class BranchCounts {
+  public:
+    BranchCounts() { counts[0] = counts[1] = 0; }
+    uint64_t counts[2];   // taken, not taken
+  };
+
+  uint8_t       code_hash_[20];
+  uint8_t       hash_[20];
+
+  xe_mutex_t*   lock_;
+  std::map<uint32_t, uint64_t>      calls_;
+  std::map<uint32_t, BranchCounts>  branches_;
+};
+
+
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_MODULE_PROFILE_H_
@@ -19,6 +19,7 @@ using namespace xe::cpu::ppc;
 
 void InstrAccessBits::Clear() {
   spr = cr = gpr = fpr = 0;
+  vmx[0] = vmx[1] = vmx[2] = vmx[3] = 0;
 }
 
 void InstrAccessBits::Extend(InstrAccessBits& other) {
@@ -26,6 +27,10 @@ void InstrAccessBits::Extend(InstrAccessBits& other) {
     cr  |= other.cr;
     gpr |= other.gpr;
     fpr |= other.fpr;
+    vmx[0] |= other.vmx[0];
+    vmx[1] |= other.vmx[1];
+    vmx[2] |= other.vmx[2];
+    vmx[3] |= other.vmx[3];
   }
 
 void InstrAccessBits::MarkAccess(InstrRegister& reg) {
@@ -59,13 +64,80 @@ void InstrAccessBits::MarkAccess(InstrRegister& reg) {
     case InstrRegister::kFPR:
       fpr |= bits << (2 * reg.ordinal);
       break;
-    default:
     case InstrRegister::kVMX:
+      vmx[reg.ordinal / 32] |= bits << (2 * (reg.ordinal % 32));
+      break;
+    default:
       XEASSERTALWAYS();
       break;
   }
 }
 
+namespace {
+
+// Even bits of an InstrAccessBits field are reads and odd bits writes.
+uint32_t CollapseAccessBits(uint64_t bits) {
+  uint32_t result = 0;
+  for (uint32_t n = 0; n < 32; n++) {
+    if (bits & (1ull << (n * 2))) {
+      result |= 1 << n;
+    }
+  }
+  return result;
+}
+
+uint64_t ExpandAccessBits(uint32_t reads, uint32_t writes) {
+  uint64_t result = 0;
+  for (uint32_t n = 0; n < 32; n++) {
+    if (reads & (1 << n)) {
+      result |= 1ull << (n * 2);
+    }
+    if (writes & (1 << n)) {
+      result |= 2ull << (n * 2);
+    }
+  }
+  return result;
+}
+
+}
+
+int InstrAccessMask::Pack(const InstrAccessBits& bits) {
+  gpr_reads = CollapseAccessBits(bits.gpr);
+  gpr_writes = CollapseAccessBits(bits.gpr >> 1);
+  fpr_reads = CollapseAccessBits(bits.fpr);
+  fpr_writes = CollapseAccessBits(bits.fpr >> 1);
+  spr_reads = (uint8_t)CollapseAccessBits(bits.spr);
+  spr_writes = (uint8_t)CollapseAccessBits(bits.spr >> 1);
+  cr_reads = (uint8_t)CollapseAccessBits(bits.cr);
+  cr_writes = (uint8_t)CollapseAccessBits(bits.cr >> 1);
+  vmx_count = 0;
+  for (uint32_t n = 0; n < 128; n++) {
+    uint64_t access = (bits.vmx[n / 32] >> (2 * (n % 32))) & 3;
+    for (uint32_t is_write = 0; is_write < 2; is_write++) {
+      if (access & (1 << is_write)) {
+        if (vmx_count == XECOUNT(vmx)) {
+          return 1;
+        }
+        vmx[vmx_count++] = (uint8_t)((n << 1) | is_write);
+      }
+    }
+  }
+  return 0;
+}
+
+void InstrAccessMask::Unpack(InstrAccessBits& out_bits) const {
+  out_bits.gpr = ExpandAccessBits(gpr_reads, gpr_writes);
+  out_bits.fpr = ExpandAccessBits(fpr_reads, fpr_writes);
+  out_bits.spr = ExpandAccessBits(spr_reads, spr_writes);
+  out_bits.cr = ExpandAccessBits(cr_reads, cr_writes);
+  out_bits.vmx[0] = out_bits.vmx[1] = out_bits.vmx[2] = out_bits.vmx[3] = 0;
+  for (uint32_t n = 0; n < vmx_count; n++) {
+    uint32_t ordinal = vmx[n] >> 1;
+    uint64_t access = (vmx[n] & 1) ? 2 : 1;
+    out_bits.vmx[ordinal / 32] |= access << (2 * (ordinal % 32));
+  }
+}
+
 void InstrAccessBits::Dump(std::string& out_str) {
   std::stringstream str;
   if (spr) {
@@ -139,6 +211,19 @@ void InstrAccessBits::Dump(std::string& out_str) {
     }
   }
 
+  for (size_t m = 0; m < XECOUNT(vmx); m++) {
+    uint64_t vmx_t = vmx[m];
+    for (size_t n = 0; vmx_t && n < 32; n++) {
+      if (vmx_t & 0x3) {
+        str << "v" << (m * 32 + n) << " [";
+        str << ((vmx_t & 1) ? "R" : " ");
+        str << ((vmx_t & 2) ? "W" : " ");
+        str << "] ";
+      }
+      vmx_t >>= 2;
+    }
+  }
+
   out_str = str.str();
 }
 
@@ -339,48 +424,25 @@ void InstrDisasm::Dump(std::string& str, size_t pad) {
 }
 
 InstrType* xe::cpu::ppc::GetInstrType(uint32_t code) {
-  InstrType* slot = NULL;
-  switch (code >> 26) {
-  case 4:
-    // Opcode = 4, index = bits 5-0 (6)
-    slot = &xe::cpu::ppc::tables::instr_table_4[XESELECTBITS(code, 0, 5)];
-    break;
-  case 19:
-    // Opcode = 19, index = bits 10-1 (10)
-    slot = &xe::cpu::ppc::tables::instr_table_19[XESELECTBITS(code, 1, 10)];
-    break;
-  case 30:
-    // Opcode = 30, index = bits 4-1 (4)
-    slot = &xe::cpu::ppc::tables::instr_table_30[XESELECTBITS(code, 1, 4)];
-    break;
-  case 31:
-    // Opcode = 31, index = bits 10-1 (10)
-    slot = &xe::cpu::ppc::tables::instr_table_31[XESELECTBITS(code, 1, 10)];
-    break;
-  case 58:
-    // Opcode = 58, index = bits 1-0 (2)
-    slot = &xe::cpu::ppc::tables::instr_table_58[XESELECTBITS(code, 0, 1)];
-    break;
-  case 59:
-    // Opcode = 59, index = bits 5-1 (5)
-    slot = &xe::cpu::ppc::tables::instr_table_59[XESELECTBITS(code, 1, 5)];
-    break;
-  case 62:
-    // Opcode = 62, index = bits 1-0 (2)
-    slot = &xe::cpu::ppc::tables::instr_table_62[XESELECTBITS(code, 0, 1)];
-    break;
-  case 63:
-    // Opcode = 63, index = bits 10-1 (10)
-    slot = &xe::cpu::ppc::tables::instr_table_63[XESELECTBITS(code, 1, 10)];
-    break;
-  default:
-    slot = &xe::cpu::ppc::tables::instr_table[XESELECTBITS(code, 26, 31)];
-    break;
+  // The primary opcode selects the table and the bits that index it.
+  const xe::cpu::ppc::tables::InstrTableDispatch& dispatch =
+      xe::cpu::ppc::tables::instr_table_dispatch[code >> 26];
+  InstrType* slot = &dispatch.table[(code >> dispatch.shift) & dispatch.mask];
+  if (slot->opcode) {
+    return slot;
   }
-  if (!slot || !slot->opcode) {
-    return NULL;
+
+  // Forms that don't have a usable index (VA and the VMX128 forms, which
+  // scatter their register bits through the extended opcode) are matched in
+  // order by their opcode mask.
+  for (size_t n = 0; n < XECOUNT(xe::cpu::ppc::tables::instr_table_scan);
+       n++) {
+    slot = &xe::cpu::ppc::tables::instr_table_scan[n];
+    if (slot->opcode == (code & slot->opcode_mask)) {
+      return slot;
+    }
   }
-  return slot;
+  return NULL;
 }
 
 int xe::cpu::ppc::RegisterInstrDisassemble(
@@ -405,3 +467,15 @@ int xe::cpu::ppc::RegisterInstrEmit(uint32_t code, InstrEmitFn emit) {
   instr_type->emit = emit;
   return 0;
 }
+
+int xe::cpu::ppc::RegisterInstrInterpret(
+    uint32_t code, InstrInterpretFn interpret) {
+  InstrType* instr_type = GetInstrType(code);
+  XEASSERTNOTNULL(instr_type);
+  if (!instr_type) {
+    return 1;
+  }
+  XEASSERTNULL(instr_type->interpret);
+  instr_type->interpret = interpret;
+  return 0;
+}
@@ -41,8 +41,29 @@ typedef enum {
   kXEPPCInstrFormatVA   = 15,
   kXEPPCInstrFormatVX   = 16,
   kXEPPCInstrFormatVXR  = 17,
+  kXEPPCInstrFormatVX128    = 18,
+  kXEPPCInstrFormatVX128_1  = 19,
+  kXEPPCInstrFormatVX128_R  = 20,
+  kXEPPCInstrFormatVX128_2  = 21,
+  kXEPPCInstrFormatVX128_3  = 22,
+  kXEPPCInstrFormatVX128_4  = 23,
+  kXEPPCInstrFormatVX128_5  = 24,
 } xe_ppc_instr_format_e;
 
+// Opcode masks for instructions that can't be found by table index and are
+// instead matched in order against the scan table.
+typedef enum {
+  kXEPPCInstrMaskVA       = 0xFC00003F,
+  kXEPPCInstrMaskVXR      = 0xFC0003FF,
+  kXEPPCInstrMaskVX128    = 0xFC0003D0,
+  kXEPPCInstrMaskVX128_1  = 0xFC0007F3,
+  kXEPPCInstrMaskVX128_R  = 0xFC000390,
+  kXEPPCInstrMaskVX128_2  = 0xFC000210,
+  kXEPPCInstrMaskVX128_3  = 0xFC0007F0,
+  kXEPPCInstrMaskVX128_4  = 0xFC000730,
+  kXEPPCInstrMaskVX128_5  = 0xFC000010,
+} xe_ppc_instr_mask_e;
+
 typedef enum {
   kXEPPCInstrTypeGeneral      = (1 << 0),
   kXEPPCInstrTypeBranch       = (1 << 1),
@@ -201,8 +222,134 @@ typedef struct {
       uint32_t                : 6;
     } MDS;
     // kXEPPCInstrFormatVA
+    struct {
+      uint32_t                : 6;
+      uint32_t        VC      : 5;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VA;
     // kXEPPCInstrFormatVX
+    struct {
+      uint32_t                : 11;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VX;
     // kXEPPCInstrFormatVXR
+    struct {
+      uint32_t                : 10;
+      uint32_t        Rc      : 1;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VXR;
+    // kXEPPCInstrFormatVX128
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VA128 = VA128l | (VA128h << 5) | (VA128H << 6)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t                : 4;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128;
+    // kXEPPCInstrFormatVX128_1
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      uint32_t                : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 7;
+      uint32_t        RB      : 5;
+      uint32_t        RA      : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_1;
+    // kXEPPCInstrFormatVX128_R
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VA128 = VA128l | (VA128h << 5) | (VA128H << 6)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        Rc      : 1;
+      uint32_t                : 3;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_R;
+    // kXEPPCInstrFormatVX128_2
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VA128 = VA128l | (VA128h << 5) | (VA128H << 6)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        VC      : 3;
+      uint32_t                : 1;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_2;
+    // kXEPPCInstrFormatVX128_3
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 7;
+      uint32_t        VB128l  : 5;
+      uint32_t        IMM     : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_3;
+    // kXEPPCInstrFormatVX128_4
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 2;
+      uint32_t        z       : 2;
+      uint32_t                : 3;
+      uint32_t        VB128l  : 5;
+      uint32_t        IMM     : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_4;
+    // kXEPPCInstrFormatVX128_5
+    struct {
+      // VD128 = VD128l | (VD128h << 5)
+      // VA128 = VA128l | (VA128h << 5) | (VA128H << 6)
+      // VB128 = VB128l | (VB128h << 5)
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        SH      : 4;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_5;
   };
 } InstrData;
 
@@ -252,7 +399,9 @@ typedef struct {
 
 class InstrAccessBits {
 public:
-  InstrAccessBits() : spr(0), cr(0), gpr(0), fpr(0) {}
+  InstrAccessBits() : spr(0), cr(0), gpr(0), fpr(0) {
+    vmx[0] = vmx[1] = vmx[2] = vmx[3] = 0;
+  }
 
   // Bitmasks derived from the accesses to registers.
   // Format is 2 bits for each register, even bits indicating reads and odds
@@ -261,6 +410,7 @@ public:
   uint64_t cr;    // cr7/6/5/4/3/2/1/0
   uint64_t gpr;   // r31-0
   uint64_t fpr;   // f31-0
+  uint64_t vmx[4];  // v127-0, 32 registers per element
 
   void Clear();
   void Extend(InstrAccessBits& other);
@@ -268,6 +418,32 @@ public:
   void Dump(std::string& out_str);
 };
 
+// InstrAccessBits packed down to one read and one write bit per register so
+// that it is cheap to keep for every decoded instruction. There are too many
+// vector registers for masks, so the few an instruction touches are listed
+// instead as (ordinal << 1) | is_write.
+class InstrAccessMask {
+public:
+  InstrAccessMask() :
+      gpr_reads(0), gpr_writes(0), fpr_reads(0), fpr_writes(0),
+      spr_reads(0), spr_writes(0), cr_reads(0), cr_writes(0), vmx_count(0) {}
+
+  uint32_t gpr_reads;
+  uint32_t gpr_writes;
+  uint32_t fpr_reads;
+  uint32_t fpr_writes;
+  uint8_t  spr_reads;   // fpcsr/ctr/lr/xer
+  uint8_t  spr_writes;
+  uint8_t  cr_reads;
+  uint8_t  cr_writes;
+  uint8_t  vmx_count;
+  uint8_t  vmx[7];
+
+  // Fails if the instruction touches more vector registers than fit.
+  int Pack(const InstrAccessBits& bits);
+  void Unpack(InstrAccessBits& out_bits) const;
+};
+
 
 class InstrDisasm {
 public:
@@ -300,11 +476,13 @@ public:
 
 typedef int (*InstrDisassembleFn)(InstrData& i, InstrDisasm& d);
 typedef void* InstrEmitFn;
+typedef void* InstrInterpretFn;
 
 
 class InstrType {
 public:
   uint32_t    opcode;
+  uint32_t    opcode_mask;  // xe_ppc_instr_mask_e, scan table only
   uint32_t    format;   // xe_ppc_instr_format_e
   uint32_t    type;     // xe_ppc_instr_type_e
   uint32_t    flags;    // xe_ppc_instr_flag_e
@@ -312,11 +490,13 @@ public:
 
   InstrDisassembleFn disassemble;
   InstrEmitFn        emit;
+  InstrInterpretFn   interpret;
 };
 
 InstrType* GetInstrType(uint32_t code);
 int RegisterInstrDisassemble(uint32_t code, InstrDisassembleFn disassemble);
 int RegisterInstrEmit(uint32_t code, InstrEmitFn emit);
+int RegisterInstrInterpret(uint32_t code, InstrInterpretFn interpret);
 
 
 }  // namespace ppc
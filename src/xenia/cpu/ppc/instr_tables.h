@@ -19,21 +19,38 @@ namespace ppc {
 namespace tables {
 
 
-static InstrType* instr_table_prep(
-    InstrType* unprep, int unprep_count, int a, int b) {
-  int prep_count = pow(2.0, b - a + 1);
-  InstrType* prep = (InstrType*)xe_calloc(prep_count * sizeof(InstrType));
+// Copies the sparse instruction list into its slot in the fixed-size table
+// indexed by bits a-b. The tables are plain arrays so that their addresses
+// are link-time constants usable in the dispatch table below.
+static int instr_table_prep(
+    InstrType* prep, InstrType* unprep, int unprep_count, int a, int b) {
   for (int n = 0; n < unprep_count; n++) {
     int ordinal = XESELECTBITS(unprep[n].opcode, a, b);
     prep[ordinal] = unprep[n];
   }
-  return prep;
+  return 1;
 }
 
 
+typedef struct {
+  InstrType*  table;
+  uint32_t    shift;
+  uint32_t    mask;
+} InstrTableDispatch;
+
+
 #define EMPTY(slot) {0}
 #define INSTRUCTION(name, opcode, format, type, flag)  { \
   opcode, \
+  0, \
+  kXEPPCInstrFormat##format, \
+  kXEPPCInstrType##type, \
+  flag, \
+  #name, \
+}
+#define SCAN_INSTRUCTION(name, opcode, format, type, flag)  { \
+  opcode, \
+  kXEPPCInstrMask##format, \
   kXEPPCInstrFormat##format, \
   kXEPPCInstrType##type, \
   flag, \
@@ -46,13 +63,50 @@ static InstrType* instr_table_prep(
 //   pem_64bit_v3.0.2005jul15.pdf, A.2
 //   PowerISA_V2.06B_V2_PUBLIC.pdf
 
-// Opcode = 4, index = bits 5-0 (6)
+// Opcode = 4, index = bits 10-0 (11)
+// VA/VXR forms and the VMX128 forms are in the scan table.
 static InstrType instr_table_4_unprep[] = {
-  // TODO: all of the vector ops
-  INSTRUCTION(vperm,          0x1000002B, VA , General        , 0),
+  // TODO: the rest of the vector ops
+  INSTRUCTION(vaddubm,        0x10000000, VX , General        , 0),
+  INSTRUCTION(vaddfp,         0x1000000A, VX , General        , 0),
+  INSTRUCTION(vmrghb,         0x1000000C, VX , General        , 0),
+  INSTRUCTION(vadduhm,        0x10000040, VX , General        , 0),
+  INSTRUCTION(vsubfp,         0x1000004A, VX , General        , 0),
+  INSTRUCTION(vmrghh,         0x1000004C, VX , General        , 0),
+  INSTRUCTION(vadduwm,        0x10000080, VX , General        , 0),
+  INSTRUCTION(vmaxuw,         0x10000082, VX , General        , 0),
+  INSTRUCTION(vrlw,           0x10000084, VX , General        , 0),
+  INSTRUCTION(vmrghw,         0x1000008C, VX , General        , 0),
+  INSTRUCTION(vmrglb,         0x1000010C, VX , General        , 0),
+  INSTRUCTION(vmrglh,         0x1000014C, VX , General        , 0),
+  INSTRUCTION(vmaxsw,         0x10000182, VX , General        , 0),
+  INSTRUCTION(vslw,           0x10000184, VX , General        , 0),
+  INSTRUCTION(vmrglw,         0x1000018C, VX , General        , 0),
+  INSTRUCTION(vspltb,         0x1000020C, VX , General        , 0),
+  INSTRUCTION(vsplth,         0x1000024C, VX , General        , 0),
+  INSTRUCTION(vminuw,         0x10000282, VX , General        , 0),
+  INSTRUCTION(vsrw,           0x10000284, VX , General        , 0),
+  INSTRUCTION(vspltw,         0x1000028C, VX , General        , 0),
+  INSTRUCTION(vspltisb,       0x1000030C, VX , General        , 0),
+  INSTRUCTION(vspltish,       0x1000034C, VX , General        , 0),
+  INSTRUCTION(vminsw,         0x10000382, VX , General        , 0),
+  INSTRUCTION(vsraw,          0x10000384, VX , General        , 0),
+  INSTRUCTION(vspltisw,       0x1000038C, VX , General        , 0),
+  INSTRUCTION(vsububm,        0x10000400, VX , General        , 0),
+  INSTRUCTION(vand,           0x10000404, VX , General        , 0),
+  INSTRUCTION(vmaxfp,         0x1000040A, VX , General        , 0),
+  INSTRUCTION(vsubuhm,        0x10000440, VX , General        , 0),
+  INSTRUCTION(vandc,          0x10000444, VX , General        , 0),
+  INSTRUCTION(vminfp,         0x1000044A, VX , General        , 0),
+  INSTRUCTION(vsubuwm,        0x10000480, VX , General        , 0),
+  INSTRUCTION(vor,            0x10000484, VX , General        , 0),
+  INSTRUCTION(vxor,           0x100004C4, VX , General        , 0),
+  INSTRUCTION(vnor,           0x10000504, VX , General        , 0),
 };
-static InstrType* instr_table_4 = instr_table_prep(
-    instr_table_4_unprep, XECOUNT(instr_table_4_unprep), 0, 5);
+static InstrType instr_table_4[2048];
+static int instr_table_4_prepped = instr_table_prep(
+    instr_table_4, instr_table_4_unprep,
+    XECOUNT(instr_table_4_unprep), 0, 10);
 
 // Opcode = 19, index = bits 10-1 (10)
 static InstrType instr_table_19_unprep[] = {
@@ -69,8 +123,10 @@ static InstrType instr_table_19_unprep[] = {
   INSTRUCTION(cror,           0x4C000382, XL , General        , 0),
   INSTRUCTION(bcctrx,         0x4C000420, XL , BranchCond     , 0),
 };
-static InstrType* instr_table_19 = instr_table_prep(
-    instr_table_19_unprep, XECOUNT(instr_table_19_unprep), 1, 10);
+static InstrType instr_table_19[1024];
+static int instr_table_19_prepped = instr_table_prep(
+    instr_table_19, instr_table_19_unprep,
+    XECOUNT(instr_table_19_unprep), 1, 10);
 
 // Opcode = 30, index = bits 4-1 (4)
 static InstrType instr_table_30_unprep[] = {
@@ -81,8 +137,10 @@ static InstrType instr_table_30_unprep[] = {
   INSTRUCTION(rldclx,         0x78000010, MDS, General        , 0),
   INSTRUCTION(rldcrx,         0x78000012, MDS, General        , 0),
 };
-static InstrType* instr_table_30 = instr_table_prep(
-    instr_table_30_unprep, XECOUNT(instr_table_30_unprep), 1, 4);
+static InstrType instr_table_30[16];
+static int instr_table_30_prepped = instr_table_prep(
+    instr_table_30, instr_table_30_unprep,
+    XECOUNT(instr_table_30_unprep), 1, 4);
 
 // Opcode = 31, index = bits 10-1 (10)
 static InstrType instr_table_31_unprep[] = {
@@ -177,35 +235,44 @@ static InstrType instr_table_31_unprep[] = {
   INSTRUCTION(lfsx,           0x7C00042E, X  , General        , 0),
   INSTRUCTION(srwx,           0x7C000430, X  , General        , 0),
   INSTRUCTION(srdx,           0x7C000436, X  , General        , 0),
+  INSTRUCTION(lvrx,           0x7C00044E, X  , General        , 0),
   INSTRUCTION(lfsux,          0x7C00046E, X  , General        , 0),
   INSTRUCTION(lswi,           0x7C0004AA, X  , General        , 0),
   INSTRUCTION(sync,           0x7C0004AC, X  , General        , 0),
   INSTRUCTION(lfdx,           0x7C0004AE, X  , General        , 0),
   INSTRUCTION(lfdux,          0x7C0004EE, X  , General        , 0),
   INSTRUCTION(stdbrx,         0x7C000528, X  , General        , 0),
+  INSTRUCTION(stvlx,          0x7C00050E, X  , General        , 0),
   INSTRUCTION(stswx,          0x7C00052A, X  , General        , 0),
   INSTRUCTION(stwbrx,         0x7C00052C, X  , General        , 0),
   INSTRUCTION(stfsx,          0x7C00052E, X  , General        , 0),
+  INSTRUCTION(stvrx,          0x7C00054E, X  , General        , 0),
   INSTRUCTION(stfsux,         0x7C00056E, X  , General        , 0),
   INSTRUCTION(stswi,          0x7C0005AA, X  , General        , 0),
   INSTRUCTION(stfdx,          0x7C0005AE, X  , General        , 0),
   INSTRUCTION(stfdux,         0x7C0005EE, X  , General        , 0),
+  INSTRUCTION(lvlxl,          0x7C00060E, X  , General        , 0),
   INSTRUCTION(lhbrx,          0x7C00062C, X  , General        , 0),
   INSTRUCTION(srawx,          0x7C000630, X  , General        , 0),
   INSTRUCTION(sradx,          0x7C000634, X  , General        , 0),
+  INSTRUCTION(lvrxl,          0x7C00064E, X  , General        , 0),
   INSTRUCTION(srawix,         0x7C000670, X  , General        , 0),
   INSTRUCTION(sradix,         0x7C000674, XS , General        , 0), // TODO
   INSTRUCTION(eieio,          0x7C0006AC, X  , General        , 0),
+  INSTRUCTION(stvlxl,         0x7C00070E, X  , General        , 0),
   INSTRUCTION(sthbrx,         0x7C00072C, X  , General        , 0),
   INSTRUCTION(extshx,         0x7C000734, X  , General        , 0),
+  INSTRUCTION(stvrxl,         0x7C00074E, X  , General        , 0),
   INSTRUCTION(extsbx,         0x7C000774, X  , General        , 0),
   INSTRUCTION(icbi,           0x7C0007AC, X  , General        , 0),
   INSTRUCTION(stfiwx,         0x7C0007AE, X  , General        , 0),
   INSTRUCTION(extswx,         0x7C0007B4, X  , General        , 0),
   INSTRUCTION(dcbz,           0x7C0007EC, X  , General        , 0), // 0x7C2007EC = DCBZ128
 };
-static InstrType* instr_table_31 = instr_table_prep(
-    instr_table_31_unprep, XECOUNT(instr_table_31_unprep), 1, 10);
+static InstrType instr_table_31[1024];
+static int instr_table_31_prepped = instr_table_prep(
+    instr_table_31, instr_table_31_unprep,
+    XECOUNT(instr_table_31_unprep), 1, 10);
 
 // Opcode = 58, index = bits 1-0 (2)
 static InstrType instr_table_58_unprep[] = {
@@ -213,8 +280,10 @@ static InstrType instr_table_58_unprep[] = {
   INSTRUCTION(ldu,            0xE8000001, DS , General        , 0),
   INSTRUCTION(lwa,            0xE8000002, DS , General        , 0),
 };
-static InstrType* instr_table_58 = instr_table_prep(
-    instr_table_58_unprep, XECOUNT(instr_table_58_unprep), 0, 1);
+static InstrType instr_table_58[4];
+static int instr_table_58_prepped = instr_table_prep(
+    instr_table_58, instr_table_58_unprep,
+    XECOUNT(instr_table_58_unprep), 0, 1);
 
 // Opcode = 59, index = bits 5-1 (5)
 static InstrType instr_table_59_unprep[] = {
@@ -229,16 +298,20 @@ static InstrType instr_table_59_unprep[] = {
   INSTRUCTION(fnmsubsx,       0xEC00003C, A  , General        , 0),
   INSTRUCTION(fnmaddsx,       0xEC00003E, A  , General        , 0),
 };
-static InstrType* instr_table_59 = instr_table_prep(
-    instr_table_59_unprep, XECOUNT(instr_table_59_unprep), 1, 5);
+static InstrType instr_table_59[32];
+static int instr_table_59_prepped = instr_table_prep(
+    instr_table_59, instr_table_59_unprep,
+    XECOUNT(instr_table_59_unprep), 1, 5);
 
 // Opcode = 62, index = bits 1-0 (2)
 static InstrType instr_table_62_unprep[] = {
   INSTRUCTION(std,            0xF8000000, DS , General        , 0),
   INSTRUCTION(stdu,           0xF8000001, DS , General        , 0),
 };
-static InstrType* instr_table_62 = instr_table_prep(
-    instr_table_62_unprep, XECOUNT(instr_table_62_unprep), 0, 1);
+static InstrType instr_table_62[4];
+static int instr_table_62_prepped = instr_table_prep(
+    instr_table_62, instr_table_62_unprep,
+    XECOUNT(instr_table_62_unprep), 0, 1);
 
 // Opcode = 63, index = bits 10-1 (10)
 static InstrType instr_table_63_unprep[] = {
@@ -272,8 +345,10 @@ static InstrType instr_table_63_unprep[] = {
   INSTRUCTION(fctidzx,        0xFC00065E, X  , General        , 0),
   INSTRUCTION(fcfidx,         0xFC00069C, X  , General        , 0),
 };
-static InstrType* instr_table_63 = instr_table_prep(
-    instr_table_63_unprep, XECOUNT(instr_table_63_unprep), 1, 10);
+static InstrType instr_table_63[1024];
+static int instr_table_63_prepped = instr_table_prep(
+    instr_table_63, instr_table_63_unprep,
+    XECOUNT(instr_table_63_unprep), 1, 10);
 
 // Main table, index = bits 31-26 (6) : (code >> 26)
 static InstrType instr_table_unprep[64] = {
@@ -324,11 +399,127 @@ static InstrType instr_table_unprep[64] = {
   INSTRUCTION(stfd,           0xD8000000, D  , General        , 0),
   INSTRUCTION(stfdu,          0xDC000000, D  , General        , 0),
 };
-static InstrType* instr_table = instr_table_prep(
-    instr_table_unprep, XECOUNT(instr_table_unprep), 26, 31);
+static InstrType instr_table[64];
+static int instr_table_prepped = instr_table_prep(
+    instr_table, instr_table_unprep,
+    XECOUNT(instr_table_unprep), 26, 31);
+
+// Primary opcode dispatch, index = bits 31-26 (6) : (code >> 26)
+// Each entry names the table the primary opcode decodes through and the bits
+// that index it, so decoding is two table loads with no branching on opcode.
+#define PRIMARY               { instr_table, 26, 0x3F }
+#define EXTENDED(table, a, b) { table, a, XEBITMASK(0, (b) - (a)) }
+static const InstrTableDispatch instr_table_dispatch[64] = {
+  // 0-7
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  EXTENDED(instr_table_4, 0, 10),
+  PRIMARY, PRIMARY, PRIMARY,
+  // 8-15
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  // 16-23
+  PRIMARY, PRIMARY, PRIMARY,
+  EXTENDED(instr_table_19, 1, 10),
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  // 24-31
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  EXTENDED(instr_table_30, 1, 4),
+  EXTENDED(instr_table_31, 1, 10),
+  // 32-39
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  // 40-47
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  // 48-55
+  PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY, PRIMARY,
+  // 56-63
+  PRIMARY, PRIMARY,
+  EXTENDED(instr_table_58, 0, 1),
+  EXTENDED(instr_table_59, 1, 5),
+  PRIMARY, PRIMARY,
+  EXTENDED(instr_table_62, 0, 1),
+  EXTENDED(instr_table_63, 1, 10),
+};
+#undef EXTENDED
+#undef PRIMARY
+
+// Instructions that are matched with (code & opcode_mask) == opcode, in order.
+// The VXR mask leaves out Rc so one entry covers both forms.
+static InstrType instr_table_scan[] = {
+  SCAN_INSTRUCTION(vsel,          0x1000002A, VA , General        , 0),
+  SCAN_INSTRUCTION(vperm,         0x1000002B, VA , General        , 0),
+  SCAN_INSTRUCTION(vsldoi,        0x1000002C, VA , General        , 0),
+  SCAN_INSTRUCTION(vmaddfp,       0x1000002E, VA , General        , 0),
+  SCAN_INSTRUCTION(vnmsubfp,      0x1000002F, VA , General        , 0),
+  SCAN_INSTRUCTION(vcmpequb,      0x10000006, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpequh,      0x10000046, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpequw,      0x10000086, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpeqfp,      0x100000C6, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgefp,      0x100001C6, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtub,      0x10000206, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtuh,      0x10000246, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtuw,      0x10000286, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtfp,      0x100002C6, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtsb,      0x10000306, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtsh,      0x10000346, VXR, General        , 0),
+  SCAN_INSTRUCTION(vcmpgtsw,      0x10000386, VXR, General        , 0),
+
+  // VMX128 loads and stores.
+  SCAN_INSTRUCTION(lvsl128,       0x10000003, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvsr128,       0x10000043, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvx128,        0x100000C3, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvx128,       0x100001C3, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvxl128,       0x100002C3, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvxl128,      0x100003C3, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvlx128,       0x10000403, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvrx128,       0x10000443, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvlx128,      0x10000503, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvrx128,      0x10000543, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvlxl128,      0x10000603, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(lvrxl128,      0x10000643, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvlxl128,     0x10000703, VX128_1, General    , 0),
+  SCAN_INSTRUCTION(stvrxl128,     0x10000743, VX128_1, General    , 0),
+
+  // VMX128 opcode 4.
+  SCAN_INSTRUCTION(vsldoi128,     0x10000010, VX128_5, General    , 0),
+
+  // VMX128 opcode 5.
+  SCAN_INSTRUCTION(vperm128,      0x14000000, VX128_2, General    , 0),
+  SCAN_INSTRUCTION(vaddfp128,     0x14000010, VX128, General      , 0),
+  SCAN_INSTRUCTION(vsubfp128,     0x14000050, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmulfp128,     0x14000090, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmaddfp128,    0x140000D0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmaddcfp128,   0x14000110, VX128, General      , 0),
+  SCAN_INSTRUCTION(vnmsubfp128,   0x14000150, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmsum3fp128,   0x14000190, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmsum4fp128,   0x140001D0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vand128,       0x14000210, VX128, General      , 0),
+  SCAN_INSTRUCTION(vandc128,      0x14000250, VX128, General      , 0),
+  SCAN_INSTRUCTION(vnor128,       0x14000290, VX128, General      , 0),
+  SCAN_INSTRUCTION(vor128,        0x140002D0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vxor128,       0x14000310, VX128, General      , 0),
+  SCAN_INSTRUCTION(vsel128,       0x14000350, VX128, General      , 0),
+
+  // VMX128 opcode 6.
+  SCAN_INSTRUCTION(vcmpeqfp128,   0x18000000, VX128_R, General    , 0),
+  SCAN_INSTRUCTION(vcmpgefp128,   0x18000080, VX128_R, General    , 0),
+  SCAN_INSTRUCTION(vcmpgtfp128,   0x18000100, VX128_R, General    , 0),
+  SCAN_INSTRUCTION(vcmpequw128,   0x18000200, VX128_R, General    , 0),
+  SCAN_INSTRUCTION(vrlw128,       0x18000050, VX128, General      , 0),
+  SCAN_INSTRUCTION(vslw128,       0x180000D0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vsraw128,      0x18000150, VX128, General      , 0),
+  SCAN_INSTRUCTION(vsrw128,       0x180001D0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmaxfp128,     0x18000280, VX128, General      , 0),
+  SCAN_INSTRUCTION(vminfp128,     0x180002C0, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmrghw128,     0x18000300, VX128, General      , 0),
+  SCAN_INSTRUCTION(vmrglw128,     0x18000340, VX128, General      , 0),
+  SCAN_INSTRUCTION(vpkd3d128,     0x18000610, VX128_4, General    , 0),
+  SCAN_INSTRUCTION(vspltw128,     0x18000730, VX128_3, General    , 0),
+  SCAN_INSTRUCTION(vspltisw128,   0x18000770, VX128_3, General    , 0),
+  SCAN_INSTRUCTION(vupkd3d128,    0x180007F0, VX128_3, General    , 0),
+};
 
 
 #undef FLAG
+#undef SCAN_INSTRUCTION
 #undef INSTRUCTION
 #undef EMPTY
 
@@ -153,6 +153,13 @@ typedef struct XECACHEALIGN64 xe_ppc_state {
   //   fpscr.value = (fpscr.value & ~0x000F8000) | v;
   // }
 
+  // Reservation made by the last lwarx/ldarx and checked by stwcx/stdcx.
+  // The value is kept as it was in memory (big endian) so that the store can
+  // compare-and-swap against it.
+  uint64_t    reserve_address;    // Guest address, or ~0 if none is held
+  uint64_t    reserve_value;      // Value loaded by the reservation
+  uint32_t    reserve_version;    // Line version, with --reservation_table
+
   // Runtime-specific data pointer. Used on callbacks to get access to the
   // current runtime and its data.
   uint8_t* membase;
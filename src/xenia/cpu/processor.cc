@@ -10,15 +10,21 @@
 #include <xenia/cpu/processor.h>
 
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/ExecutionEngine/Interpreter.h>
 #include <llvm/ExecutionEngine/JIT.h>
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/MutexGuard.h>
 #include <llvm/Support/TargetSelect.h>
 
+#include <xenia/cpu/cpu-private.h>
+#include <xenia/cpu/fault_handler.h>
 #include <xenia/cpu/codegen/emit.h>
+#include <xenia/cpu/interpreter/interpret.h>
 
 
 using namespace llvm;
@@ -47,9 +53,13 @@ namespace {
 
     // TODO(benvanik): only do this once
     codegen::RegisterEmitCategoryALU();
+    codegen::RegisterEmitCategoryAltivec();
     codegen::RegisterEmitCategoryControl();
     codegen::RegisterEmitCategoryFPU();
     codegen::RegisterEmitCategoryMemory();
+    interpreter::RegisterInterpretCategoryALU();
+    interpreter::RegisterInterpretCategoryControl();
+    interpreter::RegisterInterpretCategoryMemory();
 
     atexit(CleanupOnShutdown);
   }
@@ -63,19 +73,38 @@ namespace {
 Processor::Processor(xe_pal_ref pal, xe_memory_ref memory) {
   pal_ = xe_pal_retain(pal);
   memory_ = xe_memory_retain(memory);
+  execute_trampoline_ = NULL;
+  fault_handler_ = NULL;
+  fns_mutex_ = xe_mutex_alloc(0);
+  modules_ = new ModuleList();
 
   InitializeIfNeeded();
 }
 
 Processor::~Processor() {
   // Cleanup all modules.
-  for (std::vector<ExecModule*>::iterator it = modules_.begin();
-       it != modules_.end(); ++it) {
+  for (ModuleList::iterator it = modules_->begin(); it != modules_->end();
+       ++it) {
+    delete *it;
+  }
+  delete modules_;
+  for (std::vector<ModuleList*>::iterator it = old_module_lists_.begin();
+       it != old_module_lists_.end(); ++it) {
     delete *it;
   }
 
+  for (std::tr1::unordered_map<uint32_t, IndirectionEntry*>::iterator it =
+       indirection_entries_.begin(); it != indirection_entries_.end(); ++it) {
+    delete it->second;
+  }
+
+  if (fault_handler_) {
+    engine_->UnregisterJITEventListener(fault_handler_);
+  }
   engine_.reset();
+  delete fault_handler_;
 
+  xe_mutex_free(fns_mutex_);
   xe_memory_release(memory_);
   xe_pal_release(pal_);
 }
@@ -91,6 +120,11 @@ xe_memory_ref Processor::memory() {
 int Processor::Setup() {
   XEASSERTNULL(engine_);
 
+  if (FLAGS_tiered_compilation && FLAGS_tier_up_threshold <= 0) {
+    XELOGE("--tier_up_threshold must be greater than 0");
+    return 1;
+  }
+
   dummy_context_ = auto_ptr<LLVMContext>(new LLVMContext());
   Module* dummy_module = new Module("dummy", *dummy_context_.get());
 
@@ -105,14 +139,93 @@ int Processor::Setup() {
   builder.setAllocateGVsWithCode(false);
   //builder.setUseMCJIT(true);
 
+  // Only let the backend use the extensions the emitters were told about, so
+  // that the lowering they pick is the one that runs.
+  uint32_t features = FLAGS_use_host_cpu_features ?
+      xe_pal_get_processor_features(pal_) : 0;
+  std::vector<std::string> mattrs;
+  mattrs.push_back(
+      (features & kXEPALProcessorFeatureSSSE3) ? "+ssse3" : "-ssse3");
+  mattrs.push_back(
+      (features & kXEPALProcessorFeatureSSE41) ? "+sse41" : "-sse41");
+  mattrs.push_back(
+      (features & kXEPALProcessorFeatureAVX) ? "+avx" : "-avx");
+  mattrs.push_back(
+      (features & kXEPALProcessorFeatureF16C) ? "+f16c" : "-f16c");
+  builder.setMAttrs(mattrs);
+
   engine_ = shared_ptr<ExecutionEngine>(builder.create());
   if (!engine_) {
     return 1;
   }
 
+  // Generated code does not check memory accesses, so faults are caught here
+  // and mapped back to the guest instruction using the code the JIT emits.
+  fault_handler_ = new FaultHandler(memory_);
+  engine_->RegisterJITEventListener(fault_handler_);
+  if (fault_handler_->Install()) {
+    XELOGE("Unable to install fault handler");
+    return 1;
+  }
+  if (FLAGS_protect_code) {
+    fault_handler_->SetCodeWriteCallback(CodeWriteThunk, this);
+  }
+
+  if (GenerateTrampoline(dummy_module)) {
+    return 1;
+  }
+
   return 0;
 }
 
+int Processor::GenerateTrampoline(Module* module) {
+  LLVMContext& context = module->getContext();
+  Type* int8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+
+  // void xe_execute_trampoline(i8* fn_ptr, i8* state, i64 lr)
+  // Calls into generated code from the host. The stack is realigned on entry
+  // as we may be called from any host thread (or debugger) with whatever
+  // alignment it happens to have.
+  std::vector<Type*> args;
+  args.push_back(int8PtrTy);
+  args.push_back(int8PtrTy);
+  args.push_back(Type::getInt64Ty(context));
+  FunctionType* ft = FunctionType::get(
+      Type::getVoidTy(context), args, false);
+  Function* f = Function::Create(
+      ft, Function::ExternalLinkage, "xe_execute_trampoline", module);
+  f->addAttributes(AttributeSet::FunctionIndex, AttributeSet::get(
+      context, AttributeSet::FunctionIndex,
+      AttrBuilder().addStackAlignmentAttr(16)));
+  f->setDoesNotThrow();
+
+  Function::arg_iterator fn_args = f->arg_begin();
+  Value* fn_ptr = fn_args++;
+  fn_ptr->setName("fn_ptr");
+  Value* state = fn_args++;
+  state->setName("state");
+  Value* lr = fn_args++;
+  lr->setName("lr");
+
+  // Generated functions are void(i8* state, i64 lr).
+  std::vector<Type*> fn_args_types;
+  fn_args_types.push_back(int8PtrTy);
+  fn_args_types.push_back(Type::getInt64Ty(context));
+  FunctionType* fn_type = FunctionType::get(
+      Type::getVoidTy(context), fn_args_types, false);
+
+  BasicBlock* block = BasicBlock::Create(context, "entry", f);
+  IRBuilder<> b(block);
+  CallInst* call = b.CreateCall2(
+      b.CreateBitCast(fn_ptr, PointerType::getUnqual(fn_type)),
+      state, lr);
+  call->setCallingConv(CallingConv::Fast);
+  b.CreateRetVoid();
+
+  execute_trampoline_ = (ExecuteTrampoline)engine_->getPointerToFunction(f);
+  return execute_trampoline_ ? 0 : 1;
+}
+
 int Processor::LoadBinary(const xechar_t* path, uint32_t start_address,
                           shared_ptr<ExportResolver> export_resolver) {
   ExecModule* exec_module = NULL;
@@ -139,7 +252,8 @@ int Processor::LoadBinary(const xechar_t* path, uint32_t start_address,
   XEEXPECTTRUE(xestrnarrow(path_a, XECOUNT(path_a), path));
 
   exec_module = new ExecModule(
-      memory_, export_resolver, name_a, path_a, engine_);
+      pal_, memory_, export_resolver, name_a, path_a, engine_,
+      fault_handler_);
 
   if (exec_module->PrepareRawBinary(start_address,
                                     start_address + (uint32_t)length)) {
@@ -147,8 +261,7 @@ int Processor::LoadBinary(const xechar_t* path, uint32_t start_address,
     return 1;
   }
 
-  exec_module->AddFunctionsToMap(all_fns_);
-  modules_.push_back(exec_module);
+  AddModule(exec_module);
 
   exec_module->Dump();
 
@@ -165,20 +278,49 @@ int Processor::PrepareModule(const char* name, const char* path,
                              xe_xex2_ref xex,
                              shared_ptr<ExportResolver> export_resolver) {
   ExecModule* exec_module = new ExecModule(
-      memory_, export_resolver, name, path,
-      engine_);
+      pal_, memory_, export_resolver, name, path,
+      engine_, fault_handler_);
 
   if (exec_module->PrepareXex(xex)) {
     delete exec_module;
     return 1;
   }
 
-  exec_module->AddFunctionsToMap(all_fns_);
-  modules_.push_back(exec_module);
+  AddModule(exec_module);
 
   return 0;
 }
 
+void Processor::AddModule(ExecModule* exec_module) {
+  xe_mutex_lock(fns_mutex_);
+  exec_module->AddFunctionsToMap(all_fns_);
+
+  ModuleList* old_modules = modules_;
+  ModuleList* modules = new ModuleList(*old_modules);
+  modules->push_back(exec_module);
+  // The swap is a full barrier, so the new list is complete before anyone
+  // can see it.
+  XEIGNORE(xe_atomic_cas_64((int64_t)(intptr_t)old_modules,
+                            (int64_t)(intptr_t)modules,
+                            (volatile int64_t*)&modules_));
+  old_module_lists_.push_back(old_modules);
+  xe_mutex_unlock(fns_mutex_);
+}
+
+void Processor::CodeWriteThunk(void* data, uint32_t address,
+                               uint32_t length) {
+  ((Processor*)data)->InvalidateCode(address, length);
+}
+
+void Processor::InvalidateCode(uint32_t address, uint32_t length) {
+  XELOGCPU("Code written at %.8X-%.8X", address, address + length);
+  ModuleList* modules = modules_;
+  for (ModuleList::iterator it = modules->begin(); it != modules->end();
+       ++it) {
+    (*it)->InvalidateCode(address, length);
+  }
+}
+
 uint32_t Processor::CreateCallback(void (*callback)(void* data), void* data) {
   // TODO(benvanik): implement callback creation.
   return 0;
@@ -196,13 +338,6 @@ void Processor::DeallocThread(ThreadState* thread_state) {
 }
 
 int Processor::Execute(ThreadState* thread_state, uint32_t address) {
-  // Find the function to execute.
-  Function* f = GetFunction(address);
-  if (!f) {
-    XELOGCPU("Failed to find function %.8X to execute.", address);
-    return 1;
-  }
-
   xe_ppc_state_t* ppc_state = thread_state->ppc_state();
 
   // This could be set to anything to give us a unique identifier to track
@@ -212,24 +347,7 @@ int Processor::Execute(ThreadState* thread_state, uint32_t address) {
   // Setup registers.
   ppc_state->lr = lr;
 
-  // Args:
-  // - i8* state
-  // - i64 lr
-  std::vector<GenericValue> args;
-  args.push_back(PTOGV(ppc_state));
-  GenericValue lr_arg;
-  lr_arg.IntVal = APInt(64, lr);
-  args.push_back(lr_arg);
-  GenericValue ret = engine_->runFunction(f, args);
-  // return (uint32_t)ret.IntVal.getSExtValue();
-
-  // Faster, somewhat.
-  // Messes with the stack in such a way as to cause Xcode to behave oddly.
-  // typedef void (*fnptr)(xe_ppc_state_t*, uint64_t);
-  // fnptr ptr = (fnptr)engine_->getPointerToFunction(f);
-  // ptr(ppc_state, lr);
-
-  return 0;
+  return CallFunction(ppc_state, address, lr);
 }
 
 uint64_t Processor::Execute(ThreadState* thread_state, uint32_t address,
@@ -242,7 +360,98 @@ uint64_t Processor::Execute(ThreadState* thread_state, uint32_t address,
   return ppc_state->r[3];
 }
 
+int Processor::CallFunction(xe_ppc_state_t* state, uint32_t address,
+                            uint64_t lr) {
+  // Find the native code for the function to execute, generating it if
+  // needed.
+  void* fn_ptr = GetFunctionPointer(address);
+  if (!fn_ptr) {
+    XELOGCPU("Failed to find function %.8X to execute.", address);
+    return 1;
+  }
+
+  // Jump into the function through the trampoline.
+  execute_trampoline_(fn_ptr, state, lr);
+
+  return 0;
+}
+
+IndirectionEntry* Processor::GetIndirectionEntry(uint32_t address) {
+  // This is the slow path of indirect branches - generated code caches the
+  // result at each call site.
+  void* fn_ptr = GetFunctionPointer(address);
+  if (!fn_ptr) {
+    return NULL;
+  }
+
+  IndirectionEntry* entry = NULL;
+  xe_mutex_lock(fns_mutex_);
+  std::tr1::unordered_map<uint32_t, IndirectionEntry*>::iterator it =
+      indirection_entries_.find(address);
+  if (it != indirection_entries_.end()) {
+    entry = it->second;
+  } else {
+    entry = new IndirectionEntry();
+    entry->address = address;
+    entry->fn_ptr = fn_ptr;
+    indirection_entries_.insert(
+        std::pair<uint32_t, IndirectionEntry*>(address, entry));
+  }
+  xe_mutex_unlock(fns_mutex_);
+  return entry;
+}
+
+void* Processor::GetFunctionPointer(uint32_t address) {
+  // Functions in a module code range are looked up in its function table,
+  // which needs no lock.
+  ModuleList* modules = modules_;
+  ExecModule* exec_module = NULL;
+  for (ModuleList::iterator it = modules->begin(); it != modules->end();
+       ++it) {
+    if ((*it)->ContainsCode(address)) {
+      exec_module = *it;
+      break;
+    }
+  }
+  if (exec_module) {
+    void* fn_ptr = exec_module->GetFunctionPointer(address);
+    if (fn_ptr) {
+      return fn_ptr;
+    }
+  }
+
+  // Not compiled yet (or outside of any code range).
+  xe_mutex_lock(fns_mutex_);
+  Function* f = GetFunction(address);
+  if (!f) {
+    // Not found during analysis (callbacks, vtables, etc). Have the module
+    // that contains the address analyze and generate it now.
+    for (ModuleList::iterator module_it = modules->begin();
+         module_it != modules->end(); ++module_it) {
+      f = (*module_it)->AddRuntimeFunction(address);
+      if (f) {
+        XELOGCPU("Added function %.8X found at runtime", address);
+        all_fns_.insert(std::pair<uint32_t, Function*>(address, f));
+        break;
+      }
+    }
+  }
+  // The engine lock guards the JIT and all IR. Module generators hold it
+  // while they change code, so compiling here can't race with them.
+  void* fn_ptr = NULL;
+  if (f) {
+    MutexGuard jit_lock(engine_->lock);
+    fn_ptr = engine_->getPointerToFunction(f);
+  }
+  if (fn_ptr && exec_module) {
+    exec_module->SetFunctionPointer(address, fn_ptr);
+  }
+  xe_mutex_unlock(fns_mutex_);
+  return fn_ptr;
+}
+
 Function* Processor::GetFunction(uint32_t address) {
+  // NOTE: fns_mutex_ must be held.
   FunctionMap::iterator it = all_fns_.find(address);
   if (it != all_fns_.end()) {
     return it->second;
@@ -23,6 +23,7 @@
 namespace llvm {
   class ExecutionEngine;
   class Function;
+  class Module;
 }
 
 
@@ -30,6 +31,18 @@ namespace xe {
 namespace cpu {
 
 
+class FaultHandler;
+
+// The resolved target of an indirect branch.
+// Generated code caches pointers to these at each indirect call site, so they
+// are never freed while the processor is alive.
+class IndirectionEntry {
+public:
+  uint64_t  address;
+  void*     fn_ptr;
+};
+
+
 class Processor {
 public:
   Processor(xe_pal_ref pal, xe_memory_ref memory);
@@ -53,18 +66,44 @@ public:
   int Execute(ThreadState* thread_state, uint32_t address);
   uint64_t Execute(ThreadState* thread_state, uint32_t address, uint64_t arg0);
 
+  // Calls the function at the given address on the current thread, as a guest
+  // call that returns to lr would.
+  int CallFunction(xe_ppc_state_t* state, uint32_t address, uint64_t lr);
+
+  IndirectionEntry* GetIndirectionEntry(uint32_t address);
+
+  // Regenerates any functions overlapping the given guest range on their next
+  // call. Called by the fault handler when guest code is written to.
+  void InvalidateCode(uint32_t address, uint32_t length);
+
 private:
+  typedef void (*ExecuteTrampoline)(void* fn_ptr, xe_ppc_state_t* state,
+                                    uint64_t lr);
+
+  static void CodeWriteThunk(void* data, uint32_t address, uint32_t length);
+  int GenerateTrampoline(llvm::Module* module);
+  void AddModule(ExecModule* exec_module);
+  void* GetFunctionPointer(uint32_t address);
   llvm::Function* GetFunction(uint32_t address);
 
   xe_pal_ref              pal_;
   xe_memory_ref           memory_;
   shared_ptr<llvm::ExecutionEngine> engine_;
+  ExecuteTrampoline       execute_trampoline_;
+  FaultHandler*           fault_handler_;
 
   auto_ptr<llvm::LLVMContext> dummy_context_;
 
-  std::vector<ExecModule*> modules_;
+  // Function lookups walk the modules without locking, so the list is
+  // replaced instead of changed when a module is added. Old lists are kept
+  // until shutdown as there are only ever a handful of modules.
+  typedef std::vector<ExecModule*> ModuleList;
+  ModuleList* volatile      modules_;
+  std::vector<ModuleList*>  old_module_lists_;
 
-  FunctionMap all_fns_;
+  xe_mutex_t*   fns_mutex_;
+  FunctionMap   all_fns_;
+  std::tr1::unordered_map<uint32_t, IndirectionEntry*> indirection_entries_;
 };
 
 
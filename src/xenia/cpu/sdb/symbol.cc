@@ -57,7 +57,8 @@ FunctionSymbol::FunctionSymbol() :
     Symbol(Function),
     start_address(0), end_address(0),
     type(Unknown), flags(0),
-    kernel_export(0), ee(0) {
+    kernel_export(0), ee(0),
+    arg_gprs(0), arg_fprs(0), return_gprs(0), return_fprs(0) {
 }
 
 FunctionSymbol::~FunctionSymbol() {
@@ -65,6 +66,10 @@ FunctionSymbol::~FunctionSymbol() {
        it != blocks.end(); ++it) {
     delete it->second;
   }
+  for (std::vector<FunctionBlock*>::iterator it = retired_blocks.begin();
+       it != retired_blocks.end(); ++it) {
+    delete *it;
+  }
 }
 
 FunctionBlock* FunctionSymbol::GetBlock(uint32_t address) {
@@ -93,6 +98,13 @@ FunctionBlock* FunctionSymbol::SplitBlock(uint32_t address) {
       new_block->outgoing_type = block->outgoing_type;
       new_block->outgoing_address = block->outgoing_address;
       new_block->outgoing_block = block->outgoing_block;
+      new_block->jump_table.swap(block->jump_table);
+      size_t split_index = (address - block->start_address) / 4;
+      if (split_index < block->instrs.size()) {
+        new_block->instrs.assign(block->instrs.begin() + split_index,
+                                 block->instrs.end());
+        block->instrs.resize(split_index);
+      }
       blocks.insert(std::pair<uint32_t, FunctionBlock*>(address, new_block));
       // Patch up old block.
       block->end_address = address - 4;
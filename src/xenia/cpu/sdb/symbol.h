@@ -15,6 +15,7 @@
 #include <map>
 #include <vector>
 
+#include <xenia/cpu/ppc/instr.h>
 #include <xenia/kernel/export.h>
 
 
@@ -64,6 +65,14 @@ protected:
 
 class ExceptionEntrySymbol;
 
+// An instruction as decoded during analysis along with the registers it
+// accesses, so that later passes never need to decode it again.
+class FunctionInstr {
+public:
+  ppc::InstrData        i;
+  ppc::InstrAccessMask  access_mask;
+};
+
 class FunctionBlock {
 public:
   enum TargetType {
@@ -73,6 +82,7 @@ public:
     kTargetLR       = 3,
     kTargetCTR      = 4,
     kTargetNone     = 5,
+    kTargetJumpTable = 6,   // bctr through a recovered switch table.
   };
 
   FunctionBlock();
@@ -88,6 +98,12 @@ public:
     FunctionSymbol* outgoing_function;
     FunctionBlock*  outgoing_block;
   };
+
+  // Case targets of a kTargetJumpTable block, in table order.
+  std::vector<uint32_t> jump_table;
+
+  // One entry for each instruction from start_address to end_address.
+  std::vector<FunctionInstr> instrs;
 };
 
 class FunctionSymbol : public Symbol {
@@ -100,6 +116,12 @@ public:
   enum Flags {
     kFlagSaveGprLr  = 1 << 1,
     kFlagRestGprLr  = 1 << 2,
+    kFlagLeaf       = 1 << 3,   // Never calls or branches out.
+    // CRT routines matched by signature. Calls are replaced with native code.
+    kFlagMemcpy     = 1 << 4,
+    kFlagMemset     = 1 << 5,
+    kFlagStrlen     = 1 << 6,
+    kFlagStrcmp     = 1 << 7,
   };
 
   FunctionSymbol();
@@ -116,11 +138,22 @@ public:
   kernel::KernelExport* kernel_export;
   ExceptionEntrySymbol* ee;
 
+  // Registers that carry arguments into and results out of the function.
+  // Bit n is set for rn/fn. These are conservative guesses from the register
+  // analysis and only used as a hint for generating faster calls.
+  uint32_t      arg_gprs;
+  uint32_t      arg_fprs;
+  uint32_t      return_gprs;
+  uint32_t      return_fprs;
+
   std::vector<FunctionCall*> incoming_calls;
   std::vector<FunctionCall*> outgoing_calls;
   std::vector<VariableAccess*> variable_accesses;
 
   std::map<uint32_t, FunctionBlock*> blocks;
+  // Blocks replaced by reanalysis. An interpreter may still be running them,
+  // so they live as long as the function.
+  std::vector<FunctionBlock*> retired_blocks;
 };
 
 class VariableSymbol : public Symbol {
@@ -79,6 +79,14 @@ int SymbolDatabase::Analyze() {
     }
   } while (needs_another_pass);
 
+  // Now that the call graph is complete figure out how functions pass values
+  // to each other.
+  AnalyzeRegisterUsage();
+
+  return 0;
+}
+
+int SymbolDatabase::AnalyzeImports() {
   return 0;
 }
 
@@ -123,6 +131,43 @@ FunctionSymbol* SymbolDatabase::GetOrInsertFunction(uint32_t address) {
   return fn;
 }
 
+FunctionSymbol* SymbolDatabase::AnalyzeNewFunction(uint32_t address) {
+  // Used for functions found at runtime, such as the targets of indirect
+  // branches. The function and anything new it calls are analyzed and linked
+  // up just like in the initial analysis.
+  if (!GetOrInsertFunction(address) || CompleteNewFunctionGraphs(address)) {
+    return NULL;
+  }
+
+  // The analysis may have moved the function if it started with padding.
+  return GetFunction(address);
+}
+
+int SymbolDatabase::ReanalyzeFunction(FunctionSymbol* fn) {
+  // Used when the code of a function has been changed since it was analyzed.
+  // The blocks are rebuilt from the current code, keeping the address range.
+  // Anything new it calls is picked up like above. The old blocks are only
+  // retired, as an interpreter may still be running them.
+  if (fn->type != FunctionSymbol::User ||
+      !XEGETUINT32LE(xe_memory_addr(memory_, fn->start_address))) {
+    // Analysis would drop a function starting with padding, and the caller
+    // still holds on to it.
+    return 1;
+  }
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    fn->retired_blocks.push_back(it->second);
+  }
+  fn->blocks.clear();
+  if (AnalyzeFunction(fn) ||
+      CompleteNewFunctionGraphs(fn->start_address)) {
+    return 1;
+  }
+
+  AnalyzeFunctionRegisters(fn);
+  return 0;
+}
+
 VariableSymbol* SymbolDatabase::GetOrInsertVariable(uint32_t address) {
   VariableSymbol* var = GetVariable(address);
   if (var) {
@@ -250,6 +295,7 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
   FunctionBlock* block = NULL;
   uint32_t furthest_target = fn->start_address;
   uint32_t addr = fn->start_address;
+  uint32_t skip_to = 0;
   while (true) {
     i.code = XEGETUINT32BE(p + addr);
     i.type = ppc::GetInstrType(i.code);
@@ -293,8 +339,24 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
       ends_block = true;
     } else if (i.code == 0x4E800420) {
       // bctr -- unconditional branch to CTR.
-      // This is generally a jump to a function pointer (non-return).
-      block->outgoing_type = FunctionBlock::kTargetCTR;
+      // This is generally a jump to a function pointer (non-return), unless
+      // it is a switch statement going through a jump table.
+      uint32_t table_address = 0;
+      if (!FindJumpTable(fn, addr, block->jump_table, &table_address)) {
+        XELOGSDB("bctr %.8X through jump table %.8X (%d cases)",
+                 addr, table_address, (uint32_t)block->jump_table.size());
+        block->outgoing_type = FunctionBlock::kTargetJumpTable;
+        for (std::vector<uint32_t>::iterator it = block->jump_table.begin();
+             it != block->jump_table.end(); ++it) {
+          furthest_target = MAX(furthest_target, *it);
+        }
+        // Tables placed right after the bctr are data, so skip over them.
+        if (table_address == addr + 4) {
+          skip_to = table_address + (uint32_t)block->jump_table.size() * 4;
+        }
+      } else {
+        block->outgoing_type = FunctionBlock::kTargetCTR;
+      }
       if (furthest_target > addr) {
         // Remaining targets within function, not end.
         XELOGSDB("ignoring bctr %.8X (branch to %.8X)", addr,
@@ -384,6 +446,27 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
       ends_block = true;
     }
 
+    // Keep the decoded instruction (and the registers it accesses) around for
+    // the later passes.
+    // We really need to know the registers modified, so die if we've been
+    // lazy and haven't implemented the disassemble method right.
+    FunctionInstr instr;
+    instr.i = i;
+    if (i.type && i.type->disassemble) {
+      InstrDisasm d;
+      int result_code = i.type->disassemble(i, d);
+      if (!result_code) {
+        result_code = instr.access_mask.Pack(d.access_bits);
+      }
+      XEASSERTZERO(result_code);
+      if (result_code) {
+        XELOGE("Unable to disassemble %.8X %.8X %s",
+               addr, i.code, i.type->name);
+        return result_code;
+      }
+    }
+    block->instrs.push_back(instr);
+
     block->end_address = addr;
     if (ends_block) {
       // This instruction is the end of a basic block.
@@ -397,6 +480,10 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
     }
 
     addr += 4;
+    if (skip_to) {
+      addr = skip_to;
+      skip_to = 0;
+    }
     if (fn->end_address && addr > fn->end_address) {
       // Hmm....
       XELOGSDB("Ran over function bounds! %.8X-%.8X",
@@ -469,6 +556,61 @@ int SymbolDatabase::CompleteFunctionGraph(FunctionSymbol* fn) {
     }
   }
 
+  // Make sure every case of a jump table starts a block. If any of them
+  // ended up outside of the function the table was misidentified.
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    if (block->outgoing_type != FunctionBlock::kTargetJumpTable) {
+      continue;
+    }
+    bool valid = true;
+    for (std::vector<uint32_t>::iterator target_it =
+         block->jump_table.begin(); target_it != block->jump_table.end();
+         ++target_it) {
+      if (*target_it > fn->end_address ||
+          (!fn->GetBlock(*target_it) && !fn->SplitBlock(*target_it))) {
+        valid = false;
+        break;
+      }
+    }
+    if (!valid) {
+      XELOGSDB("jump table at %.8X leaves function %.8X; using ctr",
+               block->end_address, fn->start_address);
+      block->outgoing_type = FunctionBlock::kTargetCTR;
+      block->jump_table.clear();
+    }
+  }
+
+  // Leaf functions only ever leave by returning. Anything we don't
+  // understand may go somewhere else.
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  bool is_leaf = fn->blocks.size() > 0;
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    switch (block->outgoing_type) {
+      case FunctionBlock::kTargetBlock:
+      case FunctionBlock::kTargetJumpTable:
+      case FunctionBlock::kTargetNone:
+        break;
+      case FunctionBlock::kTargetLR:
+        // bclrl calls whatever is in LR.
+        if (XEGETUINT32BE(p + block->end_address) & 1) {
+          is_leaf = false;
+        }
+        break;
+      default:
+        is_leaf = false;
+        break;
+    }
+  }
+  if (is_leaf) {
+    fn->flags |= FunctionSymbol::kFlagLeaf;
+  } else {
+    fn->flags &= ~FunctionSymbol::kFlagLeaf;
+  }
+
   if (new_fns.size()) {
     XELOGW("Repeat analysis required to find %d new functions",
            (uint32_t)new_fns.size());
@@ -482,6 +624,202 @@ int SymbolDatabase::CompleteFunctionGraph(FunctionSymbol* fn) {
   return 0;
 }
 
+namespace {
+
+// r3-r10 and f1-f13 carry arguments and r3/f1 carry results. Calls may
+// clobber any of the volatile registers (r0, r3-r12, f0-f13).
+const uint32_t kArgGprs       = 0x000007F8;
+const uint32_t kArgFprs       = 0x00003FFE;
+const uint32_t kVolatileGprs  = 0x00001FF9;
+const uint32_t kVolatileFprs  = 0x00003FFF;
+
+class BlockRegisterUsage {
+public:
+  BlockRegisterUsage() :
+      gpr_uses(0), gpr_defs(0), fpr_uses(0), fpr_defs(0),
+      gpr_live_in(0), fpr_live_in(0) {}
+
+  uint32_t  gpr_uses;
+  uint32_t  gpr_defs;
+  uint32_t  fpr_uses;
+  uint32_t  fpr_defs;
+  uint32_t  gpr_live_in;
+  uint32_t  fpr_live_in;
+  std::vector<uint32_t> successors;
+};
+
+}
+
+void SymbolDatabase::AnalyzeRegisterUsage() {
+  // The arguments of a function depend on the arguments of the functions it
+  // calls, so keep going until nothing changes. The masks only ever grow so
+  // this always ends.
+  std::vector<FunctionSymbol*> functions;
+  if (GetAllFunctions(functions)) {
+    return;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::vector<FunctionSymbol*>::iterator it = functions.begin();
+         it != functions.end(); ++it) {
+      FunctionSymbol* fn = *it;
+      if (fn->type == FunctionSymbol::User && AnalyzeFunctionRegisters(fn)) {
+        changed = true;
+      }
+    }
+  }
+}
+
+bool SymbolDatabase::AnalyzeFunctionRegisters(FunctionSymbol* fn) {
+  // Arguments are the argument registers that are live on entry to the
+  // function. Results are guessed from the registers written anywhere in the
+  // function (including by calls). Both only need to be good guesses, as the
+  // state is still updated on every call and return.
+  if (!fn->blocks.size()) {
+    return false;
+  }
+
+  std::map<uint32_t, BlockRegisterUsage> usages;
+  uint32_t all_gpr_defs = 0;
+  uint32_t all_fpr_defs = 0;
+  uint32_t tail_gprs = 0;
+  uint32_t tail_fprs = 0;
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    BlockRegisterUsage& usage = usages[block->start_address];
+
+    for (std::vector<FunctionInstr>::iterator instr_it =
+         block->instrs.begin(); instr_it != block->instrs.end(); ++instr_it) {
+      InstrAccessMask& access_mask = instr_it->access_mask;
+      usage.gpr_uses |= access_mask.gpr_reads & ~usage.gpr_defs;
+      usage.fpr_uses |= access_mask.fpr_reads & ~usage.fpr_defs;
+      usage.gpr_defs |= access_mask.gpr_writes;
+      usage.fpr_defs |= access_mask.fpr_writes;
+    }
+
+    // Figure out how the block ends from its last instruction.
+    InstrData i;
+    i.code = block->instrs.size() ? block->instrs.back().i.code : 0;
+    uint32_t opcode = i.code >> 26;
+    uint32_t xo = (i.code >> 1) & 0x3FF;
+    bool is_branch = opcode == 16 || opcode == 18 ||
+        (opcode == 19 && (xo == 16 || xo == 528));
+    bool lk = is_branch && (i.code & 1);
+    bool unconditional = opcode == 18 || (i.B.BO & 0x14) == 0x14;
+    bool falls_through = !is_branch || lk || !unconditional;
+
+    uint32_t call_gprs = 0;
+    uint32_t call_fprs = 0;
+    switch (block->outgoing_type) {
+    case FunctionBlock::kTargetFunction:
+      {
+        FunctionSymbol* target = block->outgoing_function;
+        bool is_user = target && target->type == FunctionSymbol::User;
+        call_gprs = is_user ? target->arg_gprs : kArgGprs;
+        call_fprs = is_user ? target->arg_fprs : kArgFprs;
+        if (!lk) {
+          // Tail call - whatever the target returns we return.
+          tail_gprs |= is_user ? target->return_gprs : (1 << 3);
+          tail_fprs |= is_user ? target->return_fprs : 0;
+        }
+      }
+      break;
+    case FunctionBlock::kTargetBlock:
+      if (fn->blocks.count(block->outgoing_address)) {
+        usage.successors.push_back(block->outgoing_address);
+      }
+      break;
+    case FunctionBlock::kTargetJumpTable:
+      for (std::vector<uint32_t>::iterator target_it =
+           block->jump_table.begin(); target_it != block->jump_table.end();
+           ++target_it) {
+        if (fn->blocks.count(*target_it)) {
+          usage.successors.push_back(*target_it);
+        }
+      }
+      break;
+    case FunctionBlock::kTargetCTR:
+      // Either a jump table to any block or a call/tail call we know nothing
+      // about.
+      if (!lk) {
+        for (std::map<uint32_t, FunctionBlock*>::iterator target_it =
+             fn->blocks.begin(); target_it != fn->blocks.end(); ++target_it) {
+          usage.successors.push_back(target_it->first);
+        }
+      }
+      call_gprs = kArgGprs;
+      call_fprs = kArgFprs;
+      break;
+    case FunctionBlock::kTargetLR:
+      if (lk) {
+        call_gprs = kArgGprs;
+        call_fprs = kArgFprs;
+      }
+      break;
+    default:
+      break;
+    }
+    usage.gpr_uses |= call_gprs & ~usage.gpr_defs;
+    usage.fpr_uses |= call_fprs & ~usage.fpr_defs;
+    if (lk) {
+      usage.gpr_defs |= kVolatileGprs;
+      usage.fpr_defs |= kVolatileFprs;
+    }
+    all_gpr_defs |= usage.gpr_defs;
+    all_fpr_defs |= usage.fpr_defs;
+
+    std::map<uint32_t, FunctionBlock*>::iterator next_it = it;
+    ++next_it;
+    if (falls_through && next_it != fn->blocks.end()) {
+      usage.successors.push_back(next_it->first);
+    }
+  }
+
+  // Backward liveness over the blocks.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::map<uint32_t, BlockRegisterUsage>::reverse_iterator it =
+         usages.rbegin(); it != usages.rend(); ++it) {
+      BlockRegisterUsage& usage = it->second;
+      uint32_t gpr_live_out = 0;
+      uint32_t fpr_live_out = 0;
+      for (std::vector<uint32_t>::iterator succ_it = usage.successors.begin();
+           succ_it != usage.successors.end(); ++succ_it) {
+        BlockRegisterUsage& succ = usages[*succ_it];
+        gpr_live_out |= succ.gpr_live_in;
+        fpr_live_out |= succ.fpr_live_in;
+      }
+      uint32_t gpr_live_in = usage.gpr_uses | (gpr_live_out & ~usage.gpr_defs);
+      uint32_t fpr_live_in = usage.fpr_uses | (fpr_live_out & ~usage.fpr_defs);
+      if (gpr_live_in != usage.gpr_live_in ||
+          fpr_live_in != usage.fpr_live_in) {
+        usage.gpr_live_in = gpr_live_in;
+        usage.fpr_live_in = fpr_live_in;
+        changed = true;
+      }
+    }
+  }
+
+  BlockRegisterUsage& entry = usages[fn->blocks.begin()->first];
+  uint32_t arg_gprs = fn->arg_gprs | (entry.gpr_live_in & kArgGprs);
+  uint32_t arg_fprs = fn->arg_fprs | (entry.fpr_live_in & kArgFprs);
+  uint32_t return_gprs =
+      fn->return_gprs | tail_gprs | (all_gpr_defs & (1 << 3));
+  uint32_t return_fprs =
+      fn->return_fprs | tail_fprs | (all_fpr_defs & (1 << 1));
+  bool changed_usage =
+      arg_gprs != fn->arg_gprs || arg_fprs != fn->arg_fprs ||
+      return_gprs != fn->return_gprs || return_fprs != fn->return_fprs;
+  fn->arg_gprs = arg_gprs;
+  fn->arg_fprs = arg_fprs;
+  fn->return_gprs = return_gprs;
+  fn->return_fprs = return_fprs;
+  return changed_usage;
+}
+
 namespace {
 typedef struct {
   uint32_t start_address;
@@ -578,10 +916,43 @@ bool SymbolDatabase::FillHoles() {
   return any_functions_added;
 }
 
+int SymbolDatabase::CompleteNewFunctionGraphs(uint32_t address) {
+  // Links up the function at the address along with everything analyzed on
+  // the way, until nothing new turns up. Functions analyzed before are
+  // already complete and are left alone, so this doesn't scale with the size
+  // of the database. Functions can move or go away while they are analyzed,
+  // so they are tracked by address.
+  std::vector<uint32_t> addresses;
+  addresses.push_back(address);
+  do {
+    if (FlushQueue(addresses)) {
+      return 1;
+    }
+    std::vector<uint32_t> pending;
+    pending.swap(addresses);
+    for (std::vector<uint32_t>::iterator it = pending.begin();
+         it != pending.end(); ++it) {
+      FunctionSymbol* fn = GetFunction(*it);
+      if (fn && CompleteFunctionGraph(fn)) {
+        // Calls to new functions were found. They are analyzed on the next
+        // pass and this one is linked up to them again after.
+        addresses.push_back(*it);
+      }
+    }
+  } while (addresses.size());
+  return 0;
+}
+
 int SymbolDatabase::FlushQueue() {
+  std::vector<uint32_t> analyzed_addresses;
+  return FlushQueue(analyzed_addresses);
+}
+
+int SymbolDatabase::FlushQueue(std::vector<uint32_t>& analyzed_addresses) {
   while (scan_queue_.size()) {
     FunctionSymbol* fn = scan_queue_.front();
     scan_queue_.pop_front();
+    analyzed_addresses.push_back(fn->start_address);
     if (AnalyzeFunction(fn)) {
       XELOGSDB("Aborting analysis!");
       return 1;
@@ -595,6 +966,147 @@ bool SymbolDatabase::IsRestGprLr(uint32_t addr) {
   return fn && (fn->flags & FunctionSymbol::kFlagRestGprLr);
 }
 
+int SymbolDatabase::FindJumpTable(FunctionSymbol* fn, uint32_t bctr_address,
+                                  std::vector<uint32_t>& targets,
+                                  uint32_t* out_table_address) {
+  // Switch statements are compiled to something like:
+  //   cmplwi  cr6, r11, 5        ; bounds check on the index
+  //   bgt     cr6, default
+  //   lis     r12, table@ha
+  //   rlwinm  r0, r11, 2, 0, 29  ; index * 4
+  //   addi    r12, r12, table@l
+  //   lwzx    r0, r12, r0
+  //   mtctr   r0
+  //   bctr
+  // The instructions may be scheduled differently, so this walks backwards
+  // from the bctr following the registers that feed it. Anything else that
+  // writes one of them means this is not the pattern.
+  const uint32_t kMaxSearch = 16;
+  const uint32_t kMaxCases = 1024;
+  uint8_t* p = xe_memory_addr(memory_, 0);
+
+  uint32_t ctr_reg = 32;
+  uint32_t load_regs[2] = { 32, 32 };
+  uint32_t base_reg = 32;
+  uint32_t index_reg = 32;
+  int32_t base_lo = 0;
+  bool has_base_lo = false;
+  uint32_t table_address = 0;
+  bool has_table = false;
+  uint32_t case_count = 0;
+
+  for (uint32_t n = 1; n <= kMaxSearch && !case_count; n++) {
+    uint32_t addr = bctr_address - n * 4;
+    if (addr < fn->start_address) {
+      break;
+    }
+    InstrData i;
+    i.code = XEGETUINT32BE(p + addr);
+    i.type = ppc::GetInstrType(i.code);
+    i.address = addr;
+    if (!i.type || !i.type->disassemble) {
+      return 1;
+    }
+    InstrDisasm d;
+    if (i.type->disassemble(i, d)) {
+      return 1;
+    }
+    uint64_t writes = d.access_bits.gpr >> 1;
+
+    if (ctr_reg == 32) {
+      // mtctr rS is the first thing that has to be found.
+      if ((i.code & 0xFC1FFFFF) == 0x7C0903A6) {
+        ctr_reg = i.XFX.RT;
+      } else if (d.access_bits.spr & 0x20) {
+        // Something else writes CTR - not a plain switch.
+        return 1;
+      }
+      continue;
+    }
+
+    if (load_regs[0] == 32) {
+      if (writes & (1ull << (ctr_reg * 2))) {
+        // lwzx rS, rA, rB
+        if ((i.code & 0xFC0007FE) != 0x7C00002E || !i.X.RA) {
+          return 1;
+        }
+        load_regs[0] = i.X.RA;
+        load_regs[1] = i.X.RB;
+      }
+      continue;
+    }
+
+    if (index_reg == 32 || !has_table) {
+      for (size_t m = 0; m < XECOUNT(load_regs); m++) {
+        uint32_t reg = load_regs[m];
+        if (reg == 32 || !(writes & (1ull << (reg * 2)))) {
+          continue;
+        }
+        if (i.type->opcode == 0x54000000 && i.M.RA == reg &&
+            i.M.SH == 2 && i.M.MB == 0 && i.M.ME == 29) {
+          // rlwinm rA, rI, 2, 0, 29
+          if (index_reg != 32) {
+            return 1;
+          }
+          index_reg = i.M.RT;
+          load_regs[m] = 32;
+        } else if (i.type->opcode == 0x38000000 && i.D.RT == reg &&
+                   i.D.RA == reg && !has_base_lo) {
+          // addi rA, rA, table@l
+          base_reg = reg;
+          base_lo = XEEXTS16(i.D.DS);
+          has_base_lo = true;
+        } else if (i.type->opcode == 0x3C000000 && i.D.RT == reg &&
+                   !i.D.RA && has_base_lo && reg == base_reg) {
+          // lis rA, table@ha
+          table_address = (i.D.DS << 16) + base_lo;
+          has_table = true;
+          load_regs[m] = 32;
+        } else {
+          return 1;
+        }
+      }
+      if (index_reg != 32 && (writes & (1ull << (index_reg * 2)))) {
+        return 1;
+      }
+      continue;
+    }
+
+    // Finally the bounds check on the index.
+    if (i.type->opcode == 0x28000000 && !(i.D.RT & 1) &&
+        i.D.RA == index_reg) {
+      // cmplwi crN, rI, max
+      case_count = i.D.DS + 1;
+    } else if (writes & (1ull << (index_reg * 2))) {
+      return 1;
+    }
+  }
+  if (!case_count || case_count > kMaxCases) {
+    return 1;
+  }
+
+  // The table may be in any section but must be in guest memory, and all of
+  // the cases have to land in code after the function start.
+  if (table_address < 0x1000 ||
+      (uint64_t)table_address + case_count * 4 >
+          xe_memory_get_length(memory_)) {
+    return 1;
+  }
+  std::vector<uint32_t> cases;
+  for (uint32_t n = 0; n < case_count; n++) {
+    uint32_t target = XEGETUINT32BE(p + table_address + n * 4);
+    if (!IsValueInTextRange(target) || (target & 3) ||
+        target < fn->start_address) {
+      return 1;
+    }
+    cases.push_back(target);
+  }
+
+  targets.swap(cases);
+  *out_table_address = table_address;
+  return 0;
+}
+
 void SymbolDatabase::ReadMap(const char* file_name) {
   std::ifstream infile(file_name);
 
@@ -671,6 +1183,181 @@ void SymbolDatabase::WriteMap(const char* file_name) {
   fclose(file);
 }
 
+uint64_t SymbolDatabase::GetFunctionSignature(FunctionSymbol* fn) {
+  // FNV-1a over the instructions with anything that depends on where the
+  // function was linked masked out: the targets of branches that leave the
+  // function, the immediates of lis, which are usually address halves, and
+  // the low halves that are paired with them. Registers holding a masked
+  // high half are tracked until something else writes them.
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  uint64_t hash = 14695981039346656037ull;
+  uint32_t high_half_gprs = 0;
+  for (uint32_t addr = fn->start_address; addr <= fn->end_address;
+       addr += 4) {
+    uint32_t code = XEGETUINT32BE(p + addr);
+    uint32_t opcode = code >> 26;
+    uint32_t rt = (code >> 21) & 0x1F;
+    uint32_t ra = (code >> 16) & 0x1F;
+    switch (opcode) {
+      case 15:  // addis
+        code &= 0xFFFF0000;
+        break;
+      case 14:  // addi
+      case 32: case 33: case 34: case 35:   // lwz/lwzu/lbz/lbzu
+      case 36: case 37: case 38: case 39:   // stw/stwu/stb/stbu
+      case 40: case 41: case 42: case 43:   // lhz/lhzu/lha/lhau
+      case 44: case 45:                     // sth/sthu
+      case 48: case 49: case 50: case 51:   // lfs/lfsu/lfd/lfdu
+      case 52: case 53: case 54: case 55:   // stfs/stfsu/stfd/stfdu
+        if (ra && (high_half_gprs & (1 << ra))) {
+          code &= 0xFFFF0000;
+        }
+        break;
+      case 58:  // ld/ldu/lwa
+      case 62:  // std/stdu
+        if (ra && (high_half_gprs & (1 << ra))) {
+          code &= 0xFFFF0003;
+        }
+        break;
+      case 24:  // ori
+        if (high_half_gprs & (1 << rt)) {
+          code &= 0xFFFF0000;
+        }
+        break;
+      case 16:  // bc
+      {
+        uint32_t target = XEEXTS16(code & 0xFFFC);
+        if (!(code & 2)) {
+          target += addr;
+        }
+        if ((code & 2) ||
+            target < fn->start_address || target > fn->end_address) {
+          code &= 0xFFFF0003;
+        }
+      }
+        break;
+      case 18:  // b
+      {
+        uint32_t target = addr + XEEXTS26(code & 0x03FFFFFC);
+        if ((code & 2) ||
+            target < fn->start_address || target > fn->end_address) {
+          code &= 0xFC000003;
+        }
+      }
+        break;
+    }
+
+    // Anything that writes a register ends the pairing.
+    InstrData i;
+    i.code = XEGETUINT32BE(p + addr);
+    i.type = ppc::GetInstrType(i.code);
+    i.address = addr;
+    InstrDisasm d;
+    InstrAccessMask access_mask;
+    if (i.type && i.type->disassemble && !i.type->disassemble(i, d) &&
+        !access_mask.Pack(d.access_bits)) {
+      high_half_gprs &= ~access_mask.gpr_writes;
+    } else {
+      high_half_gprs = 0;
+    }
+    if (opcode == 15) {
+      high_half_gprs |= 1 << rt;
+    }
+
+    for (uint32_t n = 0; n < 4; n++) {
+      hash ^= (code >> (n * 8)) & 0xFF;
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+void SymbolDatabase::ReadSignatures(const char* file_name) {
+  // Signatures are listed one per line as [hex hash] [instr count] [name],
+  // in the format written by WriteSignatures.
+  static const struct {
+    const char* name;
+    uint32_t    flag;
+  } natives[] = {
+    { "memcpy", FunctionSymbol::kFlagMemcpy },
+    { "memset", FunctionSymbol::kFlagMemset },
+    { "strlen", FunctionSymbol::kFlagStrlen },
+    { "strcmp", FunctionSymbol::kFlagStrcmp },
+  };
+
+  std::ifstream infile(file_name);
+  if (!infile.is_open()) {
+    XELOGSDB("Unable to open signatures %s", file_name);
+    return;
+  }
+
+  typedef std::pair<uint64_t, uint32_t> SignatureKey;
+  std::map<SignatureKey, std::string> signatures;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::stringstream sstream(line);
+    std::string hash_str;
+    uint32_t instr_count = 0;
+    std::string name;
+    sstream >> hash_str >> instr_count >> name;
+    if (!name.size()) {
+      continue;
+    }
+    uint64_t hash = strtoull(hash_str.c_str(), NULL, 16);
+    signatures.insert(std::pair<SignatureKey, std::string>(
+        SignatureKey(hash, instr_count), name));
+  }
+
+  for (SymbolMap::iterator it = symbols_.begin(); it != symbols_.end(); ++it) {
+    if (it->second->symbol_type != Symbol::Function) {
+      continue;
+    }
+    FunctionSymbol* fn = static_cast<FunctionSymbol*>(it->second);
+    if (fn->type != FunctionSymbol::User ||
+        fn->end_address < fn->start_address) {
+      continue;
+    }
+    uint32_t instr_count = (fn->end_address - fn->start_address) / 4 + 1;
+    std::map<SignatureKey, std::string>::iterator sig_it =
+        signatures.find(SignatureKey(GetFunctionSignature(fn), instr_count));
+    if (sig_it == signatures.end()) {
+      continue;
+    }
+    const char* name = sig_it->second.c_str();
+    XELOGSDB("Matched %.8X as %s", fn->start_address, name);
+    fn->set_name(name);
+    for (size_t n = 0; n < XECOUNT(natives); n++) {
+      if (xestrcmpa(name, natives[n].name) == 0) {
+        fn->flags |= natives[n].flag;
+      }
+    }
+  }
+}
+
+void SymbolDatabase::WriteSignatures(const char* file_name) {
+  // Only functions that were named by a map or the XEX are worth matching.
+  FILE* file = fopen(file_name, "wt");
+  if (!file) {
+    return;
+  }
+  for (SymbolMap::iterator it = symbols_.begin(); it != symbols_.end(); ++it) {
+    if (it->second->symbol_type != Symbol::Function) {
+      continue;
+    }
+    FunctionSymbol* fn = static_cast<FunctionSymbol*>(it->second);
+    if (fn->type != FunctionSymbol::User || !fn->name() ||
+        xestrstra(fn->name(), "sub_") == fn->name() ||
+        fn->end_address < fn->start_address) {
+      continue;
+    }
+    fprintf(file, "%.16llX %d %s\n",
+            (unsigned long long)GetFunctionSignature(fn),
+            (fn->end_address - fn->start_address) / 4 + 1,
+            fn->name());
+  }
+  fclose(file);
+}
+
 void SymbolDatabase::Dump(FILE* file) {
   uint32_t previous = 0;
   for (SymbolMap::iterator it = symbols_.begin(); it != symbols_.end(); ++it) {
@@ -690,6 +1377,11 @@ void SymbolDatabase::Dump(FILE* file) {
                 fn->end_address + 4,
                 fn->end_address - fn->start_address + 4,
                 fn->name() ? fn->name() : "<unknown>");
+        if (fn->type == FunctionSymbol::User) {
+          fprintf(file, "  args r %.8X f %.8X returns r %.8X f %.8X\n",
+                  fn->arg_gprs, fn->arg_fprs,
+                  fn->return_gprs, fn->return_fprs);
+        }
         previous = fn->end_address + 4;
         DumpFunctionBlocks(file, fn);
       }
@@ -739,6 +1431,10 @@ void SymbolDatabase::DumpFunctionBlocks(FILE* file, FunctionSymbol* fn) {
       case FunctionBlock::kTargetCTR:
         fprintf(file, " branch ctr\n");
         break;
+      case FunctionBlock::kTargetJumpTable:
+        fprintf(file, " switch %d cases\n",
+                (uint32_t)block->jump_table.size());
+        break;
       case FunctionBlock::kTargetNone:
         fprintf(file, "\n");
         break;
@@ -31,10 +31,13 @@ public:
   virtual ~SymbolDatabase();
 
   virtual int Analyze();
+  virtual int AnalyzeImports();
 
   Symbol* GetSymbol(uint32_t address);
   ExceptionEntrySymbol* GetOrInsertExceptionEntry(uint32_t address);
   FunctionSymbol* GetOrInsertFunction(uint32_t address);
+  FunctionSymbol* AnalyzeNewFunction(uint32_t address);
+  int ReanalyzeFunction(FunctionSymbol* fn);
   VariableSymbol* GetOrInsertVariable(uint32_t address);
   FunctionSymbol* GetFunction(uint32_t address);
   VariableSymbol* GetVariable(uint32_t address);
@@ -44,6 +47,8 @@ public:
 
   void ReadMap(const char* file_name);
   void WriteMap(const char* file_name);
+  void ReadSignatures(const char* file_name);
+  void WriteSignatures(const char* file_name);
   void Dump(FILE* file);
   void DumpFunctionBlocks(FILE* file, FunctionSymbol* fn);
 
@@ -53,10 +58,18 @@ protected:
 
   int AnalyzeFunction(FunctionSymbol* fn);
   int CompleteFunctionGraph(FunctionSymbol* fn);
+  void AnalyzeRegisterUsage();
+  bool AnalyzeFunctionRegisters(FunctionSymbol* fn);
   bool FillHoles();
+  int CompleteNewFunctionGraphs(uint32_t address);
   int FlushQueue();
+  int FlushQueue(std::vector<uint32_t>& analyzed_addresses);
 
   bool IsRestGprLr(uint32_t addr);
+  uint64_t GetFunctionSignature(FunctionSymbol* fn);
+  int FindJumpTable(FunctionSymbol* fn, uint32_t bctr_address,
+                    std::vector<uint32_t>& targets,
+                    uint32_t* out_table_address);
   virtual uint32_t GetEntryPoint() = 0;
   virtual bool IsValueInTextRange(uint32_t value) = 0;
 
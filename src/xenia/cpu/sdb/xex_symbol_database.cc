@@ -54,6 +54,7 @@ XexSymbolDatabase::XexSymbolDatabase(
     xe_memory_ref memory, ExportResolver* export_resolver, xe_xex2_ref xex) :
     SymbolDatabase(memory, export_resolver) {
   xex_ = xe_xex2_retain(xex);
+  imports_analyzed_ = false;
 }
 
 XexSymbolDatabase::~XexSymbolDatabase() {
@@ -61,15 +62,11 @@ XexSymbolDatabase::~XexSymbolDatabase() {
 }
 
 int XexSymbolDatabase::Analyze() {
-  const xe_xex2_header_t* header = xe_xex2_get_header(xex_);
-
   // Find __savegprlr_* and __restgprlr_*.
   FindGplr();
 
   // Add each import thunk.
-  for (size_t n = 0; n < header->import_library_count; n++) {
-    AddImports(&header->import_libraries[n]);
-  }
+  AnalyzeImports();
 
   // Add each export root.
   // TODO(benvanik): exports.
@@ -83,6 +80,20 @@ int XexSymbolDatabase::Analyze() {
   return SymbolDatabase::Analyze();
 }
 
+int XexSymbolDatabase::AnalyzeImports() {
+  // Loading a cached module analyzes the imports on their own. If the module
+  // turns out to be unusable the full analysis must not add them again.
+  if (imports_analyzed_) {
+    return 0;
+  }
+  const xe_xex2_header_t* header = xe_xex2_get_header(xex_);
+  for (size_t n = 0; n < header->import_library_count; n++) {
+    AddImports(&header->import_libraries[n]);
+  }
+  imports_analyzed_ = true;
+  return 0;
+}
+
 int XexSymbolDatabase::FindGplr() {
   // Special stack save/restore functions.
   // __savegprlr_14 to __savegprlr_31
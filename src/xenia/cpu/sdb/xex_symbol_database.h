@@ -28,6 +28,7 @@ public:
   virtual ~XexSymbolDatabase();
 
   virtual int Analyze();
+  virtual int AnalyzeImports();
 
 private:
   int FindGplr();
@@ -38,6 +39,7 @@ private:
   virtual bool IsValueInTextRange(uint32_t value);
 
   xe_xex2_ref xex_;
+  bool        imports_analyzed_;
 };
 
 
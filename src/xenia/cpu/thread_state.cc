@@ -35,6 +35,9 @@ ThreadState::ThreadState(
   // Set initial registers.
   ppc_state_.r[1] = stack_address_;
   ppc_state_.r[13] = thread_state_address_;
+
+  // No reservation is held to start with.
+  ppc_state_.reserve_address = ~0ull;
 }
 
 ThreadState::~ThreadState() {
@@ -0,0 +1,12 @@
+# REGISTER_IN r4 5
+# REGISTER_IN r5 7
+
+cmpw r4, r5
+cmpw cr7, r5, r4
+cmpw cr3, r4, r4
+mfcr r3
+
+blr
+# REGISTER_OUT r3 0x0000000080020004
+# REGISTER_OUT r4 5
+# REGISTER_OUT r5 7
@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+
+# Copyright 2013 Ben Vanik. All Rights Reserved.
+
+"""Generates a header with a hash of the code generator sources.
+
+The hash is part of the module cache key so that any change to the code
+generator invalidates cached modules, not only changes to exec_module.cc.
+
+Usage:
+  codegen_stamp.py --list [source dir]
+  codegen_stamp.py [output header] [source dir]
+"""
+
+__author__ = 'ben.vanik@gmail.com (Ben Vanik)'
+
+
+import hashlib
+import os
+import sys
+
+
+def list_sources(path):
+  """Lists all source files under the given path in a stable order.
+
+  Args:
+    path: Directory to search.
+
+  Returns:
+    A sorted list of .h/.cc/.c file paths with forward slashes.
+  """
+  sources = []
+  for root, dirs, files in os.walk(path):
+    dirs.sort()
+    for file_name in sorted(files):
+      if os.path.splitext(file_name)[1] in ('.h', '.cc', '.c'):
+        sources.append(os.path.join(root, file_name).replace('\\', '/'))
+  return sources
+
+
+def main():
+  if len(sys.argv) != 3:
+    print 'usage: codegen_stamp.py --list|[output header] [source dir]'
+    return 1
+
+  sources = list_sources(sys.argv[2])
+  if sys.argv[1] == '--list':
+    for source in sources:
+      print source
+    return 0
+
+  sha1 = hashlib.sha1()
+  for source in sources:
+    sha1.update(source)
+    with open(source, 'rb') as f:
+      sha1.update(f.read())
+  header = (
+      '// Generated by tools/build/codegen_stamp.py. Do not edit.\n'
+      '#define XE_CODEGEN_STAMP "%s"\n' % (sha1.hexdigest()))
+
+  # Only touch the file when the stamp changes so that dependents are not
+  # rebuilt needlessly.
+  output_path = sys.argv[1]
+  if os.path.exists(output_path):
+    with open(output_path, 'r') as f:
+      if f.read() == header:
+        return 0
+  output_dir = os.path.dirname(output_path)
+  if output_dir and not os.path.isdir(output_dir):
+    os.makedirs(output_dir)
+  with open(output_path, 'w') as f:
+    f.write(header)
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/xenia.h>
+
+#include <gflags/gflags.h>
+
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::kernel;
+
+
+DECLARE_bool(cache_modules);
+DECLARE_bool(lazy_function_generation);
+DECLARE_bool(tiered_compilation);
+DECLARE_bool(interpreter);
+DECLARE_bool(profile_instrumentation);
+DECLARE_bool(trace_instructions);
+DECLARE_bool(trace_user_calls);
+DECLARE_bool(trace_kernel_calls);
+DECLARE_bool(protect_code);
+DECLARE_bool(abort_before_entry);
+
+
+// Loads a module the same way xenia-run does, which analyzes and generates
+// all of its code and writes the result to the module cache, and then exits
+// before anything runs. Later runs with --cache_modules (and the same codegen
+// flags) load the cached module instead of generating it.
+// The cache holds optimized bitcode, not machine code, so those runs skip
+// analysis, IR generation and optimization but still pay for the JIT
+// turning the module into machine code.
+class AheadOfTime {
+public:
+  AheadOfTime();
+  ~AheadOfTime();
+
+  int Setup();
+  int Compile(const xechar_t* path);
+
+private:
+  xe_pal_ref      pal_;
+  xe_memory_ref   memory_;
+  shared_ptr<Processor> processor_;
+  shared_ptr<Runtime>   runtime_;
+};
+
+AheadOfTime::AheadOfTime() {
+}
+
+AheadOfTime::~AheadOfTime() {
+  xe_memory_release(memory_);
+  xe_pal_release(pal_);
+}
+
+int AheadOfTime::Setup() {
+  xe_pal_options_t pal_options;
+  xe_zero_struct(&pal_options, sizeof(pal_options));
+  pal_ = xe_pal_create(pal_options);
+  XEEXPECTNOTNULL(pal_);
+
+  xe_memory_options_t memory_options;
+  xe_zero_struct(&memory_options, sizeof(memory_options));
+  memory_ = xe_memory_create(pal_, memory_options);
+  XEEXPECTNOTNULL(memory_);
+
+  processor_ = shared_ptr<Processor>(new Processor(pal_, memory_));
+  XEEXPECTZERO(processor_->Setup());
+
+  runtime_ = shared_ptr<Runtime>(new Runtime(pal_, processor_, XT("")));
+
+  return 0;
+XECLEANUP:
+  return 1;
+}
+
+int AheadOfTime::Compile(const xechar_t* path) {
+  xechar_t abs_path[XE_MAX_PATH];
+  xe_path_get_absolute(path, abs_path, XECOUNT(abs_path));
+
+  const xechar_t* dot = xestrrchr(abs_path, '.');
+  if (!dot) {
+    XELOGE("Invalid input path; no extension found");
+    return 1;
+  }
+
+  // Only complete modules can be cached. Anything that generates code at
+  // runtime or embeds host pointers has to be turned off.
+  FLAGS_cache_modules = true;
+  FLAGS_lazy_function_generation = false;
+  FLAGS_tiered_compilation = false;
+  FLAGS_interpreter = false;
+  FLAGS_profile_instrumentation = false;
+  FLAGS_trace_instructions = false;
+  FLAGS_trace_user_calls = false;
+  FLAGS_trace_kernel_calls = false;
+  FLAGS_abort_before_entry = true;
+
+  // Go through the normal launch so that the module gets the same name and
+  // memory layout (and so the same cache key) as when it is run.
+  if (xestrcmp(dot, XT(".xex")) == 0) {
+    return runtime_->LaunchXexFile(abs_path);
+  } else {
+    return runtime_->LaunchDiscImage(abs_path);
+  }
+}
+
+int xenia_aot(int argc, xechar_t **argv) {
+  int result_code = 1;
+
+  // Grab path.
+  if (argc < 2) {
+    google::ShowUsageWithFlags("xenia-aot");
+    return 1;
+  }
+  const xechar_t *path = argv[1];
+
+  auto_ptr<AheadOfTime> aot = auto_ptr<AheadOfTime>(new AheadOfTime());
+
+  result_code = aot->Setup();
+  XEEXPECTZERO(result_code);
+
+  result_code = aot->Compile(path);
+  XEEXPECTZERO(result_code);
+
+  result_code = 0;
+XECLEANUP:
+  return result_code;
+}
+XE_MAIN_THUNK(xenia_aot, "xenia-aot some.xex");
@@ -21,6 +21,12 @@ using namespace xe::kernel;
 
 DEFINE_string(test_path, "test/codegen/",
     "Directory scanned for test files.");
+DEFINE_bool(test_interpreter, true,
+    "Also runs each test through the interpreter tier.");
+
+DECLARE_bool(lazy_function_generation);
+DECLARE_bool(interpreter);
+DECLARE_int32(interpreter_threshold);
 
 
 typedef vector<pair<string, string> > annotations_list_t;
@@ -98,9 +104,20 @@ int check_test_results(xe_memory_ref memory, Processor* processor,
   return any_failed;
 }
 
-int run_test(xe_pal_ref pal, string& src_file_path) {
+int run_test(xe_pal_ref pal, string& src_file_path, bool interpret) {
   int result_code = 1;
 
+  // When interpreting the threshold is never reached, so nothing is ever
+  // generated and every instruction goes through the interpreter.
+  bool old_lazy_function_generation = FLAGS_lazy_function_generation;
+  bool old_interpreter = FLAGS_interpreter;
+  int32_t old_interpreter_threshold = FLAGS_interpreter_threshold;
+  if (interpret) {
+    FLAGS_lazy_function_generation = true;
+    FLAGS_interpreter = true;
+    FLAGS_interpreter_threshold = INT_MAX;
+  }
+
   // test.s -> test.bin
   string bin_file_path;
   size_t dot = src_file_path.find_last_of(".s");
@@ -151,6 +168,9 @@ XECLEANUP:
   runtime.reset();
   processor.reset();
   xe_memory_release(memory);
+  FLAGS_lazy_function_generation = old_lazy_function_generation;
+  FLAGS_interpreter = old_interpreter;
+  FLAGS_interpreter_threshold = old_interpreter_threshold;
   return result_code;
 }
 
@@ -209,13 +229,24 @@ int run_tests(const xechar_t* test_name) {
     }
 
     printf("Running %s...\n", (*it).c_str());
-    if (run_test(pal, *it)) {
+    if (run_test(pal, *it, false)) {
       printf("TEST FAILED\n");
       failed_count++;
     } else {
       printf("Passed\n");
       passed_count++;
     }
+
+    if (FLAGS_test_interpreter) {
+      printf("Running %s (interpreter)...\n", (*it).c_str());
+      if (run_test(pal, *it, true)) {
+        printf("TEST FAILED\n");
+        failed_count++;
+      } else {
+        printf("Passed\n");
+        passed_count++;
+      }
+    }
   }
 
   printf("\n");
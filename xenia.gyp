@@ -70,6 +70,28 @@
         '.',
         'src/',
         '<(llvm_includedir)',
+        '<(SHARED_INTERMEDIATE_DIR)',
+      ],
+
+      # Hash of the code generator sources. Part of the module cache key so
+      # that codegen changes invalidate cached modules.
+      'actions': [
+        {
+          'action_name': 'codegen_stamp',
+          'inputs': [
+            'tools/build/codegen_stamp.py',
+            '<!@(python tools/build/codegen_stamp.py --list src/xenia/cpu/)',
+          ],
+          'outputs': [
+            '<(SHARED_INTERMEDIATE_DIR)/xenia/cpu/codegen_stamp.h',
+          ],
+          'action': [
+            'python',
+            'tools/build/codegen_stamp.py',
+            '<(SHARED_INTERMEDIATE_DIR)/xenia/cpu/codegen_stamp.h',
+            'src/xenia/cpu/',
+          ],
+        },
       ],
 
       'includes': [